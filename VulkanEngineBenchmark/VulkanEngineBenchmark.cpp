@@ -0,0 +1,1343 @@
+﻿// VulkanEngineBenchmark.cpp : 无窗口基准测试。按场景运行渲染器并输出 JSON 报告，用于对比不同版本之间的性能回归。
+//
+// 用法 : VulkanEngineBenchmark.exe [--scenario all|frames|upload|pipeline|shader|instancing|indirect|gpu_cull|compute|render_graph|textures|bindless|descriptors] [--frames N] [--draws M]
+//                                  [--warmup W] [--reps R] [--upload-mb S] [--width X] [--height Y] [--pipeline-stats] [--position-only] [--depth-prepass] [--mesh path.vmesh]
+//                                  [--meshlets] [--mesh-shader] [--instances N] [--instance-frames F] [--draw-list D] [--cull-objects C]
+//                                  [--compute-elements E] [--textures T] [--texture-size S] [--texture-budget-mb B] [--texture-frames F]
+//                                  [--texture-dir D] [--descriptor-sets N] [--descriptor-frames F] [--out path]
+// 工作目录需要包含 shader 文件夹（与 VulkanEngineTest 相同）
+//
+// 模拟预处理头
+#include "VulkanMemoryAllocator/VmaUsage.h"
+
+#include <iostream>
+#include <format>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "VulkanBase/VulkanBase.h"
+#include "VulkanBase/Vertex.h"
+#include "VulkanBase/ShaderCompiler.h"
+#include "VulkanBase/FrameProfiler.h"
+#include "VulkanBase/Tracer.h"
+#include "VulkanBase/Logger.h"
+#include "VulkanBase/MemoryTracker.h"
+
+struct BenchmarkOptions
+{
+    std::string Scenario = "all";
+    uint32_t Frames = 1000;
+    uint32_t Draws = 1;
+    uint32_t Warmup = 100;
+    uint32_t Repetitions = 5;
+    uint32_t UploadMB = 64;
+    uint32_t Width = 1280;
+    uint32_t Height = 720;
+    bool PipelineStatistics = false;
+    bool PositionOnly = false;
+    // 帧场景先画只写深度的预通道，主通道以 EQUAL 测试着色
+    bool DepthPrepass = false;
+    // 为空时使用内置网格
+    std::string Mesh;
+    // 网格簇渲染（需要带簇数据的网格）；MeshShader 时改用网格着色器绘制
+    bool Meshlets = false;
+    bool MeshShader = false;
+    // 实例化压力测试：实例数与每种模式的帧数（逐实例绘制模式很慢，帧数单独设置）
+    uint32_t Instances = 1000000;
+    uint32_t InstanceFrames = 100;
+    // 间接绘制场景的绘制数（每个绘制一个物体，帧数同 InstanceFrames）
+    uint32_t DrawList = 10000;
+    // GPU 剔除场景的物体数
+    uint32_t CullObjects = 100000;
+    // 计算场景（向量加法）的元素数
+    uint32_t ComputeElements = 1u << 22;
+    // 纹理流式加载场景：纹理数、边长、显存预算与帧数
+    uint32_t Textures = 32;
+    uint32_t TextureSize = 1024;
+    uint32_t TextureBudgetMB = 64;
+    uint32_t TextureFrames = 300;
+    // 非空时加载该目录下的纹理（如烘焙好的 .ktx2），代替生成的测试纹理；显示尺寸仍按 TextureSize
+    std::string TextureDir;
+    // 描述符场景：每帧分配的集数与帧数
+    uint32_t DescriptorSets = 10000;
+    uint32_t DescriptorFrames = 100;
+    std::string Output = "benchmark_results.json";
+};
+
+struct SampleStats
+{
+    double MinMs = 0.0;
+    double MeanMs = 0.0;
+    double P50Ms = 0.0;
+    double P95Ms = 0.0;
+    double P99Ms = 0.0;
+    double MaxMs = 0.0;
+};
+
+static SampleStats Summarize(std::vector<double> samples)
+{
+    SampleStats stats;
+    if (samples.empty())
+        return stats;
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+        size_t index = size_t(p * double(samples.size() - 1) + 0.5);
+        return samples[std::min(index, samples.size() - 1)];
+        };
+    double sum = 0.0;
+    for (double sample : samples)
+        sum += sample;
+
+    stats.MinMs = samples.front();
+    stats.MeanMs = sum / double(samples.size());
+    stats.P50Ms = percentile(0.50);
+    stats.P95Ms = percentile(0.95);
+    stats.P99Ms = percentile(0.99);
+    stats.MaxMs = samples.back();
+    return stats;
+}
+
+static std::string StatsJson(const SampleStats& stats)
+{
+    return std::format("{{ \"min_ms\": {:.4f}, \"mean_ms\": {:.4f}, \"p50_ms\": {:.4f}, \"p95_ms\": {:.4f}, \"p99_ms\": {:.4f}, \"max_ms\": {:.4f} }}",
+        stats.MinMs, stats.MeanMs, stats.P50Ms, stats.P95Ms, stats.P99Ms, stats.MaxMs);
+}
+
+static double ElapsedMs(std::chrono::steady_clock::time_point begin)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+static bool ParseOptions(int argc, char** argv, BenchmarkOptions& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        auto nextUint = [&](uint32_t& value) -> bool {
+            const char* text = next();
+            if (!text) return false;
+            value = uint32_t(std::strtoul(text, nullptr, 10));
+            return true;
+            };
+
+        bool ok = true;
+        if (arg == "--scenario")        { const char* text = next(); ok = text != nullptr; if (text) options.Scenario = text; }
+        else if (arg == "--frames")     ok = nextUint(options.Frames);
+        else if (arg == "--draws")      ok = nextUint(options.Draws);
+        else if (arg == "--warmup")     ok = nextUint(options.Warmup);
+        else if (arg == "--reps")       ok = nextUint(options.Repetitions);
+        else if (arg == "--upload-mb")  ok = nextUint(options.UploadMB);
+        else if (arg == "--width")      ok = nextUint(options.Width);
+        else if (arg == "--height")     ok = nextUint(options.Height);
+        else if (arg == "--pipeline-stats") options.PipelineStatistics = true;
+        else if (arg == "--position-only") options.PositionOnly = true;
+        else if (arg == "--depth-prepass") options.DepthPrepass = true;
+        else if (arg == "--mesh")       { const char* text = next(); ok = text != nullptr; if (text) options.Mesh = text; }
+        else if (arg == "--meshlets")   options.Meshlets = true;
+        else if (arg == "--mesh-shader") options.Meshlets = options.MeshShader = true;
+        else if (arg == "--instances")  ok = nextUint(options.Instances);
+        else if (arg == "--instance-frames") ok = nextUint(options.InstanceFrames);
+        else if (arg == "--draw-list")  ok = nextUint(options.DrawList);
+        else if (arg == "--cull-objects") ok = nextUint(options.CullObjects);
+        else if (arg == "--compute-elements") ok = nextUint(options.ComputeElements);
+        else if (arg == "--textures")   ok = nextUint(options.Textures);
+        else if (arg == "--texture-size") ok = nextUint(options.TextureSize);
+        else if (arg == "--texture-budget-mb") ok = nextUint(options.TextureBudgetMB);
+        else if (arg == "--texture-frames") ok = nextUint(options.TextureFrames);
+        else if (arg == "--texture-dir") { const char* text = next(); ok = text != nullptr; if (text) options.TextureDir = text; }
+        else if (arg == "--descriptor-sets") ok = nextUint(options.DescriptorSets);
+        else if (arg == "--descriptor-frames") ok = nextUint(options.DescriptorFrames);
+        else if (arg == "--out")        { const char* text = next(); ok = text != nullptr; if (text) options.Output = text; }
+        else ok = false;
+
+        if (!ok)
+        {
+            std::cout << std::format("ERROR : [ Benchmark ] invalid argument : {}\n", arg);
+            return false;
+        }
+    }
+    options.Repetitions = std::max(options.Repetitions, 1u);
+    return true;
+}
+
+// 与 VulkanEngineTest 主循环相同的一帧
+static bool RunFrame(uint32_t& frameIndex)
+{
+    auto& base = VulkanBase::Base();
+    base.WaitForFence(frameIndex);
+    if (int res = base.AcquireNextImage(frameIndex))
+        return res == -1;
+    base.ResetCommandBuffer();
+    base.RecordCommandBuffer(frameIndex);
+    if (!base.SubmitCommandBuffer(frameIndex))
+        return false;
+    base.Present(frameIndex);
+    FrameProfiler::Get().EndFrame();
+    return true;
+}
+
+// GPU 分析器自上次调用以来回收到了新一帧的结果时返回 true。还没有结果时不取样（避免取到 0），同一帧的结果也不重复取
+static bool TakeGpuResult(uint64_t& collected)
+{
+    uint64_t count = VulkanBase::Base().GetGpuProfiler().GetCollectedFrameCount();
+    if (count == collected)
+        return false;
+    collected = count;
+    return true;
+}
+
+static void SampleGpuZone(const char* zone, std::vector<double>& samples)
+{
+    double ms = 0.0;
+    if (VulkanBase::Base().GetGpuProfiler().FindLastZoneMs(zone, ms))
+        samples.push_back(ms);
+}
+
+static std::string MemoryJson()
+{
+    // 各堆的预算 / 用量以及引擎分类统计
+    MemoryTracker::Get().Update();
+    return MemoryTracker::Get().ToJson();
+}
+
+static std::string RunFrameScenario(const BenchmarkOptions& options)
+{
+    std::cout << std::format("INFO : [ Benchmark ] frames : {} frames x {} draws, {} reps\n", options.Frames, options.Draws, options.Repetitions);
+
+    auto& base = VulkanBase::Base();
+    base.SetDrawCount(options.Draws);
+    base.GetGpuProfiler().SetPipelineStatisticsEnabled(options.PipelineStatistics);
+    base.SetPositionOnly(options.PositionOnly);
+    base.SetMeshletRendering(options.Meshlets);
+    base.SetMeshShading(options.MeshShader);
+    base.SetDepthPrepass(options.DepthPrepass);
+    if (options.DepthPrepass && !base.IsDepthPrepassSupported())
+        std::cout << std::format("WARNING : [ Benchmark ] depth prepass needs Vulkan 1.3, --depth-prepass ignored\n");
+
+    uint32_t frameIndex = 0;
+    for (uint32_t i = 0; i < options.Warmup; ++i)
+        RunFrame(frameIndex);
+    base.WaitIdle();
+    // 预热帧的结果在这里回收掉，之后回收的都是测量的帧
+    base.GetGpuProfiler().CollectAll();
+    uint64_t collected = base.GetGpuProfiler().GetCollectedFrameCount();
+    FrameProfiler::Get().Reset();
+
+    std::vector<double> gpuMs;
+    std::vector<double> cullMs;
+    std::vector<double> prepassMs;
+    std::vector<double> repFps;
+    for (uint32_t rep = 0; rep < options.Repetitions; ++rep)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        uint32_t frames = 0;
+        for (; frames < options.Frames; ++frames)
+        {
+            if (!RunFrame(frameIndex))
+                break;
+            if (!TakeGpuResult(collected))
+                continue;
+            SampleGpuZone("MainPass", gpuMs);
+            if (options.Meshlets)
+                SampleGpuZone("MeshletCull", cullMs);
+            if (options.DepthPrepass)
+                SampleGpuZone("DepthPrepass", prepassMs);
+        }
+        base.WaitIdle();
+        // 提前退出时按实际跑完的帧数计算
+        if (frames > 0)
+            repFps.push_back(frames / (ElapsedMs(begin) / 1000.0));
+    }
+    base.SetDrawCount(1);
+    base.GetGpuProfiler().SetPipelineStatisticsEnabled(false);
+
+    auto& meshletRenderer = base.GetMeshletRenderer();
+    std::string meshlets = std::format("{{ \"enabled\": {}, \"mesh_shader\": {}, \"total\": {}, \"visible\": {}, \"gpu_cull\": {} }}",
+        base.IsMeshletRendering() && meshletRenderer.HasMesh() ? "true" : "false",
+        base.IsMeshShading() && base.IsMeshShaderSupported() ? "true" : "false",
+        meshletRenderer.GetMeshletCount(), meshletRenderer.GetVisibleMeshletCount(), StatsJson(Summarize(cullMs)));
+    base.SetMeshletRendering(false);
+    base.SetMeshShading(false);
+    // 主通道的片元着色次数见 pipeline_statistics（--pipeline-stats）
+    std::string depthPrepass = std::format("{{ \"enabled\": {}, \"gpu\": {} }}",
+        options.DepthPrepass && base.IsDepthPrepassSupported() ? "true" : "false", StatsJson(Summarize(prepassMs)));
+    base.SetDepthPrepass(false);
+
+    auto& profiler = FrameProfiler::Get();
+    auto frame = profiler.GetPhaseHistogram(FrameProfiler::PHASE_FRAME).GetSummary();
+
+    std::string phases;
+    for (uint32_t i = 0; i < FrameProfiler::PHASE_COUNT; ++i)
+    {
+        auto phase = FrameProfiler::Phase(i);
+        if (phase == FrameProfiler::PHASE_FRAME || phase == FrameProfiler::PHASE_POLL_EVENTS)
+            continue;
+        auto summary = profiler.GetPhaseHistogram(phase).GetSummary();
+        phases += std::format("{}\"{}\": {{ \"mean_ms\": {:.4f}, \"p50_ms\": {:.4f}, \"p99_ms\": {:.4f}, \"max_ms\": {:.4f} }}",
+            phases.empty() ? "" : ", ", FrameProfiler::PhaseName(phase), summary.MeanMs, summary.P50Ms, summary.P99Ms, summary.MaxMs);
+    }
+
+    std::string counters;
+    for (uint32_t i = 0; i < FrameProfiler::COUNTER_COUNT; ++i)
+    {
+        auto counter = FrameProfiler::Counter(i);
+        auto summary = profiler.GetCounterSummary(counter);
+        counters += std::format("{}\"{}\": {{ \"mean_per_frame\": {:.1f}, \"max_per_frame\": {} }}",
+            counters.empty() ? "" : ", ", FrameProfiler::CounterName(counter), summary.Mean, summary.Max);
+    }
+
+    std::string statistics;
+    for (auto& pass : profiler.GetPipelineStatistics())
+    {
+        statistics += std::format("{}{{ \"pass\": \"{}\", \"ia_primitives\": {}, \"vs_invocations\": {}, \"clipping_primitives\": {}, \"fs_invocations\": {}, \"cs_invocations\": {} }}",
+            statistics.empty() ? "" : ", ", pass.Pass ? pass.Pass : "", pass.InputAssemblyPrimitives, pass.VertexShaderInvocations,
+            pass.ClippingPrimitives, pass.FragmentShaderInvocations, pass.ComputeShaderInvocations);
+    }
+
+    std::string fps;
+    for (double value : repFps)
+        fps += std::format("{}{:.2f}", fps.empty() ? "" : ", ", value);
+
+    return std::format(
+        "{{ \"frames\": {}, \"draws\": {}, \"repetitions\": {}, \"warmup\": {}, \"position_only\": {}, \"triangles_per_draw\": {},\n"
+        "      \"frame_time\": {{ \"count\": {}, \"mean_ms\": {:.4f}, \"p50_ms\": {:.4f}, \"p95_ms\": {:.4f}, \"p99_ms\": {:.4f}, \"max_ms\": {:.4f}, \"hitches\": {} }},\n"
+        "      \"gpu_main_pass\": {},\n"
+        "      \"meshlets\": {},\n"
+        "      \"depth_prepass\": {},\n"
+        "      \"cpu_phases\": {{ {} }},\n"
+        "      \"counters\": {{ {} }},\n"
+        "      \"pipeline_statistics\": [{}],\n"
+        "      \"fps_per_rep\": [{}],\n"
+        "      \"memory\": {} }}",
+        options.Frames, options.Draws, options.Repetitions, options.Warmup, options.PositionOnly ? "true" : "false", VulkanBase::Base().GetIndexCount() / 3,
+        frame.Count, frame.MeanMs, frame.P50Ms, frame.P95Ms, frame.P99Ms, frame.MaxMs, profiler.GetHitchCount(),
+        StatsJson(Summarize(gpuMs)), meshlets, depthPrepass, phases, counters, statistics, fps, MemoryJson());
+}
+
+static std::string RunUploadScenario(const BenchmarkOptions& options)
+{
+    std::cout << std::format("INFO : [ Benchmark ] upload : {} MB, {} reps\n", options.UploadMB, options.Repetitions);
+
+    auto& base = VulkanBase::Base();
+    VkDeviceSize size = VkDeviceSize(options.UploadMB) * 1024 * 1024;
+
+    VkBuffer stagingBuffer, deviceBuffer;
+    if (!base.UseVmaCreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer))
+        return "null";
+    if (!base.UseVmaCreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, deviceBuffer))
+    {
+        base.UseVmaDestroyBuffer(stagingBuffer);
+        return "null";
+    }
+
+    std::vector<char> source(size_t(size), 0x5a);
+    std::vector<double> totalMs, copyMs;
+    for (uint32_t rep = 0; rep < options.Warmup / 10 + options.Repetitions; ++rep)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        void* data = nullptr;
+        if (!base.UseVmaMapBuffer(stagingBuffer, &data))
+            break;
+        memcpy(data, source.data(), source.size());
+        base.UseVmaUnmapBuffer(stagingBuffer);
+
+        auto copyBegin = std::chrono::steady_clock::now();
+        base.CopyBuffer(stagingBuffer, deviceBuffer, size);
+
+        // 前几次作为预热
+        if (rep >= options.Warmup / 10)
+        {
+            copyMs.push_back(ElapsedMs(copyBegin));
+            totalMs.push_back(ElapsedMs(begin));
+        }
+    }
+
+    base.UseVmaDestroyBuffer(deviceBuffer);
+    base.UseVmaDestroyBuffer(stagingBuffer);
+
+    auto total = Summarize(totalMs);
+    auto copy = Summarize(copyMs);
+    double mb = double(options.UploadMB);
+    return std::format("{{ \"size_mb\": {}, \"repetitions\": {}, \"total\": {}, \"gpu_copy\": {}, \"throughput_mb_s\": {:.2f}, \"copy_throughput_mb_s\": {:.2f} }}",
+        options.UploadMB, totalMs.size(), StatsJson(total), StatsJson(copy),
+        total.P50Ms > 0 ? mb / (total.P50Ms / 1000.0) : 0.0, copy.P50Ms > 0 ? mb / (copy.P50Ms / 1000.0) : 0.0);
+}
+
+static std::string RunPipelineScenario(const BenchmarkOptions& options)
+{
+    std::cout << std::format("INFO : [ Benchmark ] pipeline creation : {} reps\n", options.Repetitions);
+
+    auto& base = VulkanBase::Base();
+    base.WaitIdle();
+
+    std::vector<double> samples;
+    for (uint32_t rep = 0; rep < 1 + options.Repetitions; ++rep)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        if (!base.RecreateGraphicsPipeline())
+            return "null";
+        // 第一次包含驱动的冷启动开销，不计入
+        if (rep > 0)
+            samples.push_back(ElapsedMs(begin));
+    }
+    return std::format("{{ \"repetitions\": {}, \"create\": {} }}", samples.size(), StatsJson(Summarize(samples)));
+}
+
+// 实例 / 间接绘制场景共用：短暂预热后跑 InstanceFrames 帧，报告每帧的绘制调用、管线绑定、录制耗时与帧时间。
+// cull_zone 非空时额外报告该 GPU 区段的耗时
+static std::string MeasureSceneMode(const BenchmarkOptions& options, double fill_ms, const char* cull_zone = nullptr)
+{
+    auto& base = VulkanBase::Base();
+    uint32_t frameIndex = 0;
+    for (uint32_t i = 0; i < std::min(options.Warmup, 10u); ++i)
+        RunFrame(frameIndex);
+    base.WaitIdle();
+    base.GetGpuProfiler().CollectAll();
+    uint64_t collected = base.GetGpuProfiler().GetCollectedFrameCount();
+    FrameProfiler::Get().Reset();
+
+    std::vector<double> frameMs;
+    std::vector<double> gpuMs;
+    std::vector<double> cullMs;
+    for (uint32_t i = 0; i < options.InstanceFrames; ++i)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        if (!RunFrame(frameIndex))
+            break;
+        frameMs.push_back(ElapsedMs(begin));
+        if (!TakeGpuResult(collected))
+            continue;
+        SampleGpuZone("MainPass", gpuMs);
+        if (cull_zone)
+            SampleGpuZone(cull_zone, cullMs);
+    }
+    base.WaitIdle();
+
+    auto& profiler = FrameProfiler::Get();
+    auto record = profiler.GetPhaseHistogram(FrameProfiler::PHASE_RECORD_COMMAND_BUFFER).GetSummary();
+    return std::format("{{ \"draw_calls_per_frame\": {:.0f}, \"indirect_draws_per_frame\": {:.0f}, \"pipeline_binds_per_frame\": {:.0f}, \"descriptor_binds_per_frame\": {:.0f}, \"fill_ms\": {:.2f}, \"record_mean_ms\": {:.4f},\n"
+        "        \"frame\": {}, \"gpu_main_pass\": {}{} }}",
+        profiler.GetCounterSummary(FrameProfiler::COUNTER_DRAW_CALLS).Mean, profiler.GetCounterSummary(FrameProfiler::COUNTER_INDIRECT_DRAWS).Mean,
+        profiler.GetCounterSummary(FrameProfiler::COUNTER_PIPELINE_BINDS).Mean, profiler.GetCounterSummary(FrameProfiler::COUNTER_DESCRIPTOR_BINDS).Mean, fill_ms, record.MeanMs, StatsJson(Summarize(frameMs)), StatsJson(Summarize(gpuMs)),
+        cull_zone ? std::format(",\n        \"gpu_cull\": {}", StatsJson(Summarize(cullMs))) : std::string());
+}
+
+// 同一批四边形分别按“每个实例一次绘制”和“按网格 + 管线分组的实例化绘制”提交，对比绘制调用数与帧时间
+static std::string RunInstancingScenario(const BenchmarkOptions& options)
+{
+    std::cout << std::format("INFO : [ Benchmark ] instancing : {} instances, {} frames per mode\n", options.Instances, options.InstanceFrames);
+
+    auto& base = VulkanBase::Base();
+    auto& batcher = base.GetInstanceBatcher();
+    auto mesh = base.GetMeshRange();
+
+    // 铺满 [-1, 1]^2 的网格，相邻实例交替使用两条管线，逐实例绘制时每次都要切换管线
+    uint32_t side = std::max(1u, uint32_t(std::ceil(std::sqrt(double(options.Instances)))));
+    float scale = 2.0f / float(side);
+    auto fill = [&]() {
+        batcher.Clear();
+        batcher.Reserve(options.Instances);
+        for (uint32_t i = 0; i < options.Instances; ++i)
+        {
+            uint32_t x = i % side;
+            uint32_t y = i / side;
+            glm::mat4 transform(scale);
+            transform[3] = glm::vec4(-1.0f + (float(x) + 0.5f) * scale, -1.0f + (float(y) + 0.5f) * scale, 0.0f, 1.0f);
+            glm::vec4 color(float(x) / float(side), float(y) / float(side), 0.5f, 1.0f);
+            uint32_t pipeline = (i & 1) ? VulkanBase::DRAW_PIPELINE_POSITION_ONLY : VulkanBase::DRAW_PIPELINE_COLOR;
+            batcher.Add(mesh, pipeline, PackInstance(transform, color, i & 7));
+        }
+        };
+
+    std::string modes;
+    for (bool grouping : { false, true })
+    {
+        batcher.SetGrouping(grouping);
+        auto fillBegin = std::chrono::steady_clock::now();
+        fill();
+        double fillMs = ElapsedMs(fillBegin);
+
+        modes += std::format("{}\"{}\": {}", modes.empty() ? "" : ",\n      ", grouping ? "grouped" : "per_instance", MeasureSceneMode(options, fillMs));
+    }
+    batcher.Clear();
+    batcher.SetGrouping(true);
+
+    return std::format("{{ \"instances\": {}, \"frames\": {}, \"instance_bytes\": {},\n      {} }}",
+        options.Instances, options.InstanceFrames, sizeof(InstanceData), modes);
+}
+
+// 同一批物体分别按“每个物体一次 vkCmdDrawIndexed”（实例列表、不分组）和“CPU 构建的间接绘制列表、每条管线一次多重间接绘制”提交
+static std::string RunIndirectScenario(const BenchmarkOptions& options)
+{
+    std::cout << std::format("INFO : [ Benchmark ] indirect : {} draws, {} frames per mode\n", options.DrawList, options.InstanceFrames);
+
+    auto& base = VulkanBase::Base();
+    auto& batcher = base.GetInstanceBatcher();
+    auto& drawList = base.GetDrawList();
+    auto mesh = base.GetMeshRange();
+
+    uint32_t side = std::max(1u, uint32_t(std::ceil(std::sqrt(double(options.DrawList)))));
+    float scale = 2.0f / float(side);
+    auto object = [&](uint32_t i, glm::mat4& transform, glm::vec4& color) {
+        uint32_t x = i % side;
+        uint32_t y = i / side;
+        transform = glm::mat4(scale);
+        transform[3] = glm::vec4(-1.0f + (float(x) + 0.5f) * scale, -1.0f + (float(y) + 0.5f) * scale, 0.0f, 1.0f);
+        color = glm::vec4(float(x) / float(side), float(y) / float(side), 0.5f, 1.0f);
+        return (i & 1) ? VulkanBase::DRAW_PIPELINE_POSITION_ONLY : VulkanBase::DRAW_PIPELINE_COLOR;
+        };
+
+    std::string modes;
+    for (bool indirect : { false, true })
+    {
+        batcher.Clear();
+        drawList.Clear();
+        batcher.SetGrouping(false);
+
+        auto fillBegin = std::chrono::steady_clock::now();
+        glm::mat4 transform;
+        glm::vec4 color;
+        if (indirect)
+        {
+            drawList.Reserve(options.DrawList);
+            for (uint32_t i = 0; i < options.DrawList; ++i)
+            {
+                uint32_t pipeline = object(i, transform, color);
+                drawList.Add(mesh, pipeline, PackDrawData(transform, color, i & 7));
+            }
+        }
+        else
+        {
+            batcher.Reserve(options.DrawList);
+            for (uint32_t i = 0; i < options.DrawList; ++i)
+            {
+                uint32_t pipeline = object(i, transform, color);
+                batcher.Add(mesh, pipeline, PackInstance(transform, color, i & 7));
+            }
+        }
+        double fillMs = ElapsedMs(fillBegin);
+
+        modes += std::format("{}\"{}\": {}", modes.empty() ? "" : ",\n      ", indirect ? "indirect" : "direct", MeasureSceneMode(options, fillMs));
+    }
+    batcher.Clear();
+    batcher.SetGrouping(true);
+    drawList.Clear();
+
+    return std::format("{{ \"draws\": {}, \"frames\": {}, \"draw_data_bytes\": {},\n      {} }}",
+        options.DrawList, options.InstanceFrames, sizeof(DrawData), modes);
+}
+
+// 铺在相机周围大片区域上的物体，大部分落在视锥之外：先全部提交（不剔除），再每帧在 GPU 上剔除后只画可见的
+static std::string RunGpuCullScenario(const BenchmarkOptions& options)
+{
+    std::cout << std::format("INFO : [ Benchmark ] gpu cull : {} objects, {} frames per mode\n", options.CullObjects, options.InstanceFrames);
+
+    auto& base = VulkanBase::Base();
+    auto& drawList = base.GetDrawList();
+    auto mesh = base.GetMeshRange();
+    auto meshBounds = base.GetMeshBounds();
+
+    // z = 0 平面上的 [-8, 8]^2，相机在 (2, 2, 2) 看向原点
+    uint32_t side = std::max(1u, uint32_t(std::ceil(std::sqrt(double(options.CullObjects)))));
+    float spacing = 16.0f / float(side);
+    auto fillBegin = std::chrono::steady_clock::now();
+    drawList.Clear();
+    drawList.Reserve(options.CullObjects);
+    for (uint32_t i = 0; i < options.CullObjects; ++i)
+    {
+        uint32_t x = i % side;
+        uint32_t y = i / side;
+        glm::mat4 transform(spacing * 0.5f);
+        transform[3] = glm::vec4(-8.0f + (float(x) + 0.5f) * spacing, -8.0f + (float(y) + 0.5f) * spacing, 0.0f, 1.0f);
+        glm::vec4 color(float(x) / float(side), float(y) / float(side), 0.5f, 1.0f);
+        uint32_t pipeline = (i & 1) ? VulkanBase::DRAW_PIPELINE_POSITION_ONLY : VulkanBase::DRAW_PIPELINE_COLOR;
+        drawList.Add(mesh, pipeline, PackDrawData(transform, color, i & 7), TransformBounds(transform, meshBounds));
+    }
+    double fillMs = ElapsedMs(fillBegin);
+
+    // 图形队列上剔除 vs 异步计算队列上剔除（异步时剔除不在图形队列的 GPU 区段里，只比较帧时间与主通道）
+    auto& asyncCompute = base.GetAsyncCompute();
+    std::string modes;
+    for (const char* name : { "no_cull", "gpu_cull", "async_cull" })
+    {
+        bool culling = std::strcmp(name, "no_cull") != 0;
+        bool async = std::strcmp(name, "async_cull") == 0;
+        drawList.SetGpuCulling(culling);
+        asyncCompute.SetEnabled(async);
+        if (culling && !drawList.IsGpuCulling())
+        {
+            std::cout << std::format("WARNING : [ Benchmark ] gpu culling is unavailable, skipped\n");
+            break;
+        }
+        if (async && !asyncCompute.IsAvailable())
+        {
+            std::cout << std::format("WARNING : [ Benchmark ] no dedicated compute queue, async_cull skipped\n");
+            break;
+        }
+        std::string mode = MeasureSceneMode(options, fillMs, culling && !async ? "DrawCull" : nullptr);
+        modes += std::format("{}\"{}\": {}", modes.empty() ? "" : ",\n      ", name, mode);
+    }
+    uint32_t visible = drawList.IsGpuCulling() ? drawList.GetVisibleDrawCount() : options.CullObjects;
+    asyncCompute.SetEnabled(true);
+    drawList.SetGpuCulling(false);
+    drawList.Clear();
+
+    return std::format("{{ \"objects\": {}, \"frames\": {}, \"visible\": {},\n      {} }}",
+        options.CullObjects, options.InstanceFrames, visible, modes);
+}
+
+static std::string RunComputeScenario(const BenchmarkOptions& options)
+{
+    uint32_t count = std::max(options.ComputeElements, 1u);
+    std::cout << std::format("INFO : [ Benchmark ] compute : {} elements, {} reps\n", count, options.Repetitions);
+
+    auto& base = VulkanBase::Base();
+    auto& compute = base.GetCompute();
+    auto kernel = base.CreateComputeKernel("test", 3, sizeof(uint32_t) * 2);
+    if (kernel == ComputeContext::INVALID_KERNEL)
+    {
+        std::cout << std::format("WARNING : [ Benchmark ] compute kernel is unavailable, skipped\n");
+        return "null";
+    }
+
+    VkDeviceSize size = VkDeviceSize(count) * sizeof(float);
+    std::vector<float> a(count), b(count), expected(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        a[i] = float(i % 1024);
+        b[i] = float(i % 977) * 0.5f;
+    }
+
+    // CPU 基线
+    std::vector<double> cpuMs;
+    for (uint32_t rep = 0; rep < options.Repetitions; ++rep)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < count; ++i)
+            expected[i] = a[i] + b[i];
+        cpuMs.push_back(ElapsedMs(begin));
+    }
+
+    constexpr VkBufferUsageFlags storageUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    std::array<VkBuffer, 3> buffers = { VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE };
+    VkBuffer staging = VK_NULL_HANDLE;
+    bool created = base.UseVmaCreateBuffer(size * 2, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging);
+    for (auto& buffer : buffers)
+        created = created && base.UseVmaCreateBuffer(size, storageUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer);
+    void* mapped = nullptr;
+    created = created && base.UseVmaMapBuffer(staging, &mapped);
+
+    std::string json = "null";
+    if (created)
+    {
+        memcpy(mapped, a.data(), size_t(size));
+        memcpy(static_cast<char*>(mapped) + size, b.data(), size_t(size));
+        compute.CopyBuffer(staging, buffers[0], size, 0);
+        compute.CopyBuffer(staging, buffers[1], size, size);
+        compute.Barrier();
+        compute.Submit().get();
+
+        // 工作组数受设备上限约束，超出部分由着色器按网格步长循环处理
+        uint32_t groupSize = compute.GetGroupSize(kernel)[0];
+        uint32_t groups = std::min((count + groupSize - 1) / groupSize, compute.GetMaxGroupCountX());
+        uint32_t constants[2] = { count, groups * groupSize };
+
+        std::vector<double> submitMs, gpuMs;
+        for (uint32_t rep = 0; rep < options.Warmup / 10 + options.Repetitions; ++rep)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            compute.Dispatch(kernel, { buffers[0], buffers[1], buffers[2] }, groups, 1, 1, constants);
+            compute.Submit().get();
+            if (rep >= options.Warmup / 10)
+            {
+                submitMs.push_back(ElapsedMs(begin));
+                gpuMs.push_back(compute.GetLastBatchGpuMs());
+            }
+        }
+
+        // 结果拷回暂存缓冲，在等待线程上校验，结果通过 future 交付
+        compute.Barrier();
+        compute.CopyBuffer(buffers[2], staging, size);
+        const float* results = static_cast<const float*>(mapped);
+        bool verified = false;
+        try
+        {
+            verified = compute.Submit<bool>([results, &expected, count]() {
+                return std::equal(results, results + count, expected.begin());
+                }).get();
+        }
+        catch (const std::exception& error)
+        {
+            std::cout << std::format("ERROR : [ Benchmark ] compute readback failed : {}\n", error.what());
+        }
+        if (!verified)
+            std::cout << std::format("ERROR : [ Benchmark ] compute results do not match the CPU baseline\n");
+
+        // 许多小调度：每次调度单独提交 vs 合并成一个批次
+        constexpr uint32_t SMALL_DISPATCHES = 1000;
+        uint32_t smallConstants[2] = { std::min(count, groupSize * 4), groupSize * 4 };
+        std::vector<double> separateMs, batchedMs;
+        for (uint32_t rep = 0; rep < options.Repetitions; ++rep)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < SMALL_DISPATCHES; ++i)
+            {
+                compute.Dispatch(kernel, { buffers[0], buffers[1], buffers[2] }, 4, 1, 1, smallConstants);
+                compute.Submit();
+            }
+            compute.WaitIdle();
+            separateMs.push_back(ElapsedMs(begin));
+
+            begin = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < SMALL_DISPATCHES; ++i)
+                compute.Dispatch(kernel, { buffers[0], buffers[1], buffers[2] }, 4, 1, 1, smallConstants);
+            compute.Submit().get();
+            batchedMs.push_back(ElapsedMs(begin));
+        }
+
+        auto cpu = Summarize(cpuMs);
+        auto submit = Summarize(submitMs);
+        auto gpu = Summarize(gpuMs);
+        // 读两个、写一个
+        double gigabytes = double(size) * 3.0 / 1e9;
+        json = std::format("{{ \"elements\": {}, \"group_size\": {}, \"groups\": {}, \"verified\": {},\n"
+            "      \"cpu\": {}, \"gpu_submit\": {}, \"gpu\": {},\n"
+            "      \"cpu_gb_s\": {:.2f}, \"gpu_gb_s\": {:.2f},\n"
+            "      \"small_dispatches\": {}, \"submit_each\": {}, \"batched\": {} }}",
+            count, groupSize, groups, verified, StatsJson(cpu), StatsJson(submit), StatsJson(gpu),
+            cpu.P50Ms > 0 ? gigabytes / (cpu.P50Ms / 1000.0) : 0.0, gpu.P50Ms > 0 ? gigabytes / (gpu.P50Ms / 1000.0) : 0.0,
+            SMALL_DISPATCHES, StatsJson(Summarize(separateMs)), StatsJson(Summarize(batchedMs)));
+    }
+    else
+    {
+        std::cout << std::format("ERROR : [ Benchmark ] failed to create compute buffers\n");
+    }
+
+    compute.WaitIdle();
+    if (mapped)
+        base.UseVmaUnmapBuffer(staging);
+    for (auto buffer : buffers)
+        if (buffer)
+            base.UseVmaDestroyBuffer(buffer);
+    if (staging)
+        base.UseVmaDestroyBuffer(staging);
+    return json;
+}
+
+static std::string RunRenderGraphScenario(const BenchmarkOptions& options)
+{
+    std::cout << std::format("INFO : [ Benchmark ] render graph : {} reps\n", options.Repetitions);
+
+    auto& base = VulkanBase::Base();
+    base.WaitIdle();
+    VkDevice device = base.GetVkDevice();
+
+    // 合成的延迟渲染帧：GBuffer 的几张图在 Lighting 之后不再使用，Bloom 与最终输出可以复用它们的显存；Debug 没有被用到，应被剔除
+    RenderGraph graph;
+    graph.Init(device, VulkanBase::GetVmaAllocator(), base.IsSynchronization2Supported());
+    auto declare = [&graph, &options]() {
+        graph.Reset();
+        graph.SetExtent({ options.Width, options.Height });
+        constexpr VkImageUsageFlags colorUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        auto albedo = graph.CreateImage("Albedo", { VK_FORMAT_R8G8B8A8_UNORM, {}, colorUsage });
+        auto normal = graph.CreateImage("Normal", { VK_FORMAT_R16G16B16A16_SFLOAT, {}, colorUsage });
+        auto depth = graph.CreateImage("Depth", { VK_FORMAT_D32_SFLOAT, {}, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT });
+        auto ao = graph.CreateImage("AO", { VK_FORMAT_R8_UNORM, {}, colorUsage });
+        auto hdr = graph.CreateImage("HDR", { VK_FORMAT_R16G16B16A16_SFLOAT, {}, colorUsage });
+        auto bloom = graph.CreateImage("Bloom", { VK_FORMAT_R16G16B16A16_SFLOAT, { options.Width / 2, options.Height / 2 }, colorUsage });
+        auto output = graph.CreateImage("Output", { VK_FORMAT_R8G8B8A8_UNORM, {}, colorUsage });
+        auto debug = graph.CreateImage("Debug", { VK_FORMAT_R8G8B8A8_UNORM, {}, colorUsage });
+
+        auto sampled = [](RenderGraph::PassBuilder& pass, RenderGraph::ResourceHandle image) -> RenderGraph::PassBuilder& {
+            return pass.Read(image, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            };
+        auto noop = [](VkCommandBuffer) {};
+        graph.AddPass("GBuffer", noop).WriteColor(albedo).WriteColor(normal).WriteDepth(depth);
+        auto ssao = graph.AddPass("SSAO", noop);
+        sampled(sampled(ssao, normal), depth).WriteColor(ao);
+        auto debugPass = graph.AddPass("Debug", noop);
+        sampled(debugPass, normal).WriteColor(debug);
+        auto lighting = graph.AddPass("Lighting", noop);
+        sampled(sampled(sampled(sampled(lighting, albedo), normal), depth), ao).WriteColor(hdr);
+        auto bloomPass = graph.AddPass("Bloom", noop);
+        sampled(bloomPass, hdr).WriteColor(bloom);
+        auto tonemap = graph.AddPass("Tonemap", noop);
+        sampled(sampled(tonemap, hdr), bloom).WriteColor(output).SideEffects();
+        return graph.Compile();
+        };
+
+    std::vector<double> compileMs;
+    bool compiled = true;
+    for (uint32_t rep = 0; rep < 1 + options.Repetitions && compiled; ++rep)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        compiled = declare();
+        if (rep > 0)
+            compileMs.push_back(ElapsedMs(begin));
+    }
+    if (!compiled)
+    {
+        std::cout << std::format("WARNING : [ Benchmark ] render graph failed to compile, skipped\n");
+        graph.CleanUp();
+        return "null";
+    }
+
+    // 只录制不提交，测量每帧生成屏障的开销
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkCommandPoolCreateInfo poolInfo{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = base.GetQueueFamilyIndices().GraphicsFamily;
+    VkCommandBufferAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    std::vector<double> executeMs;
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) == VK_SUCCESS
+        && (allocInfo.commandPool = commandPool, vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) == VK_SUCCESS))
+    {
+        VkCommandBufferBeginInfo beginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+        for (uint32_t rep = 0; rep < options.Frames; ++rep)
+        {
+            vkBeginCommandBuffer(commandBuffer, &beginInfo);
+            auto begin = std::chrono::steady_clock::now();
+            graph.Execute(commandBuffer);
+            executeMs.push_back(ElapsedMs(begin));
+            vkEndCommandBuffer(commandBuffer);
+        }
+    }
+    if (commandPool)
+        vkDestroyCommandPool(device, commandPool, nullptr);
+
+    const auto& stats = graph.GetStats();
+    std::string order;
+    for (auto& name : graph.GetExecutionOrder())
+        order += std::format("{}\"{}\"", order.empty() ? "" : ", ", name);
+    std::string json = std::format("{{ \"synchronization2\": {}, \"passes\": {}, \"culled_passes\": {}, \"order\": [ {} ],\n"
+        "      \"transient_images\": {}, \"transient_mb\": {:.2f}, \"allocated_mb\": {:.2f},\n"
+        "      \"barrier_calls\": {}, \"image_barriers\": {}, \"memory_barriers\": {},\n"
+        "      \"compile\": {},\n      \"execute\": {} }}",
+        base.IsSynchronization2Supported(), stats.Passes, stats.CulledPasses, order,
+        stats.TransientImages, double(stats.TransientBytes) / (1024.0 * 1024.0), double(stats.AllocatedBytes) / (1024.0 * 1024.0),
+        stats.BarrierCalls, stats.ImageBarriers, stats.MemoryBarriers,
+        StatsJson(Summarize(compileMs)), StatsJson(Summarize(executeMs)));
+    graph.CleanUp();
+    return json;
+}
+
+// 未压缩的 32 位 TGA（左上角为原点），测试纹理不依赖资源文件
+static bool WriteTestTexture(const std::filesystem::path& path, uint32_t size, uint32_t seed)
+{
+    std::vector<uint8_t> data(18 + size_t(size) * size * 4);
+    data[2] = 2;
+    data[12] = uint8_t(size & 0xff);
+    data[13] = uint8_t(size >> 8);
+    data[14] = uint8_t(size & 0xff);
+    data[15] = uint8_t(size >> 8);
+    data[16] = 32;
+    data[17] = 0x28;
+    uint8_t* pixels = data.data() + 18;
+    for (uint32_t y = 0; y < size; ++y)
+    {
+        for (uint32_t x = 0; x < size; ++x)
+        {
+            uint8_t* pixel = pixels + (size_t(y) * size + x) * 4;
+            pixel[0] = uint8_t(x * 255 / size);
+            pixel[1] = uint8_t(y * 255 / size);
+            pixel[2] = uint8_t(((x / 32 + y / 32 + seed) & 1) * 255);
+            pixel[3] = 255;
+        }
+    }
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(data.data()), std::streamsize(data.size()));
+    return file.good();
+}
+
+// --texture-dir 下的纹理（按文件名排序，至多 count 个），未指定时在临时目录生成测试纹理
+static bool CollectTexturePaths(const BenchmarkOptions& options, uint32_t count, uint32_t size, std::vector<std::string>& paths)
+{
+    std::error_code error;
+    if (!options.TextureDir.empty())
+    {
+        for (const auto& entry : std::filesystem::directory_iterator(options.TextureDir, error))
+        {
+            if (entry.is_regular_file())
+                paths.push_back(entry.path().string());
+        }
+        std::sort(paths.begin(), paths.end());
+        if (paths.size() < 2)
+        {
+            std::cout << std::format("WARNING : [ Benchmark ] need at least 2 textures in {}, skipped\n", options.TextureDir);
+            return false;
+        }
+        paths.resize(std::min<size_t>(paths.size(), count));
+        return true;
+    }
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "VulkanEngineBenchmarkTextures";
+    std::filesystem::create_directories(directory, error);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        auto path = directory / std::format("texture_{}_{}.tga", size, i);
+        if (!std::filesystem::exists(path, error) && !WriteTestTexture(path, size, i))
+        {
+            std::cout << std::format("WARNING : [ Benchmark ] failed to write test texture : {}, skipped\n", path.string());
+            return false;
+        }
+        paths.push_back(path.string());
+    }
+    return true;
+}
+
+static std::string RunTextureScenario(const BenchmarkOptions& options)
+{
+    uint32_t count = std::max(options.Textures, 2u);
+    uint32_t size = std::clamp(options.TextureSize, 64u, 8192u);
+    std::cout << std::format("INFO : [ Benchmark ] textures : {} x {}px, budget {} MB, {} frames\n", count, size, options.TextureBudgetMB, options.TextureFrames);
+
+    auto& base = VulkanBase::Base();
+    auto& streamer = base.GetTextureStreamer();
+
+    std::vector<std::string> paths;
+    if (!CollectTexturePaths(options, count, size, paths))
+        return "null";
+    count = uint32_t(paths.size());
+
+    VkDeviceSize previousBudget = streamer.GetBudget();
+    streamer.SetBudget(VkDeviceSize(options.TextureBudgetMB) * 1024 * 1024);
+    auto baseline = streamer.GetStats();
+
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<TextureStreamer::TextureHandle> textures;
+    for (auto& path : paths)
+        textures.push_back(streamer.Load(path));
+
+    // 前一半帧数里前一半纹理按原尺寸显示、其余按 1/8 显示，之后交换，预算不足时触发卸下与换入
+    uint32_t frameIndex = 0;
+    std::vector<double> frameMs;
+    double visibleMs = -1.0, settledMs = -1.0, resettledMs = -1.0;
+    std::chrono::steady_clock::time_point swapBegin;
+    for (uint32_t frame = 0; frame < options.TextureFrames; ++frame)
+    {
+        bool swapped = frame >= options.TextureFrames / 2;
+        if (swapped && frame == options.TextureFrames / 2)
+            swapBegin = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            bool near = (i < count / 2) != swapped;
+            streamer.RequestScreenSize(textures[i], near ? float(size) : float(size) / 8.0f);
+        }
+
+        auto frameBegin = std::chrono::steady_clock::now();
+        if (!RunFrame(frameIndex))
+            break;
+        frameMs.push_back(ElapsedMs(frameBegin));
+
+        if (visibleMs < 0.0 && std::all_of(textures.begin(), textures.end(), [&streamer](auto texture) { return streamer.GetImageView(texture) != VK_NULL_HANDLE; }))
+            visibleMs = ElapsedMs(begin);
+        if (streamer.IsIdle())
+        {
+            if (!swapped && settledMs < 0.0)
+                settledMs = ElapsedMs(begin);
+            if (swapped && resettledMs < 0.0)
+                resettledMs = ElapsedMs(swapBegin);
+        }
+    }
+
+    auto stats = streamer.GetStats();
+    double mb = 1024.0 * 1024.0;
+    std::string json = std::format("{{ \"textures\": {}, \"size\": {}, \"budget_mb\": {}, \"decoded\": {}, \"failures\": {},\n"
+        "      \"decode_ms_total\": {:.2f}, \"decode_ms_per_texture\": {:.3f}, \"first_visible_ms\": {:.2f}, \"settled_ms\": {:.2f}, \"resettled_after_swap_ms\": {:.2f},\n"
+        "      \"uploads\": {}, \"submits\": {}, \"uploaded_mb\": {:.2f}, \"mips_streamed_in\": {}, \"mips_evicted\": {},\n"
+        "      \"gpu_mip_chains\": {}, \"mip_submits\": {},\n"
+        "      \"resident_mb\": {:.2f}, \"source_mb\": {:.2f},\n      \"frame\": {} }}",
+        count, size, options.TextureBudgetMB, stats.Decoded - baseline.Decoded, stats.DecodeFailures - baseline.DecodeFailures,
+        stats.DecodeMs - baseline.DecodeMs, (stats.DecodeMs - baseline.DecodeMs) / double(count), visibleMs, settledMs, resettledMs,
+        stats.Uploads - baseline.Uploads, stats.Submits - baseline.Submits, double(stats.UploadedBytes - baseline.UploadedBytes) / mb,
+        stats.MipsStreamedIn - baseline.MipsStreamedIn, stats.MipsEvicted - baseline.MipsEvicted,
+        stats.MipChainsGenerated - baseline.MipChainsGenerated, stats.MipSubmits - baseline.MipSubmits,
+        double(stats.ResidentBytes) / mb, double(stats.SourceBytes) / mb, StatsJson(Summarize(frameMs)));
+
+    for (auto texture : textures)
+        streamer.Release(texture);
+    streamer.SetBudget(previousBudget);
+    return json;
+}
+
+// 间接绘制列表里每个绘制按 DrawData::TextureIndex 采样不同的纹理（无绑定资源堆），与同样的绘制不采样纹理对比：
+// 两种模式每帧都只绑定一次描述符集，绘制调用数相同
+static std::string RunBindlessScenario(const BenchmarkOptions& options)
+{
+    auto& base = VulkanBase::Base();
+    if (!base.IsBindlessSupported())
+    {
+        std::cout << std::format("WARNING : [ Benchmark ] descriptor indexing is not supported, bindless skipped\n");
+        return "null";
+    }
+
+    uint32_t count = std::max(options.Textures, 2u);
+    uint32_t size = std::clamp(options.TextureSize, 64u, 8192u);
+    std::vector<std::string> paths;
+    if (!CollectTexturePaths(options, count, size, paths))
+        return "null";
+    count = uint32_t(paths.size());
+    std::cout << std::format("INFO : [ Benchmark ] bindless : {} draws, {} textures, {} frames per mode\n", options.DrawList, count, options.InstanceFrames);
+
+    auto& streamer = base.GetTextureStreamer();
+    std::vector<TextureStreamer::TextureHandle> textures;
+    for (auto& path : paths)
+        textures.push_back(streamer.Load(path));
+
+    // 等所有纹理都有常驻 mip（登记进无绑定资源堆），至多 TextureFrames 帧
+    uint32_t frameIndex = 0;
+    std::vector<uint32_t> indices(count, BindlessHeap::NULL_INDEX);
+    for (uint32_t frame = 0; frame < options.TextureFrames; ++frame)
+    {
+        for (auto texture : textures)
+            streamer.RequestScreenSize(texture, float(size));
+        if (!RunFrame(frameIndex))
+            break;
+        for (uint32_t i = 0; i < count; ++i)
+            indices[i] = base.GetBindlessTextureIndex(textures[i]);
+        if (std::none_of(indices.begin(), indices.end(), [](uint32_t index) { return index == BindlessHeap::NULL_INDEX; }))
+            break;
+    }
+    uint32_t registered = uint32_t(std::count_if(indices.begin(), indices.end(), [](uint32_t index) { return index != BindlessHeap::NULL_INDEX; }));
+    if (registered < count)
+        std::cout << std::format("WARNING : [ Benchmark ] only {} of {} textures became resident\n", registered, count);
+
+    auto& drawList = base.GetDrawList();
+    auto mesh = base.GetMeshRange();
+    uint32_t side = std::max(1u, uint32_t(std::ceil(std::sqrt(double(options.DrawList)))));
+    float scale = 2.0f / float(side);
+    auto heapBefore = base.GetBindlessHeap().GetStats();
+
+    std::string modes;
+    for (bool textured : { false, true })
+    {
+        drawList.Clear();
+        drawList.Reserve(options.DrawList);
+        auto fillBegin = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < options.DrawList; ++i)
+        {
+            uint32_t x = i % side;
+            uint32_t y = i / side;
+            glm::mat4 transform(scale);
+            transform[3] = glm::vec4(-1.0f + (float(x) + 0.5f) * scale, -1.0f + (float(y) + 0.5f) * scale, 0.0f, 1.0f);
+            uint32_t texture = textured ? indices[i % count] : BindlessHeap::NULL_INDEX;
+            drawList.Add(mesh, VulkanBase::DRAW_PIPELINE_COLOR, PackDrawData(transform, glm::vec4(1.0f), i & 7, texture));
+        }
+        double fillMs = ElapsedMs(fillBegin);
+
+        modes += std::format("{}\"{}\": {}", modes.empty() ? "" : ",\n      ", textured ? "bindless" : "untextured", MeasureSceneMode(options, fillMs));
+    }
+    drawList.Clear();
+
+    auto heap = base.GetBindlessHeap().GetStats();
+    std::string json = std::format("{{ \"draws\": {}, \"textures\": {}, \"resident_textures\": {}, \"heap_textures\": {}, \"heap_capacity\": {},\n"
+        "      \"descriptor_writes\": {}, \"descriptor_update_calls\": {},\n      {} }}",
+        options.DrawList, count, registered, heap.Textures, base.GetBindlessHeap().GetCapacity(BindlessHeap::BINDING_TEXTURES),
+        heap.DescriptorWrites - heapBefore.DescriptorWrites, heap.UpdateCalls - heapBefore.UpdateCalls, modes);
+
+    for (auto texture : textures)
+        streamer.Release(texture);
+    return json;
+}
+
+// 每帧分配大量瞬时描述符集：分配器（池链 + 整池重置）对比可单独释放集的固定大小池（逐个 vkAllocateDescriptorSets / vkFreeDescriptorSets）。
+// 再对同一批集写入描述符：每个描述符一次 vkUpdateDescriptorSets，对比批量写入（一次调用）与更新模板（每个集一次），报告每秒写入的描述符数。
+// 只在 CPU 上测量，集不会被 GPU 使用
+static std::string RunDescriptorScenario(const BenchmarkOptions& options)
+{
+    uint32_t setCount = std::max(options.DescriptorSets, 1u);
+    uint32_t frames = std::max(options.DescriptorFrames, 1u);
+    std::cout << std::format("INFO : [ Benchmark ] descriptors : {} sets x {} frames\n", setCount, frames);
+
+    auto& base = VulkanBase::Base();
+    VkDevice device = base.GetVkDevice();
+    auto& allocator = base.GetDescriptorAllocator();
+    base.WaitIdle();
+
+    // 典型的逐绘制集：一个 UBO + 两个存储缓冲
+    VkDescriptorSetLayoutBinding uboBinding{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr };
+    VkDescriptorSetLayoutBinding inputBinding{ 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr };
+    VkDescriptorSetLayoutBinding outputBinding{ 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr };
+    VkDescriptorSetLayout layout = allocator.GetLayout({ uboBinding, inputBinding, outputBinding });
+    // 绑定顺序不同也命中缓存
+    bool cached = layout && allocator.GetLayout({ outputBinding, uboBinding, inputBinding }) == layout;
+    if (!layout)
+        return "null";
+
+    auto baseline = allocator.GetStats();
+    std::vector<double> allocatorMs;
+    uint32_t failures = 0;
+    // 两个在途帧轮流使用，与渲染循环相同
+    for (uint32_t frame = 0; frame < frames; ++frame)
+    {
+        uint32_t frameIndex = frame % 2;
+        auto begin = std::chrono::steady_clock::now();
+        allocator.BeginFrame(frameIndex);
+        for (uint32_t i = 0; i < setCount; ++i)
+            failures += allocator.AllocateTransient(frameIndex, layout) == VK_NULL_HANDLE;
+        allocatorMs.push_back(ElapsedMs(begin));
+    }
+    for (uint32_t frameIndex = 0; frameIndex < 2; ++frameIndex)
+        allocator.BeginFrame(frameIndex);
+    auto stats = allocator.GetStats();
+
+    // 对照：一个足够大的 FREE_DESCRIPTOR_SET 池，逐个分配、帧结束后逐个释放
+    std::vector<double> freeListMs;
+    std::array<VkDescriptorPoolSize, 2> poolSizes = { {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, setCount * 2 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, setCount * 4 } } };
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    poolInfo.maxSets = setCount * 2;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) == VK_SUCCESS)
+    {
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = pool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &layout;
+        std::array<std::vector<VkDescriptorSet>, 2> frameSets;
+        for (uint32_t frame = 0; frame < frames; ++frame)
+        {
+            auto& sets = frameSets[frame % 2];
+            auto begin = std::chrono::steady_clock::now();
+            for (auto set : sets)
+                vkFreeDescriptorSets(device, pool, 1, &set);
+            sets.clear();
+            for (uint32_t i = 0; i < setCount; ++i)
+            {
+                VkDescriptorSet set = VK_NULL_HANDLE;
+                if (vkAllocateDescriptorSets(device, &allocInfo, &set) == VK_SUCCESS)
+                    sets.push_back(set);
+            }
+            freeListMs.push_back(ElapsedMs(begin));
+        }
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+
+    // 写入：每个集一个 UBO + 两个存储缓冲，三种方式各写 frames 遍
+    auto& writer = base.GetDescriptorWriter();
+    std::vector<double> singleMs, batchedMs, templateMs;
+    VkBuffer uniformBuffer = VK_NULL_HANDLE, storageBuffer = VK_NULL_HANDLE;
+    bool created = base.UseVmaCreateBuffer(256, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, uniformBuffer)
+        && base.UseVmaCreateBuffer(512, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, storageBuffer);
+    std::vector<VkDescriptorSet> writeSets;
+    allocator.BeginFrame(0);
+    for (uint32_t i = 0; created && i < setCount; ++i)
+    {
+        VkDescriptorSet set = allocator.AllocateTransient(0, layout);
+        created = set != VK_NULL_HANDLE;
+        writeSets.push_back(set);
+    }
+    if (created)
+    {
+        // 模板数据：按绑定号排列的三个 VkDescriptorBufferInfo
+        struct SetData
+        {
+            VkDescriptorBufferInfo Ubo;
+            VkDescriptorBufferInfo Input;
+            VkDescriptorBufferInfo Output;
+        };
+        SetData data = { { uniformBuffer, 0, 256 }, { storageBuffer, 0, 256 }, { storageBuffer, 256, 256 } };
+        writer.GetTemplate(layout);
+
+        for (uint32_t frame = 0; frame < frames; ++frame)
+        {
+            // 改动前 _create_descriptor_sets 的做法：每个描述符一次调用
+            auto begin = std::chrono::steady_clock::now();
+            for (auto set : writeSets)
+            {
+                const VkDescriptorBufferInfo* infos[3] = { &data.Ubo, &data.Input, &data.Output };
+                for (uint32_t binding = 0; binding < 3; ++binding)
+                {
+                    VkWriteDescriptorSet write{};
+                    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                    write.dstSet = set;
+                    write.dstBinding = binding;
+                    write.descriptorCount = 1;
+                    write.descriptorType = binding ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+                    write.pBufferInfo = infos[binding];
+                    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+                }
+            }
+            singleMs.push_back(ElapsedMs(begin));
+
+            begin = std::chrono::steady_clock::now();
+            for (auto set : writeSets)
+            {
+                writer.WriteBuffer(set, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniformBuffer, 0, 256);
+                writer.WriteBuffer(set, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, storageBuffer, 0, 256);
+                writer.WriteBuffer(set, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, storageBuffer, 256, 256);
+            }
+            writer.Flush();
+            batchedMs.push_back(ElapsedMs(begin));
+
+            begin = std::chrono::steady_clock::now();
+            for (auto set : writeSets)
+                writer.Update(set, layout, &data);
+            templateMs.push_back(ElapsedMs(begin));
+        }
+    }
+    allocator.BeginFrame(0);
+    if (uniformBuffer)
+        base.UseVmaDestroyBuffer(uniformBuffer);
+    if (storageBuffer)
+        base.UseVmaDestroyBuffer(storageBuffer);
+
+    // 每秒写入的描述符数（百万）
+    auto writesPerSecond = [setCount](const std::vector<double>& samples) {
+        double meanMs = Summarize(samples).MeanMs;
+        return meanMs > 0.0 ? double(setCount) * 3.0 / (meanMs * 1e3) : 0.0;
+        };
+
+    auto allocatorStats = Summarize(allocatorMs);
+    auto freeListStats = Summarize(freeListMs);
+    return std::format("{{ \"sets_per_frame\": {}, \"frames\": {}, \"layout_cached\": {}, \"failures\": {},\n"
+        "      \"pools_created\": {}, \"pool_resets\": {}, \"pool_switches\": {}, \"frame_pools\": {},\n"
+        "      \"allocator_ns_per_set\": {:.1f}, \"free_list_ns_per_set\": {:.1f},\n"
+        "      \"allocator_frame\": {},\n      \"free_list_frame\": {},\n"
+        "      \"template_supported\": {}, \"single_write_mwrites_per_sec\": {:.2f}, \"batched_mwrites_per_sec\": {:.2f}, \"template_mwrites_per_sec\": {:.2f},\n"
+        "      \"single_write_frame\": {},\n      \"batched_frame\": {},\n      \"template_frame\": {} }}",
+        setCount, frames, cached, failures, stats.PoolsCreated - baseline.PoolsCreated, stats.PoolResets - baseline.PoolResets,
+        stats.PoolSwitches - baseline.PoolSwitches, stats.FramePools,
+        allocatorStats.MeanMs * 1e6 / double(setCount), freeListStats.MeanMs * 1e6 / double(setCount),
+        StatsJson(allocatorStats), StatsJson(freeListStats),
+        writer.GetTemplate(layout) != VK_NULL_HANDLE, writesPerSecond(singleMs), writesPerSecond(batchedMs), writesPerSecond(templateMs),
+        StatsJson(Summarize(singleMs)), StatsJson(Summarize(batchedMs)), StatsJson(Summarize(templateMs)));
+}
+
+static std::string RunShaderScenario(const BenchmarkOptions& options)
+{
+    std::cout << std::format("INFO : [ Benchmark ] shader compile : {} reps\n", options.Repetitions);
+
+    std::vector<std::string> shaderPaths = {
+        ".\\shader\\vulkan\\Slang\\fristTriangle.slang"
+    };
+    const std::string outPath = ".\\benchmark_tmp\\SPV";
+
+    std::vector<double> samples;
+    for (uint32_t rep = 0; rep < 1 + options.Repetitions; ++rep)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        ShaderCompiler::CompilerShaders(shaderPaths, outPath);
+        if (rep > 0)
+            samples.push_back(ElapsedMs(begin));
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(".\\benchmark_tmp", ec);
+    return std::format("{{ \"files\": {}, \"repetitions\": {}, \"compile\": {} }}", shaderPaths.size(), samples.size(), StatsJson(Summarize(samples)));
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions options;
+    if (!ParseOptions(argc, argv, options))
+        return -1;
+
+    Tracer::Get().SetThreadName("Main");
+
+    {
+        std::vector<std::string> shaderPaths = {
+        ".\\shader\\vulkan\\Slang\\fristTriangle.slang",
+        ".\\shader\\vulkan\\Slang\\positionOnly.slang",
+        ".\\shader\\vulkan\\Slang\\meshletCull.slang",
+        ".\\shader\\vulkan\\Slang\\meshletMesh.slang",
+        ".\\shader\\vulkan\\Slang\\instanced.slang",
+        ".\\shader\\vulkan\\Slang\\instancedPositionOnly.slang",
+        ".\\shader\\vulkan\\Slang\\indirect.slang",
+        ".\\shader\\vulkan\\Slang\\indirectPositionOnly.slang",
+        ".\\shader\\vulkan\\Slang\\indirectBindless.slang",
+        ".\\shader\\vulkan\\Slang\\drawCull.slang",
+        ".\\shader\\vulkan\\Slang\\mipDownsample.slang",
+        ".\\shader\\vulkan\\Slang\\test.slang"
+        };
+        ShaderCompiler::CompilerShaders(shaderPaths, ".\\shader\\vulkan\\SPV", ".\\shader\\vulkan\\GLSL");
+    }
+
+    auto& base = VulkanBase::Base();
+    base.SetHeadless(options.Width, options.Height);
+    if (!base.InitVulkanInstance() || !base.InitVulkan())
+    {
+        std::cout << std::format("ERROR : [ Benchmark ] failed to initialize Vulkan\n");
+        return -1;
+    }
+    if (!options.Mesh.empty() && !base.LoadMesh(options.Mesh))
+    {
+        std::cout << std::format("ERROR : [ Benchmark ] failed to load mesh : {}\n", options.Mesh);
+        return -1;
+    }
+    if (options.Meshlets && !base.GetMeshletRenderer().HasMesh())
+        std::cout << std::format("WARNING : [ Benchmark ] mesh has no meshlets, --meshlets ignored\n");
+    if (options.MeshShader && !base.IsMeshShaderSupported())
+        std::cout << std::format("WARNING : [ Benchmark ] VK_EXT_mesh_shader is not supported, --mesh-shader ignored\n");
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(base.GetPhysicalDevice(), &properties);
+
+    auto wants = [&options](const char* name) { return options.Scenario == "all" || options.Scenario == name; };
+
+    std::string scenarios;
+    auto addScenario = [&scenarios](const char* name, const std::string& json) {
+        scenarios += std::format("{}    \"{}\": {}", scenarios.empty() ? "" : ",\n", name, json);
+        };
+    if (wants("frames"))   addScenario("frames", RunFrameScenario(options));
+    if (wants("upload"))   addScenario("upload", RunUploadScenario(options));
+    if (wants("pipeline")) addScenario("pipeline", RunPipelineScenario(options));
+    if (wants("shader"))   addScenario("shader", RunShaderScenario(options));
+    if (wants("instancing")) addScenario("instancing", RunInstancingScenario(options));
+    if (wants("indirect")) addScenario("indirect", RunIndirectScenario(options));
+    if (wants("gpu_cull")) addScenario("gpu_cull", RunGpuCullScenario(options));
+    if (wants("compute"))  addScenario("compute", RunComputeScenario(options));
+    if (wants("render_graph")) addScenario("render_graph", RunRenderGraphScenario(options));
+    if (wants("textures")) addScenario("textures", RunTextureScenario(options));
+    if (wants("bindless")) addScenario("bindless", RunBindlessScenario(options));
+    if (wants("descriptors")) addScenario("descriptors", RunDescriptorScenario(options));
+
+    auto now = std::chrono::system_clock::now();
+    std::string report = std::format(
+        "{{\n  \"timestamp\": \"{:%Y-%m-%dT%H:%M:%S}Z\",\n"
+        "  \"device\": {{ \"name\": \"{}\", \"type\": {}, \"api_version\": \"{}.{}.{}\", \"driver_version\": {} }},\n"
+        "  \"resolution\": [{}, {}],\n"
+        "  \"scenarios\": {{\n{}\n  }}\n}}\n",
+        std::chrono::floor<std::chrono::seconds>(now),
+        properties.deviceName, int32_t(properties.deviceType),
+        VK_API_VERSION_MAJOR(properties.apiVersion), VK_API_VERSION_MINOR(properties.apiVersion), VK_API_VERSION_PATCH(properties.apiVersion),
+        properties.driverVersion, options.Width, options.Height, scenarios);
+
+    base.WaitIdle();
+    base.CleanUp();
+    // 报告直接写到 stdout，先让引擎日志全部输出，避免交错
+    Logger::Get().Shutdown();
+
+    std::ofstream file(options.Output, std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cout << std::format("ERROR : [ Benchmark ] failed to open file : {} \n", options.Output);
+        std::cout << report;
+        return -1;
+    }
+    file << report;
+    std::cout << report;
+    std::cout << std::format("INFO : [ Benchmark ] results written to : {} \n", options.Output);
+    return 0;
+}
@@ -0,0 +1,536 @@
+﻿#include "MeshCooker.h"
+
+#include "VulkanBase/Vertex.h"
+
+#include <algorithm>
+#include <limits>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static float VertexScore(int cache_position, uint32_t remaining_triangles)
+{
+	// 没有未输出的三角形，不再需要这个顶点
+	if (remaining_triangles == 0)
+		return -1.0f;
+
+	constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+	constexpr float CACHE_DECAY_POWER = 1.5f;
+	constexpr float VALENCE_BOOST_SCALE = 2.0f;
+	constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+	float score = 0.0f;
+	if (cache_position >= 0)
+	{
+		// 刚用过的三个顶点分数固定，避免总是沿着同一个三角形条带走
+		if (cache_position < 3)
+			score = LAST_TRIANGLE_SCORE;
+		else
+			score = std::pow(1.0f - float(cache_position - 3) / float(MeshCooker::VERTEX_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+	}
+	// 剩余三角形少的顶点优先处理完，让它尽早离开缓存
+	score += VALENCE_BOOST_SCALE * std::pow(float(remaining_triangles), -VALENCE_BOOST_POWER);
+	return score;
+}
+
+bool MeshCooker::LoadObj(const std::string& path, SourceMesh& mesh, std::string& error)
+{
+	std::ifstream file(path);
+	if (!file.is_open())
+	{
+		error = std::format("failed to open file : {}", path);
+		return false;
+	}
+
+	mesh = SourceMesh{};
+	std::vector<uint32_t> polygon;
+	std::string line;
+	uint32_t lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		++lineNumber;
+		std::istringstream stream(line);
+		std::string tag;
+		stream >> tag;
+
+		if (tag == "v")
+		{
+			glm::vec3 position(0.0f);
+			glm::vec3 color(1.0f);
+			stream >> position.x >> position.y >> position.z;
+			if (!stream)
+			{
+				error = std::format("{}:{} : bad vertex", path, lineNumber);
+				return false;
+			}
+			if (!(stream >> color.r >> color.g >> color.b))
+				color = glm::vec3(1.0f);
+			mesh.Positions.push_back(position);
+			mesh.Colors.push_back(color);
+		}
+		else if (tag == "f")
+		{
+			polygon.clear();
+			std::string token;
+			while (stream >> token)
+			{
+				long index = std::strtol(token.c_str(), nullptr, 10);
+				// 负索引相对于目前已读到的顶点
+				long resolved = index < 0 ? long(mesh.Positions.size()) + index : index - 1;
+				if (index == 0 || resolved < 0 || resolved >= long(mesh.Positions.size()))
+				{
+					error = std::format("{}:{} : bad face index {}", path, lineNumber, token);
+					return false;
+				}
+				polygon.push_back(uint32_t(resolved));
+			}
+
+			for (size_t i = 2; i < polygon.size(); ++i)
+			{
+				uint32_t a = polygon[0], b = polygon[i - 1], c = polygon[i];
+				// 退化三角形不产生像素，直接丢弃
+				if (a == b || b == c || a == c)
+					continue;
+				mesh.Indices.insert(mesh.Indices.end(), { a, b, c });
+			}
+		}
+	}
+
+	if (mesh.Indices.empty())
+	{
+		error = std::format("{} : no triangles", path);
+		return false;
+	}
+	return true;
+}
+
+void MeshCooker::OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertex_count)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// 每个顶点相邻的三角形列表：adjacency[offsets[v], offsets[v] + remaining[v]) 为尚未输出的三角形
+	std::vector<uint32_t> remaining(vertex_count, 0);
+	for (uint32_t index : indices)
+		++remaining[index];
+
+	std::vector<uint32_t> offsets(vertex_count + 1, 0);
+	for (uint32_t v = 0; v < vertex_count; ++v)
+		offsets[v + 1] = offsets[v] + remaining[v];
+
+	std::vector<uint32_t> adjacency(indices.size());
+	{
+		std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i)
+			adjacency[cursor[indices[i]]++] = uint32_t(i / 3);
+	}
+
+	std::vector<int> cachePosition(vertex_count, -1);
+	std::vector<float> vertexScores(vertex_count);
+	for (uint32_t v = 0; v < vertex_count; ++v)
+		vertexScores[v] = VertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	int bestTriangle = 0;
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+		if (triangleScores[t] > triangleScores[bestTriangle])
+			bestTriangle = int(t);
+	}
+
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	cache.reserve(VERTEX_CACHE_SIZE + 3);
+	newCache.reserve(VERTEX_CACHE_SIZE + 3);
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	size_t scanCursor = 0;
+
+	while (output.size() < indices.size())
+	{
+		// 缓存中的顶点已没有剩余三角形：按原顺序取下一个未输出的三角形
+		if (bestTriangle < 0)
+		{
+			while (emitted[scanCursor])
+				++scanCursor;
+			bestTriangle = int(scanCursor);
+		}
+
+		const uint32_t* triangle = &indices[size_t(bestTriangle) * 3];
+		emitted[bestTriangle] = true;
+		output.insert(output.end(), triangle, triangle + 3);
+
+		// 从三个顶点的相邻列表中移除该三角形
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			uint32_t v = triangle[k];
+			uint32_t* begin = &adjacency[offsets[v]];
+			uint32_t* end = begin + remaining[v];
+			uint32_t* found = std::find(begin, end, uint32_t(bestTriangle));
+			std::swap(*found, *(end - 1));
+			--remaining[v];
+		}
+
+		// LRU：新三角形的顶点移到最前，其余顺延，超出缓存大小的顶点被挤出
+		newCache.assign(triangle, triangle + 3);
+		for (uint32_t v : cache)
+		{
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				newCache.push_back(v);
+		}
+		for (size_t i = 0; i < newCache.size(); ++i)
+		{
+			uint32_t v = newCache[i];
+			cachePosition[v] = i < VERTEX_CACHE_SIZE ? int(i) : -1;
+			vertexScores[v] = VertexScore(cachePosition[v], remaining[v]);
+		}
+
+		// 只有缓存内（及刚被挤出）顶点的相邻三角形分数会变，下一个三角形从中选择
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (uint32_t v : newCache)
+		{
+			for (uint32_t i = offsets[v]; i < offsets[v] + remaining[v]; ++i)
+			{
+				uint32_t t = adjacency[i];
+				float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+				triangleScores[t] = score;
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = int(t);
+				}
+			}
+		}
+
+		if (newCache.size() > VERTEX_CACHE_SIZE)
+			newCache.resize(VERTEX_CACHE_SIZE);
+		std::swap(cache, newCache);
+	}
+
+	indices.swap(output);
+}
+
+void MeshCooker::OptimizeVertexFetch(SourceMesh& mesh)
+{
+	constexpr uint32_t UNUSED = ~0u;
+	std::vector<uint32_t> remap(mesh.Positions.size(), UNUSED);
+	uint32_t next = 0;
+	for (uint32_t& index : mesh.Indices)
+	{
+		if (remap[index] == UNUSED)
+			remap[index] = next++;
+		index = remap[index];
+	}
+
+	std::vector<glm::vec3> positions(next);
+	std::vector<glm::vec3> colors(next);
+	for (size_t v = 0; v < remap.size(); ++v)
+	{
+		if (remap[v] == UNUSED)
+			continue;
+		positions[remap[v]] = mesh.Positions[v];
+		colors[remap[v]] = mesh.Colors[v];
+	}
+	mesh.Positions.swap(positions);
+	mesh.Colors.swap(colors);
+}
+
+static void FinishMeshlet(const MeshCooker::SourceMesh& mesh, MeshFileMeshlet& meshlet, const MeshCooker::MeshletData& data)
+{
+	const uint32_t* vertices = &data.Vertices[meshlet.VertexOffset];
+
+	// 包围球：AABB 中心 + 最远顶点距离。运行时位置是半精度，半径按坐标量级留出量化误差
+	glm::vec3 boundsMin(std::numeric_limits<float>::max());
+	glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+	for (uint32_t i = 0; i < meshlet.VertexCount; ++i)
+	{
+		boundsMin = glm::min(boundsMin, mesh.Positions[vertices[i]]);
+		boundsMax = glm::max(boundsMax, mesh.Positions[vertices[i]]);
+	}
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	float radius = 0.0f;
+	float magnitude = 0.0f;
+	for (uint32_t i = 0; i < meshlet.VertexCount; ++i)
+	{
+		const glm::vec3& position = mesh.Positions[vertices[i]];
+		radius = std::max(radius, glm::length(position - center));
+		magnitude = std::max({ magnitude, std::abs(position.x), std::abs(position.y), std::abs(position.z) });
+	}
+	radius += magnitude / 1024.0f;
+
+	// 法线锥：轴为各三角形单位法线的平均方向，张角由与轴夹角最大的法线决定
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec3> corners;
+	normals.reserve(meshlet.TriangleCount);
+	corners.reserve(meshlet.TriangleCount);
+	glm::vec3 axis(0.0f);
+	for (uint32_t t = 0; t < meshlet.TriangleCount; ++t)
+	{
+		uint32_t packed = data.Triangles[meshlet.TriangleOffset + t];
+		const glm::vec3& p0 = mesh.Positions[vertices[packed & 0xFF]];
+		const glm::vec3& p1 = mesh.Positions[vertices[(packed >> 8) & 0xFF]];
+		const glm::vec3& p2 = mesh.Positions[vertices[(packed >> 16) & 0xFF]];
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		// 面积为 0 的三角形不产生像素，不影响锥
+		if (length <= 0.0f)
+			continue;
+		normals.push_back(normal / length);
+		corners.push_back(p0);
+		axis += normals.back();
+	}
+
+	float axisLength = glm::length(axis);
+	float minDot = 1.0f;
+	if (axisLength > 0.0f)
+	{
+		axis /= axisLength;
+		for (auto& normal : normals)
+			minDot = std::min(minDot, glm::dot(axis, normal));
+	}
+
+	for (int i = 0; i < 3; ++i)
+		meshlet.Center[i] = center[i];
+	meshlet.Radius = radius;
+
+	// 法线跨过半球时任何视角都可能看到正面
+	if (normals.empty() || axisLength <= 0.0f || minDot <= 0.1f)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			meshlet.ConeApex[i] = center[i];
+			meshlet.ConeAxis[i] = 0.0f;
+		}
+		meshlet.ConeCutoff = MESHLET_CONE_DISABLED;
+		return;
+	}
+
+	// 锥顶沿轴后退，直到位于所有三角形平面的背面，从锥顶出发的视线判定才对簇内每个三角形成立
+	float maxT = 0.0f;
+	for (size_t t = 0; t < normals.size(); ++t)
+	{
+		float distance = glm::dot(center - corners[t], normals[t]);
+		maxT = std::max(maxT, distance / glm::dot(axis, normals[t]));
+	}
+	glm::vec3 apex = center - axis * maxT;
+	for (int i = 0; i < 3; ++i)
+	{
+		meshlet.ConeApex[i] = apex[i];
+		meshlet.ConeAxis[i] = axis[i];
+	}
+	meshlet.ConeCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+void MeshCooker::BuildMeshlets(const SourceMesh& mesh, MeshletData& meshlets)
+{
+	meshlets = MeshletData{};
+
+	constexpr uint8_t UNUSED = 0xFF;
+	std::vector<uint8_t> localIndex(mesh.Positions.size(), UNUSED);
+
+	MeshFileMeshlet current{};
+	auto flush = [&]() {
+		if (current.TriangleCount == 0)
+			return;
+		FinishMeshlet(mesh, current, meshlets);
+		for (uint32_t i = 0; i < current.VertexCount; ++i)
+			localIndex[meshlets.Vertices[current.VertexOffset + i]] = UNUSED;
+		meshlets.Meshlets.push_back(current);
+
+		current = MeshFileMeshlet{};
+		current.FirstIndex = uint32_t(meshlets.Triangles.size() * 3);
+		current.VertexOffset = uint32_t(meshlets.Vertices.size());
+		current.TriangleOffset = uint32_t(meshlets.Triangles.size());
+		};
+
+	for (size_t t = 0; t < mesh.Indices.size(); t += 3)
+	{
+		const uint32_t* triangle = &mesh.Indices[t];
+		uint32_t newVertices = (localIndex[triangle[0]] == UNUSED) + (localIndex[triangle[1]] == UNUSED) + (localIndex[triangle[2]] == UNUSED);
+		if (current.VertexCount + newVertices > MESHLET_MAX_VERTICES || current.TriangleCount + 1 > MESHLET_MAX_TRIANGLES)
+			flush();
+
+		uint32_t packed = 0;
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			uint32_t v = triangle[k];
+			if (localIndex[v] == UNUSED)
+			{
+				localIndex[v] = uint8_t(current.VertexCount++);
+				meshlets.Vertices.push_back(v);
+			}
+			packed |= uint32_t(localIndex[v]) << (k * 8);
+		}
+		meshlets.Triangles.push_back(packed);
+		++current.TriangleCount;
+	}
+	flush();
+}
+
+double MeshCooker::ComputeAcmr(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size)
+{
+	if (indices.empty())
+		return 0.0;
+
+	// FIFO 缓存：顶点进入缓存时记录时间戳，之后又有 cache_size 个顶点进入时被挤出
+	std::vector<uint64_t> timestamps(vertex_count, 0);
+	uint64_t time = uint64_t(cache_size) + 1;
+	uint64_t misses = 0;
+	for (uint32_t index : indices)
+	{
+		if (time - timestamps[index] > cache_size)
+		{
+			timestamps[index] = time++;
+			++misses;
+		}
+	}
+	return double(misses) / double(indices.size() / 3);
+}
+
+bool MeshCooker::WriteMeshFile(const std::string& path, const SourceMesh& mesh, const MeshletData& meshlets, std::string& error)
+{
+	MeshFileHeader header;
+	header.VertexCount = uint32_t(mesh.Positions.size());
+	header.IndexCount = uint32_t(mesh.Indices.size());
+	// 索引值最大为 VertexCount - 1，不启用图元重启，0xFFFF 也是合法索引
+	header.IndexSize = header.VertexCount <= 0x10000 ? 2 : 4;
+	header.PositionStride = PositionStreamLayout::STRIDE;
+	header.AttributeStride = AttributeStreamLayout::STRIDE;
+	header.PositionOffset = AlignMeshSection(sizeof(MeshFileHeader));
+	header.AttributeOffset = AlignMeshSection(header.PositionOffset + uint64_t(header.VertexCount) * header.PositionStride);
+	header.IndexOffset = AlignMeshSection(header.AttributeOffset + uint64_t(header.VertexCount) * header.AttributeStride);
+	header.MeshletCount = uint32_t(meshlets.Meshlets.size());
+	header.MeshletVertexCount = uint32_t(meshlets.Vertices.size());
+	header.MeshletOffset = AlignMeshSection(header.IndexOffset + uint64_t(header.IndexCount) * header.IndexSize);
+	header.MeshletVertexOffset = AlignMeshSection(header.MeshletOffset + uint64_t(header.MeshletCount) * sizeof(MeshFileMeshlet));
+	header.MeshletTriangleOffset = AlignMeshSection(header.MeshletVertexOffset + uint64_t(header.MeshletVertexCount) * sizeof(uint32_t));
+
+	glm::vec3 boundsMin(std::numeric_limits<float>::max());
+	glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+	std::vector<PositionStreamLayout::Vertex> positions(header.VertexCount);
+	std::vector<AttributeStreamLayout::Vertex> attributes(header.VertexCount);
+	for (uint32_t v = 0; v < header.VertexCount; ++v)
+	{
+		boundsMin = glm::min(boundsMin, mesh.Positions[v]);
+		boundsMax = glm::max(boundsMax, mesh.Positions[v]);
+		positions[v].Set<0>(EncodeHalf4(glm::vec4(mesh.Positions[v], 1.0f)));
+		attributes[v].Set<0>(EncodeUNorm8x4(glm::vec4(mesh.Colors[v], 1.0f)));
+	}
+	for (int i = 0; i < 3; ++i)
+	{
+		header.BoundsMin[i] = boundsMin[i];
+		header.BoundsMax[i] = boundsMax[i];
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		error = std::format("failed to open file : {}", path);
+		return false;
+	}
+
+	auto padTo = [&file](uint64_t offset) {
+		static const char zeros[MESH_SECTION_ALIGNMENT] = {};
+		uint64_t position = uint64_t(file.tellp());
+		file.write(zeros, std::streamsize(offset - position));
+		};
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	padTo(header.PositionOffset);
+	file.write(reinterpret_cast<const char*>(positions.data()), std::streamsize(positions.size() * sizeof(positions[0])));
+	padTo(header.AttributeOffset);
+	file.write(reinterpret_cast<const char*>(attributes.data()), std::streamsize(attributes.size() * sizeof(attributes[0])));
+	padTo(header.IndexOffset);
+	if (header.IndexSize == 2)
+	{
+		std::vector<uint16_t> indices(mesh.Indices.begin(), mesh.Indices.end());
+		file.write(reinterpret_cast<const char*>(indices.data()), std::streamsize(indices.size() * sizeof(uint16_t)));
+	}
+	else
+	{
+		file.write(reinterpret_cast<const char*>(mesh.Indices.data()), std::streamsize(mesh.Indices.size() * sizeof(uint32_t)));
+	}
+	padTo(header.MeshletOffset);
+	file.write(reinterpret_cast<const char*>(meshlets.Meshlets.data()), std::streamsize(meshlets.Meshlets.size() * sizeof(MeshFileMeshlet)));
+	padTo(header.MeshletVertexOffset);
+	file.write(reinterpret_cast<const char*>(meshlets.Vertices.data()), std::streamsize(meshlets.Vertices.size() * sizeof(uint32_t)));
+	padTo(header.MeshletTriangleOffset);
+	file.write(reinterpret_cast<const char*>(meshlets.Triangles.data()), std::streamsize(meshlets.Triangles.size() * sizeof(uint32_t)));
+
+	if (!file)
+	{
+		error = std::format("failed to write file : {}", path);
+		return false;
+	}
+	return true;
+}
+
+int MeshCooker::Run(int argc, char** argv)
+{
+	std::vector<std::string> paths;
+	bool optimize = true;
+	for (int i = 0; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--no-optimize")
+			optimize = false;
+		else
+			paths.push_back(arg);
+	}
+	if (paths.size() != 2)
+	{
+		std::cout << std::format("ERROR : [ Cooker ] usage : mesh <input.obj> <output.vmesh> [--no-optimize]\n");
+		return -1;
+	}
+
+	auto begin = std::chrono::steady_clock::now();
+
+	SourceMesh mesh;
+	std::string error;
+	if (!LoadObj(paths[0], mesh, error))
+	{
+		std::cout << std::format("ERROR : [ Cooker ] {}\n", error);
+		return -1;
+	}
+
+	uint32_t sourceVertexCount = uint32_t(mesh.Positions.size());
+	double acmrBefore = ComputeAcmr(mesh.Indices, sourceVertexCount);
+	if (optimize)
+	{
+		// 先定索引顺序，再按新的索引顺序排顶点
+		OptimizeVertexCache(mesh.Indices, sourceVertexCount);
+	}
+	OptimizeVertexFetch(mesh);
+	double acmrAfter = ComputeAcmr(mesh.Indices, uint32_t(mesh.Positions.size()));
+
+	// 簇按最终的索引顺序划分，索引缓冲不需要再重排
+	MeshletData meshlets;
+	BuildMeshlets(mesh, meshlets);
+
+	if (!WriteMeshFile(paths[1], mesh, meshlets, error))
+	{
+		std::cout << std::format("ERROR : [ Cooker ] {}\n", error);
+		return -1;
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+	std::cout << std::format("INFO : [ Cooker ] {} -> {} : {} vertices ({} unused dropped), {} triangles, {}-bit indices\n",
+		paths[0], paths[1], mesh.Positions.size(), sourceVertexCount - mesh.Positions.size(), mesh.Indices.size() / 3,
+		mesh.Positions.size() <= 0x10000 ? 16 : 32);
+	std::cout << std::format("INFO : [ Cooker ] ACMR (FIFO {}) : {:.3f} -> {:.3f}, {:.1f} ms\n", ACMR_CACHE_SIZE, acmrBefore, acmrAfter, ms);
+	size_t coneMeshlets = std::count_if(meshlets.Meshlets.begin(), meshlets.Meshlets.end(),
+		[](const MeshFileMeshlet& meshlet) { return meshlet.ConeCutoff != MESHLET_CONE_DISABLED; });
+	std::cout << std::format("INFO : [ Cooker ] {} meshlets, {:.1f} vertices / {:.1f} triangles per meshlet, {} with a usable normal cone\n",
+		meshlets.Meshlets.size(), double(meshlets.Vertices.size()) / double(meshlets.Meshlets.size()),
+		double(meshlets.Triangles.size()) / double(meshlets.Meshlets.size()), coneMeshlets);
+	return 0;
+}
@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "VulkanBase/MeshFormat.h"
+
+/// <summary>
+/// 网格烘焙：读取 OBJ，优化索引顺序（顶点后变换缓存）与顶点顺序（顶点抓取局部性），划分网格簇，写出运行时可直接映射上传的 .vmesh 文件
+/// </summary>
+class MeshCooker
+{
+public:
+	struct SourceMesh
+	{
+		std::vector<glm::vec3> Positions;
+		// 与 Positions 等长，OBJ 中没有顶点色时为白色
+		std::vector<glm::vec3> Colors;
+		std::vector<uint32_t> Indices;
+	};
+
+	struct MeshletData
+	{
+		std::vector<MeshFileMeshlet> Meshlets;
+		// 局部顶点表：全局顶点索引
+		std::vector<uint32_t> Vertices;
+		// 局部三角形表：每个三角形三个 8 位局部索引
+		std::vector<uint32_t> Triangles;
+	};
+
+	// 优化时假定的后变换缓存大小（Forsyth 算法的 LRU 缓存）
+	static constexpr uint32_t VERTEX_CACHE_SIZE = 32;
+	// 统计 ACMR 时模拟的 FIFO 缓存大小
+	static constexpr uint32_t ACMR_CACHE_SIZE = 16;
+
+	/// <summary>
+	/// mesh 子命令：mesh &lt;input.obj&gt; &lt;output.vmesh&gt; [--no-optimize]
+	/// </summary>
+	static int Run(int argc, char** argv);
+
+	/// <summary>
+	/// 支持 v（可带 r g b 顶点色）与 f（多边形按扇形三角化，v/vt/vn 形式只取位置索引，支持负索引），其余行忽略
+	/// </summary>
+	static bool LoadObj(const std::string& path, SourceMesh& mesh, std::string& error);
+	/// <summary>
+	/// Forsyth 线性速度顶点缓存优化：每次输出分数最高的三角形，分数由顶点在模拟 LRU 缓存中的位置与剩余相邻三角形数决定
+	/// </summary>
+	static void OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertex_count);
+	/// <summary>
+	/// 按索引中首次出现的顺序重排顶点，使顶点抓取接近顺序访问；未被引用的顶点被丢弃
+	/// </summary>
+	static void OptimizeVertexFetch(SourceMesh& mesh);
+	/// <summary>
+	/// 按索引顺序贪心地划分网格簇（不超过 MESHLET_MAX_VERTICES / MESHLET_MAX_TRIANGLES），
+	/// 每个簇是索引缓冲中连续的一段，并计算包围球与法线锥。应在顶点缓存优化之后调用，簇在空间上更紧凑
+	/// </summary>
+	static void BuildMeshlets(const SourceMesh& mesh, MeshletData& meshlets);
+	/// <summary>
+	/// 平均缓存未命中率（每个三角形的顶点着色次数，理想值约 0.5，最差 3）
+	/// </summary>
+	static double ComputeAcmr(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size = ACMR_CACHE_SIZE);
+	/// <summary>
+	/// 顶点数不超过 65536 时写 16 位索引，否则 32 位
+	/// </summary>
+	static bool WriteMeshFile(const std::string& path, const SourceMesh& mesh, const MeshletData& meshlets, std::string& error);
+};
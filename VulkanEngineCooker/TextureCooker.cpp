@@ -0,0 +1,668 @@
+﻿#include "TextureCooker.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	float SrgbToLinear(float c)
+	{
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSrgb(float c)
+	{
+		return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	uint8_t ToUNorm8(float value)
+	{
+		return uint8_t(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+
+	/// <summary>
+	/// 点集的均值与主轴（协方差矩阵的最大特征向量，幂迭代求得），块编码时端点取在主轴上投影的两端
+	/// </summary>
+	void PrincipalAxis(const float (*points)[4], uint32_t count, uint32_t channels, float mean[4], float axis[4])
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			mean[c] = 0.0f;
+			for (uint32_t i = 0; i < count; ++i)
+				mean[c] += points[i][c];
+			mean[c] /= float(count);
+		}
+
+		float covariance[4][4] = {};
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			for (uint32_t a = 0; a < channels; ++a)
+			{
+				for (uint32_t b = 0; b < channels; ++b)
+					covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+			}
+		}
+
+		for (uint32_t c = 0; c < 4; ++c)
+			axis[c] = c < channels ? 1.0f : 0.0f;
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = {};
+			for (uint32_t a = 0; a < channels; ++a)
+			{
+				for (uint32_t b = 0; b < channels; ++b)
+					next[a] += covariance[a][b] * axis[b];
+			}
+			float length = 0.0f;
+			for (uint32_t c = 0; c < channels; ++c)
+				length += next[c] * next[c];
+			// 所有点相同（或互相正交抵消）时保留当前方向
+			if (length < 1e-12f)
+				break;
+			length = std::sqrt(length);
+			for (uint32_t c = 0; c < channels; ++c)
+				axis[c] = next[c] / length;
+		}
+	}
+
+	/// <summary>
+	/// 主轴上投影最远的两个位置作为端点（限制在 [0, 255]）
+	/// </summary>
+	void FitEndpoints(const float (*points)[4], uint32_t count, uint32_t channels, float high[4], float low[4])
+	{
+		float mean[4], axis[4];
+		PrincipalAxis(points, count, channels, mean, axis);
+		float minT = 0.0f, maxT = 0.0f;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			float t = 0.0f;
+			for (uint32_t c = 0; c < channels; ++c)
+				t += (points[i][c] - mean[c]) * axis[c];
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			high[c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+			low[c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+		}
+	}
+
+	uint16_t PackRgb565(const float rgb[3])
+	{
+		uint32_t r = uint32_t(rgb[0] * 31.0f / 255.0f + 0.5f);
+		uint32_t g = uint32_t(rgb[1] * 63.0f / 255.0f + 0.5f);
+		uint32_t b = uint32_t(rgb[2] * 31.0f / 255.0f + 0.5f);
+		return uint16_t((r << 11) | (g << 5) | b);
+	}
+
+	void UnpackRgb565(uint16_t color, int rgb[3])
+	{
+		int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	void WriteLE(uint8_t* output, uint64_t value, uint32_t bytes)
+	{
+		for (uint32_t i = 0; i < bytes; ++i)
+			output[i] = uint8_t(value >> (i * 8));
+	}
+
+	// 128 位块的低位优先写入
+	struct BitWriter
+	{
+		uint8_t* Output;
+		uint32_t Position = 0;
+
+		void Write(uint32_t value, uint32_t bits)
+		{
+			for (uint32_t i = 0; i < bits; ++i, ++Position)
+			{
+				if (value & (1u << i))
+					Output[Position / 8] |= uint8_t(1u << (Position % 8));
+			}
+		}
+	};
+
+	// KTX2 数据格式描述用到的 Khronos Data Format 常量
+	constexpr uint32_t KHR_DF_MODEL_RGBSDA = 1;
+	constexpr uint32_t KHR_DF_MODEL_BC1A = 128;
+	constexpr uint32_t KHR_DF_MODEL_BC3 = 130;
+	constexpr uint32_t KHR_DF_MODEL_BC5 = 132;
+	constexpr uint32_t KHR_DF_MODEL_BC7 = 134;
+	constexpr uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+	constexpr uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+	constexpr uint32_t KHR_DF_TRANSFER_SRGB = 2;
+	constexpr uint32_t KHR_DF_SAMPLE_DATATYPE_LINEAR = 0x10;
+
+	struct DfdSample
+	{
+		uint32_t BitOffset;
+		uint32_t BitLength;
+		uint32_t Channel;
+		uint32_t Upper;
+	};
+
+	/// <summary>
+	/// 基本数据格式描述块（KDF 1.3 版本 2），返回的第一个字为 dfdTotalSize
+	/// </summary>
+	std::vector<uint32_t> BuildDfd(const TextureFormatInfo& format)
+	{
+		uint32_t model = KHR_DF_MODEL_RGBSDA;
+		std::vector<DfdSample> samples;
+		switch (format.Format)
+		{
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+			model = KHR_DF_MODEL_BC1A;
+			// BC1A 的 alpha 通道（1）表示带一位透明
+			samples = { { 0, 64, 1, UINT32_MAX } };
+			break;
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+			model = KHR_DF_MODEL_BC3;
+			samples = { { 0, 64, 15, UINT32_MAX }, { 64, 64, 0, UINT32_MAX } };
+			break;
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+			model = KHR_DF_MODEL_BC5;
+			samples = { { 0, 64, 0, UINT32_MAX }, { 64, 64, 1, UINT32_MAX } };
+			break;
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+			model = KHR_DF_MODEL_BC7;
+			samples = { { 0, 128, 0, UINT32_MAX } };
+			break;
+		default:
+			samples = { { 0, 8, 0, 255 }, { 8, 8, 1, 255 }, { 16, 8, 2, 255 }, { 24, 8, 15, 255 } };
+			break;
+		}
+
+		std::vector<uint32_t> words;
+		uint32_t blockSize = 24 + 16 * uint32_t(samples.size());
+		words.push_back(4 + blockSize);
+		// vendorId = 0（Khronos），descriptorType = 0（基本格式）
+		words.push_back(0);
+		words.push_back(2 | (blockSize << 16));
+		words.push_back(model | (KHR_DF_PRIMARIES_BT709 << 8) | ((format.Srgb ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR) << 16));
+		words.push_back((format.BlockWidth - 1) | ((format.BlockHeight - 1) << 8));
+		words.push_back(format.BlockBytes);
+		words.push_back(0);
+		for (const DfdSample& sample : samples)
+		{
+			uint32_t channel = sample.Channel;
+			// sRGB 只作用于颜色通道，alpha 标记为线性
+			if (format.Srgb && channel == 15)
+				channel |= KHR_DF_SAMPLE_DATATYPE_LINEAR;
+			words.push_back(sample.BitOffset | ((sample.BitLength - 1) << 16) | (channel << 24));
+			words.push_back(0);
+			words.push_back(0);
+			words.push_back(sample.Upper);
+		}
+		return words;
+	}
+}
+
+bool TextureCooker::LoadImage(const std::string& path, Image& image, std::string& error)
+{
+	int width = 0, height = 0, channels = 0;
+	stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+	if (!pixels)
+	{
+		error = std::format("failed to load image {} : {}", path, stbi_failure_reason());
+		return false;
+	}
+	image.Width = uint32_t(width);
+	image.Height = uint32_t(height);
+	image.Pixels.assign(pixels, pixels + size_t(width) * size_t(height) * 4);
+	stbi_image_free(pixels);
+	return true;
+}
+
+std::vector<TextureCooker::Image> TextureCooker::BuildMipChain(Image base, bool srgb)
+{
+	// 在浮点（sRGB 时为线性空间）中逐级滤波，避免每级量化误差累积
+	std::array<float, 256> toLinear;
+	for (uint32_t i = 0; i < 256; ++i)
+		toLinear[i] = srgb ? SrgbToLinear(float(i) / 255.0f) : float(i) / 255.0f;
+
+	uint32_t width = base.Width, height = base.Height;
+	std::vector<float> current(base.Pixels.size());
+	for (size_t i = 0; i < base.Pixels.size(); ++i)
+		current[i] = i % 4 == 3 ? float(base.Pixels[i]) / 255.0f : toLinear[base.Pixels[i]];
+
+	std::vector<Image> levels;
+	levels.push_back(std::move(base));
+	while (width > 1 || height > 1)
+	{
+		uint32_t nextWidth = std::max(width / 2, 1u);
+		uint32_t nextHeight = std::max(height / 2, 1u);
+		std::vector<float> next(size_t(nextWidth) * nextHeight * 4);
+		Image& level = levels.emplace_back();
+		level.Width = nextWidth;
+		level.Height = nextHeight;
+		level.Pixels.resize(next.size());
+		for (uint32_t y = 0; y < nextHeight; ++y)
+		{
+			const float* row0 = current.data() + size_t(std::min(y * 2, height - 1)) * width * 4;
+			const float* row1 = current.data() + size_t(std::min(y * 2 + 1, height - 1)) * width * 4;
+			for (uint32_t x = 0; x < nextWidth; ++x)
+			{
+				uint32_t x0 = std::min(x * 2, width - 1) * 4;
+				uint32_t x1 = std::min(x * 2 + 1, width - 1) * 4;
+				size_t out = (size_t(y) * nextWidth + x) * 4;
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					float value = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]) * 0.25f;
+					next[out + c] = value;
+					level.Pixels[out + c] = ToUNorm8(srgb && c < 3 ? LinearToSrgb(value) : value);
+				}
+			}
+		}
+		current.swap(next);
+		width = nextWidth;
+		height = nextHeight;
+	}
+	return levels;
+}
+
+std::vector<uint8_t> TextureCooker::EncodeLevel(const Image& image, const TextureFormatInfo& format)
+{
+	if (format.BlockWidth == 1)
+		return image.Pixels;
+
+	std::vector<uint8_t> output(size_t(TextureLevelBytes(format, image.Width, image.Height)));
+	uint32_t blocksX = (image.Width + 3) / 4, blocksY = (image.Height + 3) / 4;
+	uint8_t block[64];
+	for (uint32_t by = 0; by < blocksY; ++by)
+	{
+		for (uint32_t bx = 0; bx < blocksX; ++bx)
+		{
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				uint32_t x = std::min(bx * 4 + i % 4, image.Width - 1);
+				uint32_t y = std::min(by * 4 + i / 4, image.Height - 1);
+				std::memcpy(block + i * 4, image.Pixels.data() + (size_t(y) * image.Width + x) * 4, 4);
+			}
+
+			uint8_t* out = output.data() + (size_t(by) * blocksX + bx) * format.BlockBytes;
+			switch (format.Format)
+			{
+			case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+				EncodeBC1Block(block, out, true);
+				break;
+			case VK_FORMAT_BC3_UNORM_BLOCK:
+			case VK_FORMAT_BC3_SRGB_BLOCK:
+				EncodeBC3Block(block, out);
+				break;
+			case VK_FORMAT_BC5_UNORM_BLOCK:
+				EncodeBC5Block(block, out);
+				break;
+			default:
+				EncodeBC7Block(block, out);
+				break;
+			}
+		}
+	}
+	return output;
+}
+
+void TextureCooker::EncodeBC1Block(const uint8_t* block, uint8_t* output, bool allow_transparent)
+{
+	bool transparent[16];
+	bool anyTransparent = false;
+	float points[16][4] = {};
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		transparent[i] = allow_transparent && block[i * 4 + 3] < 128;
+		anyTransparent |= transparent[i];
+		if (!transparent[i])
+		{
+			for (uint32_t c = 0; c < 3; ++c)
+				points[count][c] = float(block[i * 4 + c]);
+			++count;
+		}
+	}
+
+	// 全部透明：c0 == c1 为三色模式，索引 3 为透明
+	if (count == 0)
+	{
+		WriteLE(output, 0, 4);
+		WriteLE(output + 4, UINT32_MAX, 4);
+		return;
+	}
+
+	float high[4], low[4];
+	FitEndpoints(points, count, 3, high, low);
+	uint16_t c0 = PackRgb565(high), c1 = PackRgb565(low);
+	// c0 > c1 为四色模式，c0 <= c1 为三色 + 透明模式
+	if ((c0 < c1) != anyTransparent)
+		std::swap(c0, c1);
+	bool fourColor = c0 > c1;
+
+	int palette[4][3];
+	UnpackRgb565(c0, palette[0]);
+	UnpackRgb565(c1, palette[1]);
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		if (fourColor)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+
+	uint32_t indices = 0;
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		uint32_t best = 3;
+		if (!transparent[i])
+		{
+			int bestError = INT32_MAX;
+			for (uint32_t p = 0; p < (fourColor ? 4u : 3u); ++p)
+			{
+				int error = 0;
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					int d = int(block[i * 4 + c]) - palette[p][c];
+					error += d * d;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					best = p;
+				}
+			}
+		}
+		indices |= best << (i * 2);
+	}
+
+	WriteLE(output, c0, 2);
+	WriteLE(output + 2, c1, 2);
+	WriteLE(output + 4, indices, 4);
+}
+
+void TextureCooker::EncodeBC4Block(const uint8_t* block, uint32_t channel, uint8_t* output)
+{
+	uint8_t low = 255, high = 0;
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		low = std::min(low, block[i * 4 + channel]);
+		high = std::max(high, block[i * 4 + channel]);
+	}
+
+	// a0 > a1 为八值模式：0 = a0，1 = a1，2 ~ 7 为两端之间的六个插值
+	int palette[8] = { high, low };
+	for (int i = 1; i < 7; ++i)
+		palette[i + 1] = ((7 - i) * high + i * low + 3) / 7;
+
+	uint64_t indices = 0;
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		uint32_t best = 0;
+		int bestError = INT32_MAX;
+		for (uint32_t p = 0; p < (high > low ? 8u : 1u); ++p)
+		{
+			int error = std::abs(int(block[i * 4 + channel]) - palette[p]);
+			if (error < bestError)
+			{
+				bestError = error;
+				best = p;
+			}
+		}
+		indices |= uint64_t(best) << (i * 3);
+	}
+
+	output[0] = high;
+	output[1] = low;
+	WriteLE(output + 2, indices, 6);
+}
+
+void TextureCooker::EncodeBC3Block(const uint8_t* block, uint8_t* output)
+{
+	// BC3 的颜色块总是按四色模式解码
+	EncodeBC4Block(block, 3, output);
+	EncodeBC1Block(block, output + 8, false);
+}
+
+void TextureCooker::EncodeBC5Block(const uint8_t* block, uint8_t* output)
+{
+	EncodeBC4Block(block, 0, output);
+	EncodeBC4Block(block, 1, output + 8);
+}
+
+void TextureCooker::EncodeBC7Block(const uint8_t* block, uint8_t* output)
+{
+	static constexpr int WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	float points[16][4];
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+			points[i][c] = float(block[i * 4 + c]);
+	}
+	float fitted[2][4];
+	FitEndpoints(points, 16, 4, fitted[0], fitted[1]);
+
+	// 端点为 7 位 + 每个端点一个共享的最低位（p 位），两种 p 取误差小的
+	uint32_t quantized[2][4], pbits[2];
+	int endpoints[2][4];
+	for (uint32_t e = 0; e < 2; ++e)
+	{
+		float bestError = -1.0f;
+		for (uint32_t p = 0; p < 2; ++p)
+		{
+			uint32_t q[4];
+			float error = 0.0f;
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				q[c] = uint32_t(std::clamp(std::lround((fitted[e][c] - float(p)) / 2.0f), 0l, 127l));
+				float d = float((q[c] << 1) | p) - fitted[e][c];
+				error += d * d;
+			}
+			if (bestError < 0.0f || error < bestError)
+			{
+				bestError = error;
+				pbits[e] = p;
+				std::memcpy(quantized[e], q, sizeof(q));
+			}
+		}
+		for (uint32_t c = 0; c < 4; ++c)
+			endpoints[e][c] = int((quantized[e][c] << 1) | pbits[e]);
+	}
+
+	int palette[16][4];
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+			palette[i][c] = ((64 - WEIGHTS[i]) * endpoints[0][c] + WEIGHTS[i] * endpoints[1][c] + 32) >> 6;
+	}
+
+	uint32_t indices[16];
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		int bestError = INT32_MAX;
+		for (uint32_t p = 0; p < 16; ++p)
+		{
+			int error = 0;
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				int d = int(block[i * 4 + c]) - palette[p][c];
+				error += d * d;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				indices[i] = p;
+			}
+		}
+	}
+
+	// 第一个像素的索引只存 3 位（最高位隐含为 0），否则交换端点并反转索引
+	if (indices[0] & 8)
+	{
+		std::swap(quantized[0], quantized[1]);
+		std::swap(pbits[0], pbits[1]);
+		for (uint32_t& index : indices)
+			index = 15 - index;
+	}
+
+	std::memset(output, 0, 16);
+	BitWriter writer{ output };
+	writer.Write(1u << 6, 7);
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		writer.Write(quantized[0][c], 7);
+		writer.Write(quantized[1][c], 7);
+	}
+	writer.Write(pbits[0], 1);
+	writer.Write(pbits[1], 1);
+	writer.Write(indices[0], 3);
+	for (uint32_t i = 1; i < 16; ++i)
+		writer.Write(indices[i], 4);
+}
+
+bool TextureCooker::WriteKtx2(const std::string& path, const TextureFormatInfo& format, uint32_t width, uint32_t height,
+	const std::vector<std::vector<uint8_t>>& levels, std::string& error)
+{
+	std::vector<uint32_t> dfd = BuildDfd(format);
+
+	Ktx2Header header{};
+	std::memcpy(header.Identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+	header.Format = uint32_t(format.Format);
+	header.TypeSize = 1;
+	header.PixelWidth = width;
+	header.PixelHeight = height;
+	header.FaceCount = 1;
+	header.LevelCount = uint32_t(levels.size());
+	header.DfdByteOffset = uint32_t(sizeof(Ktx2Header) + levels.size() * sizeof(Ktx2LevelIndex));
+	header.DfdByteLength = uint32_t(dfd.size() * sizeof(uint32_t));
+
+	// 规范建议从最小的一级开始存放，流式读取时先拿到粗糙的几级
+	std::vector<Ktx2LevelIndex> index(levels.size());
+	uint64_t offset = header.DfdByteOffset + header.DfdByteLength;
+	for (size_t level = levels.size(); level-- > 0;)
+	{
+		offset = AlignTextureLevel(offset);
+		index[level].ByteOffset = offset;
+		index[level].ByteLength = levels[level].size();
+		index[level].UncompressedByteLength = levels[level].size();
+		offset += levels[level].size();
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		error = std::format("failed to open file : {}", path);
+		return false;
+	}
+
+	auto padTo = [&file](uint64_t target) {
+		static const char zeros[KTX2_LEVEL_ALIGNMENT] = {};
+		uint64_t position = uint64_t(file.tellp());
+		file.write(zeros, std::streamsize(target - position));
+		};
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(index.data()), std::streamsize(index.size() * sizeof(Ktx2LevelIndex)));
+	file.write(reinterpret_cast<const char*>(dfd.data()), std::streamsize(dfd.size() * sizeof(uint32_t)));
+	for (size_t level = levels.size(); level-- > 0;)
+	{
+		padTo(index[level].ByteOffset);
+		file.write(reinterpret_cast<const char*>(levels[level].data()), std::streamsize(levels[level].size()));
+	}
+
+	if (!file)
+	{
+		error = std::format("failed to write file : {}", path);
+		return false;
+	}
+	return true;
+}
+
+int TextureCooker::Run(int argc, char** argv)
+{
+	std::vector<std::string> paths;
+	std::string formatName = "bc7";
+	bool linear = false;
+	for (int i = 0; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--format" && i + 1 < argc)
+			formatName = argv[++i];
+		else if (arg == "--linear")
+			linear = true;
+		else
+			paths.push_back(arg);
+	}
+	if (paths.size() != 2)
+	{
+		std::cout << std::format("ERROR : [ Cooker ] usage : texture <input> <output.ktx2> [--format bc1|bc3|bc5|bc7|rgba8] [--linear]\n");
+		return -1;
+	}
+
+	// 颜色贴图默认 sRGB；BC5 用于法线（两个通道），只有 UNORM
+	bool srgb = !linear && formatName != "bc5";
+	const TextureFormatInfo* format = nullptr;
+	for (const auto& info : TEXTURE_FORMATS)
+	{
+		if (info.Name == formatName && info.Srgb == srgb)
+			format = &info;
+	}
+	if (!format || formatName == "astc4x4")
+	{
+		std::cout << std::format("ERROR : [ Cooker ] unsupported texture format : {}\n", formatName);
+		return -1;
+	}
+
+	auto begin = std::chrono::steady_clock::now();
+
+	Image image;
+	std::string error;
+	if (!LoadImage(paths[0], image, error))
+	{
+		std::cout << std::format("ERROR : [ Cooker ] {}\n", error);
+		return -1;
+	}
+	uint32_t width = image.Width, height = image.Height;
+
+	std::vector<Image> mips = BuildMipChain(std::move(image), srgb);
+	std::vector<std::vector<uint8_t>> levels;
+	uint64_t encodedBytes = 0, rgbaBytes = 0;
+	for (const Image& mip : mips)
+	{
+		levels.push_back(EncodeLevel(mip, *format));
+		encodedBytes += levels.back().size();
+		rgbaBytes += mip.Pixels.size();
+	}
+
+	if (!WriteKtx2(paths[1], *format, width, height, levels, error))
+	{
+		std::cout << std::format("ERROR : [ Cooker ] {}\n", error);
+		return -1;
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+	std::cout << std::format("INFO : [ Cooker ] {} -> {} : {}x{}, {} levels, {}{}\n",
+		paths[0], paths[1], width, height, levels.size(), format->Name, format->Srgb ? " (sRGB)" : "");
+	std::cout << std::format("INFO : [ Cooker ] {:.2f} MB (RGBA8 {:.2f} MB, {:.1f}x smaller), {:.1f} ms\n",
+		double(encodedBytes) / (1024.0 * 1024.0), double(rgbaBytes) / (1024.0 * 1024.0), double(rgbaBytes) / double(encodedBytes), ms);
+	return 0;
+}
@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "VulkanBase/TextureFormat.h"
+
+/// <summary>
+/// 纹理烘焙：读取图片（stb_image 支持的格式），生成完整 mip 链，编码成 BC1 / BC3 / BC5 / BC7（或保持 RGBA8），写出 .ktx2。
+/// 运行时（TextureStreamer）映射文件后直接上传各级的块数据。块压缩后显存与上传量是 RGBA8 的 1/8（BC1）或 1/4（其余）
+/// </summary>
+class TextureCooker
+{
+public:
+	struct Image
+	{
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		// RGBA8，逐行紧密排列
+		std::vector<uint8_t> Pixels;
+	};
+
+	/// <summary>
+	/// texture 子命令：texture &lt;input&gt; &lt;output.ktx2&gt; [--format bc1|bc3|bc5|bc7|rgba8] [--linear]
+	/// </summary>
+	static int Run(int argc, char** argv);
+
+	static bool LoadImage(const std::string& path, Image& image, std::string& error);
+	/// <summary>
+	/// 2x2 盒式滤波生成到 1x1 为止的各级，奇数边长时边缘的像素重复使用；srgb 为 true 时颜色通道在线性空间平均
+	/// </summary>
+	static std::vector<Image> BuildMipChain(Image base, bool srgb);
+	/// <summary>
+	/// 按 format 编码一级，边长不是 4 的倍数时用边缘像素补齐最后的块
+	/// </summary>
+	static std::vector<uint8_t> EncodeLevel(const Image& image, const TextureFormatInfo& format);
+
+	/// <summary>
+	/// 4x4 块（RGBA8，64 字节）编码。BC1 有 alpha 小于 128 的像素时用三色 + 透明模式，BC3 / BC5 的单通道部分为 BC4 的八值模式，
+	/// BC7 只用模式 6（单分区、RGBA 端点 7 位 + 共享最低位、4 位索引）
+	/// </summary>
+	static void EncodeBC1Block(const uint8_t* block, uint8_t* output, bool allow_transparent);
+	static void EncodeBC4Block(const uint8_t* block, uint32_t channel, uint8_t* output);
+	static void EncodeBC3Block(const uint8_t* block, uint8_t* output);
+	static void EncodeBC5Block(const uint8_t* block, uint8_t* output);
+	static void EncodeBC7Block(const uint8_t* block, uint8_t* output);
+
+	/// <summary>
+	/// 写出 KTX2：文件头、级索引、基本数据格式描述（DFD），各级数据按规范从最小的一级开始存放并按 KTX2_LEVEL_ALIGNMENT 对齐
+	/// </summary>
+	static bool WriteKtx2(const std::string& path, const TextureFormatInfo& format, uint32_t width, uint32_t height,
+		const std::vector<std::vector<uint8_t>>& levels, std::string& error);
+};
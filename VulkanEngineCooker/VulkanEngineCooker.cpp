@@ -0,0 +1,37 @@
+﻿// VulkanEngineCooker.cpp : 离线资源烘焙工具，把源资源转换成运行时可直接映射上传的二进制格式。
+//
+// 用法 : VulkanEngineCooker.exe mesh <input.obj> <output.vmesh> [--no-optimize]
+//        VulkanEngineCooker.exe texture <input> <output.ktx2> [--format bc1|bc3|bc5|bc7|rgba8] [--linear]
+//
+#include <iostream>
+#include <format>
+#include <string>
+
+#include "MeshCooker.h"
+#include "TextureCooker.h"
+
+static void PrintUsage()
+{
+    std::cout << std::format("usage : VulkanEngineCooker <command> [args]\n"
+        "  mesh <input.obj> <output.vmesh> [--no-optimize]\n"
+        "  texture <input> <output.ktx2> [--format bc1|bc3|bc5|bc7|rgba8] [--linear]\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        PrintUsage();
+        return -1;
+    }
+
+    std::string command = argv[1];
+    if (command == "mesh")
+        return MeshCooker::Run(argc - 2, argv + 2);
+    if (command == "texture")
+        return TextureCooker::Run(argc - 2, argv + 2);
+
+    std::cout << std::format("ERROR : [ Cooker ] unknown command : {}\n", command);
+    PrintUsage();
+    return -1;
+}
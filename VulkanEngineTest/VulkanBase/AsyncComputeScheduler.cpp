@@ -0,0 +1,136 @@
+﻿// 模拟预处理头
+#include "VulkanMemoryAllocator/VmaUsage.h"
+
+#include "AsyncComputeScheduler.h"
+#include "Tracer.h"
+#include "Logger.h"
+
+#include <format>
+
+bool AsyncComputeScheduler::Init(VkDevice device, VkQueue compute_queue, uint32_t compute_queue_family, uint32_t graphics_queue_family, uint32_t frames_in_flight)
+{
+	_device = device;
+	if (!compute_queue || compute_queue_family == graphics_queue_family)
+	{
+		LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "AsyncComputeScheduler : no dedicated compute queue, compute passes run on the graphics queue");
+		return false;
+	}
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = compute_queue_family;
+	if (VkResult result = vkCreateCommandPool(_device, &poolInfo, nullptr, &_command_pool))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "AsyncComputeScheduler : failed to create command pool! Error code: {}", int32_t(result));
+		return false;
+	}
+
+	std::vector<VkCommandBuffer> commandBuffers(frames_in_flight);
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = _command_pool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = frames_in_flight;
+	if (VkResult result = vkAllocateCommandBuffers(_device, &allocInfo, commandBuffers.data()))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "AsyncComputeScheduler : failed to allocate command buffers! Error code: {}", int32_t(result));
+		CleanUp();
+		return false;
+	}
+
+	_frames.resize(frames_in_flight);
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	for (uint32_t i = 0; i < frames_in_flight; ++i)
+	{
+		_frames[i].CommandBuffer = commandBuffers[i];
+		if (VkResult result = vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &_frames[i].Finished))
+		{
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "AsyncComputeScheduler : failed to create semaphore! Error code: {}", int32_t(result));
+			CleanUp();
+			return false;
+		}
+	}
+
+	_compute_queue = compute_queue;
+	LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "AsyncComputeScheduler : compute passes run on queue family {} (graphics family {})", compute_queue_family, graphics_queue_family);
+	return true;
+}
+
+void AsyncComputeScheduler::CleanUp()
+{
+	for (auto& frame : _frames)
+	{
+		if (frame.Finished)
+			vkDestroySemaphore(_device, frame.Finished, nullptr);
+	}
+	_frames.clear();
+	_passes.clear();
+
+	// 命令缓冲随命令池一起释放
+	if (_command_pool)
+		vkDestroyCommandPool(_device, _command_pool, nullptr);
+	_command_pool = VK_NULL_HANDLE;
+	_compute_queue = VK_NULL_HANDLE;
+}
+
+void AsyncComputeScheduler::AddPass(const std::string& name, VkPipelineStageFlags consumer_stages, RecordFunction record)
+{
+	_passes.push_back({ name, consumer_stages, std::move(record) });
+}
+
+bool AsyncComputeScheduler::Submit(uint32_t frame_index, VkSemaphore& wait_semaphore, VkPipelineStageFlags& wait_stages)
+{
+	if (_passes.empty() || !IsAvailable() || frame_index >= _frames.size())
+	{
+		_passes.clear();
+		return false;
+	}
+
+	TRACE_ZONE("AsyncComputeSubmit");
+
+	auto& frame = _frames[frame_index];
+	vkResetCommandBuffer(frame.CommandBuffer, 0);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	if (VkResult result = vkBeginCommandBuffer(frame.CommandBuffer, &beginInfo))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "AsyncComputeScheduler : failed to begin command buffer! Error code: {}", int32_t(result));
+		_passes.clear();
+		return false;
+	}
+
+	VkPipelineStageFlags consumerStages = 0;
+	for (auto& pass : _passes)
+	{
+		TRACE_ZONE_DETAIL("RecordComputePass", "compute", pass.Name);
+		pass.Record(frame.CommandBuffer, frame_index);
+		consumerStages |= pass.ConsumerStages;
+	}
+	_passes.clear();
+
+	VkResult result = vkEndCommandBuffer(frame.CommandBuffer);
+	if (result == VK_SUCCESS)
+	{
+		// 信号量的信号操作包含对之前所有写入的内存依赖，图形提交的等待使其对消费阶段可见
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &frame.CommandBuffer;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &frame.Finished;
+		result = vkQueueSubmit(_compute_queue, 1, &submitInfo, VK_NULL_HANDLE);
+	}
+	if (result != VK_SUCCESS)
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "AsyncComputeScheduler : failed to submit compute passes! Error code: {}", int32_t(result));
+		return false;
+	}
+
+	wait_semaphore = frame.Finished;
+	wait_stages = consumerStages ? consumerStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	return true;
+}
@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// 异步计算调度：把每帧的计算通道（剔除、粒子、后处理等）录制到专用计算队列的命令缓冲里单独提交，
+/// 提交时发出该帧的信号量，图形提交在消费结果的阶段等待它。这样计算可以和上一帧仍在执行的图形工作重叠，
+/// 图形队列在等待阶段之前的工作也不必排在计算之后。
+/// 两个队列分属不同的队列族时，被双方访问的缓冲以 CONCURRENT 方式创建（见 VulkanBase::UseVmaCreateBuffer），不需要所有权转移。
+/// 通道的命令缓冲与信号量随帧复用，复用前由该帧的图形围栏保证计算已完成（图形提交等待了计算的信号量）
+/// </summary>
+class AsyncComputeScheduler
+{
+public:
+	using RecordFunction = std::function<void(VkCommandBuffer command_buffer, uint32_t frame_index)>;
+
+	AsyncComputeScheduler() = default;
+	~AsyncComputeScheduler() = default;
+
+	/// <summary>
+	/// compute_queue 为空或与图形队列属于同一个队列族时不可用，计算通道应直接录制到图形命令缓冲
+	/// </summary>
+	bool Init(VkDevice device, VkQueue compute_queue, uint32_t compute_queue_family, uint32_t graphics_queue_family, uint32_t frames_in_flight);
+	/// <summary>
+	/// 需在 GPU 空闲后调用
+	/// </summary>
+	void CleanUp();
+
+	bool IsAvailable() const { return _compute_queue != VK_NULL_HANDLE && !_frames.empty(); }
+	void SetEnabled(bool enabled) { _enabled = enabled; }
+	bool IsEnabled() const { return _enabled && IsAvailable(); }
+
+	/// <summary>
+	/// 登记本帧的一个计算通道，Submit 时按登记顺序录制。consumer_stages 为图形队列上读取结果的阶段
+	/// （只能是图形提交里的阶段；计算队列上的命令缓冲结尾不需要面向这些阶段的屏障）
+	/// </summary>
+	void AddPass(const std::string& name, VkPipelineStageFlags consumer_stages, RecordFunction record);
+	uint32_t GetPassCount() const { return static_cast<uint32_t>(_passes.size()); }
+
+	/// <summary>
+	/// 在图形提交之前调用：录制并提交本帧登记的通道，然后清空登记。
+	/// 有提交时返回 true，图形提交需要在 wait_stages 等待 wait_semaphore
+	/// </summary>
+	bool Submit(uint32_t frame_index, VkSemaphore& wait_semaphore, VkPipelineStageFlags& wait_stages);
+
+private:
+	struct Pass
+	{
+		std::string Name;
+		VkPipelineStageFlags ConsumerStages;
+		RecordFunction Record;
+	};
+
+	struct FrameResources
+	{
+		VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+		// 计算完成，图形提交等待
+		VkSemaphore Finished = VK_NULL_HANDLE;
+	};
+
+private:
+	VkDevice _device = VK_NULL_HANDLE;
+	VkQueue _compute_queue = VK_NULL_HANDLE;
+	VkCommandPool _command_pool = VK_NULL_HANDLE;
+	bool _enabled = true;
+
+	std::vector<Pass> _passes;
+	std::vector<FrameResources> _frames;
+};
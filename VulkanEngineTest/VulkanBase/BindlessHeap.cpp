@@ -0,0 +1,363 @@
+﻿// 模拟预处理头
+#include "VulkanMemoryAllocator/VmaUsage.h"
+
+#include "BindlessHeap.h"
+#include "DescriptorWriter.h"
+#include "Tracer.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <format>
+
+bool BindlessHeap::IsSupported(const VkPhysicalDeviceVulkan12Features& features)
+{
+	return features.runtimeDescriptorArray
+		&& features.descriptorBindingPartiallyBound
+		&& features.descriptorBindingSampledImageUpdateAfterBind
+		&& features.descriptorBindingStorageBufferUpdateAfterBind
+		&& features.shaderSampledImageArrayNonUniformIndexing
+		&& features.shaderStorageBufferArrayNonUniformIndexing;
+}
+
+void BindlessHeap::EnableFeatures(VkPhysicalDeviceVulkan12Features& features)
+{
+	features.descriptorIndexing = VK_TRUE;
+	features.runtimeDescriptorArray = VK_TRUE;
+	features.descriptorBindingPartiallyBound = VK_TRUE;
+	features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+	features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+}
+
+bool BindlessHeap::Init(VkPhysicalDevice physical_device, VkDevice device, uint32_t frames_in_flight, VkShaderStageFlags stages)
+{
+	_device = device;
+	_frames.resize(frames_in_flight);
+
+	// 数组大小受 update-after-bind 的逐阶段与逐集限制，三个数组合计还受 maxPerStageUpdateAfterBindResources 限制
+	VkPhysicalDeviceVulkan12Properties properties12{};
+	properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+	VkPhysicalDeviceProperties2 properties2{};
+	properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties2.pNext = &properties12;
+	vkGetPhysicalDeviceProperties2(physical_device, &properties2);
+
+	uint32_t samplers = std::min({ MAX_SAMPLERS, properties12.maxPerStageDescriptorUpdateAfterBindSamplers, properties12.maxDescriptorSetUpdateAfterBindSamplers });
+	uint32_t textures = std::min({ MAX_TEXTURES, properties12.maxPerStageDescriptorUpdateAfterBindSampledImages, properties12.maxDescriptorSetUpdateAfterBindSampledImages });
+	uint32_t buffers = std::min({ MAX_BUFFERS, properties12.maxPerStageDescriptorUpdateAfterBindStorageBuffers, properties12.maxDescriptorSetUpdateAfterBindStorageBuffers });
+	uint32_t resources = properties12.maxPerStageUpdateAfterBindResources;
+	if (resources > samplers && uint64_t(samplers) + textures + buffers > resources)
+	{
+		// 采样器数组很小，剩余的额度在纹理与缓冲之间平分
+		textures = std::min(textures, (resources - samplers) / 2);
+		buffers = std::min(buffers, resources - samplers - textures);
+	}
+	if (samplers == 0 || textures < 2 || buffers < 2)
+	{
+		LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "BindlessHeap : update-after-bind limits too small ({} textures, {} samplers, {} buffers)", textures, samplers, buffers);
+		return false;
+	}
+	_slots[BINDING_TEXTURES] = { textures, NULL_INDEX + 1, {} };
+	_slots[BINDING_SAMPLERS] = { samplers, 0, {} };
+	_slots[BINDING_BUFFERS] = { buffers, NULL_INDEX + 1, {} };
+	_textures.assign(textures, VkDescriptorImageInfo{});
+	_samplers.assign(samplers, VkDescriptorImageInfo{});
+	_buffers.assign(buffers, VkDescriptorBufferInfo{});
+	for (uint32_t i = 0; i < BINDING_COUNT; ++i)
+	{
+		_slots[i].Live.assign(_slots[i].Capacity, false);
+		_generations[i].assign(_slots[i].Capacity, 0);
+		for (auto& frame : _frames)
+			frame.Written[i].assign(_slots[i].Capacity, 0);
+	}
+	_generation = 0;
+
+	std::array<VkDescriptorSetLayoutBinding, BINDING_COUNT> bindings{};
+	bindings[BINDING_TEXTURES].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	bindings[BINDING_SAMPLERS].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+	bindings[BINDING_BUFFERS].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	std::array<VkDescriptorBindingFlags, BINDING_COUNT> bindingFlags{};
+	for (uint32_t i = 0; i < BINDING_COUNT; ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorCount = _slots[i].Capacity;
+		bindings[i].stageFlags = stages;
+		// 从未登记过的元素只要不被访问就合法；各帧的集在录制前才写入，不需要 UPDATE_UNUSED_WHILE_PENDING
+		bindingFlags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+	}
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+	bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &bindingFlagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+	if (VkResult result = vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &_set_layout))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "BindlessHeap : failed to create descriptor set layout! Error code: {}", int32_t(result));
+		return false;
+	}
+
+	std::array<VkDescriptorPoolSize, BINDING_COUNT> poolSizes{};
+	for (uint32_t i = 0; i < BINDING_COUNT; ++i)
+	{
+		poolSizes[i].type = bindings[i].descriptorType;
+		poolSizes[i].descriptorCount = bindings[i].descriptorCount * frames_in_flight;
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = frames_in_flight;
+	if (VkResult result = vkCreateDescriptorPool(_device, &poolInfo, nullptr, &_descriptor_pool))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "BindlessHeap : failed to create descriptor pool! Error code: {}", int32_t(result));
+		CleanUp();
+		return false;
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(frames_in_flight, _set_layout);
+	std::vector<VkDescriptorSet> sets(frames_in_flight);
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = _descriptor_pool;
+	allocInfo.descriptorSetCount = frames_in_flight;
+	allocInfo.pSetLayouts = layouts.data();
+	if (VkResult result = vkAllocateDescriptorSets(_device, &allocInfo, sets.data()))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "BindlessHeap : failed to allocate descriptor sets! Error code: {}", int32_t(result));
+		CleanUp();
+		return false;
+	}
+	for (uint32_t i = 0; i < frames_in_flight; ++i)
+		_frames[i].DescriptorSet = sets[i];
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	if (VkResult result = vkCreateSampler(_device, &samplerInfo, nullptr, &_default_sampler))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "BindlessHeap : failed to create default sampler! Error code: {}", int32_t(result));
+		CleanUp();
+		return false;
+	}
+	AddSampler(_default_sampler);
+
+	LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "BindlessHeap : {} textures, {} samplers, {} buffers", textures, samplers, buffers);
+	return true;
+}
+
+void BindlessHeap::CleanUp()
+{
+	if (_default_sampler)
+		vkDestroySampler(_device, _default_sampler, nullptr);
+	if (_descriptor_pool)
+		vkDestroyDescriptorPool(_device, _descriptor_pool, nullptr);
+	if (_set_layout)
+		vkDestroyDescriptorSetLayout(_device, _set_layout, nullptr);
+	_default_sampler = VK_NULL_HANDLE;
+	_descriptor_pool = VK_NULL_HANDLE;
+	_set_layout = VK_NULL_HANDLE;
+	_frames.clear();
+	_slots = {};
+	_textures.clear();
+	_samplers.clear();
+	_buffers.clear();
+	for (auto& generations : _generations)
+		generations.clear();
+	_generation = 0;
+	_fallback_texture = {};
+	_fallback_buffer = {};
+}
+
+void BindlessHeap::SetFallback(VkImageView view, VkBuffer buffer)
+{
+	_fallback_texture = { VK_NULL_HANDLE, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	_fallback_buffer = { buffer, 0, VK_WHOLE_SIZE };
+
+	// 下标 0 与此前归还的下标
+	for (uint32_t index = 0; index < _slots[BINDING_TEXTURES].Next; ++index)
+	{
+		if (!_textures[index].imageView)
+		{
+			_textures[index] = _fallback_texture;
+			_mark_dirty(BINDING_TEXTURES, index);
+		}
+	}
+	for (uint32_t index = 0; index < _slots[BINDING_BUFFERS].Next; ++index)
+	{
+		if (!_buffers[index].buffer)
+		{
+			_buffers[index] = _fallback_buffer;
+			_mark_dirty(BINDING_BUFFERS, index);
+		}
+	}
+}
+
+uint32_t BindlessHeap::AddTexture(VkImageView view, VkImageLayout layout)
+{
+	uint32_t index = _allocate(BINDING_TEXTURES);
+	if (index != INVALID_INDEX)
+		UpdateTexture(index, view, layout);
+	return index;
+}
+
+uint32_t BindlessHeap::AddSampler(VkSampler sampler)
+{
+	uint32_t index = _allocate(BINDING_SAMPLERS);
+	if (index != INVALID_INDEX)
+	{
+		_samplers[index] = { sampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED };
+		_mark_dirty(BINDING_SAMPLERS, index);
+	}
+	return index;
+}
+
+uint32_t BindlessHeap::AddBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	uint32_t index = _allocate(BINDING_BUFFERS);
+	if (index != INVALID_INDEX)
+		UpdateBuffer(index, buffer, offset, range);
+	return index;
+}
+
+void BindlessHeap::UpdateTexture(uint32_t index, VkImageView view, VkImageLayout layout)
+{
+	if (index == NULL_INDEX || index >= _textures.size())
+		return;
+	_textures[index] = { VK_NULL_HANDLE, view, layout };
+	_mark_dirty(BINDING_TEXTURES, index);
+}
+
+void BindlessHeap::UpdateBuffer(uint32_t index, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	if (index == NULL_INDEX || index >= _buffers.size())
+		return;
+	_buffers[index] = { buffer, offset, range };
+	_mark_dirty(BINDING_BUFFERS, index);
+}
+
+void BindlessHeap::Remove(Binding binding, uint32_t index)
+{
+	Slots& slots = _slots[binding];
+	if (index >= slots.Next || (binding != BINDING_SAMPLERS && index == NULL_INDEX) || (binding == BINDING_SAMPLERS && index == DEFAULT_SAMPLER))
+		return;
+	if (!slots.Live[index])
+	{
+		LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "BindlessHeap : binding {} index {} is already removed", uint32_t(binding), index);
+		return;
+	}
+	slots.Live[index] = false;
+
+	// 换成替代资源并重新写入各帧：仍引用该下标的绘制读到的是替代资源，而不是即将销毁的资源
+	switch (binding)
+	{
+	case BINDING_TEXTURES: _textures[index] = _fallback_texture; break;
+	case BINDING_SAMPLERS: _samplers[index] = _samplers[DEFAULT_SAMPLER]; break;
+	case BINDING_BUFFERS: _buffers[index] = _fallback_buffer; break;
+	default: return;
+	}
+	_mark_dirty(binding, index);
+	slots.Free.push_back(index);
+}
+
+void BindlessHeap::BeginFrame(uint32_t frame_index, DescriptorWriter& writer)
+{
+	FrameResources& frame = _frames[frame_index];
+	if (frame.SyncedGeneration == _generation)
+		return;
+	if (!_fallback_texture.imageView || !_fallback_buffer.buffer)
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "BindlessHeap : fallback resources are not set, descriptors not written!");
+		return;
+	}
+
+	// 版本落后的下标按顺序登记，writer 把连续的下标合并成一项
+	uint64_t descriptors = 0;
+	for (uint32_t binding = 0; binding < BINDING_COUNT; ++binding)
+	{
+		const auto& generations = _generations[binding];
+		auto& written = frame.Written[binding];
+		uint32_t end = _slots[binding].Next;
+		for (uint32_t index = 0; index < end; ++index)
+		{
+			if (written[index] == generations[index])
+				continue;
+			written[index] = generations[index];
+			switch (binding)
+			{
+			case BINDING_TEXTURES:
+				writer.WriteImage(frame.DescriptorSet, binding, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, _textures[index].imageView,
+					_textures[index].imageLayout, VK_NULL_HANDLE, index);
+				break;
+			case BINDING_SAMPLERS:
+				writer.WriteImage(frame.DescriptorSet, binding, VK_DESCRIPTOR_TYPE_SAMPLER, VK_NULL_HANDLE,
+					VK_IMAGE_LAYOUT_UNDEFINED, _samplers[index].sampler, index);
+				break;
+			default:
+				writer.WriteBuffer(frame.DescriptorSet, binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _buffers[index].buffer,
+					_buffers[index].offset, _buffers[index].range, index);
+				break;
+			}
+			++descriptors;
+		}
+	}
+	frame.SyncedGeneration = _generation;
+
+	if (descriptors)
+	{
+		TRACE_ZONE_DETAIL("UpdateBindlessHeap", "descriptor", std::format("{} descriptors", descriptors));
+		_descriptor_writes += descriptors;
+		++_update_calls;
+	}
+}
+
+BindlessHeap::Stats BindlessHeap::GetStats() const
+{
+	Stats stats;
+	stats.Textures = _slots[BINDING_TEXTURES].Next - uint32_t(_slots[BINDING_TEXTURES].Free.size()) - (_slots[BINDING_TEXTURES].Next ? 1 : 0);
+	stats.Samplers = _slots[BINDING_SAMPLERS].Next - uint32_t(_slots[BINDING_SAMPLERS].Free.size());
+	stats.Buffers = _slots[BINDING_BUFFERS].Next - uint32_t(_slots[BINDING_BUFFERS].Free.size()) - (_slots[BINDING_BUFFERS].Next ? 1 : 0);
+	stats.DescriptorWrites = _descriptor_writes;
+	stats.UpdateCalls = _update_calls;
+	return stats;
+}
+
+uint32_t BindlessHeap::_allocate(Binding binding)
+{
+	Slots& slots = _slots[binding];
+	if (!slots.Free.empty())
+	{
+		uint32_t index = slots.Free.back();
+		slots.Free.pop_back();
+		slots.Live[index] = true;
+		return index;
+	}
+	if (slots.Next >= slots.Capacity)
+	{
+		LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "BindlessHeap : binding {} is full ({} descriptors)", uint32_t(binding), slots.Capacity);
+		return INVALID_INDEX;
+	}
+	slots.Live[slots.Next] = true;
+	return slots.Next++;
+}
+
+void BindlessHeap::_mark_dirty(Binding binding, uint32_t index)
+{
+	++_generations[binding][index];
+	++_generation;
+}
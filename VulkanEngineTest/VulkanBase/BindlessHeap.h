@@ -0,0 +1,150 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class DescriptorWriter;
+
+/// <summary>
+/// 无绑定资源堆（描述符索引，Vulkan 1.2 核心）：一个描述符集里是三个大数组——采样图像、采样器、存储缓冲，
+/// 绑定标志为 PARTIALLY_BOUND | UPDATE_AFTER_BIND，没写入的元素只要着色器不访问就合法。资源登记后得到数组下标，
+/// 着色器通过推送常量或逐绘制数据里的下标（NonUniformResourceIndex）访问，每个命令缓冲只绑定一次描述符集，绘制之间不再切换。
+/// 每个在途帧一份描述符集：Add / Update / Remove 先记在 CPU 侧并把该下标的版本号加一，录制该帧之前 BeginFrame
+/// 把版本号与该帧集里已写入的版本不同的下标写入该帧的集，写入时该帧上一次的命令缓冲已经执行完，所以下标可以立即复用、同一下标也可以换资源。
+/// 某个帧序号长期不用也只是它的版本落后，不会积压待写入的记录。归还的下标（以及下标 0）写入替代资源（SetFallback），
+/// 仍引用它的绘制不会访问已销毁的资源。
+/// update-after-bind 的描述符池的数量上限远高于普通池（常见为 50 万以上对 4096），数组可以开得足够大
+/// </summary>
+class BindlessHeap
+{
+public:
+	enum Binding : uint32_t
+	{
+		BINDING_TEXTURES = 0,
+		BINDING_SAMPLERS,
+		BINDING_BUFFERS,
+
+		BINDING_COUNT
+	};
+
+	// 各数组的上限，Init 时再按设备的 update-after-bind 限制收紧
+	static constexpr uint32_t MAX_TEXTURES = 16384;
+	static constexpr uint32_t MAX_SAMPLERS = 64;
+	static constexpr uint32_t MAX_BUFFERS = 16384;
+
+	// 纹理与缓冲的下标 0 保留为“无”（着色器据此跳过访问），采样器的下标 0 是 Init 创建的默认采样器（线性、重复）
+	static constexpr uint32_t NULL_INDEX = 0;
+	static constexpr uint32_t DEFAULT_SAMPLER = 0;
+	static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+	struct Stats
+	{
+		uint32_t Textures = 0;
+		uint32_t Samplers = 0;
+		uint32_t Buffers = 0;
+		// 累计写入各帧描述符集的描述符数与有写入的 BeginFrame 次数（每次合并在该帧的一次 vkUpdateDescriptorSets 里）
+		uint64_t DescriptorWrites = 0;
+		uint64_t UpdateCalls = 0;
+	};
+
+	/// <summary>
+	/// 设备需要开启的描述符索引特性（在 _create_logical_device 中检查并开启）
+	/// </summary>
+	static bool IsSupported(const VkPhysicalDeviceVulkan12Features& features);
+	static void EnableFeatures(VkPhysicalDeviceVulkan12Features& features);
+
+	BindlessHeap() = default;
+	~BindlessHeap() = default;
+
+	/// <summary>
+	/// stages 为会访问这些数组的着色器阶段
+	/// </summary>
+	bool Init(VkPhysicalDevice physical_device, VkDevice device, uint32_t frames_in_flight, VkShaderStageFlags stages);
+	/// <summary>
+	/// 需在 GPU 空闲后调用，不销毁登记进来的资源（默认采样器除外）
+	/// </summary>
+	void CleanUp();
+
+	/// <summary>
+	/// 归还的下标与纹理 / 缓冲的下标 0 写入的替代资源（如 1x1 纹理、小的存储缓冲），由调用方创建并在 CleanUp 之后销毁。
+	/// 需在第一次 BeginFrame 之前设置，之前 BeginFrame 不写入
+	/// </summary>
+	void SetFallback(VkImageView view, VkBuffer buffer);
+
+	bool IsInitialized() const { return _set_layout != VK_NULL_HANDLE; }
+	VkDescriptorSetLayout GetSetLayout() const { return _set_layout; }
+	VkDescriptorSet GetDescriptorSet(uint32_t frame_index) const { return _frames[frame_index].DescriptorSet; }
+	uint32_t GetCapacity(Binding binding) const { return _slots[binding].Capacity; }
+
+	/// <summary>
+	/// 登记资源，返回数组下标；数组已满时返回 INVALID_INDEX
+	/// </summary>
+	uint32_t AddTexture(VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	uint32_t AddSampler(VkSampler sampler);
+	uint32_t AddBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+	/// <summary>
+	/// 同一下标换成新的资源（例如纹理流式加载换了图像视图），引用该下标的绘制数据不用改
+	/// </summary>
+	void UpdateTexture(uint32_t index, VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	void UpdateBuffer(uint32_t index, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+	/// <summary>
+	/// 归还下标，之后写入的帧里该下标指向替代资源。之前的帧仍在使用的旧资源由调用方延迟销毁
+	/// </summary>
+	void Remove(Binding binding, uint32_t index);
+
+	/// <summary>
+	/// 录制该帧的命令之前调用（围栏已等待）：把该帧的集里过时的下标登记到 writer，随该帧的其他写入一起提交
+	/// </summary>
+	void BeginFrame(uint32_t frame_index, DescriptorWriter& writer);
+
+	Stats GetStats() const;
+
+private:
+	struct Slots
+	{
+		uint32_t Capacity = 0;
+		// 下一个从未使用过的下标
+		uint32_t Next = 0;
+		std::vector<uint32_t> Free;
+		// 已分配、尚未归还的下标，重复归还时忽略
+		std::vector<bool> Live;
+	};
+
+	struct FrameResources
+	{
+		VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+		// 该帧的集里各下标已写入的版本
+		std::array<std::vector<uint32_t>, BINDING_COUNT> Written;
+		// 上次写入时的 _generation，相同时没有需要写入的下标
+		uint64_t SyncedGeneration = 0;
+	};
+
+	uint32_t _allocate(Binding binding);
+	void _mark_dirty(Binding binding, uint32_t index);
+
+private:
+	VkDevice _device = VK_NULL_HANDLE;
+	VkDescriptorSetLayout _set_layout = VK_NULL_HANDLE;
+	VkDescriptorPool _descriptor_pool = VK_NULL_HANDLE;
+	VkSampler _default_sampler = VK_NULL_HANDLE;
+
+	std::array<Slots, BINDING_COUNT> _slots;
+	// 各下标当前的描述符（CPU 侧的副本），BeginFrame 从这里取最新值写入
+	std::vector<VkDescriptorImageInfo> _textures;
+	std::vector<VkDescriptorImageInfo> _samplers;
+	std::vector<VkDescriptorBufferInfo> _buffers;
+	// 各下标的版本，每次改动加一
+	std::array<std::vector<uint32_t>, BINDING_COUNT> _generations;
+	// 所有下标改动的总次数
+	uint64_t _generation = 0;
+	std::vector<FrameResources> _frames;
+
+	VkDescriptorImageInfo _fallback_texture{};
+	VkDescriptorBufferInfo _fallback_buffer{};
+
+	uint64_t _descriptor_writes = 0;
+	uint64_t _update_calls = 0;
+};
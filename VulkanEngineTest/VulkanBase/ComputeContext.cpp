@@ -0,0 +1,558 @@
+﻿// 模拟预处理头
+#include "VulkanMemoryAllocator/VmaUsage.h"
+
+#include "ComputeContext.h"
+#include "ShaderCompiler.h"
+#include "Tracer.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+
+bool ComputeContext::Init(VkPhysicalDevice physical_device, VkDevice device, VkQueue queue, uint32_t queue_family_index)
+{
+	_device = device;
+	_queue = queue;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physical_device, &properties);
+	_max_group_count_x = properties.limits.maxComputeWorkGroupCount[0];
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queueFamilyCount, queueFamilies.data());
+	// 不支持时间戳时只是不统计批次的 GPU 耗时
+	if (queue_family_index < queueFamilyCount && queueFamilies[queue_family_index].timestampValidBits > 0)
+		_timestamp_period = double(properties.limits.timestampPeriod);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = queue_family_index;
+	if (VkResult result = vkCreateCommandPool(_device, &poolInfo, nullptr, &_command_pool))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "ComputeContext : failed to create command pool! Error code: {}", int32_t(result));
+		return false;
+	}
+
+	_shutdown = false;
+	_thread = std::thread(&ComputeContext::_worker, this);
+
+	LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "ComputeContext : queue family {}, max group count x {}, timestamps {}",
+		queue_family_index, _max_group_count_x, _timestamp_period > 0.0);
+	return true;
+}
+
+void ComputeContext::CleanUp()
+{
+	// 还在录制的批次直接丢弃
+	_recording = nullptr;
+	if (_thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_shutdown = true;
+		}
+		_wake.notify_all();
+		_thread.join();
+	}
+	_in_flight.clear();
+	_completed.clear();
+	_free_batches.clear();
+
+	for (auto& batch : _batches)
+	{
+		if (batch->Fence)
+			vkDestroyFence(_device, batch->Fence, nullptr);
+		if (batch->DescriptorPool)
+			vkDestroyDescriptorPool(_device, batch->DescriptorPool, nullptr);
+		if (batch->QueryPool)
+			vkDestroyQueryPool(_device, batch->QueryPool, nullptr);
+	}
+	_batches.clear();
+
+	for (auto& kernel : _kernels)
+	{
+		if (kernel.Pipeline)
+			vkDestroyPipeline(_device, kernel.Pipeline, nullptr);
+		if (kernel.PipelineLayout)
+			vkDestroyPipelineLayout(_device, kernel.PipelineLayout, nullptr);
+		if (kernel.SetLayout)
+			vkDestroyDescriptorSetLayout(_device, kernel.SetLayout, nullptr);
+	}
+	_kernels.clear();
+
+	// 命令缓冲随命令池一起释放
+	if (_command_pool)
+		vkDestroyCommandPool(_device, _command_pool, nullptr);
+	_command_pool = VK_NULL_HANDLE;
+	_bound_kernel = INVALID_KERNEL;
+}
+
+ComputeContext::KernelHandle ComputeContext::CreateKernel(const std::string& spv_path, uint32_t buffer_count, uint32_t push_constant_size)
+{
+	TRACE_ZONE_DETAIL("CreateComputePipeline", "pipeline", spv_path);
+
+	if (buffer_count > MAX_BUFFERS_PER_KERNEL || push_constant_size > MAX_PUSH_CONSTANT_SIZE || push_constant_size % 4 != 0)
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "ComputeContext : invalid kernel layout ({} buffers, {} bytes push constants) : {}", buffer_count, push_constant_size, spv_path);
+		return INVALID_KERNEL;
+	}
+
+	auto code = ShaderCompiler::ReadFile(spv_path);
+	if (code.empty() || code.size() % 4 != 0)
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "ComputeContext : failed to read shader : {}", spv_path);
+		return INVALID_KERNEL;
+	}
+
+	Kernel kernel;
+	kernel.BufferCount = buffer_count;
+	kernel.PushConstantSize = push_constant_size;
+	if (!_read_local_size(code, kernel.GroupSize))
+		LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "ComputeContext : no LocalSize in {}, assuming 1x1x1", spv_path);
+
+	std::array<VkDescriptorSetLayoutBinding, MAX_BUFFERS_PER_KERNEL> bindings{};
+	for (uint32_t i = 0; i < buffer_count; ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = buffer_count;
+	layoutInfo.pBindings = bindings.data();
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = push_constant_size;
+
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = code.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+	VkShaderModule shaderModule = VK_NULL_HANDLE;
+
+	bool created = false;
+	if (VkResult result = vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &kernel.SetLayout))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "ComputeContext : failed to create descriptor set layout! Error code: {}", int32_t(result));
+	}
+	else
+	{
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &kernel.SetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = push_constant_size > 0 ? 1 : 0;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		VkResult result = vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &kernel.PipelineLayout);
+		if (result != VK_SUCCESS)
+		{
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "ComputeContext : failed to create pipeline layout! Error code: {}", int32_t(result));
+		}
+		else if ((result = vkCreateShaderModule(_device, &moduleInfo, nullptr, &shaderModule)) != VK_SUCCESS)
+		{
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "ComputeContext : failed to create shader module! Error code: {}", int32_t(result));
+		}
+		else
+		{
+			VkComputePipelineCreateInfo pipelineInfo{};
+			pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+			pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+			pipelineInfo.stage.module = shaderModule;
+			pipelineInfo.stage.pName = "main";
+			pipelineInfo.layout = kernel.PipelineLayout;
+			result = vkCreateComputePipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &kernel.Pipeline);
+			if (result != VK_SUCCESS)
+				LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "ComputeContext : failed to create compute pipeline! Error code: {}", int32_t(result));
+			else
+				created = true;
+			vkDestroyShaderModule(_device, shaderModule, nullptr);
+		}
+	}
+
+	if (!created)
+	{
+		if (kernel.PipelineLayout)
+			vkDestroyPipelineLayout(_device, kernel.PipelineLayout, nullptr);
+		if (kernel.SetLayout)
+			vkDestroyDescriptorSetLayout(_device, kernel.SetLayout, nullptr);
+		return INVALID_KERNEL;
+	}
+
+	LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "ComputeContext : kernel {} : {} buffers, group size {}x{}x{}",
+		spv_path, buffer_count, kernel.GroupSize[0], kernel.GroupSize[1], kernel.GroupSize[2]);
+	_kernels.push_back(kernel);
+	return static_cast<KernelHandle>(_kernels.size() - 1);
+}
+
+std::array<uint32_t, 3> ComputeContext::GetGroupSize(KernelHandle kernel) const
+{
+	if (kernel >= _kernels.size())
+		return { 1, 1, 1 };
+	return _kernels[kernel].GroupSize;
+}
+
+bool ComputeContext::Dispatch(KernelHandle kernel, std::initializer_list<VkBuffer> buffers, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z,
+	const void* push_constants)
+{
+	if (kernel >= _kernels.size() || buffers.size() != _kernels[kernel].BufferCount)
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "ComputeContext : invalid dispatch (kernel {}, {} buffers)", kernel, buffers.size());
+		return false;
+	}
+	auto& info = _kernels[kernel];
+
+	Batch* batch = _recording_batch();
+	if (batch && batch->DispatchCount >= MAX_DISPATCHES_PER_BATCH)
+	{
+		// 描述符集用完：先提交已录制的部分，新批次开头的屏障保证前后顺序
+		++_stats.AutoFlushes;
+		_submit(nullptr);
+		batch = _recording_batch();
+	}
+	if (!batch)
+		return false;
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = batch->DescriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &info.SetLayout;
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	if (VkResult result = vkAllocateDescriptorSets(_device, &allocInfo, &set))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "ComputeContext : failed to allocate descriptor set! Error code: {}", int32_t(result));
+		return false;
+	}
+
+	std::array<VkDescriptorBufferInfo, MAX_BUFFERS_PER_KERNEL> bufferInfos{};
+	std::array<VkWriteDescriptorSet, MAX_BUFFERS_PER_KERNEL> writes{};
+	uint32_t binding = 0;
+	for (VkBuffer buffer : buffers)
+	{
+		bufferInfos[binding].buffer = buffer;
+		bufferInfos[binding].offset = 0;
+		bufferInfos[binding].range = VK_WHOLE_SIZE;
+
+		writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[binding].dstSet = set;
+		writes[binding].dstBinding = binding;
+		writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[binding].descriptorCount = 1;
+		writes[binding].pBufferInfo = &bufferInfos[binding];
+		++binding;
+	}
+	vkUpdateDescriptorSets(_device, binding, writes.data(), 0, nullptr);
+
+	if (_bound_kernel != kernel)
+	{
+		vkCmdBindPipeline(batch->CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, info.Pipeline);
+		_bound_kernel = kernel;
+	}
+	vkCmdBindDescriptorSets(batch->CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, info.PipelineLayout, 0, 1, &set, 0, nullptr);
+	if (info.PushConstantSize > 0 && push_constants)
+		vkCmdPushConstants(batch->CommandBuffer, info.PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, info.PushConstantSize, push_constants);
+	vkCmdDispatch(batch->CommandBuffer, group_count_x, group_count_y, group_count_z);
+
+	++batch->DispatchCount;
+	++_stats.Dispatches;
+	return true;
+}
+
+bool ComputeContext::DispatchThreads(KernelHandle kernel, std::initializer_list<VkBuffer> buffers, uint32_t thread_count, const void* push_constants)
+{
+	uint32_t groupSize = GetGroupSize(kernel)[0];
+	uint32_t groups = std::min((thread_count + groupSize - 1) / groupSize, _max_group_count_x);
+	return Dispatch(kernel, buffers, std::max(groups, 1u), 1, 1, push_constants);
+}
+
+void ComputeContext::CopyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size, VkDeviceSize src_offset, VkDeviceSize dst_offset)
+{
+	Batch* batch = _recording_batch();
+	if (!batch)
+		return;
+	VkBufferCopy copyRegion{ src_offset, dst_offset, size };
+	vkCmdCopyBuffer(batch->CommandBuffer, src_buffer, dst_buffer, 1, &copyRegion);
+}
+
+void ComputeContext::Barrier()
+{
+	Batch* batch = _recording_batch();
+	if (!batch)
+		return;
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	constexpr VkPipelineStageFlags stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+	vkCmdPipelineBarrier(batch->CommandBuffer, stages, stages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void ComputeContext::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_idle.wait(lock, [this] { return _in_flight.empty(); });
+}
+
+uint32_t ComputeContext::GetRecordedDispatchCount() const
+{
+	return _recording ? _recording->DispatchCount : 0;
+}
+
+ComputeContext::Batch* ComputeContext::_recording_batch()
+{
+	if (_recording)
+		return _recording;
+
+	Batch* batch = _acquire_batch();
+	if (!batch)
+		return nullptr;
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	if (VkResult result = vkBeginCommandBuffer(batch->CommandBuffer, &beginInfo))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "ComputeContext : failed to begin command buffer! Error code: {}", int32_t(result));
+		_free_batches.push_back(batch);
+		return nullptr;
+	}
+
+	if (batch->QueryPool)
+	{
+		vkCmdResetQueryPool(batch->CommandBuffer, batch->QueryPool, 0, 2);
+		vkCmdWriteTimestamp(batch->CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, batch->QueryPool, 0);
+	}
+
+	// 同一队列上之前提交的计算 / 拷贝写入对本批次可见
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	constexpr VkPipelineStageFlags stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+	vkCmdPipelineBarrier(batch->CommandBuffer, stages | VK_PIPELINE_STAGE_HOST_BIT, stages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	_bound_kernel = INVALID_KERNEL;
+	_recording = batch;
+	return batch;
+}
+
+ComputeContext::Batch* ComputeContext::_acquire_batch()
+{
+	_reclaim_completed();
+	if (!_free_batches.empty())
+	{
+		Batch* batch = _free_batches.back();
+		_free_batches.pop_back();
+		return batch;
+	}
+
+	auto batch = std::make_unique<Batch>();
+	if (!_create_batch(*batch))
+	{
+		if (batch->Fence)
+			vkDestroyFence(_device, batch->Fence, nullptr);
+		if (batch->DescriptorPool)
+			vkDestroyDescriptorPool(_device, batch->DescriptorPool, nullptr);
+		if (batch->QueryPool)
+			vkDestroyQueryPool(_device, batch->QueryPool, nullptr);
+		return nullptr;
+	}
+	_batches.push_back(std::move(batch));
+	return _batches.back().get();
+}
+
+bool ComputeContext::_create_batch(Batch& batch)
+{
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = _command_pool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+	if (VkResult result = vkAllocateCommandBuffers(_device, &allocInfo, &batch.CommandBuffer))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "ComputeContext : failed to allocate command buffer! Error code: {}", int32_t(result));
+		return false;
+	}
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	if (VkResult result = vkCreateFence(_device, &fenceInfo, nullptr, &batch.Fence))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "ComputeContext : failed to create fence! Error code: {}", int32_t(result));
+		return false;
+	}
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = MAX_DISPATCHES_PER_BATCH * MAX_BUFFERS_PER_KERNEL;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	poolInfo.maxSets = MAX_DISPATCHES_PER_BATCH;
+	if (VkResult result = vkCreateDescriptorPool(_device, &poolInfo, nullptr, &batch.DescriptorPool))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "ComputeContext : failed to create descriptor pool! Error code: {}", int32_t(result));
+		return false;
+	}
+
+	if (_timestamp_period > 0.0)
+	{
+		VkQueryPoolCreateInfo queryPoolInfo{};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = 2;
+		if (vkCreateQueryPool(_device, &queryPoolInfo, nullptr, &batch.QueryPool) != VK_SUCCESS)
+			batch.QueryPool = VK_NULL_HANDLE;
+	}
+	return true;
+}
+
+void ComputeContext::_reclaim_completed()
+{
+	std::vector<Batch*> completed;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		completed.swap(_completed);
+	}
+	for (Batch* batch : completed)
+	{
+		// 等待线程已不再访问这些批次
+		vkResetFences(_device, 1, &batch->Fence);
+		vkResetDescriptorPool(_device, batch->DescriptorPool, 0);
+		vkResetCommandBuffer(batch->CommandBuffer, 0);
+		batch->DispatchCount = 0;
+		_free_batches.push_back(batch);
+	}
+}
+
+bool ComputeContext::_submit(std::function<void(bool)> on_complete)
+{
+	TRACE_ZONE("ComputeSubmit");
+
+	Batch* batch = _recording_batch();
+	if (!batch)
+	{
+		if (on_complete)
+			on_complete(false);
+		return false;
+	}
+	_recording = nullptr;
+
+	// 结果对主机可见（完成回调里读取映射的缓冲）
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(batch->CommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+	if (batch->QueryPool)
+		vkCmdWriteTimestamp(batch->CommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, batch->QueryPool, 1);
+
+	VkResult result = vkEndCommandBuffer(batch->CommandBuffer);
+	if (result == VK_SUCCESS)
+	{
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &batch->CommandBuffer;
+		result = vkQueueSubmit(_queue, 1, &submitInfo, batch->Fence);
+	}
+	if (result != VK_SUCCESS)
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "ComputeContext : failed to submit batch! Error code: {}", int32_t(result));
+		vkResetCommandBuffer(batch->CommandBuffer, 0);
+		vkResetDescriptorPool(_device, batch->DescriptorPool, 0);
+		batch->DispatchCount = 0;
+		_free_batches.push_back(batch);
+		if (on_complete)
+			on_complete(false);
+		return false;
+	}
+
+	++_stats.Submits;
+	batch->OnComplete = std::move(on_complete);
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_in_flight.push_back(batch);
+	}
+	_wake.notify_one();
+	return true;
+}
+
+void ComputeContext::_worker()
+{
+	Tracer::Get().SetThreadName("ComputeWait");
+
+	for (;;)
+	{
+		Batch* batch = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			// 关闭时先把已提交的批次等完，保证每个 future 都有结果
+			_wake.wait(lock, [this] { return _shutdown || !_in_flight.empty(); });
+			if (_in_flight.empty())
+				return;
+			batch = _in_flight.front();
+		}
+
+		VkResult result = vkWaitForFences(_device, 1, &batch->Fence, VK_TRUE, UINT64_MAX);
+		if (result == VK_SUCCESS && batch->QueryPool)
+		{
+			uint64_t timestamps[2] = {};
+			if (vkGetQueryPoolResults(_device, batch->QueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+				_last_batch_gpu_ms.store(double(timestamps[1] - timestamps[0]) * _timestamp_period * 1e-6, std::memory_order_relaxed);
+		}
+		auto onComplete = std::move(batch->OnComplete);
+		batch->OnComplete = nullptr;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_in_flight.pop_front();
+			_completed.push_back(batch);
+		}
+		if (onComplete)
+			onComplete(result == VK_SUCCESS);
+		_idle.notify_all();
+	}
+}
+
+bool ComputeContext::_read_local_size(const std::vector<char>& code, std::array<uint32_t, 3>& group_size)
+{
+	// SPIR-V：5 个字的头，之后每条指令的第一个字高 16 位为字数、低 16 位为操作码
+	constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+	constexpr uint32_t OP_EXECUTION_MODE = 16;
+	constexpr uint32_t EXECUTION_MODE_LOCAL_SIZE = 17;
+
+	size_t wordCount = code.size() / 4;
+	std::vector<uint32_t> words(wordCount);
+	std::memcpy(words.data(), code.data(), wordCount * 4);
+	if (wordCount < 5 || words[0] != SPIRV_MAGIC)
+		return false;
+
+	for (size_t i = 5; i < wordCount;)
+	{
+		uint32_t length = words[i] >> 16;
+		uint32_t opcode = words[i] & 0xFFFF;
+		if (length == 0 || i + length > wordCount)
+			return false;
+		if (opcode == OP_EXECUTION_MODE && length >= 6 && words[i + 2] == EXECUTION_MODE_LOCAL_SIZE)
+		{
+			group_size = { words[i + 3], words[i + 4], words[i + 5] };
+			return true;
+		}
+		i += length;
+	}
+	return false;
+}
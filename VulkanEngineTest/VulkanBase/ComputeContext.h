@@ -0,0 +1,183 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// <summary>
+/// 通用计算调度。内核由编译好的 Slang 计算入口（*.slang.comp.spv，入口名 main）创建，集 0 依次绑定若干存储缓冲，
+/// 可选推送常量；工作组大小从 SPIR-V 的 LocalSize 读取。
+/// Dispatch / CopyBuffer 录制到当前批次的命令缓冲里，许多小调度合并成一次提交；Submit 提交批次并返回 std::future，
+/// 等待线程在围栏发出信号后执行完成回调，回调的返回值（例如从映射缓冲读出的结果）通过 future 交付。
+/// 录制与提交只能在一个线程上进行（与渲染共用队列时就是渲染线程）；完成回调在等待线程上执行，不能再调用本类
+/// </summary>
+class ComputeContext
+{
+public:
+	using KernelHandle = uint32_t;
+	static constexpr KernelHandle INVALID_KERNEL = UINT32_MAX;
+
+	static constexpr uint32_t MAX_BUFFERS_PER_KERNEL = 8;
+	static constexpr uint32_t MAX_PUSH_CONSTANT_SIZE = 128;
+	// 一个批次的描述符集数量，用完时自动提交当前批次并开始新的批次
+	static constexpr uint32_t MAX_DISPATCHES_PER_BATCH = 1024;
+
+	struct Stats
+	{
+		uint64_t Dispatches = 0;
+		uint64_t Submits = 0;
+		// 描述符集用完导致的自动提交
+		uint64_t AutoFlushes = 0;
+	};
+
+	ComputeContext() = default;
+	~ComputeContext() = default;
+
+	bool Init(VkPhysicalDevice physical_device, VkDevice device, VkQueue queue, uint32_t queue_family_index);
+	/// <summary>
+	/// 等待所有批次完成（完成回调都会执行）后销毁内核与批次资源
+	/// </summary>
+	void CleanUp();
+
+	/// <summary>
+	/// buffer_count 个存储缓冲依次在集 0 的 binding 0, 1, ...；失败返回 INVALID_KERNEL
+	/// </summary>
+	KernelHandle CreateKernel(const std::string& spv_path, uint32_t buffer_count, uint32_t push_constant_size = 0);
+	std::array<uint32_t, 3> GetGroupSize(KernelHandle kernel) const;
+	/// <summary>
+	/// x 方向的工作组数上限；线程数更多时内核需要按网格步长循环
+	/// </summary>
+	uint32_t GetMaxGroupCountX() const { return _max_group_count_x; }
+
+	/// <summary>
+	/// 录制一次调度。buffers 按 binding 顺序给出，整个缓冲绑定；push_constants 的大小为创建内核时给出的大小
+	/// </summary>
+	bool Dispatch(KernelHandle kernel, std::initializer_list<VkBuffer> buffers, uint32_t group_count_x, uint32_t group_count_y = 1, uint32_t group_count_z = 1,
+		const void* push_constants = nullptr);
+	/// <summary>
+	/// 按一维线程数换算工作组数（向上取整，并截断到 GetMaxGroupCountX）
+	/// </summary>
+	bool DispatchThreads(KernelHandle kernel, std::initializer_list<VkBuffer> buffers, uint32_t thread_count, const void* push_constants = nullptr);
+	void CopyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size, VkDeviceSize src_offset = 0, VkDeviceSize dst_offset = 0);
+	/// <summary>
+	/// 之后录制的调度 / 拷贝能看到之前的写入。同一批次内默认不插入屏障，相互独立的调度可以并行执行
+	/// </summary>
+	void Barrier();
+
+	/// <summary>
+	/// 提交当前批次（没有录制任何内容时提交一个空批次）。批次完成后在等待线程上调用 on_complete，
+	/// 其返回值或抛出的异常通过 future 交付；提交失败时 future 持有异常
+	/// </summary>
+	template<typename T>
+	std::future<T> Submit(std::function<T()> on_complete);
+	std::future<void> Submit() { return Submit<void>([] {}); }
+	/// <summary>
+	/// 等待所有已提交的批次完成
+	/// </summary>
+	void WaitIdle();
+
+	uint32_t GetRecordedDispatchCount() const;
+	/// <summary>
+	/// 最近完成的批次在 GPU 上的耗时（时间戳），不支持时为 0
+	/// </summary>
+	double GetLastBatchGpuMs() const { return _last_batch_gpu_ms.load(std::memory_order_relaxed); }
+	const Stats& GetStats() const { return _stats; }
+
+private:
+	struct Kernel
+	{
+		VkDescriptorSetLayout SetLayout = VK_NULL_HANDLE;
+		VkPipelineLayout PipelineLayout = VK_NULL_HANDLE;
+		VkPipeline Pipeline = VK_NULL_HANDLE;
+		uint32_t BufferCount = 0;
+		uint32_t PushConstantSize = 0;
+		std::array<uint32_t, 3> GroupSize = { 1, 1, 1 };
+	};
+
+	struct Batch
+	{
+		VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+		VkFence Fence = VK_NULL_HANDLE;
+		VkDescriptorPool DescriptorPool = VK_NULL_HANDLE;
+		VkQueryPool QueryPool = VK_NULL_HANDLE;
+		uint32_t DispatchCount = 0;
+		// 参数为 false 表示提交或等待失败
+		std::function<void(bool)> OnComplete;
+	};
+
+	Batch* _recording_batch();
+	Batch* _acquire_batch();
+	bool _create_batch(Batch& batch);
+	void _reclaim_completed();
+	bool _submit(std::function<void(bool)> on_complete);
+	void _worker();
+	static bool _read_local_size(const std::vector<char>& code, std::array<uint32_t, 3>& group_size);
+
+private:
+	VkDevice _device = VK_NULL_HANDLE;
+	VkQueue _queue = VK_NULL_HANDLE;
+	VkCommandPool _command_pool = VK_NULL_HANDLE;
+	uint32_t _max_group_count_x = 65535;
+	double _timestamp_period = 0.0;
+
+	std::vector<Kernel> _kernels;
+
+	// 以下只在录制线程上访问
+	std::vector<std::unique_ptr<Batch>> _batches;
+	std::vector<Batch*> _free_batches;
+	Batch* _recording = nullptr;
+	KernelHandle _bound_kernel = INVALID_KERNEL;
+	Stats _stats;
+
+	// 与等待线程共享
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _idle;
+	std::deque<Batch*> _in_flight;
+	std::vector<Batch*> _completed;
+	bool _shutdown = false;
+	std::thread _thread;
+	std::atomic<double> _last_batch_gpu_ms{ 0.0 };
+};
+
+template<typename T>
+std::future<T> ComputeContext::Submit(std::function<T()> on_complete)
+{
+	auto promise = std::make_shared<std::promise<T>>();
+	std::future<T> future = promise->get_future();
+	_submit([promise, on_complete = std::move(on_complete)](bool completed) {
+		try
+		{
+			if (!completed)
+				throw std::runtime_error("compute batch failed");
+			if constexpr (std::is_void_v<T>)
+			{
+				on_complete();
+				promise->set_value();
+			}
+			else
+			{
+				promise->set_value(on_complete());
+			}
+		}
+		catch (...)
+		{
+			promise->set_exception(std::current_exception());
+		}
+		});
+	return future;
+}
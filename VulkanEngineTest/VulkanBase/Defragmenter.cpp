@@ -0,0 +1,365 @@
+﻿// 模拟预处理头
+#include "VulkanMemoryAllocator/VmaUsage.h"
+
+#include "Defragmenter.h"
+#include "MemoryTracker.h"
+#include "Tracer.h"
+#include "Logger.h"
+
+#include <format>
+
+static constexpr double MB = 1024.0 * 1024.0;
+
+bool Defragmenter::Init(VkDevice device, VmaAllocator allocator, VkQueue queue, uint32_t queue_family_index, uint32_t frames_in_flight,
+	BufferReplacedCallback on_buffer_replaced)
+{
+	_device = device;
+	_allocator = allocator;
+	_queue = queue;
+	_frames_in_flight = frames_in_flight;
+	_on_buffer_replaced = std::move(on_buffer_replaced);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = queue_family_index;
+	if (VkResult result = vkCreateCommandPool(_device, &poolInfo, nullptr, &_command_pool))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Defragmenter : failed to create command pool! Error code: {}", int32_t(result));
+		return false;
+	}
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = _command_pool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+	if (VkResult result = vkAllocateCommandBuffers(_device, &allocInfo, &_command_buffer))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Defragmenter : failed to allocate command buffer! Error code: {}", int32_t(result));
+		CleanUp();
+		return false;
+	}
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	if (VkResult result = vkCreateFence(_device, &fenceInfo, nullptr, &_fence))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Defragmenter : failed to create fence! Error code: {}", int32_t(result));
+		CleanUp();
+		return false;
+	}
+
+	return true;
+}
+
+void Defragmenter::CleanUp()
+{
+	if (_state == STATE_COPYING)
+	{
+		vkWaitForFences(_device, 1, &_fence, VK_TRUE, UINT64_MAX);
+		_swap_buffers();
+		_state = STATE_RETIRING;
+	}
+	if (_state == STATE_RETIRING)
+		_end_pass();
+	if (_context)
+		_finish();
+
+	if (_fence)
+		vkDestroyFence(_device, _fence, nullptr);
+	if (_command_pool)
+		vkDestroyCommandPool(_device, _command_pool, nullptr);
+	_fence = VK_NULL_HANDLE;
+	_command_pool = VK_NULL_HANDLE;
+	_command_buffer = VK_NULL_HANDLE;
+	_buffers.clear();
+}
+
+void Defragmenter::RegisterBuffer(VmaAllocation allocation, VkBuffer* slot, const VkBufferCreateInfo& create_info, BufferMovedCallback on_moved)
+{
+	auto& buffer = _buffers[allocation];
+	buffer.Slot = slot;
+	buffer.CreateInfo = create_info;
+	// 不保留调用者的 pNext；CONCURRENT 的队列族拷贝一份，新缓冲保持同样的共享方式
+	buffer.CreateInfo.pNext = nullptr;
+	if (create_info.sharingMode == VK_SHARING_MODE_CONCURRENT && create_info.pQueueFamilyIndices)
+		buffer.QueueFamilyIndices.assign(create_info.pQueueFamilyIndices, create_info.pQueueFamilyIndices + create_info.queueFamilyIndexCount);
+	else
+		buffer.QueueFamilyIndices.clear();
+	buffer.CreateInfo.queueFamilyIndexCount = static_cast<uint32_t>(buffer.QueueFamilyIndices.size());
+	buffer.CreateInfo.pQueueFamilyIndices = nullptr;
+	if (buffer.QueueFamilyIndices.empty())
+		buffer.CreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	buffer.OnMoved = std::move(on_moved);
+}
+
+bool Defragmenter::OnDestroyBuffer(VmaAllocation allocation)
+{
+	if (!_buffers.erase(allocation))
+		return false;
+
+	for (auto& pending : _pending)
+	{
+		if (pending.Allocation != allocation)
+			continue;
+		// 拷贝可能仍在进行，或旧缓冲仍被在途的帧引用：两个 VkBuffer 都在 pass 结束时销毁，分配由 VMA 释放
+		pending.Destroyed = true;
+		_moves[pending.MoveIndex].operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_DESTROY;
+		return true;
+	}
+	return false;
+}
+
+void Defragmenter::Update()
+{
+	if (!_allocator || !_fence)
+		return;
+
+	++_frame;
+	switch (_state)
+	{
+	case STATE_IDLE:
+		if (_requested || (_auto && _frame >= _next_check_frame && _should_start()))
+		{
+			_requested = false;
+			if (_begin())
+				_begin_pass();
+		}
+		break;
+	case STATE_BEGIN_PASS:
+		_begin_pass();
+		break;
+	case STATE_COPYING:
+		if (vkGetFenceStatus(_device, _fence) == VK_SUCCESS)
+		{
+			_swap_buffers();
+			// 之后录制的帧都使用新缓冲，再等 frames in flight 帧，旧缓冲就不再被引用
+			_retire_frame = _frame + _frames_in_flight;
+			_state = STATE_RETIRING;
+		}
+		break;
+	case STATE_RETIRING:
+		if (_frame >= _retire_frame)
+			_end_pass();
+		break;
+	}
+}
+
+bool Defragmenter::_should_start()
+{
+	_next_check_frame = _frame + CHECK_INTERVAL_FRAMES;
+	if (_buffers.empty())
+		return false;
+
+	for (auto& heap : MemoryTracker::Get().GetHeaps())
+	{
+		VkDeviceSize freeBytes = heap.BlockBytes > heap.AllocationBytes ? heap.BlockBytes - heap.AllocationBytes : 0;
+		if (freeBytes >= FRAGMENTATION_MIN_BYTES && double(freeBytes) >= double(heap.BlockBytes) * FRAGMENTATION_RATIO)
+		{
+			LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "Defragmenter : {:.1f} MB of {:.1f} MB free inside memory blocks, starting defragmentation",
+				freeBytes / MB, heap.BlockBytes / MB);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Defragmenter::_begin()
+{
+	VmaDefragmentationInfo info{};
+	info.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+	info.pool = nullptr;
+	info.maxBytesPerPass = _bytes_per_pass;
+	info.maxAllocationsPerPass = DEFAULT_ALLOCATIONS_PER_PASS;
+	if (VkResult result = vmaBeginDefragmentation(_allocator, &info, &_context))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Defragmenter : vmaBeginDefragmentation failed! Error code: {}", int32_t(result));
+		_context = nullptr;
+		return false;
+	}
+	++_stats.Runs;
+	_state = STATE_BEGIN_PASS;
+	return true;
+}
+
+void Defragmenter::_begin_pass()
+{
+	TRACE_ZONE_DETAIL("DefragmentPass", "memory", std::format("pass {}", _stats.Passes));
+
+	VmaDefragmentationPassMoveInfo pass{};
+	VkResult result = vmaBeginDefragmentationPass(_allocator, _context, &pass);
+	if (result == VK_SUCCESS)
+	{
+		// 没有需要移动的分配
+		_finish();
+		return;
+	}
+	if (result != VK_INCOMPLETE)
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Defragmenter : vmaBeginDefragmentationPass failed! Error code: {}", int32_t(result));
+		_finish();
+		return;
+	}
+	++_stats.Passes;
+
+	_moves = pass.pMoves;
+	_move_count = pass.moveCount;
+	_pending.clear();
+	for (uint32_t i = 0; i < pass.moveCount; ++i)
+	{
+		auto& move = pass.pMoves[i];
+		auto iter = _buffers.find(move.srcAllocation);
+		if (iter == _buffers.end())
+		{
+			// 未登记的分配（图像、映射中的缓冲等）留在原地
+			move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+			continue;
+		}
+
+		VkBufferCreateInfo createInfo = iter->second.CreateInfo;
+		createInfo.pQueueFamilyIndices = iter->second.QueueFamilyIndices.empty() ? nullptr : iter->second.QueueFamilyIndices.data();
+		VkBuffer newBuffer = VK_NULL_HANDLE;
+		if (VkResult result = vkCreateBuffer(_device, &createInfo, nullptr, &newBuffer))
+		{
+			LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "Defragmenter : failed to create buffer! Error code: {}", int32_t(result));
+			move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+			continue;
+		}
+		if (VkResult result = vmaBindBufferMemory(_allocator, move.dstTmpAllocation, newBuffer))
+		{
+			LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "Defragmenter : failed to bind buffer memory! Error code: {}", int32_t(result));
+			vkDestroyBuffer(_device, newBuffer, nullptr);
+			move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+			continue;
+		}
+
+		PendingMove pending;
+		pending.MoveIndex = i;
+		pending.Allocation = move.srcAllocation;
+		pending.OldBuffer = *iter->second.Slot;
+		pending.NewBuffer = newBuffer;
+		_pending.push_back(pending);
+	}
+
+	if (_pending.empty() || !_submit_copies())
+	{
+		// 本 pass 没有可执行的移动，直接结束
+		_end_pass();
+		return;
+	}
+	_state = STATE_COPYING;
+}
+
+bool Defragmenter::_submit_copies()
+{
+	vkResetCommandBuffer(_command_buffer, 0);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(_command_buffer, &beginInfo);
+
+	// 之前提交的写入对拷贝可见
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	vkCmdPipelineBarrier(_command_buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	VkDeviceSize bytes = 0;
+	for (auto& pending : _pending)
+	{
+		VkBufferCopy copyRegion{};
+		copyRegion.size = _buffers[pending.Allocation].CreateInfo.size;
+		vkCmdCopyBuffer(_command_buffer, pending.OldBuffer, pending.NewBuffer, 1, &copyRegion);
+		bytes += copyRegion.size;
+	}
+
+	// 之后提交的帧读取新缓冲
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+	vkCmdPipelineBarrier(_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	vkEndCommandBuffer(_command_buffer);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &_command_buffer;
+
+	vkResetFences(_device, 1, &_fence);
+	if (VkResult result = vkQueueSubmit(_queue, 1, &submitInfo, _fence))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Defragmenter : failed to submit copies! Error code: {}", int32_t(result));
+		for (auto& pending : _pending)
+		{
+			vkDestroyBuffer(_device, pending.NewBuffer, nullptr);
+			_moves[pending.MoveIndex].operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+		}
+		_pending.clear();
+		return false;
+	}
+
+	LOG_VERBOSE(LOG_CATEGORY_VULKAN_BASE, "Defragmenter : pass {} moving {} buffers, {:.2f} MB", _stats.Passes, _pending.size(), bytes / MB);
+	return true;
+}
+
+void Defragmenter::_swap_buffers()
+{
+	for (auto& pending : _pending)
+	{
+		if (pending.Destroyed)
+			continue;
+		auto& buffer = _buffers[pending.Allocation];
+		*buffer.Slot = pending.NewBuffer;
+		if (_on_buffer_replaced)
+			_on_buffer_replaced(pending.OldBuffer, pending.NewBuffer, pending.Allocation);
+		if (buffer.OnMoved)
+			buffer.OnMoved(pending.NewBuffer);
+	}
+}
+
+void Defragmenter::_end_pass()
+{
+	for (auto& pending : _pending)
+	{
+		vkDestroyBuffer(_device, pending.OldBuffer, nullptr);
+		if (pending.Destroyed)
+			vkDestroyBuffer(_device, pending.NewBuffer, nullptr);
+	}
+	_pending.clear();
+
+	VmaDefragmentationPassMoveInfo pass{};
+	pass.moveCount = _move_count;
+	pass.pMoves = _moves;
+	VkResult result = vmaEndDefragmentationPass(_allocator, _context, &pass);
+	_moves = nullptr;
+	_move_count = 0;
+
+	if (result == VK_INCOMPLETE)
+		_state = STATE_BEGIN_PASS;
+	else
+		_finish();
+}
+
+void Defragmenter::_finish()
+{
+	VmaDefragmentationStats stats{};
+	vmaEndDefragmentation(_allocator, _context, &stats);
+	_context = nullptr;
+	_state = STATE_IDLE;
+
+	_stats.AllocationsMoved += stats.allocationsMoved;
+	_stats.BytesMoved += stats.bytesMoved;
+	_stats.BytesFreed += stats.bytesFreed;
+	_stats.BlocksFreed += stats.deviceMemoryBlocksFreed;
+
+	// 没能释放内存块（剩下的多是不可移动的分配）时，推迟下一次检查
+	_next_check_frame = _frame + (stats.deviceMemoryBlocksFreed ? CHECK_INTERVAL_FRAMES : CHECK_INTERVAL_FRAMES * IDLE_BACKOFF);
+
+	LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "Defragmenter : moved {} allocations ({:.2f} MB), freed {} blocks ({:.2f} MB)",
+		stats.allocationsMoved, stats.bytesMoved / MB, stats.deviceMemoryBlocksFreed, stats.bytesFreed / MB);
+}
@@ -0,0 +1,146 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+typedef struct VmaAllocator_T* VmaAllocator;
+typedef struct VmaAllocation_T* VmaAllocation;
+typedef struct VmaDefragmentationContext_T* VmaDefragmentationContext;
+struct VmaDefragmentationMove;
+
+/// <summary>
+/// 增量显存碎片整理。基于 vmaBeginDefragmentation 的多个 pass，每帧最多推进一步，每个 pass 搬运的字节数有上限；
+/// 拷贝命令单独提交并用围栏异步等待，不阻塞渲染。
+/// 只有登记为可移动的缓冲（RegisterBuffer）会被搬运：拷贝完成后把新缓冲写回登记的句柄槽位并通知持有者，
+/// 旧缓冲等仍可能引用它的帧全部结束后才销毁；其余分配（图像、主机可见的缓冲等）保持不动。
+/// </summary>
+class Defragmenter
+{
+public:
+	static constexpr VkDeviceSize DEFAULT_BYTES_PER_PASS = 8ull * 1024 * 1024;
+	static constexpr uint32_t DEFAULT_ALLOCATIONS_PER_PASS = 64;
+	// 自动触发条件：某个堆上 VMA 内存块中的空闲部分超过 FRAGMENTATION_MIN_BYTES，且超过块总量的 FRAGMENTATION_RATIO
+	static constexpr VkDeviceSize FRAGMENTATION_MIN_BYTES = 32ull * 1024 * 1024;
+	static constexpr double FRAGMENTATION_RATIO = 0.25;
+	static constexpr uint64_t CHECK_INTERVAL_FRAMES = 120;
+	// 一次整理没有释放任何内存块时，下一次检查推迟的倍数
+	static constexpr uint64_t IDLE_BACKOFF = 10;
+
+	using BufferMovedCallback = std::function<void(VkBuffer new_buffer)>;
+	using BufferReplacedCallback = std::function<void(VkBuffer old_buffer, VkBuffer new_buffer, VmaAllocation allocation)>;
+
+	struct Stats
+	{
+		uint64_t Runs = 0;
+		uint64_t Passes = 0;
+		uint64_t AllocationsMoved = 0;
+		uint64_t BytesMoved = 0;
+		uint64_t BytesFreed = 0;
+		uint64_t BlocksFreed = 0;
+	};
+
+	Defragmenter() = default;
+	~Defragmenter() = default;
+
+	/// <summary>
+	/// on_buffer_replaced 在每个缓冲换成新句柄时调用，供 VulkanBase 更新 VkBuffer -> VmaAllocation 的映射
+	/// </summary>
+	bool Init(VkDevice device, VmaAllocator allocator, VkQueue queue, uint32_t queue_family_index, uint32_t frames_in_flight,
+		BufferReplacedCallback on_buffer_replaced);
+	/// <summary>
+	/// 需在 GPU 空闲后、销毁登记的缓冲之前调用：完成进行中的 pass 并结束整理
+	/// </summary>
+	void CleanUp();
+
+	/// <summary>
+	/// 登记可移动的缓冲。slot 是持有者保存句柄的位置，搬运后写入新句柄，在缓冲销毁前必须一直有效；
+	/// 缓冲被描述符等其他地方引用时用 on_moved 更新引用。缓冲必须带有 TRANSFER_SRC 与 TRANSFER_DST 用途
+	/// </summary>
+	void RegisterBuffer(VmaAllocation allocation, VkBuffer* slot, const VkBufferCreateInfo& create_info, BufferMovedCallback on_moved = nullptr);
+	/// <summary>
+	/// 缓冲销毁前调用。该缓冲正在被搬运时由整理器接管 VkBuffer 的销毁并让 VMA 释放分配，返回 true，调用者不能再释放
+	/// </summary>
+	bool OnDestroyBuffer(VmaAllocation allocation);
+
+	void SetAutoDefragment(bool enabled) { _auto = enabled; }
+	bool IsAutoDefragment() const { return _auto; }
+	void SetBytesPerPass(VkDeviceSize bytes) { _bytes_per_pass = bytes; }
+	/// <summary>
+	/// 在下一帧开始一次整理（不检查碎片程度）
+	/// </summary>
+	void Request() { _requested = true; }
+	bool IsActive() const { return _state != STATE_IDLE; }
+	const Stats& GetStats() const { return _stats; }
+
+	/// <summary>
+	/// 每帧调用一次（该帧围栏等待之后）
+	/// </summary>
+	void Update();
+
+private:
+	enum State
+	{
+		STATE_IDLE = 0,
+		STATE_BEGIN_PASS,	// 下一帧开始新的 pass
+		STATE_COPYING,		// 拷贝已提交，等待围栏
+		STATE_RETIRING,		// 句柄已替换，等待引用旧缓冲的帧结束
+	};
+
+	struct MovableBuffer
+	{
+		VkBuffer* Slot = nullptr;
+		// pQueueFamilyIndices 不保留，重建时指向 QueueFamilyIndices
+		VkBufferCreateInfo CreateInfo{};
+		std::vector<uint32_t> QueueFamilyIndices;
+		BufferMovedCallback OnMoved;
+	};
+
+	struct PendingMove
+	{
+		uint32_t MoveIndex = 0;
+		VmaAllocation Allocation = nullptr;
+		VkBuffer OldBuffer = VK_NULL_HANDLE;
+		VkBuffer NewBuffer = VK_NULL_HANDLE;
+		bool Destroyed = false;
+	};
+
+	bool _should_start();
+	bool _begin();
+	void _begin_pass();
+	bool _submit_copies();
+	void _swap_buffers();
+	void _end_pass();
+	void _finish();
+
+private:
+	VkDevice _device = VK_NULL_HANDLE;
+	VmaAllocator _allocator = nullptr;
+	VkQueue _queue = VK_NULL_HANDLE;
+	VkCommandPool _command_pool = VK_NULL_HANDLE;
+	VkCommandBuffer _command_buffer = VK_NULL_HANDLE;
+	VkFence _fence = VK_NULL_HANDLE;
+	uint32_t _frames_in_flight = 2;
+	BufferReplacedCallback _on_buffer_replaced;
+
+	std::unordered_map<VmaAllocation, MovableBuffer> _buffers;
+
+	State _state = STATE_IDLE;
+	VmaDefragmentationContext _context = nullptr;
+	// 当前 pass 的移动列表，由 VMA 持有，直到 vmaEndDefragmentationPass
+	VmaDefragmentationMove* _moves = nullptr;
+	uint32_t _move_count = 0;
+	std::vector<PendingMove> _pending;
+
+	bool _auto = true;
+	bool _requested = false;
+	VkDeviceSize _bytes_per_pass = DEFAULT_BYTES_PER_PASS;
+	uint64_t _frame = 0;
+	uint64_t _next_check_frame = CHECK_INTERVAL_FRAMES;
+	uint64_t _retire_frame = 0;
+
+	Stats _stats;
+};
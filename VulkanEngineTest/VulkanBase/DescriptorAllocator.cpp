@@ -0,0 +1,285 @@
+﻿// 模拟预处理头
+#include "VulkanMemoryAllocator/VmaUsage.h"
+
+#include "DescriptorAllocator.h"
+#include "Logger.h"
+
+#include <algorithm>
+
+bool DescriptorAllocator::Init(VkDevice device, uint32_t frames_in_flight)
+{
+	_device = device;
+	_frames.resize(frames_in_flight);
+	return true;
+}
+
+void DescriptorAllocator::CleanUp()
+{
+	_destroy_pools(_persistent);
+	for (auto& frame : _frames)
+		_destroy_pools(frame);
+	_persistent = {};
+	_frames.clear();
+
+	for (auto& [hash, layouts] : _layouts)
+	{
+		for (auto& cached : layouts)
+			vkDestroyDescriptorSetLayout(_device, cached.Layout, nullptr);
+	}
+	_layouts.clear();
+	_layout_info.clear();
+}
+
+VkDescriptorSetLayout DescriptorAllocator::GetLayout(const VkDescriptorSetLayoutBinding* bindings, uint32_t binding_count, VkDescriptorSetLayoutCreateFlags flags)
+{
+	// 这两种布局不能从分配器的池里分配集
+	if (flags & (VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT | VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "DescriptorAllocator : unsupported descriptor set layout flags {}!", uint32_t(flags));
+		return VK_NULL_HANDLE;
+	}
+	for (uint32_t i = 0; i < binding_count; ++i)
+	{
+		// 池的大小只按核心类型估计，扩展类型的集会一直分配失败
+		if (uint32_t(bindings[i].descriptorType) >= DESCRIPTOR_TYPE_COUNT)
+		{
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "DescriptorAllocator : unsupported descriptor type {} at binding {}!", int32_t(bindings[i].descriptorType), bindings[i].binding);
+			return VK_NULL_HANDLE;
+		}
+	}
+
+	std::vector<VkDescriptorSetLayoutBinding> sorted(bindings, bindings + binding_count);
+	std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.binding < b.binding; });
+
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&hash](uint64_t value) {
+		hash ^= value;
+		hash *= 1099511628211ull;
+		};
+	mix(flags);
+	for (const auto& binding : sorted)
+	{
+		mix(binding.binding);
+		mix(uint64_t(binding.descriptorType));
+		mix(binding.descriptorCount);
+		mix(binding.stageFlags);
+		mix(reinterpret_cast<uintptr_t>(binding.pImmutableSamplers));
+	}
+
+	auto same = [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+		return a.binding == b.binding && a.descriptorType == b.descriptorType && a.descriptorCount == b.descriptorCount
+			&& a.stageFlags == b.stageFlags && a.pImmutableSamplers == b.pImmutableSamplers;
+		};
+	auto& bucket = _layouts[hash];
+	for (const auto& cached : bucket)
+	{
+		if (cached.Flags == flags && std::equal(cached.Bindings.begin(), cached.Bindings.end(), sorted.begin(), sorted.end(), same))
+			return cached.Layout;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.flags = flags;
+	layoutInfo.bindingCount = binding_count;
+	layoutInfo.pBindings = sorted.data();
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	if (VkResult result = vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &layout))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "DescriptorAllocator : failed to create descriptor set layout! Error code: {}", int32_t(result));
+		return VK_NULL_HANDLE;
+	}
+
+	DescriptorCounts counts{};
+	for (const auto& binding : sorted)
+		counts[binding.descriptorType] += binding.descriptorCount;
+	_layout_info[layout] = { counts, sorted };
+	bucket.push_back({ flags, std::move(sorted), layout });
+	return layout;
+}
+
+const std::vector<VkDescriptorSetLayoutBinding>* DescriptorAllocator::GetBindings(VkDescriptorSetLayout layout) const
+{
+	auto it = _layout_info.find(layout);
+	return it != _layout_info.end() ? &it->second.Bindings : nullptr;
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout)
+{
+	VkDescriptorSet set = _allocate(_persistent, layout);
+	if (set)
+		++_persistent_sets;
+	return set;
+}
+
+VkDescriptorSet DescriptorAllocator::AllocateTransient(uint32_t frame_index, VkDescriptorSetLayout layout)
+{
+	VkDescriptorSet set = _allocate(_frames[frame_index], layout);
+	if (set)
+		++_transient_sets;
+	return set;
+}
+
+void DescriptorAllocator::BeginFrame(uint32_t frame_index)
+{
+	PoolChain& chain = _frames[frame_index];
+	// 这一帧的用量留 1/4 余量
+	uint64_t wantedSets = chain.Used.Sets + chain.Used.Sets / 4;
+	uint64_t wantedPools = (wantedSets + MAX_POOL_SETS - 1) / MAX_POOL_SETS;
+	if (chain.Pools.size() > std::max<uint64_t>(wantedPools, 1))
+	{
+		// 这一帧用的池比需要的多（逐步翻倍建出来的）：全部销毁，下次分配时按这一帧的总用量建池，超出一个池的上限时都建最大的池
+		chain.Reserve = chain.Used;
+		chain.ReserveSets = uint32_t(std::min<uint64_t>(wantedSets, MAX_POOL_SETS));
+		chain.UnderusedFrames = 0;
+		chain.Peak = {};
+		_destroy_pools(chain);
+	}
+	else if (chain.Pools.size() > 1)
+	{
+		// 一个池容纳不下且池数已经合适：保留这一帧用到的池逐个重置，之后没用到的池销毁
+		for (uint32_t i = static_cast<uint32_t>(chain.Pools.size()) - 1; i > chain.Current; --i)
+		{
+			vkDestroyDescriptorPool(_device, chain.Pools[i], nullptr);
+			chain.Pools.pop_back();
+		}
+		for (auto pool : chain.Pools)
+			vkResetDescriptorPool(_device, pool, 0);
+		_pool_resets += chain.Pools.size();
+	}
+	else if (chain.Pools.size() == 1 && chain.LargestPoolSets > INITIAL_POOL_SETS && wantedSets * 4 <= chain.LargestPoolSets)
+	{
+		// 用量回落：持续 SHRINK_AFTER_FRAMES 帧后按这段时间的峰值重建
+		if (chain.Used.Sets > chain.Peak.Sets)
+			chain.Peak = chain.Used;
+		if (++chain.UnderusedFrames >= SHRINK_AFTER_FRAMES)
+		{
+			chain.Reserve = chain.Peak;
+			chain.ReserveSets = uint32_t(chain.Peak.Sets + chain.Peak.Sets / 4);
+			chain.UnderusedFrames = 0;
+			chain.Peak = {};
+			_destroy_pools(chain);
+		}
+		else if (chain.Used.Sets > 0)
+		{
+			vkResetDescriptorPool(_device, chain.Pools[0], 0);
+			++_pool_resets;
+		}
+	}
+	else if (chain.Pools.size() == 1)
+	{
+		chain.UnderusedFrames = 0;
+		chain.Peak = {};
+		if (chain.Used.Sets > 0)
+		{
+			vkResetDescriptorPool(_device, chain.Pools[0], 0);
+			++_pool_resets;
+		}
+	}
+	chain.Current = 0;
+	chain.Used = {};
+}
+
+DescriptorAllocator::Stats DescriptorAllocator::GetStats() const
+{
+	Stats stats;
+	for (const auto& [hash, layouts] : _layouts)
+		stats.Layouts += static_cast<uint32_t>(layouts.size());
+	stats.PersistentPools = static_cast<uint32_t>(_persistent.Pools.size());
+	for (const auto& frame : _frames)
+		stats.FramePools += static_cast<uint32_t>(frame.Pools.size());
+	stats.PersistentSets = _persistent_sets;
+	stats.TransientSets = _transient_sets;
+	stats.PoolsCreated = _pools_created;
+	stats.PoolResets = _pool_resets;
+	stats.PoolSwitches = _pool_switches;
+	return stats;
+}
+
+VkDescriptorSet DescriptorAllocator::_allocate(PoolChain& chain, VkDescriptorSetLayout layout)
+{
+	auto infoIt = _layout_info.find(layout);
+	DescriptorCounts counts = infoIt != _layout_info.end() ? infoIt->second.Counts : DescriptorCounts{};
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	bool created = false;
+	while (true)
+	{
+		if (chain.Current >= chain.Pools.size())
+		{
+			if (!_create_pool(chain, counts))
+				return VK_NULL_HANDLE;
+			created = true;
+		}
+
+		allocInfo.descriptorPool = chain.Pools[chain.Current];
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		VkResult result = vkAllocateDescriptorSets(_device, &allocInfo, &set);
+		if (result == VK_SUCCESS)
+		{
+			++chain.Used.Sets;
+			for (uint32_t type = 0; type < DESCRIPTOR_TYPE_COUNT; ++type)
+				chain.Used.Descriptors[type] += counts[type];
+			return set;
+		}
+		// 刚按这个集的需求建的池也分配不了，说明不是池的大小问题
+		if (created || (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL))
+		{
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "DescriptorAllocator : failed to allocate descriptor set! Error code: {}", int32_t(result));
+			return VK_NULL_HANDLE;
+		}
+		++chain.Current;
+		++_pool_switches;
+	}
+}
+
+bool DescriptorAllocator::_create_pool(PoolChain& chain, const DescriptorCounts& counts)
+{
+	uint32_t sets = std::min(std::max({ INITIAL_POOL_SETS, chain.LargestPoolSets * 2, chain.ReserveSets }), MAX_POOL_SETS);
+
+	// 每种类型按观察到的平均每集用量乘以集数；从没见过的类型假设所有集都像这个集
+	const Usage& observed = chain.Used.Sets ? chain.Used : chain.Reserve;
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for (uint32_t type = 0; type < DESCRIPTOR_TYPE_COUNT; ++type)
+	{
+		uint64_t descriptors = observed.Sets ? (observed.Descriptors[type] * sets + observed.Sets - 1) / observed.Sets : 0;
+		if (counts[type])
+			descriptors = std::max<uint64_t>(descriptors, descriptors ? counts[type] : uint64_t(counts[type]) * sets);
+		if (descriptors)
+			poolSizes.push_back({ VkDescriptorType(type), uint32_t(std::min<uint64_t>(descriptors, UINT32_MAX)) });
+	}
+	// 没有描述符的布局（空集）也需要至少一项
+	if (poolSizes.empty())
+		poolSizes.push_back({ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 });
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = sets;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	if (VkResult result = vkCreateDescriptorPool(_device, &poolInfo, nullptr, &pool))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "DescriptorAllocator : failed to create descriptor pool ({} sets)! Error code: {}", sets, int32_t(result));
+		return false;
+	}
+
+	chain.Pools.push_back(pool);
+	chain.Current = static_cast<uint32_t>(chain.Pools.size() - 1);
+	chain.LargestPoolSets = std::max(chain.LargestPoolSets, sets);
+	++_pools_created;
+	return true;
+}
+
+void DescriptorAllocator::_destroy_pools(PoolChain& chain)
+{
+	for (auto pool : chain.Pools)
+		vkDestroyDescriptorPool(_device, pool, nullptr);
+	chain.Pools.clear();
+	chain.Current = 0;
+	chain.LargestPoolSets = 0;
+}
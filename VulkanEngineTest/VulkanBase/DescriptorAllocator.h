@@ -0,0 +1,139 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// 描述符集分配器。集从池链里分配：当前池用完（OUT_OF_POOL_MEMORY / FRAGMENTED_POOL）时换到链上的下一个池，
+/// 没有时按已观察到的用量（每个集平均的各类型描述符数）创建更大的池，分配不会因为池的大小而失败。
+/// 常驻集在 CleanUp 之前一直有效；瞬时集属于某个在途帧，该帧下一次 BeginFrame 时随整个池一起重置（vkResetDescriptorPool），
+/// 不逐个释放。一帧用到多个池时，下一次重置改为按这一帧的总用量创建一个池（不超过 MAX_POOL_SETS），稳定之后每帧只有一次重置、分配不再建池；
+/// 用量回落后池连续 SHRINK_AFTER_FRAMES 帧用不到四分之一时，按这段时间的峰值重建较小的池。
+/// 集布局按绑定缓存，相同的绑定只创建一次，由分配器持有。只能在一个线程上使用（渲染线程）
+/// </summary>
+class DescriptorAllocator
+{
+public:
+	// 第一个池的集数，之后的池至少翻倍，直到 MAX_POOL_SETS
+	static constexpr uint32_t INITIAL_POOL_SETS = 64;
+	static constexpr uint32_t MAX_POOL_SETS = 4096;
+	// 帧链的池连续这么多帧用量不到四分之一时缩小
+	static constexpr uint32_t SHRINK_AFTER_FRAMES = 120;
+
+	struct Stats
+	{
+		uint32_t Layouts = 0;
+		uint32_t PersistentPools = 0;
+		uint32_t FramePools = 0;
+		uint64_t PersistentSets = 0;
+		uint64_t TransientSets = 0;
+		uint64_t PoolsCreated = 0;
+		uint64_t PoolResets = 0;
+		// 当前池用完、换到下一个池的次数
+		uint64_t PoolSwitches = 0;
+	};
+
+	DescriptorAllocator() = default;
+	~DescriptorAllocator() = default;
+
+	bool Init(VkDevice device, uint32_t frames_in_flight);
+	/// <summary>
+	/// 需在 GPU 空闲后调用：销毁所有池（及其中的集）与缓存的布局
+	/// </summary>
+	void CleanUp();
+
+	/// <summary>
+	/// 按绑定（顺序无关）与标志查找缓存的布局，没有时创建。失败返回 VK_NULL_HANDLE。
+	/// 池不带 UPDATE_AFTER_BIND，也不带绑定标志（VkDescriptorSetLayoutBindingFlagsCreateInfo），
+	/// 因此不接受 UPDATE_AFTER_BIND_POOL / PUSH_DESCRIPTOR 标志与 INPUT_ATTACHMENT 之后的扩展描述符类型，这类布局需自行创建
+	/// </summary>
+	VkDescriptorSetLayout GetLayout(const VkDescriptorSetLayoutBinding* bindings, uint32_t binding_count, VkDescriptorSetLayoutCreateFlags flags = 0);
+	VkDescriptorSetLayout GetLayout(std::initializer_list<VkDescriptorSetLayoutBinding> bindings, VkDescriptorSetLayoutCreateFlags flags = 0)
+	{
+		return GetLayout(bindings.begin(), static_cast<uint32_t>(bindings.size()), flags);
+	}
+	/// <summary>
+	/// GetLayout 创建的布局的绑定（按绑定号升序），在 CleanUp 之前有效。其他布局返回 nullptr
+	/// </summary>
+	const std::vector<VkDescriptorSetLayoutBinding>* GetBindings(VkDescriptorSetLayout layout) const;
+
+	/// <summary>
+	/// 常驻集，不能单独释放。layout 需来自 GetLayout（用于估计池的大小）
+	/// </summary>
+	VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+	/// <summary>
+	/// 瞬时集，只在 frame_index 这一帧录制的命令里使用
+	/// </summary>
+	VkDescriptorSet AllocateTransient(uint32_t frame_index, VkDescriptorSetLayout layout);
+	/// <summary>
+	/// 该帧围栏等待之后调用：该帧的瞬时集全部失效，池重置后重新使用
+	/// </summary>
+	void BeginFrame(uint32_t frame_index);
+
+	Stats GetStats() const;
+
+private:
+	// 核心的描述符类型 VK_DESCRIPTOR_TYPE_SAMPLER .. VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT
+	static constexpr uint32_t DESCRIPTOR_TYPE_COUNT = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT + 1;
+	using DescriptorCounts = std::array<uint32_t, DESCRIPTOR_TYPE_COUNT>;
+
+	struct Usage
+	{
+		uint64_t Sets = 0;
+		std::array<uint64_t, DESCRIPTOR_TYPE_COUNT> Descriptors{};
+	};
+
+	struct PoolChain
+	{
+		std::vector<VkDescriptorPool> Pools;
+		// 正在分配的池在 Pools 中的位置，之前的池都已用完
+		uint32_t Current = 0;
+		// 最大一个池的集数，新池至少是它的两倍
+		uint32_t LargestPoolSets = 0;
+		// 常驻链为累计用量，帧链为这一帧（上次重置以来）的用量
+		Usage Used;
+		// 帧链：下一次建池时至少容纳的集数（上一次合并或缩小时的用量）
+		uint32_t ReserveSets = 0;
+		Usage Reserve;
+		// 帧链：池连续用量不到四分之一的帧数，以及这段时间单帧的最大用量
+		uint32_t UnderusedFrames = 0;
+		Usage Peak;
+	};
+
+	struct CachedLayout
+	{
+		VkDescriptorSetLayoutCreateFlags Flags = 0;
+		std::vector<VkDescriptorSetLayoutBinding> Bindings;
+		VkDescriptorSetLayout Layout = VK_NULL_HANDLE;
+	};
+
+	struct LayoutInfo
+	{
+		DescriptorCounts Counts{};
+		std::vector<VkDescriptorSetLayoutBinding> Bindings;
+	};
+
+	VkDescriptorSet _allocate(PoolChain& chain, VkDescriptorSetLayout layout);
+	bool _create_pool(PoolChain& chain, const DescriptorCounts& counts);
+	void _destroy_pools(PoolChain& chain);
+
+private:
+	VkDevice _device = VK_NULL_HANDLE;
+	PoolChain _persistent;
+	std::vector<PoolChain> _frames;
+
+	// 按绑定的哈希分桶
+	std::unordered_map<uint64_t, std::vector<CachedLayout>> _layouts;
+	std::unordered_map<VkDescriptorSetLayout, LayoutInfo> _layout_info;
+
+	uint64_t _persistent_sets = 0;
+	uint64_t _transient_sets = 0;
+	uint64_t _pools_created = 0;
+	uint64_t _pool_resets = 0;
+	uint64_t _pool_switches = 0;
+};
@@ -0,0 +1,231 @@
+﻿// 模拟预处理头
+#include "VulkanMemoryAllocator/VmaUsage.h"
+
+#include "DescriptorWriter.h"
+#include "DescriptorAllocator.h"
+#include "Logger.h"
+
+bool DescriptorWriter::Init(VkDevice device, const DescriptorAllocator& allocator, bool templates_supported)
+{
+	_device = device;
+	_allocator = &allocator;
+	_templates_supported = templates_supported;
+	return true;
+}
+
+void DescriptorWriter::CleanUp()
+{
+	for (auto& [layout, cached] : _templates)
+	{
+		if (cached.Template)
+			vkDestroyDescriptorUpdateTemplate(_device, cached.Template, nullptr);
+	}
+	_templates.clear();
+	_writes.clear();
+	_info_indices.clear();
+	_buffer_infos.clear();
+	_image_infos.clear();
+}
+
+void DescriptorWriter::WriteBuffer(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkBuffer buffer,
+	VkDeviceSize offset, VkDeviceSize range, uint32_t array_element)
+{
+	if (_info_kind(type) != InfoKind::Buffer)
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "DescriptorWriter : descriptor type {} is not a buffer!", int32_t(type));
+		return;
+	}
+	_buffer_infos.push_back({ buffer, offset, range });
+	_append(set, binding, array_element, type, static_cast<uint32_t>(_buffer_infos.size() - 1));
+}
+
+void DescriptorWriter::WriteImage(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkImageView view,
+	VkImageLayout layout, VkSampler sampler, uint32_t array_element)
+{
+	if (_info_kind(type) != InfoKind::Image)
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "DescriptorWriter : descriptor type {} is not an image!", int32_t(type));
+		return;
+	}
+	_image_infos.push_back({ sampler, view, layout });
+	_append(set, binding, array_element, type, static_cast<uint32_t>(_image_infos.size() - 1));
+}
+
+uint32_t DescriptorWriter::Flush()
+{
+	if (_writes.empty())
+		return 0;
+
+	uint64_t descriptors = 0;
+	for (size_t i = 0; i < _writes.size(); ++i)
+	{
+		auto& write = _writes[i];
+		if (_info_kind(write.descriptorType) == InfoKind::Buffer)
+			write.pBufferInfo = &_buffer_infos[_info_indices[i]];
+		else
+			write.pImageInfo = &_image_infos[_info_indices[i]];
+		descriptors += write.descriptorCount;
+	}
+	uint32_t count = static_cast<uint32_t>(_writes.size());
+	vkUpdateDescriptorSets(_device, count, _writes.data(), 0, nullptr);
+
+	_flushed_writes += count;
+	_flushed_descriptors += descriptors;
+	++_flushes;
+	_writes.clear();
+	_info_indices.clear();
+	_buffer_infos.clear();
+	_image_infos.clear();
+	return count;
+}
+
+VkDescriptorUpdateTemplate DescriptorWriter::GetTemplate(VkDescriptorSetLayout layout)
+{
+	const CachedTemplate* cached = _get_template(layout);
+	return cached ? cached->Template : VK_NULL_HANDLE;
+}
+
+uint32_t DescriptorWriter::GetTemplateDataSize(VkDescriptorSetLayout layout)
+{
+	const CachedTemplate* cached = _get_template(layout);
+	return cached ? cached->DataSize : 0;
+}
+
+bool DescriptorWriter::Update(VkDescriptorSet set, VkDescriptorSetLayout layout, const void* data)
+{
+	const CachedTemplate* cached = _get_template(layout);
+	if (!cached)
+		return false;
+
+	if (cached->Template)
+	{
+		vkUpdateDescriptorSetWithTemplate(_device, set, cached->Template, data);
+	}
+	else
+	{
+		// 没有模板：各项的信息在数据里已经紧密排列，直接指向数据
+		std::vector<VkWriteDescriptorSet> writes(cached->Entries.size());
+		for (size_t i = 0; i < writes.size(); ++i)
+		{
+			const auto& entry = cached->Entries[i];
+			const void* info = static_cast<const char*>(data) + entry.offset;
+			auto& write = writes[i];
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = set;
+			write.dstBinding = entry.dstBinding;
+			write.dstArrayElement = entry.dstArrayElement;
+			write.descriptorCount = entry.descriptorCount;
+			write.descriptorType = entry.descriptorType;
+			switch (_info_kind(entry.descriptorType))
+			{
+			case InfoKind::Buffer: write.pBufferInfo = static_cast<const VkDescriptorBufferInfo*>(info); break;
+			case InfoKind::Image: write.pImageInfo = static_cast<const VkDescriptorImageInfo*>(info); break;
+			case InfoKind::TexelBuffer: write.pTexelBufferView = static_cast<const VkBufferView*>(info); break;
+			}
+		}
+		vkUpdateDescriptorSets(_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+	++_template_updates;
+	return true;
+}
+
+DescriptorWriter::Stats DescriptorWriter::GetStats() const
+{
+	Stats stats;
+	for (const auto& [layout, cached] : _templates)
+		stats.Templates += cached.Template != VK_NULL_HANDLE;
+	stats.Writes = _flushed_writes;
+	stats.Descriptors = _flushed_descriptors;
+	stats.Flushes = _flushes;
+	stats.TemplateUpdates = _template_updates;
+	return stats;
+}
+
+DescriptorWriter::InfoKind DescriptorWriter::_info_kind(VkDescriptorType type)
+{
+	switch (type)
+	{
+	case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+	case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+	case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+	case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+		return InfoKind::Buffer;
+	case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+	case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+		return InfoKind::TexelBuffer;
+	default:
+		return InfoKind::Image;
+	}
+}
+
+const DescriptorWriter::CachedTemplate* DescriptorWriter::_get_template(VkDescriptorSetLayout layout)
+{
+	auto it = _templates.find(layout);
+	if (it != _templates.end())
+		return &it->second;
+
+	const auto* bindings = _allocator ? _allocator->GetBindings(layout) : nullptr;
+	if (!bindings)
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "DescriptorWriter : layout was not created by the descriptor allocator!");
+		return nullptr;
+	}
+
+	CachedTemplate cached;
+	for (const auto& binding : *bindings)
+	{
+		if (binding.descriptorCount == 0 || (binding.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER && binding.pImmutableSamplers))
+			continue;
+		size_t stride = 0;
+		switch (_info_kind(binding.descriptorType))
+		{
+		case InfoKind::Buffer: stride = sizeof(VkDescriptorBufferInfo); break;
+		case InfoKind::Image: stride = sizeof(VkDescriptorImageInfo); break;
+		case InfoKind::TexelBuffer: stride = sizeof(VkBufferView); break;
+		}
+		cached.Entries.push_back({ binding.binding, 0, binding.descriptorCount, binding.descriptorType, cached.DataSize, stride });
+		cached.DataSize += static_cast<uint32_t>(stride * binding.descriptorCount);
+	}
+
+	if (_templates_supported && !cached.Entries.empty())
+	{
+		VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+		templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+		templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(cached.Entries.size());
+		templateInfo.pDescriptorUpdateEntries = cached.Entries.data();
+		templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+		templateInfo.descriptorSetLayout = layout;
+		if (VkResult result = vkCreateDescriptorUpdateTemplate(_device, &templateInfo, nullptr, &cached.Template))
+		{
+			// 退回逐项写入，模板数据布局不变
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "DescriptorWriter : failed to create descriptor update template! Error code: {}", int32_t(result));
+			cached.Template = VK_NULL_HANDLE;
+		}
+	}
+	return &_templates.emplace(layout, std::move(cached)).first->second;
+}
+
+void DescriptorWriter::_append(VkDescriptorSet set, uint32_t binding, uint32_t array_element, VkDescriptorType type, uint32_t info_index)
+{
+	if (!_writes.empty())
+	{
+		auto& last = _writes.back();
+		if (last.dstSet == set && last.dstBinding == binding && last.descriptorType == type
+			&& last.dstArrayElement + last.descriptorCount == array_element
+			&& _info_indices.back() + last.descriptorCount == info_index)
+		{
+			++last.descriptorCount;
+			return;
+		}
+	}
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = set;
+	write.dstBinding = binding;
+	write.dstArrayElement = array_element;
+	write.descriptorCount = 1;
+	write.descriptorType = type;
+	_writes.push_back(write);
+	_info_indices.push_back(info_index);
+}
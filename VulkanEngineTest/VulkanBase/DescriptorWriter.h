@@ -0,0 +1,110 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class DescriptorAllocator;
+
+/// <summary>
+/// 描述符写入。两种方式：
+/// 1. 批量写入：WriteBuffer / WriteImage 只登记，Flush 时所有登记的写入合成一次 vkUpdateDescriptorSets。
+///    同一集、同一绑定上数组下标连续的写入合并为一项。渲染循环在每帧录制前 Flush 一次，
+///    无绑定资源堆、间接绘制列表与网格簇渲染器运行时的重写都登记在这里
+/// 2. 更新模板：按布局缓存 VkDescriptorUpdateTemplate，Update 直接从打包的结构体写入整个集，驱动不用逐项解析 VkWriteDescriptorSet。
+///    设备不支持（低于 1.1）时按同样的数据布局转成一次 vkUpdateDescriptorSets
+/// 被写入的集不能正被在途帧使用（除非绑定带 UPDATE_AFTER_BIND）。只能在一个线程上使用（渲染线程）
+/// </summary>
+class DescriptorWriter
+{
+public:
+	struct Stats
+	{
+		uint32_t Templates = 0;
+		// 已提交的 VkWriteDescriptorSet 项数（合并之后）与描述符数
+		uint64_t Writes = 0;
+		uint64_t Descriptors = 0;
+		uint64_t Flushes = 0;
+		uint64_t TemplateUpdates = 0;
+	};
+
+	DescriptorWriter() = default;
+	~DescriptorWriter() = default;
+
+	/// <summary>
+	/// allocator 提供布局的绑定（只有它创建的布局可以用模板）；templates_supported 为设备与实例都不低于 1.1
+	/// </summary>
+	bool Init(VkDevice device, const DescriptorAllocator& allocator, bool templates_supported);
+	/// <summary>
+	/// 丢弃未提交的写入，销毁缓存的模板
+	/// </summary>
+	void CleanUp();
+
+	void WriteBuffer(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkBuffer buffer,
+		VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE, uint32_t array_element = 0);
+	void WriteImage(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkImageView view,
+		VkImageLayout layout, VkSampler sampler = VK_NULL_HANDLE, uint32_t array_element = 0);
+	/// <summary>
+	/// 提交登记的写入（一次 vkUpdateDescriptorSets），返回提交的项数
+	/// </summary>
+	uint32_t Flush();
+
+	/// <summary>
+	/// 布局的更新模板，第一次使用时创建。数据为按绑定号升序、每个绑定 descriptorCount 个描述符信息紧密排列：
+	/// 缓冲为 VkDescriptorBufferInfo，图像 / 采样器为 VkDescriptorImageInfo，纹素缓冲为 VkBufferView，
+	/// 与按同样顺序声明这些成员的结构体相同。带不可变采样器的 SAMPLER 绑定不占数据。
+	/// 不支持模板时返回 VK_NULL_HANDLE（Update 仍然可用）
+	/// </summary>
+	VkDescriptorUpdateTemplate GetTemplate(VkDescriptorSetLayout layout);
+	/// <summary>
+	/// 模板数据的字节数，布局不可用时为 0
+	/// </summary>
+	uint32_t GetTemplateDataSize(VkDescriptorSetLayout layout);
+	/// <summary>
+	/// 用 layout 的模板从 data 写入整个集，立即生效（不经过 Flush）
+	/// </summary>
+	bool Update(VkDescriptorSet set, VkDescriptorSetLayout layout, const void* data);
+
+	bool IsTemplateSupported() const { return _templates_supported; }
+	Stats GetStats() const;
+
+private:
+	struct CachedTemplate
+	{
+		VkDescriptorUpdateTemplate Template = VK_NULL_HANDLE;
+		std::vector<VkDescriptorUpdateTemplateEntry> Entries;
+		uint32_t DataSize = 0;
+	};
+
+	enum class InfoKind : uint8_t
+	{
+		Buffer,
+		Image,
+		TexelBuffer,
+	};
+	static InfoKind _info_kind(VkDescriptorType type);
+
+	const CachedTemplate* _get_template(VkDescriptorSetLayout layout);
+	// 登记一项写入，能与上一项合并时合并。info_index 为该描述符信息在对应数组中的位置
+	void _append(VkDescriptorSet set, uint32_t binding, uint32_t array_element, VkDescriptorType type, uint32_t info_index);
+
+private:
+	VkDevice _device = VK_NULL_HANDLE;
+	const DescriptorAllocator* _allocator = nullptr;
+	bool _templates_supported = false;
+
+	// 登记的写入。信息数组在登记期间可能扩容，指针在 Flush 时按 _info_indices 填入
+	std::vector<VkWriteDescriptorSet> _writes;
+	std::vector<uint32_t> _info_indices;
+	std::vector<VkDescriptorBufferInfo> _buffer_infos;
+	std::vector<VkDescriptorImageInfo> _image_infos;
+
+	std::unordered_map<VkDescriptorSetLayout, CachedTemplate> _templates;
+
+	uint64_t _flushed_writes = 0;
+	uint64_t _flushed_descriptors = 0;
+	uint64_t _flushes = 0;
+	uint64_t _template_updates = 0;
+};
@@ -0,0 +1,341 @@
+﻿#include "FrameProfiler.h"
+#include "Tracer.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <fstream>
+#include <format>
+
+////////////////////////// LatencyHistogram ////////////////////////////////////////////
+
+uint32_t LatencyHistogram::BucketIndex(uint64_t micro_seconds)
+{
+	if (micro_seconds < SUB_BUCKET_COUNT)
+		return uint32_t(micro_seconds);
+
+	uint32_t msb = uint32_t(std::bit_width(micro_seconds)) - 1;
+	if (msb >= MAX_VALUE_BITS)
+		return BUCKET_COUNT - 1;
+
+	uint32_t shift = msb - SUB_BUCKET_BITS;
+	uint32_t sub = uint32_t(micro_seconds >> shift) - SUB_BUCKET_COUNT;
+	return SUB_BUCKET_COUNT + shift * SUB_BUCKET_COUNT + sub;
+}
+
+uint64_t LatencyHistogram::BucketValue(uint32_t index)
+{
+	if (index < SUB_BUCKET_COUNT)
+		return index;
+
+	uint32_t shift = (index - SUB_BUCKET_COUNT) / SUB_BUCKET_COUNT;
+	uint64_t sub = (index - SUB_BUCKET_COUNT) % SUB_BUCKET_COUNT;
+	uint64_t lower = (SUB_BUCKET_COUNT + sub) << shift;
+	uint64_t width = uint64_t(1) << shift;
+	return lower + width / 2;
+}
+
+void LatencyHistogram::Record(uint64_t micro_seconds)
+{
+	_buckets[BucketIndex(micro_seconds)].fetch_add(1, std::memory_order_relaxed);
+	_count.fetch_add(1, std::memory_order_relaxed);
+	_sum.fetch_add(micro_seconds, std::memory_order_relaxed);
+
+	uint64_t prev = _max.load(std::memory_order_relaxed);
+	while (prev < micro_seconds && !_max.compare_exchange_weak(prev, micro_seconds, std::memory_order_relaxed))
+	{
+	}
+}
+
+void LatencyHistogram::Reset()
+{
+	for (auto& bucket : _buckets)
+		bucket.store(0, std::memory_order_relaxed);
+	_count.store(0, std::memory_order_relaxed);
+	_sum.store(0, std::memory_order_relaxed);
+	_max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetPercentile(double percentile) const
+{
+	// 遍历时计数可能仍在增长，以桶内累计值为准
+	uint64_t total = 0;
+	std::array<uint64_t, BUCKET_COUNT> snapshot;
+	for (uint32_t i = 0; i < BUCKET_COUNT; ++i)
+	{
+		snapshot[i] = _buckets[i].load(std::memory_order_relaxed);
+		total += snapshot[i];
+	}
+	if (total == 0)
+		return 0;
+
+	uint64_t rank = uint64_t(std::ceil(std::clamp(percentile, 0.0, 1.0) * double(total)));
+	if (rank == 0) rank = 1;
+
+	uint64_t accumulated = 0;
+	for (uint32_t i = 0; i < BUCKET_COUNT; ++i)
+	{
+		accumulated += snapshot[i];
+		if (accumulated >= rank)
+			return std::min(BucketValue(i), GetMax());
+	}
+	return GetMax();
+}
+
+LatencyHistogram::Summary LatencyHistogram::GetSummary() const
+{
+	Summary summary;
+	summary.Count = GetCount();
+	if (summary.Count == 0)
+		return summary;
+
+	summary.MeanMs = double(_sum.load(std::memory_order_relaxed)) / double(summary.Count) / 1000.0;
+	summary.P50Ms = GetPercentile(0.50) / 1000.0;
+	summary.P95Ms = GetPercentile(0.95) / 1000.0;
+	summary.P99Ms = GetPercentile(0.99) / 1000.0;
+	summary.MaxMs = GetMax() / 1000.0;
+	return summary;
+}
+
+////////////////////////// FrameProfiler ////////////////////////////////////////////
+
+FrameProfiler::ScopedPhase::ScopedPhase(Phase phase)
+	: _phase(phase)
+	, _begin(std::chrono::steady_clock::now())
+{}
+
+FrameProfiler::ScopedPhase::~ScopedPhase()
+{
+	auto end = std::chrono::steady_clock::now();
+	FrameProfiler::Get().RecordPhase(_phase, uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(end - _begin).count()));
+
+	// 同时作为 trace 区间输出，与 Tracer::NowNs 使用同一时钟
+	auto toNs = [](std::chrono::steady_clock::time_point t) {
+		return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count());
+		};
+	Tracer::Get().RecordCpu(PhaseName(_phase), "frame", toNs(_begin), toNs(end));
+}
+
+FrameProfiler& FrameProfiler::Get()
+{
+	static FrameProfiler profiler;
+	return profiler;
+}
+
+const char* FrameProfiler::PhaseName(Phase phase)
+{
+	switch (phase)
+	{
+	case PHASE_WAIT_FOR_FENCE:			return "WaitForFence";
+	case PHASE_ACQUIRE_NEXT_IMAGE:		return "AcquireNextImage";
+	case PHASE_RECORD_COMMAND_BUFFER:	return "RecordCommandBuffer";
+	case PHASE_SUBMIT_COMMAND_BUFFER:	return "SubmitCommandBuffer";
+	case PHASE_PRESENT:					return "Present";
+	case PHASE_POLL_EVENTS:				return "PollEvents";
+	case PHASE_FRAME:					return "Frame";
+	default:							return "Unknown";
+	}
+}
+
+const char* FrameProfiler::CounterName(Counter counter)
+{
+	switch (counter)
+	{
+	case COUNTER_DRAW_CALLS:			return "DrawCalls";
+	case COUNTER_TRIANGLES:				return "Triangles";
+	case COUNTER_PIPELINE_BINDS:		return "PipelineBinds";
+	case COUNTER_DESCRIPTOR_BINDS:		return "DescriptorBinds";
+	case COUNTER_BYTES_UPLOADED:		return "BytesUploaded";
+	case COUNTER_INDIRECT_DRAWS:		return "IndirectDraws";
+	default:							return "Unknown";
+	}
+}
+
+void FrameProfiler::RecordPhase(Phase phase, uint64_t micro_seconds)
+{
+	if (phase >= PHASE_COUNT)
+		return;
+	_phases[phase].Record(micro_seconds);
+}
+
+void FrameProfiler::EndFrame()
+{
+	// 结算本帧计数
+	for (uint32_t i = 0; i < COUNTER_COUNT; ++i)
+	{
+		uint64_t value = _counters[i].exchange(0, std::memory_order_relaxed);
+		_last_counters[i].store(value, std::memory_order_relaxed);
+		_counter_totals[i].fetch_add(value, std::memory_order_relaxed);
+		if (value > _counter_max[i].load(std::memory_order_relaxed))
+			_counter_max[i].store(value, std::memory_order_relaxed);
+	}
+	_counter_frames.fetch_add(1, std::memory_order_relaxed);
+
+	auto now = std::chrono::steady_clock::now();
+	if (!_has_last_frame)
+	{
+		_last_frame_end = now;
+		_has_last_frame = true;
+		return;
+	}
+
+	uint64_t frameUs = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(now - _last_frame_end).count());
+	_last_frame_end = now;
+
+	_phases[PHASE_FRAME].Record(frameUs);
+	_window_frame.Record(frameUs);
+
+	// 前几帧用来建立基准，不参与卡顿判定
+	if (_phases[PHASE_FRAME].GetCount() > 8 && double(frameUs) > _frame_time_ema_us * _hitch_factor)
+	{
+		_hitch_count.fetch_add(1, std::memory_order_relaxed);
+		_window_hitch_count.fetch_add(1, std::memory_order_relaxed);
+	}
+	_frame_time_ema_us = _frame_time_ema_us == 0.0 ? double(frameUs) : _frame_time_ema_us * 0.9 + double(frameUs) * 0.1;
+}
+
+void FrameProfiler::Reset()
+{
+	for (auto& histogram : _phases)
+		histogram.Reset();
+	_window_frame.Reset();
+	_hitch_count.store(0, std::memory_order_relaxed);
+	_window_hitch_count.store(0, std::memory_order_relaxed);
+	_has_last_frame = false;
+	_frame_time_ema_us = 0.0;
+
+	for (uint32_t i = 0; i < COUNTER_COUNT; ++i)
+	{
+		_counters[i].store(0, std::memory_order_relaxed);
+		_last_counters[i].store(0, std::memory_order_relaxed);
+		_counter_totals[i].store(0, std::memory_order_relaxed);
+		_counter_max[i].store(0, std::memory_order_relaxed);
+	}
+	_counter_frames.store(0, std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(_statistics_mutex);
+	_pipeline_statistics.clear();
+}
+
+FrameProfiler::CounterSummary FrameProfiler::GetCounterSummary(Counter counter) const
+{
+	CounterSummary summary;
+	if (counter >= COUNTER_COUNT)
+		return summary;
+
+	uint64_t frames = _counter_frames.load(std::memory_order_relaxed);
+	summary.LastFrame = _last_counters[counter].load(std::memory_order_relaxed);
+	summary.Max = _counter_max[counter].load(std::memory_order_relaxed);
+	summary.Mean = frames ? double(_counter_totals[counter].load(std::memory_order_relaxed)) / double(frames) : 0.0;
+	return summary;
+}
+
+void FrameProfiler::SetPipelineStatistics(std::vector<PipelineStatistics> statistics)
+{
+	std::lock_guard<std::mutex> lock(_statistics_mutex);
+	_pipeline_statistics = std::move(statistics);
+}
+
+std::vector<FrameProfiler::PipelineStatistics> FrameProfiler::GetPipelineStatistics() const
+{
+	std::lock_guard<std::mutex> lock(_statistics_mutex);
+	return _pipeline_statistics;
+}
+
+LatencyHistogram::Summary FrameProfiler::TakeWindowSummary()
+{
+	auto summary = _window_frame.GetSummary();
+	summary.Hitches = _window_hitch_count.exchange(0, std::memory_order_relaxed);
+	_window_frame.Reset();
+	return summary;
+}
+
+std::string FrameProfiler::ToCsv() const
+{
+	std::string csv = "phase,count,mean_ms,p50_ms,p95_ms,p99_ms,max_ms,hitches\n";
+	for (uint32_t i = 0; i < PHASE_COUNT; ++i)
+	{
+		auto summary = _phases[i].GetSummary();
+		uint64_t hitches = i == PHASE_FRAME ? GetHitchCount() : 0;
+		csv += std::format("{},{},{:.3f},{:.3f},{:.3f},{:.3f},{:.3f},{}\n",
+			PhaseName(Phase(i)), summary.Count, summary.MeanMs, summary.P50Ms, summary.P95Ms, summary.P99Ms, summary.MaxMs, hitches);
+	}
+
+	csv += "\ncounter,last_frame,mean_per_frame,max_per_frame\n";
+	for (uint32_t i = 0; i < COUNTER_COUNT; ++i)
+	{
+		auto summary = GetCounterSummary(Counter(i));
+		csv += std::format("{},{},{:.1f},{}\n", CounterName(Counter(i)), summary.LastFrame, summary.Mean, summary.Max);
+	}
+
+	// 最近一次回收的 GPU 管线统计（未开启时为空）
+	auto statistics = GetPipelineStatistics();
+	if (!statistics.empty())
+	{
+		csv += "\npass,ia_vertices,ia_primitives,vs_invocations,clipping_invocations,clipping_primitives,fs_invocations,cs_invocations\n";
+		for (const auto& pass : statistics)
+		{
+			csv += std::format("{},{},{},{},{},{},{},{}\n", pass.Pass ? pass.Pass : "", pass.InputAssemblyVertices, pass.InputAssemblyPrimitives,
+				pass.VertexShaderInvocations, pass.ClippingInvocations, pass.ClippingPrimitives, pass.FragmentShaderInvocations, pass.ComputeShaderInvocations);
+		}
+	}
+	return csv;
+}
+
+std::string FrameProfiler::ToJson() const
+{
+	std::string json = "{\n";
+	json += std::format("\t\"frames\": {},\n\t\"hitches\": {},\n\t\"hitch_factor\": {:.2f},\n\t\"phases\": {{\n",
+		GetFrameCount(), GetHitchCount(), _hitch_factor);
+	for (uint32_t i = 0; i < PHASE_COUNT; ++i)
+	{
+		auto summary = _phases[i].GetSummary();
+		json += std::format("\t\t\"{}\": {{ \"count\": {}, \"mean_ms\": {:.3f}, \"p50_ms\": {:.3f}, \"p95_ms\": {:.3f}, \"p99_ms\": {:.3f}, \"max_ms\": {:.3f} }}{}\n",
+			PhaseName(Phase(i)), summary.Count, summary.MeanMs, summary.P50Ms, summary.P95Ms, summary.P99Ms, summary.MaxMs,
+			i + 1 < PHASE_COUNT ? "," : "");
+	}
+	json += "\t},\n\t\"counters\": {\n";
+	for (uint32_t i = 0; i < COUNTER_COUNT; ++i)
+	{
+		auto summary = GetCounterSummary(Counter(i));
+		json += std::format("\t\t\"{}\": {{ \"last_frame\": {}, \"mean_per_frame\": {:.1f}, \"max_per_frame\": {} }}{}\n",
+			CounterName(Counter(i)), summary.LastFrame, summary.Mean, summary.Max, i + 1 < COUNTER_COUNT ? "," : "");
+	}
+	json += "\t},\n\t\"pipeline_statistics\": [\n";
+	auto statistics = GetPipelineStatistics();
+	for (size_t i = 0; i < statistics.size(); ++i)
+	{
+		const auto& pass = statistics[i];
+		json += std::format("\t\t{{ \"pass\": \"{}\", \"ia_vertices\": {}, \"ia_primitives\": {}, \"vs_invocations\": {}, \"clipping_invocations\": {}, "
+			"\"clipping_primitives\": {}, \"fs_invocations\": {}, \"cs_invocations\": {} }}{}\n",
+			pass.Pass ? pass.Pass : "", pass.InputAssemblyVertices, pass.InputAssemblyPrimitives, pass.VertexShaderInvocations,
+			pass.ClippingInvocations, pass.ClippingPrimitives, pass.FragmentShaderInvocations, pass.ComputeShaderInvocations,
+			i + 1 < statistics.size() ? "," : "");
+	}
+	json += "\t]\n}\n";
+	return json;
+}
+
+static bool WriteTextFile(const std::string& path, const std::string& text)
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open())
+	{
+		LOG_ERROR(LOG_CATEGORY_PROFILER, "failed to open file : {}", path);
+		return false;
+	}
+	file << text;
+	LOG_INFO(LOG_CATEGORY_PROFILER, "frame stats written to : {}", path);
+	return bool(file);
+}
+
+bool FrameProfiler::DumpCsv(const std::string& path) const
+{
+	return WriteTextFile(path, ToCsv());
+}
+
+bool FrameProfiler::DumpJson(const std::string& path) const
+{
+	return WriteTextFile(path, ToJson());
+}
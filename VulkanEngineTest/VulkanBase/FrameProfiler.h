@@ -0,0 +1,190 @@
+﻿#pragma once
+
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// 无锁直方图，单位为微秒。
+/// 桶按 2 的幂分段，每段再细分 16 个子桶（相对误差 <= 1/16），记录只做 relaxed 原子加法，可在任意线程调用。
+/// </summary>
+class LatencyHistogram
+{
+public:
+	static constexpr uint32_t SUB_BUCKET_BITS = 4;
+	static constexpr uint32_t SUB_BUCKET_COUNT = 1u << SUB_BUCKET_BITS;
+	static constexpr uint32_t MAX_VALUE_BITS = 40; // 约 12.7 天，足够覆盖任何帧时间
+	static constexpr uint32_t BUCKET_COUNT = SUB_BUCKET_COUNT + (MAX_VALUE_BITS - SUB_BUCKET_BITS) * SUB_BUCKET_COUNT;
+
+	struct Summary
+	{
+		uint64_t Count = 0;
+		double MeanMs = 0.0;
+		double P50Ms = 0.0;
+		double P95Ms = 0.0;
+		double P99Ms = 0.0;
+		double MaxMs = 0.0;
+		// 只对整帧（PHASE_FRAME）有意义
+		uint64_t Hitches = 0;
+	};
+
+	void Record(uint64_t micro_seconds);
+	void Reset();
+
+	uint64_t GetCount() const { return _count.load(std::memory_order_relaxed); }
+	uint64_t GetMax() const { return _max.load(std::memory_order_relaxed); }
+	// percentile : [0, 1]
+	uint64_t GetPercentile(double percentile) const;
+	Summary GetSummary() const;
+
+	static uint32_t BucketIndex(uint64_t micro_seconds);
+	// 返回桶所覆盖区间的中点
+	static uint64_t BucketValue(uint32_t index);
+
+private:
+	std::array<std::atomic<uint64_t>, BUCKET_COUNT> _buckets{};
+	std::atomic<uint64_t> _count{ 0 };
+	std::atomic<uint64_t> _sum{ 0 };
+	std::atomic<uint64_t> _max{ 0 };
+};
+
+/// <summary>
+/// CPU 帧阶段计时。每个阶段一个 LatencyHistogram，整帧时间额外统计卡顿（hitch）次数。
+/// 取代原来按秒平均的 TitleFps —— 平均值会把偶发的卡顿抹平。
+/// 同时汇总引擎侧的每帧计数（绘制次数、三角形数、绑定次数、上传字节数）与 GPU 管线统计，
+/// 用来判断一帧是受顶点、片元还是提交开销限制。
+/// </summary>
+class FrameProfiler
+{
+public:
+	enum Phase : uint32_t
+	{
+		PHASE_WAIT_FOR_FENCE = 0,
+		PHASE_ACQUIRE_NEXT_IMAGE,
+		PHASE_RECORD_COMMAND_BUFFER,
+		PHASE_SUBMIT_COMMAND_BUFFER,
+		PHASE_PRESENT,
+		PHASE_POLL_EVENTS,
+		PHASE_FRAME,
+
+		PHASE_COUNT
+	};
+
+	enum Counter : uint32_t
+	{
+		COUNTER_DRAW_CALLS = 0,
+		COUNTER_TRIANGLES,
+		COUNTER_PIPELINE_BINDS,
+		COUNTER_DESCRIPTOR_BINDS,
+		COUNTER_BYTES_UPLOADED,
+		// 间接命令里的绘制数（一次多重间接绘制调用可包含多条）
+		COUNTER_INDIRECT_DRAWS,
+
+		COUNTER_COUNT
+	};
+
+	struct CounterSummary
+	{
+		uint64_t LastFrame = 0;
+		double Mean = 0.0;
+		uint64_t Max = 0;
+	};
+
+	/// <summary>
+	/// 某个 pass 的 VK_QUERY_TYPE_PIPELINE_STATISTICS 结果，由 GpuProfiler 在回收查询时写入
+	/// </summary>
+	struct PipelineStatistics
+	{
+		const char* Pass = nullptr;
+		uint64_t InputAssemblyVertices = 0;
+		uint64_t InputAssemblyPrimitives = 0;
+		uint64_t VertexShaderInvocations = 0;
+		uint64_t ClippingInvocations = 0;
+		uint64_t ClippingPrimitives = 0;
+		uint64_t FragmentShaderInvocations = 0;
+		uint64_t ComputeShaderInvocations = 0;
+	};
+
+	class ScopedPhase
+	{
+	public:
+		explicit ScopedPhase(Phase phase);
+		~ScopedPhase();
+
+		ScopedPhase(const ScopedPhase&) = delete;
+		ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+	private:
+		Phase _phase;
+		std::chrono::steady_clock::time_point _begin;
+	};
+
+	static FrameProfiler& Get();
+	static const char* PhaseName(Phase phase);
+	static const char* CounterName(Counter counter);
+
+	void RecordPhase(Phase phase, uint64_t micro_seconds);
+	/// <summary>
+	/// 每帧结束时调用一次（只能在同一个线程调用），以两次调用的间隔作为帧时间
+	/// </summary>
+	void EndFrame();
+	void Reset();
+
+	const LatencyHistogram& GetPhaseHistogram(Phase phase) const { return _phases[phase]; }
+	uint64_t GetHitchCount() const { return _hitch_count.load(std::memory_order_relaxed); }
+	uint64_t GetFrameCount() const { return _phases[PHASE_FRAME].GetCount(); }
+
+	/// <summary>
+	/// 累加到当前帧的计数，EndFrame 时结算。可在任意线程调用
+	/// </summary>
+	void AddCounter(Counter counter, uint64_t value = 1) { _counters[counter].fetch_add(value, std::memory_order_relaxed); }
+	uint64_t GetLastFrameCounter(Counter counter) const { return _last_counters[counter].load(std::memory_order_relaxed); }
+	CounterSummary GetCounterSummary(Counter counter) const;
+
+	void SetPipelineStatistics(std::vector<PipelineStatistics> statistics);
+	std::vector<PipelineStatistics> GetPipelineStatistics() const;
+
+	/// <summary>
+	/// 返回自上次调用以来的帧时间统计并清空窗口（用于窗口标题等周期性显示）
+	/// </summary>
+	LatencyHistogram::Summary TakeWindowSummary();
+
+	/// <summary>
+	/// 帧时间超过 最近帧时间的指数滑动平均 * factor 时计为一次卡顿
+	/// </summary>
+	void SetHitchFactor(double factor) { _hitch_factor = factor; }
+
+	std::string ToCsv() const;
+	std::string ToJson() const;
+	bool DumpCsv(const std::string& path) const;
+	bool DumpJson(const std::string& path) const;
+
+private:
+	FrameProfiler() = default;
+
+private:
+	std::array<LatencyHistogram, PHASE_COUNT> _phases;
+	LatencyHistogram _window_frame;
+
+	std::atomic<uint64_t> _hitch_count{ 0 };
+	std::atomic<uint64_t> _window_hitch_count{ 0 };
+
+	std::array<std::atomic<uint64_t>, COUNTER_COUNT> _counters{};		// 当前帧
+	std::array<std::atomic<uint64_t>, COUNTER_COUNT> _last_counters{};	// 上一帧
+	std::array<std::atomic<uint64_t>, COUNTER_COUNT> _counter_totals{};
+	std::array<std::atomic<uint64_t>, COUNTER_COUNT> _counter_max{};
+	std::atomic<uint64_t> _counter_frames{ 0 };
+
+	mutable std::mutex _statistics_mutex;
+	std::vector<PipelineStatistics> _pipeline_statistics;
+
+	// 以下只在 EndFrame 所在线程访问
+	std::chrono::steady_clock::time_point _last_frame_end{};
+	bool _has_last_frame = false;
+	double _frame_time_ema_us = 0.0;
+	double _hitch_factor = 2.0;
+};
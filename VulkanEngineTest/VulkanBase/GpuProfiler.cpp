@@ -0,0 +1,391 @@
+﻿// 模拟预处理头
+#include "VulkanMemoryAllocator/VmaUsage.h"
+
+#include "GpuProfiler.h"
+#include "FrameProfiler.h"
+#include "Tracer.h"
+#include "Logger.h"
+
+#include <format>
+#include <cstring>
+
+bool GpuProfiler::Init(VkInstance instance, VkPhysicalDevice physical_device, VkDevice device, VkQueue queue, uint32_t queue_family_index,
+	VkCommandPool command_pool, uint32_t frames_in_flight, bool calibrated_timestamps_enabled, bool pipeline_statistics_enabled)
+{
+	_physical_device = physical_device;
+	_device = device;
+	_queue = queue;
+	_command_pool = command_pool;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(_physical_device, &properties);
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(_physical_device, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(_physical_device, &queueFamilyCount, queueFamilies.data());
+
+	uint32_t validBits = queue_family_index < queueFamilyCount ? queueFamilies[queue_family_index].timestampValidBits : 0;
+	if (validBits == 0 || properties.limits.timestampPeriod <= 0.0f)
+	{
+		LOG_WARNING(LOG_CATEGORY_GPU_PROFILER, "timestamps are not supported on queue family {}", queue_family_index);
+		return false;
+	}
+	_timestamp_period = double(properties.limits.timestampPeriod);
+	_timestamp_mask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+	_frames.resize(frames_in_flight);
+	for (auto& frame : _frames)
+	{
+		VkQueryPoolCreateInfo queryPoolInfo{};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = MAX_ZONES_PER_FRAME * 2;
+		if (VkResult result = vkCreateQueryPool(_device, &queryPoolInfo, nullptr, &frame.QueryPool))
+		{
+			LOG_ERROR(LOG_CATEGORY_GPU_PROFILER, "Failed to create timestamp query pool! Error code: {}", int32_t(result));
+			CleanUp();
+			return false;
+		}
+		frame.Zones.reserve(MAX_ZONES_PER_FRAME);
+
+		if (pipeline_statistics_enabled)
+		{
+			VkQueryPoolCreateInfo statisticsPoolInfo{};
+			statisticsPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			statisticsPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+			statisticsPoolInfo.queryCount = MAX_STATISTICS_ZONES_PER_FRAME;
+			statisticsPoolInfo.pipelineStatistics = PIPELINE_STATISTICS_FLAGS;
+			if (VkResult result = vkCreateQueryPool(_device, &statisticsPoolInfo, nullptr, &frame.StatisticsPool))
+			{
+				// 不影响时间戳，只是没有管线统计
+				LOG_WARNING(LOG_CATEGORY_GPU_PROFILER, "Failed to create pipeline statistics query pool! Error code: {}", int32_t(result));
+				frame.StatisticsPool = VK_NULL_HANDLE;
+				pipeline_statistics_enabled = false;
+			}
+		}
+	}
+	if (!pipeline_statistics_enabled)
+	{
+		for (auto& frame : _frames)
+		{
+			if (frame.StatisticsPool)
+				vkDestroyQueryPool(_device, frame.StatisticsPool, nullptr);
+			frame.StatisticsPool = VK_NULL_HANDLE;
+		}
+	}
+
+	if (calibrated_timestamps_enabled)
+	{
+		auto getTimeDomains = reinterpret_cast<PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT>(
+			vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT"));
+		_get_calibrated_timestamps = reinterpret_cast<PFN_vkGetCalibratedTimestampsEXT>(
+			vkGetDeviceProcAddr(_device, "vkGetCalibratedTimestampsEXT"));
+
+		if (getTimeDomains && _get_calibrated_timestamps)
+		{
+			uint32_t domainCount = 0;
+			getTimeDomains(_physical_device, &domainCount, nullptr);
+			std::vector<VkTimeDomainEXT> domains(domainCount);
+			getTimeDomains(_physical_device, &domainCount, domains.data());
+
+			bool hasDevice = false;
+			for (auto domain : domains)
+			{
+				if (domain == VK_TIME_DOMAIN_DEVICE_EXT)
+					hasDevice = true;
+#ifdef _WIN32
+				if (domain == VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT)
+					_host_time_domain = domain;
+#else
+				if (domain == VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT)
+					_host_time_domain = domain;
+#endif
+			}
+			if (!hasDevice || _host_time_domain == VK_TIME_DOMAIN_MAX_ENUM_EXT)
+			{
+				_get_calibrated_timestamps = nullptr;
+			}
+		}
+		else
+		{
+			_get_calibrated_timestamps = nullptr;
+		}
+	}
+
+	_supported = true;
+	if (!_calibrate())
+	{
+		CleanUp();
+		return false;
+	}
+
+	LOG_INFO(LOG_CATEGORY_GPU_PROFILER, "Init done. timestampPeriod : {} ns, calibrated timestamps : {}, pipeline statistics : {}",
+		_timestamp_period, _get_calibrated_timestamps ? "yes" : "no", IsPipelineStatisticsSupported() ? "yes" : "no");
+	return true;
+}
+
+void GpuProfiler::CleanUp()
+{
+	for (auto& frame : _frames)
+	{
+		if (frame.QueryPool)
+			vkDestroyQueryPool(_device, frame.QueryPool, nullptr);
+		if (frame.StatisticsPool)
+			vkDestroyQueryPool(_device, frame.StatisticsPool, nullptr);
+	}
+	_frames.clear();
+	_recording = nullptr;
+	_supported = false;
+	_pipeline_statistics_enabled = false;
+}
+
+void GpuProfiler::BeginFrame(VkCommandBuffer command_buffer, uint32_t frame_index)
+{
+	if (!_supported || frame_index >= _frames.size())
+	{
+		_recording = nullptr;
+		return;
+	}
+
+	_recording = &_frames[frame_index];
+	_recording->Zones.clear();
+	_recording->UsedQueries = 0;
+	_recording->UsedStatisticsQueries = 0;
+	_recording->Statistics = _pipeline_statistics_enabled;
+	_recording->Pending = false;
+	_active_statistics_zone = UINT32_MAX;
+	vkCmdResetQueryPool(command_buffer, _recording->QueryPool, 0, MAX_ZONES_PER_FRAME * 2);
+	if (_recording->Statistics)
+		vkCmdResetQueryPool(command_buffer, _recording->StatisticsPool, 0, MAX_STATISTICS_ZONES_PER_FRAME);
+}
+
+uint32_t GpuProfiler::BeginZone(VkCommandBuffer command_buffer, const char* name)
+{
+	if (!_recording || _recording->Zones.size() >= MAX_ZONES_PER_FRAME)
+		return UINT32_MAX;
+
+	auto& zone = _recording->Zones.emplace_back();
+	zone.Name = name;
+	zone.BeginQuery = _recording->UsedQueries++;
+	zone.EndQuery = UINT32_MAX;
+	vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _recording->QueryPool, zone.BeginQuery);
+
+	uint32_t index = uint32_t(_recording->Zones.size() - 1);
+	if (_recording->Statistics && _active_statistics_zone == UINT32_MAX && _recording->UsedStatisticsQueries < MAX_STATISTICS_ZONES_PER_FRAME)
+	{
+		zone.StatisticsQuery = _recording->UsedStatisticsQueries++;
+		vkCmdBeginQuery(command_buffer, _recording->StatisticsPool, zone.StatisticsQuery, 0);
+		_active_statistics_zone = index;
+	}
+	return index;
+}
+
+void GpuProfiler::EndZone(VkCommandBuffer command_buffer, uint32_t zone)
+{
+	if (!_recording || zone >= _recording->Zones.size())
+		return;
+
+	auto& z = _recording->Zones[zone];
+	if (z.StatisticsQuery != UINT32_MAX && _active_statistics_zone == zone)
+	{
+		vkCmdEndQuery(command_buffer, _recording->StatisticsPool, z.StatisticsQuery);
+		_active_statistics_zone = UINT32_MAX;
+	}
+	z.EndQuery = _recording->UsedQueries++;
+	vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _recording->QueryPool, z.EndQuery);
+	_recording->Pending = true;
+}
+
+void GpuProfiler::Collect(uint32_t frame_index)
+{
+	if (!_supported || frame_index >= _frames.size())
+		return;
+
+	auto& frame = _frames[frame_index];
+	if (!frame.Pending || frame.UsedQueries == 0)
+		return;
+	frame.Pending = false;
+
+	// 校准时间戳代价很低，每秒重新对齐一次以抵消两个时钟的漂移
+	if (_get_calibrated_timestamps && Tracer::NowNs() - _last_calibration_ns > 1'000'000'000ull)
+	{
+		_calibrate();
+	}
+
+	std::vector<uint64_t> results(frame.UsedQueries);
+	VkResult result = vkGetQueryPoolResults(_device, frame.QueryPool, 0, frame.UsedQueries,
+		results.size() * sizeof(uint64_t), results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS)
+	{
+		// VK_NOT_READY : 围栏之前的帧没有提交或被跳过（如交换链重建）
+		return;
+	}
+
+	_last_zones.clear();
+	for (auto& zone : frame.Zones)
+	{
+		if (zone.EndQuery == UINT32_MAX)
+			continue;
+		uint64_t beginTicks = results[zone.BeginQuery] & _timestamp_mask;
+		uint64_t endTicks = results[zone.EndQuery] & _timestamp_mask;
+		uint64_t elapsedTicks = (endTicks - beginTicks) & _timestamp_mask;
+
+		uint64_t beginNs = _to_cpu_ns(beginTicks);
+		uint64_t endNs = beginNs + uint64_t(double(elapsedTicks) * _timestamp_period);
+		Tracer::Get().RecordGpu(zone.Name, beginNs, endNs);
+		_last_zones.push_back({ zone.Name, double(endNs - beginNs) / 1'000'000.0 });
+	}
+	++_collected_frames;
+
+	if (frame.Statistics && frame.UsedStatisticsQueries > 0)
+	{
+		std::vector<uint64_t> statistics(size_t(frame.UsedStatisticsQueries) * PIPELINE_STATISTICS_COUNT);
+		if (vkGetQueryPoolResults(_device, frame.StatisticsPool, 0, frame.UsedStatisticsQueries, statistics.size() * sizeof(uint64_t),
+			statistics.data(), PIPELINE_STATISTICS_COUNT * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+		{
+			std::vector<FrameProfiler::PipelineStatistics> passes;
+			for (auto& zone : frame.Zones)
+			{
+				if (zone.StatisticsQuery == UINT32_MAX || zone.EndQuery == UINT32_MAX)
+					continue;
+				const uint64_t* values = &statistics[size_t(zone.StatisticsQuery) * PIPELINE_STATISTICS_COUNT];
+				auto& pass = passes.emplace_back();
+				pass.Pass = zone.Name;
+				pass.InputAssemblyVertices = values[0];
+				pass.InputAssemblyPrimitives = values[1];
+				pass.VertexShaderInvocations = values[2];
+				pass.ClippingInvocations = values[3];
+				pass.ClippingPrimitives = values[4];
+				pass.FragmentShaderInvocations = values[5];
+				pass.ComputeShaderInvocations = values[6];
+			}
+			FrameProfiler::Get().SetPipelineStatistics(std::move(passes));
+		}
+	}
+}
+
+void GpuProfiler::CollectAll()
+{
+	for (uint32_t i = 0; i < _frames.size(); ++i)
+		Collect(i);
+}
+
+double GpuProfiler::GetLastZoneMs(const char* name) const
+{
+	double ms = 0.0;
+	FindLastZoneMs(name, ms);
+	return ms;
+}
+
+bool GpuProfiler::FindLastZoneMs(const char* name, double& ms) const
+{
+	for (auto& zone : _last_zones)
+	{
+		if (zone.Name == name || (zone.Name && name && !strcmp(zone.Name, name)))
+		{
+			ms = zone.Ms;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool GpuProfiler::_calibrate()
+{
+	if (_get_calibrated_timestamps)
+	{
+		VkCalibratedTimestampInfoEXT infos[2]{};
+		infos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+		infos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+		infos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+		infos[1].timeDomain = _host_time_domain;
+
+		uint64_t timestamps[2] = {};
+		uint64_t maxDeviation = 0;
+		if (VkResult result = _get_calibrated_timestamps(_device, 2, infos, timestamps, &maxDeviation))
+		{
+			LOG_WARNING(LOG_CATEGORY_GPU_PROFILER, "vkGetCalibratedTimestampsEXT error : {}", int32_t(result));
+			return false;
+		}
+
+		uint64_t hostNs = timestamps[1];
+#ifdef _WIN32
+		// QPC 计数换算为纳秒，与 MSVC 的 steady_clock 保持一致
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		uint64_t ticksPerSecond = uint64_t(frequency.QuadPart);
+		hostNs = (timestamps[1] / ticksPerSecond) * 1'000'000'000ull
+			+ (timestamps[1] % ticksPerSecond) * 1'000'000'000ull / ticksPerSecond;
+#endif
+		_gpu_base_ticks = int64_t(timestamps[0] & _timestamp_mask);
+		_cpu_base_ns = int64_t(hostNs);
+		_last_calibration_ns = Tracer::NowNs();
+		return true;
+	}
+
+	// 没有校准扩展：提交一条只写时间戳的命令，以 CPU 往返时间的中点近似 GPU 写入时刻
+	VkQueryPoolCreateInfo queryPoolInfo{};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = 1;
+	VkQueryPool queryPool;
+	if (VkResult result = vkCreateQueryPool(_device, &queryPoolInfo, nullptr, &queryPool))
+	{
+		LOG_ERROR(LOG_CATEGORY_GPU_PROFILER, "Failed to create calibration query pool! Error code: {}", int32_t(result));
+		return false;
+	}
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = _command_pool;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	vkAllocateCommandBuffers(_device, &allocInfo, &commandBuffer);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	vkCmdResetQueryPool(commandBuffer, queryPool, 0, 1);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 0);
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	uint64_t cpuBefore = Tracer::NowNs();
+	vkQueueSubmit(_queue, 1, &submitInfo, VK_NULL_HANDLE);
+	vkQueueWaitIdle(_queue);
+	uint64_t cpuAfter = Tracer::NowNs();
+
+	uint64_t gpuTicks = 0;
+	VkResult result = vkGetQueryPoolResults(_device, queryPool, 0, 1, sizeof(gpuTicks), &gpuTicks, sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+	vkFreeCommandBuffers(_device, _command_pool, 1, &commandBuffer);
+	vkDestroyQueryPool(_device, queryPool, nullptr);
+
+	if (result != VK_SUCCESS)
+	{
+		LOG_ERROR(LOG_CATEGORY_GPU_PROFILER, "Failed to read calibration timestamp! Error code: {}", int32_t(result));
+		return false;
+	}
+
+	_gpu_base_ticks = int64_t(gpuTicks & _timestamp_mask);
+	_cpu_base_ns = int64_t(cpuBefore + (cpuAfter - cpuBefore) / 2);
+	_last_calibration_ns = cpuAfter;
+	return true;
+}
+
+uint64_t GpuProfiler::_to_cpu_ns(uint64_t gpu_ticks) const
+{
+	// 时间戳有效位数不足 64 时可能回绕，按有符号差值处理
+	uint64_t delta = (gpu_ticks - uint64_t(_gpu_base_ticks)) & _timestamp_mask;
+	int64_t signedDelta = delta > (_timestamp_mask >> 1) ? -int64_t((_timestamp_mask - delta) + 1) : int64_t(delta);
+	return uint64_t(_cpu_base_ns + int64_t(double(signedDelta) * _timestamp_period));
+}
@@ -0,0 +1,132 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// GPU 时间戳区间。每个 frame in flight 一个 query pool，录制时写入 vkCmdWriteTimestamp，
+/// 等待该帧围栏之后回收结果，换算到 CPU 的 steady_clock 纳秒后写入 Tracer。
+/// 支持 VK_EXT_calibrated_timestamps 时用校准时间戳对齐两个时钟，否则用一次提交的 CPU 往返时间的中点估算。
+/// 可选地在区间上同时记录 VK_QUERY_TYPE_PIPELINE_STATISTICS（需要 pipelineStatisticsQuery 特性），结果写入 FrameProfiler。
+/// </summary>
+class GpuProfiler
+{
+public:
+	static constexpr uint32_t MAX_ZONES_PER_FRAME = 64;
+	static constexpr uint32_t MAX_STATISTICS_ZONES_PER_FRAME = 16;
+	// 顺序与 VkQueryPipelineStatisticFlagBits 的位序一致，即查询结果的排列顺序
+	static constexpr VkQueryPipelineStatisticFlags PIPELINE_STATISTICS_FLAGS =
+		VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT
+		| VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT
+		| VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT
+		| VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT
+		| VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT
+		| VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT
+		| VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+	static constexpr uint32_t PIPELINE_STATISTICS_COUNT = 7;
+
+	GpuProfiler() = default;
+	~GpuProfiler() = default;
+
+	bool Init(VkInstance instance, VkPhysicalDevice physical_device, VkDevice device, VkQueue queue, uint32_t queue_family_index,
+		VkCommandPool command_pool, uint32_t frames_in_flight, bool calibrated_timestamps_enabled, bool pipeline_statistics_enabled);
+	void CleanUp();
+
+	bool IsSupported() const { return _supported; }
+
+	/// <summary>
+	/// 管线统计默认关闭（查询本身有开销），从下一帧开始生效
+	/// </summary>
+	void SetPipelineStatisticsEnabled(bool enabled) { _pipeline_statistics_enabled = enabled && IsPipelineStatisticsSupported(); }
+	bool IsPipelineStatisticsEnabled() const { return _pipeline_statistics_enabled; }
+	bool IsPipelineStatisticsSupported() const { return _supported && !_frames.empty() && _frames[0].StatisticsPool != VK_NULL_HANDLE; }
+
+	/// <summary>
+	/// 必须在 render pass 之外调用（会重置该帧的查询）
+	/// </summary>
+	void BeginFrame(VkCommandBuffer command_buffer, uint32_t frame_index);
+	/// <summary>
+	/// name 必须是静态字符串。返回区间编号，传给 EndZone。
+	/// 开启管线统计时，最外层的区间同时记录管线统计（同类型查询不能嵌套）；
+	/// 在 render pass 内开始的区间必须在同一个 subpass 内结束
+	/// </summary>
+	uint32_t BeginZone(VkCommandBuffer command_buffer, const char* name);
+	void EndZone(VkCommandBuffer command_buffer, uint32_t zone);
+	/// <summary>
+	/// 该帧的围栏已发出信号后调用，读取结果并写入 Tracer
+	/// </summary>
+	void Collect(uint32_t frame_index);
+	/// <summary>
+	/// GPU 空闲后调用：回收所有在途帧的结果
+	/// </summary>
+	void CollectAll();
+	/// <summary>
+	/// 已回收结果的帧数，每回收一帧加一。用来判断 GetLastZoneMs 是否有新结果
+	/// </summary>
+	uint64_t GetCollectedFrameCount() const { return _collected_frames; }
+
+	/// <summary>
+	/// 最近一次回收的某个区间的 GPU 耗时（毫秒），找不到返回 0
+	/// </summary>
+	double GetLastZoneMs(const char* name) const;
+	/// <summary>
+	/// 同 GetLastZoneMs，最近一次回收的结果里没有这个区间时返回 false
+	/// </summary>
+	bool FindLastZoneMs(const char* name, double& ms) const;
+
+private:
+	bool _calibrate();
+	uint64_t _to_cpu_ns(uint64_t gpu_ticks) const;
+
+	struct Zone
+	{
+		const char* Name = nullptr;
+		uint32_t BeginQuery = 0;
+		uint32_t EndQuery = 0;
+		uint32_t StatisticsQuery = UINT32_MAX;
+	};
+
+	struct FrameQueries
+	{
+		VkQueryPool QueryPool = VK_NULL_HANDLE;
+		std::vector<Zone> Zones;
+		uint32_t UsedQueries = 0;
+		VkQueryPool StatisticsPool = VK_NULL_HANDLE;
+		uint32_t UsedStatisticsQueries = 0;
+		bool Statistics = false;	// 录制该帧时是否开启了管线统计
+		bool Pending = false;
+	};
+
+private:
+	VkPhysicalDevice _physical_device = VK_NULL_HANDLE;
+	VkDevice _device = VK_NULL_HANDLE;
+	VkQueue _queue = VK_NULL_HANDLE;
+	VkCommandPool _command_pool = VK_NULL_HANDLE;
+
+	PFN_vkGetCalibratedTimestampsEXT _get_calibrated_timestamps = nullptr;
+	VkTimeDomainEXT _host_time_domain = VK_TIME_DOMAIN_MAX_ENUM_EXT;
+
+	std::vector<FrameQueries> _frames;
+	FrameQueries* _recording = nullptr;
+	uint32_t _active_statistics_zone = UINT32_MAX;
+
+	struct LastZone
+	{
+		const char* Name;
+		double Ms;
+	};
+	std::vector<LastZone> _last_zones;
+	uint64_t _collected_frames = 0;
+
+	double _timestamp_period = 1.0;	// 每个 tick 的纳秒数
+	uint64_t _timestamp_mask = ~0ull;
+	// cpu_ns = (gpu_ticks - _gpu_base_ticks) * period + _cpu_base_ns
+	int64_t _gpu_base_ticks = 0;
+	int64_t _cpu_base_ns = 0;
+	uint64_t _last_calibration_ns = 0;
+
+	bool _supported = false;
+	bool _pipeline_statistics_enabled = false;
+};
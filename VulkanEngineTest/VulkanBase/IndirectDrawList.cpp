@@ -0,0 +1,423 @@
+﻿// 模拟预处理头
+#include "VulkanMemoryAllocator/VmaUsage.h"
+
+#include "IndirectDrawList.h"
+#include "VulkanBase.h"
+#include "VkShader.h"
+#include "FrameProfiler.h"
+#include "Tracer.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+
+bool IndirectDrawList::Init(VkDevice device, VkDescriptorSetLayout ubo_layout, uint32_t frames_in_flight, const std::string& cull_shader_path,
+	bool draw_indirect_count_enabled, bool multi_draw_indirect_enabled, VkDescriptorSetLayout bindless_layout)
+{
+	_device = device;
+	_bindless = bindless_layout != VK_NULL_HANDLE;
+	_draw_indirect_count_enabled = draw_indirect_count_enabled;
+	_multi_draw_indirect_enabled = multi_draw_indirect_enabled;
+	_frames.resize(frames_in_flight);
+
+	std::array<VkDescriptorSetLayoutBinding, BINDING_COUNT> bindings{};
+	for (uint32_t i = 0; i < BINDING_COUNT; ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	bindings[BINDING_DRAW_DATA].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	bindings[BINDING_DRAW_IDS].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+	if (VkResult result = vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &_set_layout))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "IndirectDrawList : failed to create descriptor set layout! Error code: {}", int32_t(result));
+		return false;
+	}
+
+	// 集 0 为 UBO，集 1 为逐绘制数据与剔除缓冲，集 2 为无绑定资源堆（可选）；剔除的计算管线与间接绘制的图形管线共用此布局
+	std::array<VkDescriptorSetLayout, 3> setLayouts = { ubo_layout, _set_layout, bindless_layout };
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(PushConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = _bindless ? 3 : 2;
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	if (VkResult result = vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &_pipeline_layout))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "IndirectDrawList : failed to create pipeline layout! Error code: {}", int32_t(result));
+		CleanUp();
+		return false;
+	}
+
+	// 剔除管线可选
+	_create_cull_pipeline(cull_shader_path);
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = BINDING_COUNT * frames_in_flight;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	poolInfo.maxSets = frames_in_flight;
+	if (VkResult result = vkCreateDescriptorPool(_device, &poolInfo, nullptr, &_descriptor_pool))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "IndirectDrawList : failed to create descriptor pool! Error code: {}", int32_t(result));
+		CleanUp();
+		return false;
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(frames_in_flight, _set_layout);
+	std::vector<VkDescriptorSet> sets(frames_in_flight);
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = _descriptor_pool;
+	allocInfo.descriptorSetCount = frames_in_flight;
+	allocInfo.pSetLayouts = layouts.data();
+	if (VkResult result = vkAllocateDescriptorSets(_device, &allocInfo, sets.data()))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "IndirectDrawList : failed to allocate descriptor sets! Error code: {}", int32_t(result));
+		CleanUp();
+		return false;
+	}
+	for (uint32_t i = 0; i < frames_in_flight; ++i)
+		_frames[i].DescriptorSet = sets[i];
+
+	LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "IndirectDrawList : draw indirect count {}, multi draw indirect {}, gpu culling {}, bindless {}",
+		_draw_indirect_count_enabled, _multi_draw_indirect_enabled, _cull_pipeline != VK_NULL_HANDLE, _bindless);
+	return true;
+}
+
+void IndirectDrawList::CleanUp()
+{
+	for (auto& frame : _frames)
+		_destroy_frame_buffers(frame);
+
+	if (_descriptor_pool)
+		vkDestroyDescriptorPool(_device, _descriptor_pool, nullptr);
+	if (_cull_pipeline)
+		vkDestroyPipeline(_device, _cull_pipeline, nullptr);
+	if (_pipeline_layout)
+		vkDestroyPipelineLayout(_device, _pipeline_layout, nullptr);
+	if (_set_layout)
+		vkDestroyDescriptorSetLayout(_device, _set_layout, nullptr);
+	_descriptor_pool = VK_NULL_HANDLE;
+	_cull_pipeline = VK_NULL_HANDLE;
+	_pipeline_layout = VK_NULL_HANDLE;
+	_set_layout = VK_NULL_HANDLE;
+	_frames.clear();
+	_buckets.clear();
+	_visible_draws = 0;
+}
+
+void IndirectDrawList::Clear()
+{
+	_draws.clear();
+	++_version;
+}
+
+void IndirectDrawList::Reserve(size_t draw_count)
+{
+	_draws.reserve(draw_count);
+}
+
+void IndirectDrawList::Add(const MeshRange& mesh, uint32_t pipeline, const DrawData& data, const glm::vec4& bounds)
+{
+	_draws.push_back({ mesh, pipeline, data, bounds });
+	++_version;
+}
+
+bool IndirectDrawList::Prepare(uint32_t frame_index)
+{
+	if (frame_index >= _frames.size() || _draws.empty())
+		return false;
+
+	// 列表未变化时沿用该帧缓冲里的命令
+	auto& frame = _frames[frame_index];
+	frame.Culled = false;
+	if (frame.Version == _version)
+		return true;
+
+	uint32_t drawCount = GetDrawCount();
+	if (drawCount > frame.Capacity && !_reserve_frame(frame, drawCount))
+		return false;
+
+	// 按管线计数排序，同一管线内保持提交顺序
+	uint32_t pipelineCount = 0;
+	for (auto& draw : _draws)
+		pipelineCount = std::max(pipelineCount, draw.Pipeline + 1);
+	_cursors.assign(pipelineCount, 0);
+	for (auto& draw : _draws)
+		++_cursors[draw.Pipeline];
+
+	_buckets.clear();
+	uint32_t first = 0;
+	for (uint32_t pipeline = 0; pipeline < pipelineCount; ++pipeline)
+	{
+		uint32_t count = _cursors[pipeline];
+		_cursors[pipeline] = first;
+		if (count)
+			_buckets.push_back({ pipeline, first, count, 0 });
+		first += count;
+	}
+
+	// 剔除需要知道每条命令所在的桶
+	_bucket_of_pipeline.assign(pipelineCount, 0);
+	for (uint32_t i = 0; i < _buckets.size(); ++i)
+		_bucket_of_pipeline[_buckets[i].Pipeline] = i;
+
+	auto commands = static_cast<VkDrawIndexedIndirectCommand*>(frame.CommandsMapped);
+	auto drawData = static_cast<DrawData*>(frame.DrawDataMapped);
+	auto cullObjects = static_cast<CullObject*>(frame.CullObjectsMapped);
+	for (auto& draw : _draws)
+	{
+		uint32_t slot = _cursors[draw.Pipeline]++;
+		commands[slot] = { draw.Mesh.IndexCount, 1, draw.Mesh.FirstIndex, draw.Mesh.VertexOffset, 0 };
+		drawData[slot] = draw.Data;
+		if (cullObjects)
+		{
+			uint32_t bucket = _bucket_of_pipeline[draw.Pipeline];
+			cullObjects[slot] = { draw.Bounds, bucket, _buckets[bucket].FirstDraw, { 0, 0 } };
+		}
+	}
+
+	auto counts = reinterpret_cast<uint32_t*>(static_cast<unsigned char*>(frame.CommandsMapped) + _count_offset(frame.Capacity));
+	counts[0] = drawCount;
+	for (size_t i = 0; i < _buckets.size(); ++i)
+	{
+		auto& bucket = _buckets[i];
+		for (uint32_t d = bucket.FirstDraw; d < bucket.FirstDraw + bucket.DrawCount; ++d)
+			bucket.Triangles += commands[d].indexCount / 3;
+		counts[1 + i] = bucket.DrawCount;
+	}
+
+	frame.Version = _version;
+	uint64_t bytesPerDraw = sizeof(VkDrawIndexedIndirectCommand) + sizeof(DrawData) + (cullObjects ? sizeof(CullObject) : 0);
+	FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_BYTES_UPLOADED, uint64_t(drawCount) * bytesPerDraw + _buckets.size() * sizeof(uint32_t));
+	return true;
+}
+
+void IndirectDrawList::Collect(uint32_t frame_index)
+{
+	if (frame_index >= _frames.size())
+		return;
+	auto& frame = _frames[frame_index];
+	if (frame.HasResult && frame.ReadbackMapped)
+		_visible_draws = *static_cast<const uint32_t*>(frame.ReadbackMapped);
+	frame.HasResult = false;
+}
+
+void IndirectDrawList::RecordCull(VkCommandBuffer command_buffer, uint32_t frame_index, VkDescriptorSet ubo_set, bool external_sync)
+{
+	if (!IsGpuCulling() || frame_index >= _frames.size())
+		return;
+	auto& frame = _frames[frame_index];
+	if (!frame.CulledCommands || frame.Version != _version)
+		return;
+
+	// 可见总数与各桶数量清零
+	VkDeviceSize countOffset = _count_offset(frame.Capacity);
+	vkCmdFillBuffer(command_buffer, frame.CulledCommands, countOffset, VkDeviceSize(1 + _buckets.size()) * sizeof(uint32_t), 0);
+
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	std::array<VkDescriptorSet, 2> sets = { ubo_set, frame.DescriptorSet };
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, _cull_pipeline);
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline_layout, 0, static_cast<uint32_t>(sets.size()), sets.data(), 0, nullptr);
+	PushConstants constants{ 0, 1, GetDrawCount(), _draw_indirect_count_enabled ? 1u : 0u, static_cast<uint32_t>(countOffset) };
+	vkCmdPushConstants(command_buffer, _pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+	vkCmdDispatch(command_buffer, (GetDrawCount() + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+	// 计算队列不支持顶点阶段；由外部同步时只需对回读拷贝做屏障
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = external_sync ? VK_ACCESS_TRANSFER_READ_BIT
+		: VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+	VkPipelineStageFlags dstStages = external_sync ? VK_PIPELINE_STAGE_TRANSFER_BIT
+		: VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStages,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	// 可见总数拷回主机，围栏之后由 Collect 读取
+	VkBufferCopy copy{ countOffset, 0, sizeof(uint32_t) };
+	vkCmdCopyBuffer(command_buffer, frame.CulledCommands, frame.Readback, 1, &copy);
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+	frame.Culled = true;
+	frame.HasResult = true;
+}
+
+void IndirectDrawList::BindDescriptorSets(VkCommandBuffer command_buffer, uint32_t frame_index, VkDescriptorSet ubo_set, VkDescriptorSet bindless_set)
+{
+	std::array<VkDescriptorSet, 3> sets = { ubo_set, _frames[frame_index].DescriptorSet, bindless_set };
+	uint32_t setCount = _bindless && bindless_set ? 3 : 2;
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline_layout, 0, setCount, sets.data(), 0, nullptr);
+}
+
+uint32_t IndirectDrawList::RecordBucket(VkCommandBuffer command_buffer, uint32_t frame_index, uint32_t bucket_index)
+{
+	auto& frame = _frames[frame_index];
+	auto& bucket = _buckets[bucket_index];
+	constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+	VkDeviceSize offset = VkDeviceSize(bucket.FirstDraw) * stride;
+	// 剔除后的命令与数量在设备缓冲中，布局与主机写入的相同
+	VkBuffer commands = frame.Culled ? frame.CulledCommands : frame.Commands;
+
+	// SV_DrawIndex 在每次多重绘制调用内从 0 开始，桶的起点由推送常量补上
+	PushConstants constants{ bucket.FirstDraw, frame.Culled ? 1u : 0u, 0, 0, 0 };
+	constexpr VkShaderStageFlags stages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+	vkCmdPushConstants(command_buffer, _pipeline_layout, stages, 0, sizeof(constants), &constants);
+
+	if (_draw_indirect_count_enabled)
+	{
+		vkCmdDrawIndexedIndirectCount(command_buffer, commands, offset, commands, _bucket_count_offset(frame.Capacity, bucket_index), bucket.DrawCount, stride);
+		return 1;
+	}
+	if (_multi_draw_indirect_enabled)
+	{
+		// 剔除时被剔除的命令 instanceCount 为 0
+		vkCmdDrawIndexedIndirect(command_buffer, commands, offset, bucket.DrawCount, stride);
+		return 1;
+	}
+	for (uint32_t i = 0; i < bucket.DrawCount; ++i)
+	{
+		constants.DrawBase = bucket.FirstDraw + i;
+		vkCmdPushConstants(command_buffer, _pipeline_layout, stages, 0, sizeof(constants), &constants);
+		vkCmdDrawIndexedIndirect(command_buffer, commands, offset + VkDeviceSize(i) * stride, 1, stride);
+	}
+	return bucket.DrawCount;
+}
+
+bool IndirectDrawList::_create_cull_pipeline(const std::string& cull_shader_path)
+{
+	TRACE_ZONE_DETAIL("CreateComputePipeline", "pipeline", "drawCull");
+
+	VkEngineShaderModule shaderModule(_device, cull_shader_path);
+	if (!shaderModule.IsVaild())
+	{
+		LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "IndirectDrawList : failed to load cull shader : {}, gpu culling disabled", cull_shader_path);
+		return false;
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule.GetShaderModule();
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = _pipeline_layout;
+
+	if (VkResult result = vkCreateComputePipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_cull_pipeline))
+	{
+		LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "IndirectDrawList : failed to create cull pipeline! Error code: {}", int32_t(result));
+		_cull_pipeline = VK_NULL_HANDLE;
+		return false;
+	}
+	return true;
+}
+
+bool IndirectDrawList::_reserve_frame(FrameResources& frame, uint32_t draw_count)
+{
+	// 该帧的上一次提交已完成（WaitForFence），可以直接替换
+	_destroy_frame_buffers(frame);
+
+	auto& base = VulkanBase::Base();
+	uint32_t capacity = std::bit_ceil(std::max(draw_count, 1024u));
+	// 数量区：总数一项 + 每个管线一个数量（管线数不会超过绘制数）
+	VkDeviceSize commandsSize = _count_offset(capacity) + VkDeviceSize(capacity + 1) * sizeof(uint32_t);
+	bool created = base.UseVmaCreateBuffer(commandsSize,
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.Commands)
+		&& base.UseVmaMapBuffer(frame.Commands, &frame.CommandsMapped)
+		&& base.UseVmaCreateBuffer(VkDeviceSize(capacity) * sizeof(DrawData),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.DrawDataBuffer)
+		&& base.UseVmaMapBuffer(frame.DrawDataBuffer, &frame.DrawDataMapped)
+		// drawIds 只在剔除后读取，不剔除时也创建以保证描述符有效
+		&& base.UseVmaCreateBuffer(VkDeviceSize(capacity) * sizeof(uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.DrawIds);
+	if (created && _cull_pipeline)
+	{
+		// 剔除输出每帧重写，不登记到碎片整理器
+		created = base.UseVmaCreateBuffer(VkDeviceSize(capacity) * sizeof(CullObject),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.CullObjects)
+			&& base.UseVmaMapBuffer(frame.CullObjects, &frame.CullObjectsMapped)
+			&& base.UseVmaCreateBuffer(commandsSize,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.CulledCommands)
+			&& base.UseVmaCreateBuffer(sizeof(uint32_t),
+				VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.Readback)
+			&& base.UseVmaMapBuffer(frame.Readback, &frame.ReadbackMapped);
+	}
+	if (!created)
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "IndirectDrawList : failed to create draw buffers for {} draws", draw_count);
+		_destroy_frame_buffers(frame);
+		return false;
+	}
+	frame.Capacity = capacity;
+
+	// 不剔除时剔除相关的绑定指向主机写入的缓冲，只为满足描述符有效性
+	const std::array<VkBuffer, BINDING_COUNT> buffers = {
+		frame.DrawDataBuffer, frame.DrawIds,
+		frame.CullObjects ? frame.CullObjects : frame.DrawDataBuffer,
+		frame.Commands,
+		frame.CulledCommands ? frame.CulledCommands : frame.Commands
+	};
+
+	// 登记到 VulkanBase 的 DescriptorWriter，录制之前随该帧的其他写入一起提交
+	auto& writer = base.GetDescriptorWriter();
+	for (uint32_t i = 0; i < BINDING_COUNT; ++i)
+		writer.WriteBuffer(frame.DescriptorSet, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffers[i]);
+	return true;
+}
+
+void IndirectDrawList::_destroy_frame_buffers(FrameResources& frame)
+{
+	auto& base = VulkanBase::Base();
+	if (frame.CommandsMapped)
+		base.UseVmaUnmapBuffer(frame.Commands);
+	if (frame.DrawDataMapped)
+		base.UseVmaUnmapBuffer(frame.DrawDataBuffer);
+	if (frame.CullObjectsMapped)
+		base.UseVmaUnmapBuffer(frame.CullObjects);
+	if (frame.ReadbackMapped)
+		base.UseVmaUnmapBuffer(frame.Readback);
+	// UseVmaDestroyBuffer 对空句柄不做处理
+	base.UseVmaDestroyBuffer(frame.Commands);
+	base.UseVmaDestroyBuffer(frame.DrawDataBuffer);
+	base.UseVmaDestroyBuffer(frame.CullObjects);
+	base.UseVmaDestroyBuffer(frame.CulledCommands);
+	base.UseVmaDestroyBuffer(frame.DrawIds);
+	base.UseVmaDestroyBuffer(frame.Readback);
+	frame.Commands = frame.DrawDataBuffer = frame.CullObjects = frame.CulledCommands = frame.DrawIds = frame.Readback = VK_NULL_HANDLE;
+	frame.CommandsMapped = frame.DrawDataMapped = frame.CullObjectsMapped = frame.ReadbackMapped = nullptr;
+	frame.Capacity = 0;
+	frame.Version = UINT64_MAX;
+	frame.Culled = false;
+	frame.HasResult = false;
+}
@@ -0,0 +1,218 @@
+﻿#pragma once
+
+#include "InstanceBatcher.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// 逐绘制数据（存储缓冲，std430），着色器用 drawBase + SV_DrawIndex 读取，64 字节
+/// </summary>
+struct DrawData
+{
+	// 仿射变换的前三行
+	glm::vec4 Transform[3];
+	// RGBA8
+	uint32_t Color;
+	uint32_t MaterialIndex;
+	// 无绑定资源堆（BindlessHeap）里纹理数组的下标，BindlessHeap::NULL_INDEX 表示不采样纹理
+	uint32_t TextureIndex;
+	uint32_t Padding;
+};
+static_assert(sizeof(DrawData) == 64, "DrawData must match the shader layout");
+
+inline DrawData PackDrawData(const glm::mat4& transform, const glm::vec4& color, uint32_t material_index, uint32_t texture_index = 0)
+{
+	DrawData data{};
+	for (int row = 0; row < 3; ++row)
+		data.Transform[row] = glm::vec4(transform[0][row], transform[1][row], transform[2][row], transform[3][row]);
+	glm::u8vec4 rgba = EncodeUNorm8x4(color);
+	data.Color = uint32_t(rgba.x) | uint32_t(rgba.y) << 8 | uint32_t(rgba.z) << 16 | uint32_t(rgba.w) << 24;
+	data.MaterialIndex = material_index;
+	data.TextureIndex = texture_index;
+	return data;
+}
+
+/// <summary>
+/// 把网格空间的包围球（xyz 中心，w 半径）变换到绘制变换之后的空间，半径按最大轴缩放放大
+/// </summary>
+inline glm::vec4 TransformBounds(const glm::mat4& transform, const glm::vec4& bounds)
+{
+	glm::vec3 center = glm::vec3(transform * glm::vec4(glm::vec3(bounds), 1.0f));
+	float scale = glm::max(glm::length(glm::vec3(transform[0])), glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+	return glm::vec4(center, bounds.w * scale);
+}
+
+/// <summary>
+/// CPU 构建的间接绘制列表：每帧的绘制按管线分桶，编译成持久映射缓冲里的 VkDrawIndexedIndirectCommand 数组，
+/// 每个桶一次 vkCmdDrawIndexedIndirect（支持时用 vkCmdDrawIndexedIndirectCount，不剔除时数量由 CPU 写入）。
+/// 逐绘制数据放在存储缓冲（集 1），推送常量给出桶的起点，着色器用 SV_DrawIndex 取自己的那一项。
+/// 不支持 multiDrawIndirect 时退化为每条命令一次间接绘制。
+/// 开启 GPU 剔除后，每帧一次计算着色器调度按包围球做视锥剔除，幸存的绘制压缩到各桶前部并原子累加桶的数量
+/// （不支持 drawIndirectCount 时按原位置写入、被剔除的 instanceCount 为 0），顶点着色器经 drawIds 找到原来的逐绘制数据
+/// </summary>
+class IndirectDrawList
+{
+public:
+	static constexpr uint32_t CULL_GROUP_SIZE = 64;
+
+	enum Binding : uint32_t
+	{
+		BINDING_DRAW_DATA = 0,
+		BINDING_DRAW_IDS,
+		BINDING_CULL_OBJECTS,
+		BINDING_SOURCE_COMMANDS,
+		BINDING_CULLED_COMMANDS,	// 命令之后是数量区：可见总数，然后是每个桶的数量
+
+		BINDING_COUNT
+	};
+
+	struct Bucket
+	{
+		uint32_t Pipeline = 0;
+		uint32_t FirstDraw = 0;
+		uint32_t DrawCount = 0;
+		uint64_t Triangles = 0;
+	};
+
+	IndirectDrawList() = default;
+	~IndirectDrawList() = default;
+
+	/// <summary>
+	/// ubo_layout 作为集 0（stageFlags 需要包含 COMPUTE）；返回的管线布局供间接绘制的图形管线使用。
+	/// bindless_layout 不为空时作为集 2，着色器用 DrawData::TextureIndex 访问其中的纹理。
+	/// 剔除着色器加载失败时列表仍可用，只是不能开启 GPU 剔除
+	/// </summary>
+	bool Init(VkDevice device, VkDescriptorSetLayout ubo_layout, uint32_t frames_in_flight, const std::string& cull_shader_path,
+		bool draw_indirect_count_enabled, bool multi_draw_indirect_enabled, VkDescriptorSetLayout bindless_layout = VK_NULL_HANDLE);
+	/// <summary>
+	/// 需在 GPU 空闲后调用
+	/// </summary>
+	void CleanUp();
+
+	VkPipelineLayout GetPipelineLayout() const { return _pipeline_layout; }
+
+	void SetGpuCulling(bool gpu_culling) { _gpu_culling = gpu_culling; }
+	bool IsGpuCulling() const { return _gpu_culling && _cull_pipeline; }
+
+	void Clear();
+	void Reserve(size_t draw_count);
+	/// <summary>
+	/// bounds 为绘制变换之后的包围球（见 TransformBounds），半径为负时不参与剔除
+	/// </summary>
+	void Add(const MeshRange& mesh, uint32_t pipeline, const DrawData& data, const glm::vec4& bounds = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f));
+	bool IsEmpty() const { return _draws.empty(); }
+	uint32_t GetDrawCount() const { return static_cast<uint32_t>(_draws.size()); }
+
+	/// <summary>
+	/// 该帧围栏发出信号后、录制前调用：列表有变化时编译进该帧的缓冲（不够大时重建，描述符登记到 VulkanBase 的 DescriptorWriter，
+	/// 需在它提交之前调用）
+	/// </summary>
+	bool Prepare(uint32_t frame_index);
+	/// <summary>
+	/// 最近一次编译得到的桶，按管线编号排序
+	/// </summary>
+	const std::vector<Bucket>& GetBuckets() const { return _buckets; }
+
+	/// <summary>
+	/// 该帧围栏发出信号后调用，读取上一次剔除后的可见绘制数
+	/// </summary>
+	void Collect(uint32_t frame_index);
+	uint32_t GetVisibleDrawCount() const { return _visible_draws; }
+
+	/// <summary>
+	/// 在 render pass 之外录制剔除（Prepare 之后、开启 GPU 剔除时）。
+	/// external_sync 为 true 时结尾不面向图形阶段做屏障，由调用方保证可见（计算队列提交间的信号量，或渲染图的屏障）
+	/// </summary>
+	void RecordCull(VkCommandBuffer command_buffer, uint32_t frame_index, VkDescriptorSet ubo_set, bool external_sync = false);
+	/// <summary>
+	/// 每个命令缓冲绑定一次，各桶的绘制之间不再切换描述符集；bindless_set 只在 Init 传入了 bindless_layout 时使用
+	/// </summary>
+	void BindDescriptorSets(VkCommandBuffer command_buffer, uint32_t frame_index, VkDescriptorSet ubo_set, VkDescriptorSet bindless_set = VK_NULL_HANDLE);
+	/// <summary>
+	/// 录制一个桶的绘制，调用前需绑定该桶的管线、顶点流与索引缓冲。返回发出的 API 调用数
+	/// </summary>
+	uint32_t RecordBucket(VkCommandBuffer command_buffer, uint32_t frame_index, uint32_t bucket_index);
+
+private:
+	// 顶点与计算阶段共用一段推送常量
+	struct PushConstants
+	{
+		uint32_t DrawBase;
+		// 1 : 经 drawIds 取逐绘制数据（GPU 剔除后）
+		uint32_t Remap;
+		uint32_t DrawCount;
+		// 1 : 可见绘制压缩到桶的前部（配合 vkCmdDrawIndexedIndirectCount）
+		uint32_t Compact;
+		// 数量区的字节偏移
+		uint32_t CountOffset;
+	};
+
+	// 剔除输入，与 drawCull.slang 一致，32 字节
+	struct CullObject
+	{
+		glm::vec4 Bounds;
+		uint32_t Bucket;
+		uint32_t BucketFirst;
+		uint32_t Padding[2];
+	};
+
+	struct Draw
+	{
+		MeshRange Mesh;
+		uint32_t Pipeline;
+		DrawData Data;
+		glm::vec4 Bounds;
+	};
+
+	struct FrameResources
+	{
+		VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+		// 间接命令，之后是数量区（总数一项 + 每个桶的绘制数量，vkCmdDrawIndexedIndirectCount 用）
+		VkBuffer Commands = VK_NULL_HANDLE;
+		void* CommandsMapped = nullptr;
+		VkBuffer DrawDataBuffer = VK_NULL_HANDLE;
+		void* DrawDataMapped = nullptr;
+		// GPU 剔除：输入（主机写入）、输出命令与数量、可见绘制的原序号、可见总数的回读
+		VkBuffer CullObjects = VK_NULL_HANDLE;
+		void* CullObjectsMapped = nullptr;
+		VkBuffer CulledCommands = VK_NULL_HANDLE;
+		VkBuffer DrawIds = VK_NULL_HANDLE;
+		VkBuffer Readback = VK_NULL_HANDLE;
+		void* ReadbackMapped = nullptr;
+		bool Culled = false;
+		bool HasResult = false;
+		uint32_t Capacity = 0;
+		uint64_t Version = UINT64_MAX;
+	};
+
+	bool _create_cull_pipeline(const std::string& cull_shader_path);
+	bool _reserve_frame(FrameResources& frame, uint32_t draw_count);
+	void _destroy_frame_buffers(FrameResources& frame);
+	VkDeviceSize _count_offset(uint32_t capacity) const { return VkDeviceSize(capacity) * sizeof(VkDrawIndexedIndirectCommand); }
+	VkDeviceSize _bucket_count_offset(uint32_t capacity, uint32_t bucket_index) const { return _count_offset(capacity) + VkDeviceSize(1 + bucket_index) * sizeof(uint32_t); }
+
+private:
+	VkDevice _device = VK_NULL_HANDLE;
+	VkDescriptorSetLayout _set_layout = VK_NULL_HANDLE;
+	VkPipelineLayout _pipeline_layout = VK_NULL_HANDLE;
+	bool _bindless = false;
+	VkDescriptorPool _descriptor_pool = VK_NULL_HANDLE;
+	VkPipeline _cull_pipeline = VK_NULL_HANDLE;
+
+	bool _draw_indirect_count_enabled = false;
+	bool _multi_draw_indirect_enabled = false;
+	bool _gpu_culling = false;
+	uint32_t _visible_draws = 0;
+
+	std::vector<Draw> _draws;
+	uint64_t _version = 0;
+
+	std::vector<Bucket> _buckets;
+	std::vector<uint32_t> _cursors;
+	std::vector<uint32_t> _bucket_of_pipeline;
+	std::vector<FrameResources> _frames;
+};
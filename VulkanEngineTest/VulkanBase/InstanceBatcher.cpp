@@ -0,0 +1,101 @@
+﻿#include "InstanceBatcher.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <tuple>
+
+void InstanceBatcher::Clear()
+{
+	_instances.clear();
+	_instance_groups.clear();
+	_groups.clear();
+	_last_group = UINT32_MAX;
+	++_version;
+}
+
+void InstanceBatcher::Reserve(size_t instance_count)
+{
+	_instances.reserve(instance_count);
+	_instance_groups.reserve(instance_count);
+}
+
+void InstanceBatcher::Add(const MeshRange& mesh, uint32_t pipeline, const InstanceData& instance)
+{
+	_instances.push_back(instance);
+	_instance_groups.push_back(_find_group(mesh, pipeline));
+	++_version;
+}
+
+uint32_t InstanceBatcher::_find_group(const MeshRange& mesh, uint32_t pipeline)
+{
+	// 连续提交的实例多半属于同一组
+	if (_last_group < _groups.size() && _groups[_last_group].Pipeline == pipeline && _groups[_last_group].Mesh == mesh)
+	{
+		++_groups[_last_group].Count;
+		return _last_group;
+	}
+	for (uint32_t i = 0; i < _groups.size(); ++i)
+	{
+		if (_groups[i].Pipeline == pipeline && _groups[i].Mesh == mesh)
+		{
+			++_groups[i].Count;
+			return _last_group = i;
+		}
+	}
+	_groups.push_back({ mesh, pipeline, 1 });
+	return _last_group = static_cast<uint32_t>(_groups.size() - 1);
+}
+
+const std::vector<InstanceBatcher::Batch>& InstanceBatcher::Build(InstanceData* dst)
+{
+	TRACE_ZONE_DETAIL("BuildInstanceBatches", "render", std::to_string(_instances.size()));
+
+	_batches.clear();
+	if (_instances.empty())
+		return _batches;
+
+	if (!_grouping)
+	{
+		// 不分组：按提交顺序每个实例一次绘制
+		_batches.resize(_instances.size());
+		for (uint32_t i = 0; i < _instances.size(); ++i)
+		{
+			auto& group = _groups[_instance_groups[i]];
+			_batches[i] = { group.Mesh, group.Pipeline, i, 1 };
+		}
+		std::memcpy(dst, _instances.data(), _instances.size() * sizeof(InstanceData));
+		return _batches;
+	}
+
+	// 组按（管线，网格）排序，再按组计数得到每组在实例缓冲中的起点
+	std::vector<uint32_t> order(_groups.size());
+	std::iota(order.begin(), order.end(), 0u);
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+		auto& ga = _groups[a];
+		auto& gb = _groups[b];
+		return std::tie(ga.Pipeline, ga.Mesh.FirstIndex, ga.Mesh.IndexCount, ga.Mesh.VertexOffset)
+			< std::tie(gb.Pipeline, gb.Mesh.FirstIndex, gb.Mesh.IndexCount, gb.Mesh.VertexOffset);
+		});
+
+	_cursors.assign(_groups.size(), 0);
+	uint32_t first = 0;
+	for (uint32_t g : order)
+	{
+		auto& group = _groups[g];
+		_batches.push_back({ group.Mesh, group.Pipeline, first, group.Count });
+		_cursors[g] = first;
+		first += group.Count;
+	}
+
+	if (_groups.size() == 1)
+	{
+		std::memcpy(dst, _instances.data(), _instances.size() * sizeof(InstanceData));
+		return _batches;
+	}
+	for (size_t i = 0; i < _instances.size(); ++i)
+		dst[_cursors[_instance_groups[i]]++] = _instances[i];
+	return _batches;
+}
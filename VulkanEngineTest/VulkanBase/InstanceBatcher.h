@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include "Vertex.h"
+
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// 索引缓冲中的一段网格：相同的 MeshRange + 管线的实例会被合并成一次实例化绘制
+/// </summary>
+struct MeshRange
+{
+	uint32_t FirstIndex = 0;
+	uint32_t IndexCount = 0;
+	int32_t VertexOffset = 0;
+
+	bool operator==(const MeshRange&) const = default;
+};
+
+/// <summary>
+/// 实例化绘制的收集与分组：Add 逐个提交实例，Build 按（管线，网格）分组后把实例连续写入实例缓冲，
+/// 每组对应一次 vkCmdDrawIndexed(indexCount, instanceCount, ..., firstInstance)。
+/// 分组是计数排序（组数通常很少），不改变同组实例的提交顺序；关闭分组时每个实例单独一次绘制（用于对比）
+/// </summary>
+class InstanceBatcher
+{
+public:
+	struct Batch
+	{
+		MeshRange Mesh;
+		uint32_t Pipeline = 0;
+		uint32_t FirstInstance = 0;
+		uint32_t InstanceCount = 0;
+	};
+
+	InstanceBatcher() = default;
+	~InstanceBatcher() = default;
+
+	void SetGrouping(bool grouping) { if (_grouping != grouping) { _grouping = grouping; ++_version; } }
+	bool IsGrouping() const { return _grouping; }
+
+	void Clear();
+	void Reserve(size_t instance_count);
+	void Add(const MeshRange& mesh, uint32_t pipeline, const InstanceData& instance);
+
+	uint32_t GetInstanceCount() const { return static_cast<uint32_t>(_instances.size()); }
+	bool IsEmpty() const { return _instances.empty(); }
+	/// <summary>
+	/// 每次修改实例列表后递增，用于判断实例缓冲是否需要重写
+	/// </summary>
+	uint64_t GetVersion() const { return _version; }
+
+	/// <summary>
+	/// 按批次顺序把 GetInstanceCount() 个实例写入 dst（通常是映射的实例缓冲），返回的批次按管线排序以减少管线切换
+	/// </summary>
+	const std::vector<Batch>& Build(InstanceData* dst);
+	/// <summary>
+	/// 最近一次 Build 的结果
+	/// </summary>
+	const std::vector<Batch>& GetBatches() const { return _batches; }
+
+private:
+	struct Group
+	{
+		MeshRange Mesh;
+		uint32_t Pipeline = 0;
+		uint32_t Count = 0;
+	};
+
+	uint32_t _find_group(const MeshRange& mesh, uint32_t pipeline);
+
+private:
+	bool _grouping = true;
+	uint64_t _version = 0;
+
+	std::vector<InstanceData> _instances;
+	// 每个实例所属的组
+	std::vector<uint32_t> _instance_groups;
+	std::vector<Group> _groups;
+	uint32_t _last_group = UINT32_MAX;
+
+	std::vector<Batch> _batches;
+	std::vector<uint32_t> _cursors;
+};
@@ -0,0 +1,291 @@
+﻿#include "Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+////////////////////////// Logger ////////////////////////////////////////////
+
+Logger& Logger::Get()
+{
+	static Logger logger;
+	return logger;
+}
+
+const char* Logger::LevelName(LogLevel level)
+{
+	switch (level)
+	{
+	case LogLevel::Verbose:		return "VERBOSE";
+	case LogLevel::Info:		return "INFO";
+	case LogLevel::Warning:		return "WARNING";
+	case LogLevel::Error:		return "ERROR";
+	default:					return "OFF";
+	}
+}
+
+const char* Logger::CategoryName(LogCategory category)
+{
+	switch (category)
+	{
+	case LOG_CATEGORY_GENERAL:			return "General";
+	case LOG_CATEGORY_VULKAN_BASE:		return "VulkanBase";
+	case LOG_CATEGORY_VALIDATION:		return "Validation";
+	case LOG_CATEGORY_SHADER:			return "Shader";
+	case LOG_CATEGORY_SHADER_COMPILER:	return "ShaderCompiler";
+	case LOG_CATEGORY_GPU_PROFILER:		return "GpuProfiler";
+	case LOG_CATEGORY_PROFILER:			return "Profiler";
+	default:							return "Unknown";
+	}
+}
+
+Logger::Logger()
+{
+	for (auto& level : _levels)
+		level.store(LogLevel::Info, std::memory_order_relaxed);
+
+	_running.store(true, std::memory_order_release);
+	_thread = std::thread(&Logger::_worker, this);
+}
+
+Logger::~Logger()
+{
+	Shutdown();
+	if (_file)
+		fclose(_file);
+}
+
+void Logger::SetLevel(LogLevel level)
+{
+	for (auto& l : _levels)
+		l.store(level, std::memory_order_relaxed);
+}
+
+void Logger::SetCategoryLevel(LogCategory category, LogLevel level)
+{
+	if (category < LOG_CATEGORY_COUNT)
+		_levels[category].store(level, std::memory_order_relaxed);
+}
+
+bool Logger::SetOutputFile(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(_drain_mutex);
+	if (_file)
+	{
+		fclose(_file);
+		_file = nullptr;
+	}
+	if (path.empty())
+		return true;
+
+	if (errno_t error = fopen_s(&_file, path.c_str(), "a"))
+	{
+		_file = nullptr;
+		std::cout << std::format("ERROR : [ Logger ] failed to open file : {} (errno {}) \n", path, int32_t(error));
+		return false;
+	}
+	return true;
+}
+
+uint64_t Logger::_now_ns()
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t Logger::_hash_text(const char* text, size_t length, uint64_t seed)
+{
+	// FNV-1a
+	uint64_t hash = seed;
+	for (size_t i = 0; i < length; ++i)
+	{
+		hash ^= uint8_t(text[i]);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+Logger::ThreadRing& Logger::_local_ring()
+{
+	thread_local std::shared_ptr<ThreadRing> ring;
+	if (!ring)
+	{
+		ring = std::make_shared<ThreadRing>();
+		std::lock_guard<std::mutex> lock(_registry_mutex);
+		ring->ThreadId = _next_thread_id++;
+		// 注册表持有一份引用，线程退出后剩余记录仍会被写出
+		_rings.push_back(ring);
+	}
+	return *ring;
+}
+
+bool Logger::_rate_limit(ThreadRing& ring, uint64_t key, uint64_t now_ns, uint32_t& suppressed)
+{
+	auto& slot = ring.RateLimit[key % RATE_LIMIT_SLOTS];
+	if (slot.Key != key || now_ns - slot.WindowBeginNs >= 1'000'000'000ull)
+	{
+		// 新窗口：带上此前被限流的条数。槽位被别的消息占用时原消息的计数交给后台线程汇总
+		suppressed = slot.Key == key ? slot.Suppressed : 0;
+		if (slot.Key != key && slot.Suppressed)
+			_evicted_suppressed.fetch_add(slot.Suppressed, std::memory_order_relaxed);
+		slot.Key = key;
+		slot.WindowBeginNs = now_ns;
+		slot.Count = 1;
+		slot.Suppressed = 0;
+		return true;
+	}
+
+	if (slot.Count < RATE_LIMIT_PER_SECOND)
+	{
+		++slot.Count;
+		suppressed = 0;
+		return true;
+	}
+
+	++slot.Suppressed;
+	return false;
+}
+
+void Logger::_submit(Record& record, uint64_t key)
+{
+	auto& ring = _local_ring();
+	record.ThreadId = ring.ThreadId;
+
+	if (!_rate_limit(ring, key, record.TimeNs, record.Suppressed))
+		return;
+
+	if (!_running.load(std::memory_order_acquire))
+	{
+		// 后台线程已结束：同步写出
+		std::lock_guard<std::mutex> lock(_drain_mutex);
+		_batch.push_back(record);
+		_drain_locked();
+		return;
+	}
+
+	uint64_t head = ring.Head.load(std::memory_order_relaxed);
+	if (head - ring.Tail.load(std::memory_order_acquire) >= RING_CAPACITY)
+	{
+		// 满了就丢弃，不阻塞调用线程
+		_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	ring.Records[head % RING_CAPACITY] = record;
+	ring.Head.store(head + 1, std::memory_order_release);
+
+	// Shutdown 可能在上面的检查之后结束了后台线程、做完了最后一次写出：再检查一次，自己写出。
+	// 栅栏保证这里读到 true 时，Shutdown 之后的写出能看到这条记录
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (!_running.load(std::memory_order_relaxed))
+	{
+		Flush();
+		return;
+	}
+
+	// 错误尽快输出
+	if (record.Level >= LogLevel::Error)
+		_wake.notify_one();
+}
+
+void Logger::Flush()
+{
+	std::lock_guard<std::mutex> lock(_drain_mutex);
+	_drain_locked();
+}
+
+void Logger::Shutdown()
+{
+	if (_running.exchange(false, std::memory_order_seq_cst))
+	{
+		{
+			std::lock_guard<std::mutex> lock(_wake_mutex);
+			_shutdown.store(true, std::memory_order_release);
+		}
+		_wake.notify_one();
+		if (_thread.joinable())
+			_thread.join();
+	}
+	Flush();
+}
+
+void Logger::_worker()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_wake_mutex);
+			_wake.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS),
+				[this] { return _shutdown.load(std::memory_order_acquire); });
+		}
+
+		Flush();
+
+		if (_shutdown.load(std::memory_order_acquire))
+			break;
+	}
+}
+
+void Logger::_drain_locked()
+{
+	std::vector<std::shared_ptr<ThreadRing>> rings;
+	{
+		std::lock_guard<std::mutex> lock(_registry_mutex);
+		rings = _rings;
+	}
+
+	for (auto& ring : rings)
+	{
+		uint64_t tail = ring->Tail.load(std::memory_order_relaxed);
+		uint64_t head = ring->Head.load(std::memory_order_acquire);
+		for (; tail < head; ++tail)
+			_batch.push_back(ring->Records[tail % RING_CAPACITY]);
+		ring->Tail.store(tail, std::memory_order_release);
+	}
+
+	uint64_t dropped = _dropped.load(std::memory_order_relaxed);
+	uint64_t evicted = _evicted_suppressed.load(std::memory_order_relaxed);
+	if (_batch.empty() && dropped == _reported_dropped && evicted == _reported_evicted_suppressed)
+		return;
+
+	// 各线程内部有序，合并后按时间排序
+	std::stable_sort(_batch.begin(), _batch.end(), [](const Record& a, const Record& b) { return a.TimeNs < b.TimeNs; });
+
+	std::string text;
+	for (auto& record : _batch)
+	{
+		text += std::format("{} : [ {} ] ", LevelName(record.Level), CategoryName(record.Category));
+		if (record.Formatter)
+			record.Formatter(record, text);
+		else
+			text.append(reinterpret_cast<const char*>(record.Payload), record.TextLength);
+		if (record.Truncated)
+			text += " ...(truncated)";
+		if (record.Suppressed)
+			text += std::format(" (+{} similar messages suppressed)", record.Suppressed);
+		text += '\n';
+	}
+	_batch.clear();
+
+	if (dropped != _reported_dropped)
+	{
+		text += std::format("WARNING : [ Logger ] {} messages dropped (ring buffer full)\n", dropped - _reported_dropped);
+		_reported_dropped = dropped;
+	}
+	if (evicted != _reported_evicted_suppressed)
+	{
+		text += std::format("WARNING : [ Logger ] {} messages suppressed (rate limit)\n", evicted - _reported_evicted_suppressed);
+		_reported_evicted_suppressed = evicted;
+	}
+
+	_write_locked(text);
+}
+
+void Logger::_write_locked(const std::string& text)
+{
+	std::cout.write(text.data(), std::streamsize(text.size()));
+	std::cout.flush();
+	if (_file)
+	{
+		fwrite(text.data(), 1, text.size(), _file);
+		fflush(_file);
+	}
+}
@@ -0,0 +1,233 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+enum class LogLevel : uint8_t
+{
+	Verbose = 0,
+	Info,
+	Warning,
+	Error,
+	Off
+};
+
+enum LogCategory : uint8_t
+{
+	LOG_CATEGORY_GENERAL = 0,
+	LOG_CATEGORY_VULKAN_BASE,
+	LOG_CATEGORY_VALIDATION,
+	LOG_CATEGORY_SHADER,
+	LOG_CATEGORY_SHADER_COMPILER,
+	LOG_CATEGORY_GPU_PROFILER,
+	LOG_CATEGORY_PROFILER,
+
+	LOG_CATEGORY_COUNT
+};
+
+/// <summary>
+/// 异步日志。调用线程只做级别过滤、限流和一次定长拷贝：
+/// 参数全是数值时只保存参数，格式化推迟到后台线程；含字符串参数时在调用线程格式化到定长缓冲区（不分配内存），
+/// 超出 PAYLOAD_SIZE 的部分截断并在输出时标注。
+/// 记录写入线程局部的单生产者环形缓冲区，后台线程定期取出、按时间排序后统一写到控制台 / 文件。
+/// 同一条消息（同一个调用点且参数相同，或同样的文本）每秒最多输出 RATE_LIMIT_PER_SECOND 次，其余计数后合并提示；
+/// 限流槽位被别的消息占用时，原消息尚未提示的计数单独汇总输出。
+/// 环形缓冲区满时丢弃新记录而不阻塞调用线程。
+/// </summary>
+class Logger
+{
+public:
+	static constexpr uint32_t RING_CAPACITY = 1024;	// 每个线程
+	static constexpr uint32_t PAYLOAD_SIZE = 448;
+	static constexpr uint32_t RATE_LIMIT_PER_SECOND = 10;
+	static constexpr uint32_t RATE_LIMIT_SLOTS = 64;
+	static constexpr uint32_t FLUSH_INTERVAL_MS = 5;
+
+	struct Record;
+	using FormatFunction = void(*)(const Record& record, std::string& out);
+
+	struct Record
+	{
+		uint64_t TimeNs = 0;
+		uint32_t ThreadId = 0;
+		LogLevel Level = LogLevel::Info;
+		LogCategory Category = LOG_CATEGORY_GENERAL;
+		uint32_t Suppressed = 0;		// 此前被限流掉的同类消息条数
+		const char* Format = nullptr;	// 延迟格式化时的格式串（字面量）
+		uint32_t FormatLength = 0;
+		FormatFunction Formatter = nullptr;	// 为空表示 Payload 中已是格式化好的文本
+		uint32_t TextLength = 0;
+		bool Truncated = false;			// 文本超出 Payload 被截断
+		alignas(8) unsigned char Payload[PAYLOAD_SIZE];
+	};
+
+	static Logger& Get();
+	static const char* LevelName(LogLevel level);
+	static const char* CategoryName(LogCategory category);
+
+	~Logger();
+
+	void SetLevel(LogLevel level);
+	void SetCategoryLevel(LogCategory category, LogLevel level);
+	bool IsEnabled(LogLevel level, LogCategory category) const
+	{
+		return level >= _levels[category].load(std::memory_order_relaxed) && level != LogLevel::Off;
+	}
+
+	/// <summary>
+	/// 额外写入文件（追加），传空字符串关闭
+	/// </summary>
+	bool SetOutputFile(const std::string& path);
+
+	template<typename... Args>
+	void Log(LogLevel level, LogCategory category, std::format_string<Args...> fmt, Args&&... args);
+
+	/// <summary>
+	/// 同步写出所有已提交的记录
+	/// </summary>
+	void Flush();
+	/// <summary>
+	/// 写出剩余记录并结束后台线程（程序退出前调用）。之后的日志在调用线程同步写出
+	/// </summary>
+	void Shutdown();
+
+	uint64_t GetDroppedCount() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+	Logger();
+
+	template<typename T>
+	static constexpr bool IS_DEFERRABLE = std::is_arithmetic_v<T> || std::is_same_v<T, const void*> || std::is_same_v<T, void*>;
+
+	template<typename... Ts>
+	struct PackedArgs
+	{
+		static constexpr size_t SIZE = (sizeof(Ts) + ... + 0);
+
+		static void Store(unsigned char* out, const Ts&... args)
+		{
+			size_t offset = 0;
+			((std::memcpy(out + offset, &args, sizeof(Ts)), offset += sizeof(Ts)), ...);
+		}
+
+		static void Format(const Record& record, std::string& out)
+		{
+			std::tuple<Ts...> values;
+			std::apply([&record, &out](Ts&... args) {
+				size_t offset = 0;
+				((std::memcpy(&args, record.Payload + offset, sizeof(Ts)), offset += sizeof(Ts)), ...);
+				std::vformat_to(std::back_inserter(out), std::string_view(record.Format, record.FormatLength), std::make_format_args(args...));
+				}, values);
+		}
+	};
+
+	struct RateLimitSlot
+	{
+		uint64_t Key = 0;
+		uint64_t WindowBeginNs = 0;
+		uint32_t Count = 0;
+		uint32_t Suppressed = 0;
+	};
+
+	struct ThreadRing
+	{
+		std::unique_ptr<Record[]> Records{ new Record[RING_CAPACITY] };
+		std::atomic<uint64_t> Head{ 0 };	// 生产者写
+		std::atomic<uint64_t> Tail{ 0 };	// 消费者写
+		uint32_t ThreadId = 0;
+		// 只由生产者访问
+		RateLimitSlot RateLimit[RATE_LIMIT_SLOTS];
+	};
+
+	ThreadRing& _local_ring();
+	static uint64_t _now_ns();
+	static uint64_t _hash_text(const char* text, size_t length, uint64_t seed = 14695981039346656037ull);
+	// 返回 false 表示被限流；允许输出时带回之前被限流的条数
+	bool _rate_limit(ThreadRing& ring, uint64_t key, uint64_t now_ns, uint32_t& suppressed);
+	void _submit(Record& record, uint64_t key);
+
+	void _worker();
+	// 调用前需持有 _drain_mutex
+	void _drain_locked();
+	void _write_locked(const std::string& text);
+
+private:
+	std::array<std::atomic<LogLevel>, LOG_CATEGORY_COUNT> _levels;
+
+	std::mutex _registry_mutex;
+	std::vector<std::shared_ptr<ThreadRing>> _rings;
+	uint32_t _next_thread_id = 1;
+
+	std::mutex _drain_mutex;
+	std::vector<Record> _batch;
+	FILE* _file = nullptr;
+
+	std::mutex _wake_mutex;
+	std::condition_variable _wake;
+	std::thread _thread;
+	std::atomic<bool> _running{ false };
+	std::atomic<bool> _shutdown{ false };
+
+	std::atomic<uint64_t> _dropped{ 0 };
+	uint64_t _reported_dropped = 0;
+	// 槽位被占用时丢失了对应消息、只能汇总提示的限流条数
+	std::atomic<uint64_t> _evicted_suppressed{ 0 };
+	uint64_t _reported_evicted_suppressed = 0;
+};
+
+template<typename... Args>
+void Logger::Log(LogLevel level, LogCategory category, std::format_string<Args...> fmt, Args&&... args)
+{
+	if (!IsEnabled(level, category))
+		return;
+
+	Record record;
+	record.TimeNs = _now_ns();
+	record.Level = level;
+	record.Category = category;
+
+	std::string_view format = fmt.get();
+	using Packed = PackedArgs<std::decay_t<Args>...>;
+	if constexpr ((IS_DEFERRABLE<std::decay_t<Args>> && ...) && Packed::SIZE <= PAYLOAD_SIZE)
+	{
+		// 只拷贝参数，后台线程再格式化；以调用点（格式串地址）加参数值作为限流键，同一调用点的不同消息互不限流
+		record.Format = format.data();
+		record.FormatLength = uint32_t(format.size());
+		record.Formatter = &Packed::Format;
+		Packed::Store(record.Payload, args...);
+		const char* site = format.data();
+		_submit(record, _hash_text(reinterpret_cast<const char*>(record.Payload), Packed::SIZE,
+			_hash_text(reinterpret_cast<const char*>(&site), sizeof(site))));
+	}
+	else
+	{
+		// 含字符串等参数：引用在返回后可能失效，就地格式化，以文本内容作为限流键
+		char* text = reinterpret_cast<char*>(record.Payload);
+		auto result = std::format_to_n(text, PAYLOAD_SIZE, fmt, std::forward<Args>(args)...);
+		size_t length = std::min(size_t(result.size), size_t(PAYLOAD_SIZE));
+		record.TextLength = uint32_t(length);
+		record.Truncated = size_t(result.size) > PAYLOAD_SIZE;
+		_submit(record, _hash_text(text, length));
+	}
+}
+
+#define LOG_AT(level, category, ...) \
+	do { if (Logger::Get().IsEnabled(level, category)) Logger::Get().Log(level, category, __VA_ARGS__); } while (0)
+#define LOG_VERBOSE(category, ...)	LOG_AT(LogLevel::Verbose, category, __VA_ARGS__)
+#define LOG_INFO(category, ...)		LOG_AT(LogLevel::Info, category, __VA_ARGS__)
+#define LOG_WARNING(category, ...)	LOG_AT(LogLevel::Warning, category, __VA_ARGS__)
+#define LOG_ERROR(category, ...)	LOG_AT(LogLevel::Error, category, __VA_ARGS__)
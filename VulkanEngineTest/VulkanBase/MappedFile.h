@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <string>
+
+/// <summary>
+/// 只读内存映射文件（Windows 用 CreateFileMapping / MapViewOfFile，其他平台用 mmap）。
+/// 页面按需由操作系统换入，读取大文件时不需要额外的缓冲与拷贝
+/// </summary>
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return _data != nullptr; }
+	const unsigned char* Data() const { return static_cast<const unsigned char*>(_data); }
+	size_t Size() const { return _size; }
+
+private:
+	void _swap(MappedFile& other) noexcept;
+
+private:
+	void* _data = nullptr;
+	size_t _size = 0;
+#ifdef _WIN32
+	void* _file = nullptr;
+	void* _mapping = nullptr;
+#endif
+};
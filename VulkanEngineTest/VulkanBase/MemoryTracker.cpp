@@ -0,0 +1,242 @@
+﻿// 模拟预处理头
+#include "VulkanMemoryAllocator/VmaUsage.h"
+
+#include "MemoryTracker.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+
+static constexpr double MB = 1024.0 * 1024.0;
+
+MemoryTracker& MemoryTracker::Get()
+{
+	static MemoryTracker tracker;
+	return tracker;
+}
+
+const char* MemoryTracker::CategoryName(Category category)
+{
+	switch (category)
+	{
+	case CATEGORY_GEOMETRY:			return "Geometry";
+	case CATEGORY_UNIFORMS:			return "Uniforms";
+	case CATEGORY_STAGING:			return "Staging";
+	case CATEGORY_TEXTURES:			return "Textures";
+	case CATEGORY_RENDER_TARGETS:	return "RenderTargets";
+	case CATEGORY_OTHER:			return "Other";
+	default:						return "Unknown";
+	}
+}
+
+MemoryTracker::Category MemoryTracker::ClassifyBuffer(VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+{
+	if (usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT))
+		return CATEGORY_GEOMETRY;
+	if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+		return CATEGORY_UNIFORMS;
+	// 只作为拷贝源的主机可见缓冲
+	if ((usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) && (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+		return CATEGORY_STAGING;
+	return CATEGORY_OTHER;
+}
+
+MemoryTracker::Category MemoryTracker::ClassifyImage(VkImageUsageFlags usage)
+{
+	if (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT))
+		return CATEGORY_RENDER_TARGETS;
+	if (usage & VK_IMAGE_USAGE_SAMPLED_BIT)
+		return CATEGORY_TEXTURES;
+	return CATEGORY_OTHER;
+}
+
+void MemoryTracker::Init(VmaAllocator allocator, VkPhysicalDevice physical_device)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_allocator = allocator;
+
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(physical_device, &memoryProperties);
+
+	_heap_count = memoryProperties.memoryHeapCount;
+	for (uint32_t i = 0; i < _heap_count; ++i)
+	{
+		_heaps[i] = HeapInfo{};
+		_heaps[i].Size = memoryProperties.memoryHeaps[i].size;
+		_heaps[i].DeviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		_warning_level[i] = 0;
+	}
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+	{
+		_memory_type_heaps[i] = memoryProperties.memoryTypes[i].heapIndex;
+	}
+}
+
+void MemoryTracker::CleanUp()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_allocations.empty())
+	{
+		LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "MemoryTracker : {} allocations still alive at shutdown", _allocations.size());
+	}
+	_allocations.clear();
+	for (auto& bytes : _category_bytes)
+		bytes.store(0, std::memory_order_relaxed);
+	_allocator = nullptr;
+	_heap_count = 0;
+}
+
+void MemoryTracker::OnAllocate(VmaAllocation allocation, Category category)
+{
+	if (!_allocator || !allocation)
+		return;
+
+	VmaAllocationInfo info;
+	vmaGetAllocationInfo(_allocator, allocation, &info);
+
+	AllocationRecord record{ category, _memory_type_heaps[info.memoryType], info.size };
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_allocations[allocation] = record;
+	_heaps[record.Heap].CategoryBytes[category] += record.Size;
+	_category_bytes[category].fetch_add(record.Size, std::memory_order_relaxed);
+}
+
+void MemoryTracker::OnFree(VmaAllocation allocation)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto iter = _allocations.find(allocation);
+	if (iter == _allocations.end())
+		return;
+
+	auto& record = iter->second;
+	_heaps[record.Heap].CategoryBytes[record.Type] -= record.Size;
+	_category_bytes[record.Type].fetch_sub(record.Size, std::memory_order_relaxed);
+	_allocations.erase(iter);
+}
+
+void MemoryTracker::Update()
+{
+	if (!_allocator)
+		return;
+
+	// VMA 依赖帧序号决定何时重新向驱动查询预算
+	vmaSetCurrentFrameIndex(_allocator, uint32_t(++_frame_index));
+
+	VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+	vmaGetHeapBudgets(_allocator, budgets);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (uint32_t i = 0; i < _heap_count; ++i)
+	{
+		auto& heap = _heaps[i];
+		heap.Usage = budgets[i].usage;
+		heap.Budget = budgets[i].budget;
+		heap.BlockBytes = budgets[i].statistics.blockBytes;
+		heap.AllocationBytes = budgets[i].statistics.allocationBytes;
+		heap.AllocationCount = budgets[i].statistics.allocationCount;
+
+		if (heap.Budget == 0)
+			continue;
+
+		double ratio = double(heap.Usage) / double(heap.Budget);
+		if (ratio > 1.0 && _warning_level[i] < 2)
+		{
+			_warning_level[i] = 2;
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "heap {} over budget : {:.1f} MB used / {:.1f} MB budget",
+				i, heap.Usage / MB, heap.Budget / MB);
+		}
+		else if (ratio > WARNING_RATIO && _warning_level[i] < 1)
+		{
+			_warning_level[i] = 1;
+			LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "heap {} close to budget : {:.1f} MB used / {:.1f} MB budget",
+				i, heap.Usage / MB, heap.Budget / MB);
+		}
+		else if (ratio < RECOVER_RATIO)
+		{
+			_warning_level[i] = 0;
+		}
+	}
+}
+
+std::vector<MemoryTracker::HeapInfo> MemoryTracker::GetHeaps() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return std::vector<HeapInfo>(_heaps.begin(), _heaps.begin() + _heap_count);
+}
+
+VkDeviceSize MemoryTracker::GetAvailableBytes(uint32_t heap_index) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (heap_index >= _heap_count)
+		return 0;
+	auto& heap = _heaps[heap_index];
+	return heap.Budget > heap.Usage ? heap.Budget - heap.Usage : 0;
+}
+
+VkDeviceSize MemoryTracker::GetAvailableDeviceLocalBytes() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	VkDeviceSize available = 0;
+	for (uint32_t i = 0; i < _heap_count; ++i)
+	{
+		auto& heap = _heaps[i];
+		if (heap.DeviceLocal && heap.Budget > heap.Usage)
+			available = std::max(available, heap.Budget - heap.Usage);
+	}
+	return available;
+}
+
+std::string MemoryTracker::ToJson() const
+{
+	auto heaps = GetHeaps();
+
+	std::string json = "{ \"heaps\": [";
+	for (uint32_t i = 0; i < heaps.size(); ++i)
+	{
+		auto& heap = heaps[i];
+		std::string categories;
+		for (uint32_t c = 0; c < CATEGORY_COUNT; ++c)
+		{
+			categories += std::format("{}\"{}\": {}", c ? ", " : "", CategoryName(Category(c)), heap.CategoryBytes[c]);
+		}
+		json += std::format("{}{{ \"heap\": {}, \"device_local\": {}, \"size_bytes\": {}, \"usage_bytes\": {}, \"budget_bytes\": {}, "
+			"\"block_bytes\": {}, \"allocation_bytes\": {}, \"allocation_count\": {}, \"categories\": {{ {} }} }}",
+			i ? ", " : "", i, heap.DeviceLocal ? "true" : "false", heap.Size, heap.Usage, heap.Budget,
+			heap.BlockBytes, heap.AllocationBytes, heap.AllocationCount, categories);
+	}
+	json += "], \"categories\": { ";
+	for (uint32_t c = 0; c < CATEGORY_COUNT; ++c)
+	{
+		json += std::format("{}\"{}\": {}", c ? ", " : "", CategoryName(Category(c)), GetCategoryBytes(Category(c)));
+	}
+	json += " } }";
+	return json;
+}
+
+bool MemoryTracker::DumpVmaStats(const std::string& path) const
+{
+	if (!_allocator)
+		return false;
+
+	char* statsString = nullptr;
+	vmaBuildStatsString(_allocator, &statsString, VK_TRUE);
+
+	std::ofstream file(path, std::ios::trunc);
+	bool ok = file.is_open();
+	if (ok)
+	{
+		file << statsString;
+		ok = bool(file);
+	}
+	vmaFreeStatsString(_allocator, statsString);
+
+	if (!ok)
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "MemoryTracker : failed to write file : {}", path);
+		return false;
+	}
+	LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "MemoryTracker : VMA stats written to : {}", path);
+	return true;
+}
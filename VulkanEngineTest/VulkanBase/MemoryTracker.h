@@ -0,0 +1,111 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef struct VmaAllocator_T* VmaAllocator;
+typedef struct VmaAllocation_T* VmaAllocation;
+
+/// <summary>
+/// 显存预算与用量统计。
+/// 每帧用 vmaGetHeapBudgets 读取各个堆的驱动预算（VK_EXT_memory_budget），接近或超过预算时输出警告；
+/// 所有经由 VulkanBase::UseVma* 创建的资源按用途归类（几何、uniform、staging、纹理、渲染目标），分别按堆统计。
+/// 流式加载等模块可以用 GetAvailableBytes 按真实预算确定缓存池大小。
+/// </summary>
+class MemoryTracker
+{
+public:
+	static constexpr uint32_t MAX_HEAPS = VK_MAX_MEMORY_HEAPS;
+	static constexpr double WARNING_RATIO = 0.90;	// 用量超过预算的 90% 时警告
+	static constexpr double RECOVER_RATIO = 0.85;	// 回落到 85% 以下才重新允许警告
+
+	enum Category : uint32_t
+	{
+		CATEGORY_GEOMETRY = 0,
+		CATEGORY_UNIFORMS,
+		CATEGORY_STAGING,
+		CATEGORY_TEXTURES,
+		CATEGORY_RENDER_TARGETS,
+		CATEGORY_OTHER,
+
+		CATEGORY_COUNT
+	};
+
+	struct HeapInfo
+	{
+		VkDeviceSize Size = 0;
+		bool DeviceLocal = false;
+		// 来自 vmaGetHeapBudgets
+		VkDeviceSize Usage = 0;				// 整个进程在该堆上的用量（驱动报告）
+		VkDeviceSize Budget = 0;
+		VkDeviceSize BlockBytes = 0;		// VMA 分配的 VkDeviceMemory 总量
+		VkDeviceSize AllocationBytes = 0;	// 其中实际被资源占用的量
+		uint32_t AllocationCount = 0;
+		// 引擎分类统计
+		std::array<VkDeviceSize, CATEGORY_COUNT> CategoryBytes{};
+	};
+
+	static MemoryTracker& Get();
+	static const char* CategoryName(Category category);
+	static Category ClassifyBuffer(VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+	static Category ClassifyImage(VkImageUsageFlags usage);
+
+	void Init(VmaAllocator allocator, VkPhysicalDevice physical_device);
+	void CleanUp();
+
+	void OnAllocate(VmaAllocation allocation, Category category);
+	void OnFree(VmaAllocation allocation);
+
+	/// <summary>
+	/// 每帧调用一次：推进 VMA 帧序号，刷新预算并检查是否接近超额
+	/// </summary>
+	void Update();
+
+	uint32_t GetHeapCount() const { return _heap_count; }
+	std::vector<HeapInfo> GetHeaps() const;
+	VkDeviceSize GetCategoryBytes(Category category) const { return _category_bytes[category].load(std::memory_order_relaxed); }
+	/// <summary>
+	/// 该堆剩余的预算（预算 - 用量），已超额时返回 0
+	/// </summary>
+	VkDeviceSize GetAvailableBytes(uint32_t heap_index) const;
+	/// <summary>
+	/// 设备本地堆中剩余预算最多的那个堆的剩余量
+	/// </summary>
+	VkDeviceSize GetAvailableDeviceLocalBytes() const;
+
+	std::string ToJson() const;
+	/// <summary>
+	/// 写出 vmaBuildStatsString 的详细 JSON（每个内存块、每个分配）
+	/// </summary>
+	bool DumpVmaStats(const std::string& path) const;
+
+private:
+	MemoryTracker() = default;
+
+	struct AllocationRecord
+	{
+		Category Type;
+		uint32_t Heap;
+		VkDeviceSize Size;
+	};
+
+private:
+	VmaAllocator _allocator = nullptr;
+	uint32_t _heap_count = 0;
+	uint32_t _memory_type_heaps[VK_MAX_MEMORY_TYPES] = {};
+	uint64_t _frame_index = 0;
+
+	mutable std::mutex _mutex;
+	std::unordered_map<VmaAllocation, AllocationRecord> _allocations;
+	std::array<HeapInfo, MAX_HEAPS> _heaps{};
+	std::array<uint32_t, MAX_HEAPS> _warning_level{};	// 0 正常，1 已警告接近预算，2 已报告超额
+
+	std::array<std::atomic<VkDeviceSize>, CATEGORY_COUNT> _category_bytes{};
+};
@@ -0,0 +1,127 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// 二进制网格文件（.vmesh），由 VulkanEngineCooker 的 mesh 子命令生成。
+/// 布局：MeshFileHeader | 位置流 | 属性流 | 索引 | 网格簇 | 簇局部顶点表 | 簇局部三角形表，各段按 MESH_SECTION_ALIGNMENT 对齐。
+/// 顶点流与 SplitVertexStreams 的内存布局逐字节一致，运行时映射文件后直接从映射区拷贝到 staging 缓冲，不做任何解析。
+/// 版本 2 增加了网格簇，版本 1 的文件需要重新烘焙
+/// </summary>
+constexpr uint32_t MESH_FILE_MAGIC = 0x48534D56;	// "VMSH"
+constexpr uint32_t MESH_FILE_VERSION = 2;
+constexpr uint64_t MESH_SECTION_ALIGNMENT = 16;
+
+// 网格簇大小上限：64 个顶点 / 124 个三角形，正好放进一个网格着色器工作组，局部索引用 8 位
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+// ConeCutoff 取此值表示法线锥无效（簇内法线跨过半球），不做背面剔除
+constexpr float MESHLET_CONE_DISABLED = 2.0f;
+
+/// <summary>
+/// 网格簇（meshlet）：索引缓冲中连续的一段三角形 [FirstIndex, FirstIndex + TriangleCount * 3)，
+/// 同时以局部顶点表 + 局部三角形表的形式给网格着色器使用。布局与着色器中的 std430 结构一致（meshletCull.slang）
+/// </summary>
+struct MeshFileMeshlet
+{
+	// 包围球（模型空间）
+	float Center[3];
+	float Radius;
+	// 法线锥：dot(normalize(ConeApex - 相机位置), ConeAxis) >= ConeCutoff 时，簇内所有三角形都背对相机
+	float ConeApex[3];
+	float ConeCutoff;
+	float ConeAxis[3];
+	uint32_t FirstIndex;
+	// 在局部顶点表（每项为 uint32 全局顶点索引）中的起点
+	uint32_t VertexOffset;
+	// 在局部三角形表（每个三角形一个 uint32，低 24 位依次为三个 8 位局部索引）中的起点
+	uint32_t TriangleOffset;
+	uint32_t VertexCount;
+	uint32_t TriangleCount;
+};
+static_assert(sizeof(MeshFileMeshlet) == 64, "MeshFileMeshlet is part of the file format");
+
+struct MeshFileHeader
+{
+	uint32_t Magic = MESH_FILE_MAGIC;
+	uint32_t Version = MESH_FILE_VERSION;
+	uint32_t VertexCount = 0;
+	uint32_t IndexCount = 0;
+	// 2（uint16）或 4（uint32），顶点数不超过 65536 时烘焙器选 2
+	uint32_t IndexSize = 2;
+	uint32_t PositionStride = 0;
+	uint32_t AttributeStride = 0;
+	uint32_t MeshletCount = 0;
+	// 各段相对文件开头的偏移
+	uint64_t PositionOffset = 0;
+	uint64_t AttributeOffset = 0;
+	uint64_t IndexOffset = 0;
+	uint64_t MeshletOffset = 0;
+	uint64_t MeshletVertexOffset = 0;
+	// 局部三角形表的长度与三角形总数（IndexCount / 3）相同
+	uint64_t MeshletTriangleOffset = 0;
+	uint32_t MeshletVertexCount = 0;
+	uint32_t Reserved = 0;
+	float BoundsMin[3] = {};
+	float BoundsMax[3] = {};
+};
+static_assert(sizeof(MeshFileHeader) == 112, "MeshFileHeader is part of the file format");
+
+inline uint64_t AlignMeshSection(uint64_t offset)
+{
+	return (offset + MESH_SECTION_ALIGNMENT - 1) & ~(MESH_SECTION_ALIGNMENT - 1);
+}
+
+/// <summary>
+/// 检查文件头、各段是否落在文件范围内以及网格簇引用的范围；position_stride / attribute_stride 为运行时期望的步长。
+/// 合法时返回 nullptr，否则返回错误描述
+/// </summary>
+inline const char* ValidateMeshFile(const void* data, size_t size, uint32_t position_stride, uint32_t attribute_stride)
+{
+	if (size < sizeof(MeshFileHeader))
+		return "file smaller than header";
+
+	auto& header = *static_cast<const MeshFileHeader*>(data);
+	if (header.Magic != MESH_FILE_MAGIC)
+		return "bad magic";
+	if (header.Version != MESH_FILE_VERSION)
+		return "unsupported version";
+	if (header.IndexSize != 2 && header.IndexSize != 4)
+		return "bad index size";
+	if (header.PositionStride != position_stride || header.AttributeStride != attribute_stride)
+		return "vertex layout mismatch";
+	if (header.VertexCount == 0 || header.IndexCount == 0 || header.IndexCount % 3 != 0)
+		return "bad vertex / index count";
+
+	auto inside = [size](uint64_t offset, uint64_t bytes) {
+		return offset % MESH_SECTION_ALIGNMENT == 0 && offset <= size && bytes <= size - offset;
+		};
+	if (!inside(header.PositionOffset, uint64_t(header.VertexCount) * header.PositionStride)
+		|| !inside(header.AttributeOffset, uint64_t(header.VertexCount) * header.AttributeStride)
+		|| !inside(header.IndexOffset, uint64_t(header.IndexCount) * header.IndexSize))
+		return "section out of range";
+
+	if (header.MeshletCount == 0)
+		return nullptr;
+
+	const uint32_t triangleCount = header.IndexCount / 3;
+	if (!inside(header.MeshletOffset, uint64_t(header.MeshletCount) * sizeof(MeshFileMeshlet))
+		|| !inside(header.MeshletVertexOffset, uint64_t(header.MeshletVertexCount) * sizeof(uint32_t))
+		|| !inside(header.MeshletTriangleOffset, uint64_t(triangleCount) * sizeof(uint32_t)))
+		return "meshlet section out of range";
+
+	// 着色器按这些范围直接读取缓冲，越界的簇在这里拒绝
+	auto meshlets = reinterpret_cast<const MeshFileMeshlet*>(static_cast<const unsigned char*>(data) + header.MeshletOffset);
+	for (uint32_t i = 0; i < header.MeshletCount; ++i)
+	{
+		auto& meshlet = meshlets[i];
+		if (meshlet.VertexCount > MESHLET_MAX_VERTICES || meshlet.TriangleCount > MESHLET_MAX_TRIANGLES
+			|| uint64_t(meshlet.FirstIndex) + uint64_t(meshlet.TriangleCount) * 3 > header.IndexCount
+			|| uint64_t(meshlet.VertexOffset) + meshlet.VertexCount > header.MeshletVertexCount
+			|| uint64_t(meshlet.TriangleOffset) + meshlet.TriangleCount > triangleCount)
+			return "meshlet out of range";
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,351 @@
+﻿// 模拟预处理头
+#include "VulkanMemoryAllocator/VmaUsage.h"
+
+#include "MeshletRenderer.h"
+#include "VulkanBase.h"
+#include "VkShader.h"
+#include "Tracer.h"
+#include "Logger.h"
+
+#include <array>
+#include <format>
+
+bool MeshletRenderer::Init(VkDevice device, VkDescriptorSetLayout ubo_layout, uint32_t frames_in_flight, const std::string& cull_shader_path,
+	bool draw_indirect_count_enabled, bool multi_draw_indirect_enabled, bool mesh_shader_enabled)
+{
+	_device = device;
+	_draw_indirect_count_enabled = draw_indirect_count_enabled;
+	_multi_draw_indirect_enabled = multi_draw_indirect_enabled;
+	_mesh_shader_enabled = mesh_shader_enabled;
+	_frames.resize(frames_in_flight);
+
+	if (_mesh_shader_enabled)
+	{
+		_cmd_draw_mesh_tasks_indirect = (PFN_vkCmdDrawMeshTasksIndirectEXT)vkGetDeviceProcAddr(_device, "vkCmdDrawMeshTasksIndirectEXT");
+		if (!_cmd_draw_mesh_tasks_indirect)
+		{
+			LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "MeshletRenderer : vkCmdDrawMeshTasksIndirectEXT not found, mesh shader path disabled");
+			_mesh_shader_enabled = false;
+		}
+	}
+
+	std::array<VkDescriptorSetLayoutBinding, BINDING_COUNT> bindings{};
+	for (uint32_t i = 0; i < BINDING_COUNT; ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | (_mesh_shader_enabled ? VK_SHADER_STAGE_MESH_BIT_EXT : 0);
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+	if (VkResult result = vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &_set_layout))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "MeshletRenderer : failed to create descriptor set layout! Error code: {}", int32_t(result));
+		return false;
+	}
+
+	// 集 0 为 UBO，集 1 为簇数据；网格着色器管线也使用此布局
+	std::array<VkDescriptorSetLayout, 2> setLayouts = { ubo_layout, _set_layout };
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(CullConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	if (VkResult result = vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &_pipeline_layout))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "MeshletRenderer : failed to create pipeline layout! Error code: {}", int32_t(result));
+		CleanUp();
+		return false;
+	}
+
+	if (!_create_pipeline(cull_shader_path))
+	{
+		CleanUp();
+		return false;
+	}
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = BINDING_COUNT * frames_in_flight;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	poolInfo.maxSets = frames_in_flight;
+	if (VkResult result = vkCreateDescriptorPool(_device, &poolInfo, nullptr, &_descriptor_pool))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "MeshletRenderer : failed to create descriptor pool! Error code: {}", int32_t(result));
+		CleanUp();
+		return false;
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(frames_in_flight, _set_layout);
+	std::vector<VkDescriptorSet> sets(frames_in_flight);
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = _descriptor_pool;
+	allocInfo.descriptorSetCount = frames_in_flight;
+	allocInfo.pSetLayouts = layouts.data();
+	if (VkResult result = vkAllocateDescriptorSets(_device, &allocInfo, sets.data()))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "MeshletRenderer : failed to allocate descriptor sets! Error code: {}", int32_t(result));
+		CleanUp();
+		return false;
+	}
+	for (uint32_t i = 0; i < frames_in_flight; ++i)
+		_frames[i].DescriptorSet = sets[i];
+
+	LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "MeshletRenderer : draw indirect count {}, multi draw indirect {}, mesh shader {}",
+		_draw_indirect_count_enabled, _multi_draw_indirect_enabled, _mesh_shader_enabled);
+	return true;
+}
+
+void MeshletRenderer::CleanUp()
+{
+	ClearMesh();
+
+	if (_descriptor_pool)
+		vkDestroyDescriptorPool(_device, _descriptor_pool, nullptr);
+	if (_cull_pipeline)
+		vkDestroyPipeline(_device, _cull_pipeline, nullptr);
+	if (_pipeline_layout)
+		vkDestroyPipelineLayout(_device, _pipeline_layout, nullptr);
+	if (_set_layout)
+		vkDestroyDescriptorSetLayout(_device, _set_layout, nullptr);
+	_descriptor_pool = VK_NULL_HANDLE;
+	_cull_pipeline = VK_NULL_HANDLE;
+	_pipeline_layout = VK_NULL_HANDLE;
+	_set_layout = VK_NULL_HANDLE;
+	_frames.clear();
+}
+
+bool MeshletRenderer::SetMesh(const MeshBuffers& buffers)
+{
+	ClearMesh();
+	if (!_cull_pipeline || buffers.MeshletCount == 0)
+		return false;
+
+	auto& base = VulkanBase::Base();
+	VkDeviceSize commandsSize = VkDeviceSize(buffers.MeshletCount) * sizeof(VkDrawIndexedIndirectCommand);
+	VkDeviceSize visibleSize = VkDeviceSize(buffers.MeshletCount) * sizeof(uint32_t);
+	for (auto& frame : _frames)
+	{
+		// 剔除输出每帧重写，不登记到碎片整理器
+		bool created = base.UseVmaCreateBuffer(commandsSize,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.DrawCommands)
+			&& base.UseVmaCreateBuffer(4 * sizeof(uint32_t),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.DrawCount)
+			&& base.UseVmaCreateBuffer(visibleSize,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.VisibleMeshlets)
+			&& base.UseVmaCreateBuffer(sizeof(uint32_t),
+				VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.Readback)
+			&& base.UseVmaMapBuffer(frame.Readback, &frame.ReadbackMapped);
+		if (!created)
+		{
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "MeshletRenderer : failed to create cull buffers for {} meshlets", buffers.MeshletCount);
+			_destroy_frame_buffers();
+			return false;
+		}
+		frame.DescriptorsDirty = true;
+		frame.HasResult = false;
+	}
+
+	_mesh = buffers;
+	_visible_meshlets = 0;
+	return true;
+}
+
+void MeshletRenderer::ClearMesh()
+{
+	_destroy_frame_buffers();
+	_mesh = MeshBuffers{};
+	_visible_meshlets = 0;
+}
+
+void MeshletRenderer::OnBufferReplaced(VkBuffer old_buffer, VkBuffer new_buffer)
+{
+	VkBuffer* slots[] = { &_mesh.Positions, &_mesh.Attributes, &_mesh.Meshlets, &_mesh.MeshletVertices, &_mesh.MeshletTriangles };
+	for (auto slot : slots)
+	{
+		if (*slot != old_buffer)
+			continue;
+		*slot = new_buffer;
+		// 描述符集可能仍被在途的帧使用，该帧的 Prepare 时再重写
+		for (auto& frame : _frames)
+			frame.DescriptorsDirty = true;
+	}
+}
+
+void MeshletRenderer::Collect(uint32_t frame_index)
+{
+	if (frame_index >= _frames.size())
+		return;
+	auto& frame = _frames[frame_index];
+	if (frame.HasResult && frame.ReadbackMapped)
+		_visible_meshlets = *static_cast<const uint32_t*>(frame.ReadbackMapped);
+	frame.HasResult = false;
+}
+
+void MeshletRenderer::Prepare(uint32_t frame_index)
+{
+	if (!HasMesh() || frame_index >= _frames.size())
+		return;
+	auto& frame = _frames[frame_index];
+	if (frame.DescriptorsDirty)
+		_write_descriptors(frame);
+}
+
+void MeshletRenderer::RecordCull(VkCommandBuffer command_buffer, uint32_t frame_index, VkDescriptorSet ubo_set, bool external_sync)
+{
+	if (!HasMesh())
+		return;
+	auto& frame = _frames[frame_index];
+
+	// 可见数量清零；网格着色器的工作组数 y、z 固定为 1
+	const uint32_t resetCount[4] = { 0, 0, 1, 1 };
+	vkCmdUpdateBuffer(command_buffer, frame.DrawCount, 0, sizeof(resetCount), resetCount);
+
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	std::array<VkDescriptorSet, 2> sets = { ubo_set, frame.DescriptorSet };
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, _cull_pipeline);
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline_layout, 0, static_cast<uint32_t>(sets.size()), sets.data(), 0, nullptr);
+	CullConstants constants{ _mesh.MeshletCount, _draw_indirect_count_enabled ? 1u : 0u };
+	vkCmdPushConstants(command_buffer, _pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+	vkCmdDispatch(command_buffer, (_mesh.MeshletCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+	VkPipelineStageFlags drawStages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	if (!external_sync)
+		drawStages |= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+	if (!external_sync && _mesh_shader_enabled)
+		drawStages |= VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = external_sync ? VK_ACCESS_TRANSFER_READ_BIT
+		: VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, drawStages,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	// 可见数量拷回主机，围栏之后由 Collect 读取
+	VkBufferCopy copy{ 0, 0, sizeof(uint32_t) };
+	vkCmdCopyBuffer(command_buffer, frame.DrawCount, frame.Readback, 1, &copy);
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+	frame.HasResult = true;
+}
+
+void MeshletRenderer::RecordDrawIndexed(VkCommandBuffer command_buffer, uint32_t frame_index, uint32_t repeat)
+{
+	if (!HasMesh())
+		return;
+	auto& frame = _frames[frame_index];
+	constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+	for (uint32_t r = 0; r < repeat; ++r)
+	{
+		if (_draw_indirect_count_enabled)
+		{
+			vkCmdDrawIndexedIndirectCount(command_buffer, frame.DrawCommands, 0, frame.DrawCount, 0, _mesh.MeshletCount, stride);
+		}
+		else if (_multi_draw_indirect_enabled)
+		{
+			// 被剔除的簇 instanceCount 为 0
+			vkCmdDrawIndexedIndirect(command_buffer, frame.DrawCommands, 0, _mesh.MeshletCount, stride);
+		}
+		else
+		{
+			for (uint32_t i = 0; i < _mesh.MeshletCount; ++i)
+				vkCmdDrawIndexedIndirect(command_buffer, frame.DrawCommands, VkDeviceSize(i) * stride, 1, stride);
+		}
+	}
+}
+
+void MeshletRenderer::RecordDrawMeshTasks(VkCommandBuffer command_buffer, uint32_t frame_index, VkDescriptorSet ubo_set, uint32_t repeat)
+{
+	if (!HasMesh() || !_mesh_shader_enabled)
+		return;
+	auto& frame = _frames[frame_index];
+	std::array<VkDescriptorSet, 2> sets = { ubo_set, frame.DescriptorSet };
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline_layout, 0, static_cast<uint32_t>(sets.size()), sets.data(), 0, nullptr);
+	// 每个可见簇一个工作组，工作组数由剔除写在 DrawCount[1..3]
+	for (uint32_t r = 0; r < repeat; ++r)
+		_cmd_draw_mesh_tasks_indirect(command_buffer, frame.DrawCount, sizeof(uint32_t), 1, sizeof(VkDrawMeshTasksIndirectCommandEXT));
+}
+
+bool MeshletRenderer::_create_pipeline(const std::string& cull_shader_path)
+{
+	TRACE_ZONE_DETAIL("CreateComputePipeline", "pipeline", "meshletCull");
+
+	VkEngineShaderModule shaderModule(_device, cull_shader_path);
+	if (!shaderModule.IsVaild())
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "MeshletRenderer : failed to load cull shader : {}", cull_shader_path);
+		return false;
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule.GetShaderModule();
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = _pipeline_layout;
+
+	if (VkResult result = vkCreateComputePipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_cull_pipeline))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "MeshletRenderer : failed to create cull pipeline! Error code: {}", int32_t(result));
+		return false;
+	}
+	return true;
+}
+
+void MeshletRenderer::_destroy_frame_buffers()
+{
+	auto& base = VulkanBase::Base();
+	for (auto& frame : _frames)
+	{
+		if (frame.ReadbackMapped)
+			base.UseVmaUnmapBuffer(frame.Readback);
+		// UseVmaDestroyBuffer 对空句柄不做处理
+		base.UseVmaDestroyBuffer(frame.DrawCommands);
+		base.UseVmaDestroyBuffer(frame.DrawCount);
+		base.UseVmaDestroyBuffer(frame.VisibleMeshlets);
+		base.UseVmaDestroyBuffer(frame.Readback);
+		frame.DrawCommands = frame.DrawCount = frame.VisibleMeshlets = frame.Readback = VK_NULL_HANDLE;
+		frame.ReadbackMapped = nullptr;
+		frame.HasResult = false;
+	}
+}
+
+void MeshletRenderer::_write_descriptors(FrameResources& frame)
+{
+	const std::array<VkBuffer, BINDING_COUNT> buffers = {
+		_mesh.Meshlets, frame.DrawCommands, frame.DrawCount, frame.VisibleMeshlets,
+		_mesh.Positions, _mesh.Attributes, _mesh.MeshletVertices, _mesh.MeshletTriangles
+	};
+
+	auto& writer = VulkanBase::Base().GetDescriptorWriter();
+	for (uint32_t i = 0; i < BINDING_COUNT; ++i)
+		writer.WriteBuffer(frame.DescriptorSet, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffers[i]);
+	frame.DescriptorsDirty = false;
+}
@@ -0,0 +1,141 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// 网格簇（meshlet）渲染路径。每帧先用计算着色器对所有簇做视锥剔除与法线锥背面剔除，幸存的簇写成间接绘制命令：
+/// 支持 drawIndirectCount 时压缩成连续数组并由 GPU 给出数量（vkCmdDrawIndexedIndirectCount），
+/// 否则按簇序号写入、被剔除的簇 instanceCount 为 0（vkCmdDrawIndexedIndirect）；
+/// 启用 VK_EXT_mesh_shader 时也可以改用网格着色器逐簇绘制可见列表（vkCmdDrawMeshTasksIndirectEXT）。
+/// 描述符集 1 放簇数据与剔除输出，计算管线与网格着色器管线共用同一个管线布局（集 0 为 UBO）
+/// </summary>
+class MeshletRenderer
+{
+public:
+	static constexpr uint32_t CULL_GROUP_SIZE = 64;
+
+	enum Binding : uint32_t
+	{
+		BINDING_MESHLETS = 0,
+		BINDING_DRAW_COMMANDS,
+		BINDING_DRAW_COUNT,			// uint[4]：[0] 可见簇数，[1..3] 网格着色器的 VkDrawMeshTasksIndirectCommandEXT
+		BINDING_VISIBLE_MESHLETS,
+		BINDING_POSITIONS,
+		BINDING_ATTRIBUTES,
+		BINDING_MESHLET_VERTICES,
+		BINDING_MESHLET_TRIANGLES,
+
+		BINDING_COUNT
+	};
+
+	/// <summary>
+	/// 网格数据缓冲（由 VulkanBase 持有），都需要带 STORAGE_BUFFER 用途
+	/// </summary>
+	struct MeshBuffers
+	{
+		VkBuffer Positions = VK_NULL_HANDLE;
+		VkBuffer Attributes = VK_NULL_HANDLE;
+		VkBuffer Meshlets = VK_NULL_HANDLE;
+		VkBuffer MeshletVertices = VK_NULL_HANDLE;
+		VkBuffer MeshletTriangles = VK_NULL_HANDLE;
+		uint32_t MeshletCount = 0;
+	};
+
+	MeshletRenderer() = default;
+	~MeshletRenderer() = default;
+
+	/// <summary>
+	/// ubo_layout 的 stageFlags 需要包含 COMPUTE（启用网格着色器时还需要 MESH）
+	/// </summary>
+	bool Init(VkDevice device, VkDescriptorSetLayout ubo_layout, uint32_t frames_in_flight, const std::string& cull_shader_path,
+		bool draw_indirect_count_enabled, bool multi_draw_indirect_enabled, bool mesh_shader_enabled);
+	/// <summary>
+	/// 需在 GPU 空闲后调用
+	/// </summary>
+	void CleanUp();
+
+	VkPipelineLayout GetPipelineLayout() const { return _pipeline_layout; }
+	bool IsMeshShaderEnabled() const { return _mesh_shader_enabled; }
+
+	/// <summary>
+	/// 设置要绘制的网格并创建剔除输出缓冲（调用前需保证 GPU 空闲）
+	/// </summary>
+	bool SetMesh(const MeshBuffers& buffers);
+	void ClearMesh();
+	bool HasMesh() const { return _mesh.MeshletCount > 0; }
+	uint32_t GetMeshletCount() const { return _mesh.MeshletCount; }
+	/// <summary>
+	/// 网格缓冲被碎片整理器换成新句柄时调用，之后各帧的 Prepare 重写描述符
+	/// </summary>
+	void OnBufferReplaced(VkBuffer old_buffer, VkBuffer new_buffer);
+
+	/// <summary>
+	/// 该帧围栏发出信号后调用，读取上一次剔除后的可见簇数
+	/// </summary>
+	void Collect(uint32_t frame_index);
+	uint32_t GetVisibleMeshletCount() const { return _visible_meshlets; }
+
+	/// <summary>
+	/// 录制该帧之前、VulkanBase 提交描述符写入之前调用：该帧的描述符集需要重写时（新网格、缓冲被搬运）登记到 DescriptorWriter
+	/// </summary>
+	void Prepare(uint32_t frame_index);
+	/// <summary>
+	/// 在 render pass 之外录制剔除（清零计数、dispatch、到间接绘制 / 网格着色器的屏障）。
+	/// external_sync 为 true 时不做到绘制阶段的屏障，由调用方（渲染图）负责
+	/// </summary>
+	void RecordCull(VkCommandBuffer command_buffer, uint32_t frame_index, VkDescriptorSet ubo_set, bool external_sync = false);
+	/// <summary>
+	/// 在 render pass 内录制索引间接绘制。调用前需绑定图形管线、顶点流与索引缓冲；repeat 为重复绘制次数（压力测试）
+	/// </summary>
+	void RecordDrawIndexed(VkCommandBuffer command_buffer, uint32_t frame_index, uint32_t repeat);
+	/// <summary>
+	/// 在 render pass 内录制网格着色器绘制。调用前需绑定网格着色器管线
+	/// </summary>
+	void RecordDrawMeshTasks(VkCommandBuffer command_buffer, uint32_t frame_index, VkDescriptorSet ubo_set, uint32_t repeat);
+
+private:
+	struct CullConstants
+	{
+		uint32_t MeshletCount;
+		// 1：压缩输出（配合 vkCmdDrawIndexedIndirectCount）；0：按簇序号输出
+		uint32_t Compact;
+	};
+
+	struct FrameResources
+	{
+		VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+		VkBuffer DrawCommands = VK_NULL_HANDLE;
+		VkBuffer DrawCount = VK_NULL_HANDLE;
+		VkBuffer VisibleMeshlets = VK_NULL_HANDLE;
+		// 主机可见，拷贝可见簇数用于统计
+		VkBuffer Readback = VK_NULL_HANDLE;
+		void* ReadbackMapped = nullptr;
+		bool DescriptorsDirty = true;
+		bool HasResult = false;
+	};
+
+	bool _create_pipeline(const std::string& cull_shader_path);
+	void _destroy_frame_buffers();
+	// 登记到 VulkanBase 的 DescriptorWriter，录制之前随该帧的写入一起提交
+	void _write_descriptors(FrameResources& frame);
+
+private:
+	VkDevice _device = VK_NULL_HANDLE;
+	VkDescriptorSetLayout _set_layout = VK_NULL_HANDLE;
+	VkPipelineLayout _pipeline_layout = VK_NULL_HANDLE;
+	VkPipeline _cull_pipeline = VK_NULL_HANDLE;
+	VkDescriptorPool _descriptor_pool = VK_NULL_HANDLE;
+	PFN_vkCmdDrawMeshTasksIndirectEXT _cmd_draw_mesh_tasks_indirect = nullptr;
+
+	bool _draw_indirect_count_enabled = false;
+	bool _multi_draw_indirect_enabled = false;
+	bool _mesh_shader_enabled = false;
+
+	MeshBuffers _mesh;
+	std::vector<FrameResources> _frames;
+	uint32_t _visible_meshlets = 0;
+};
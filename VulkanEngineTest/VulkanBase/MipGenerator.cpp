@@ -0,0 +1,425 @@
+﻿// 模拟预处理头
+#include "VulkanMemoryAllocator/VmaUsage.h"
+
+#include "MipGenerator.h"
+#include "VkShader.h"
+#include "Tracer.h"
+#include "Logger.h"
+
+#include <algorithm>
+
+namespace
+{
+	struct PushConstants
+	{
+		uint32_t SourceWidth;
+		uint32_t SourceHeight;
+		uint32_t LevelCount;
+		uint32_t Srgb;
+	};
+
+	constexpr uint32_t BINDING_COUNT = 1 + MipGenerator::MIPS_PER_DISPATCH;
+	// 每个工作组覆盖源级上 32x32 的区域
+	constexpr uint32_t TILE_SIZE = 32;
+
+	VkImageMemoryBarrier LevelBarrier(VkImage image, uint32_t base_level, uint32_t level_count, VkImageLayout old_layout, VkImageLayout new_layout,
+		VkAccessFlags src_access, VkAccessFlags dst_access)
+	{
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = src_access;
+		barrier.dstAccessMask = dst_access;
+		barrier.oldLayout = old_layout;
+		barrier.newLayout = new_layout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, base_level, level_count, 0, 1 };
+		return barrier;
+	}
+}
+
+bool MipGenerator::Init(VkPhysicalDevice physical_device, VkDevice device, const std::string& spv_path)
+{
+	_physical_device = physical_device;
+	_device = device;
+
+	std::array<VkDescriptorSetLayoutBinding, BINDING_COUNT> bindings{};
+	for (uint32_t i = 0; i < BINDING_COUNT; ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+	if (VkResult result = vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &_descriptor_set_layout))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "MipGenerator : failed to create descriptor set layout! Error code: {}", int32_t(result));
+		return false;
+	}
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(PushConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &_descriptor_set_layout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	if (VkResult result = vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &_pipeline_layout))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "MipGenerator : failed to create pipeline layout! Error code: {}", int32_t(result));
+		CleanUp();
+		return false;
+	}
+
+	// 计算路径可选：常见的 RGBA8 格式都支持线性过滤的 blit
+	TRACE_ZONE_DETAIL("CreateComputePipeline", "pipeline", "mipDownsample");
+	VkEngineShaderModule shaderModule(_device, spv_path);
+	if (!shaderModule.IsVaild())
+	{
+		LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "MipGenerator : failed to load downsample shader : {}, compute fallback disabled", spv_path);
+		return true;
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule.GetShaderModule();
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = _pipeline_layout;
+	if (VkResult result = vkCreateComputePipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_pipeline))
+	{
+		LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "MipGenerator : failed to create downsample pipeline! Error code: {}", int32_t(result));
+		_pipeline = VK_NULL_HANDLE;
+	}
+	return true;
+}
+
+void MipGenerator::CleanUp()
+{
+	for (uint32_t i = 0; i < MAX_SLOTS; ++i)
+		ResetSlot(i);
+	if (_pipeline)
+		vkDestroyPipeline(_device, _pipeline, nullptr);
+	if (_pipeline_layout)
+		vkDestroyPipelineLayout(_device, _pipeline_layout, nullptr);
+	if (_descriptor_set_layout)
+		vkDestroyDescriptorSetLayout(_device, _descriptor_set_layout, nullptr);
+	_pipeline = VK_NULL_HANDLE;
+	_pipeline_layout = VK_NULL_HANDLE;
+	_descriptor_set_layout = VK_NULL_HANDLE;
+}
+
+bool MipGenerator::UsesCompute(VkFormat format) const
+{
+	constexpr VkFormatFeatureFlags blitFeatures =
+		VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	VkFormatProperties properties{};
+	vkGetPhysicalDeviceFormatProperties(_physical_device, format, &properties);
+	return (properties.optimalTilingFeatures & blitFeatures) != blitFeatures;
+}
+
+bool MipGenerator::CanGenerate(VkFormat format) const
+{
+	if (!UsesCompute(format))
+		return true;
+	VkFormat storageFormat = _storage_format(format);
+	if (!_pipeline || storageFormat == VK_FORMAT_UNDEFINED)
+		return false;
+	VkFormatProperties properties{};
+	vkGetPhysicalDeviceFormatProperties(_physical_device, storageFormat, &properties);
+	return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0;
+}
+
+VkImageUsageFlags MipGenerator::GetImageUsage(VkFormat format) const
+{
+	if (UsesCompute(format))
+		return VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+	return VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+}
+
+VkImageCreateFlags MipGenerator::GetImageFlags(VkFormat format) const
+{
+	// sRGB 格式不能作为存储图像，用 UNORM 视图访问
+	if (UsesCompute(format) && _storage_format(format) != format)
+		return VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT | VK_IMAGE_CREATE_EXTENDED_USAGE_BIT;
+	return 0;
+}
+
+uint32_t MipGenerator::Record(VkCommandBuffer command_buffer, uint32_t slot, const std::vector<Request>& requests,
+	VkImageLayout final_layout, VkPipelineStageFlags final_stages, VkAccessFlags final_access)
+{
+	std::vector<const Request*> blits, computes;
+	for (const auto& request : requests)
+	{
+		if (!request.Image)
+			continue;
+		if (!UsesCompute(request.Format))
+			blits.push_back(&request);
+		else if (slot < MAX_SLOTS && CanGenerate(request.Format))
+			computes.push_back(&request);
+		else
+			LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "MipGenerator : no way to generate mips for format {}", int32_t(request.Format));
+	}
+
+	if (!blits.empty())
+		_record_blits(command_buffer, blits, final_layout, final_stages, final_access);
+	if (!computes.empty())
+	{
+		// 同一槽位上一次录制的命令应已执行完
+		ResetSlot(slot);
+		_record_compute(command_buffer, _slots[slot], computes, final_layout, final_stages, final_access);
+	}
+
+	_stats.BlitTextures += blits.size();
+	_stats.ComputeTextures += computes.size();
+	return static_cast<uint32_t>(blits.size() + computes.size());
+}
+
+void MipGenerator::ResetSlot(uint32_t slot)
+{
+	if (slot >= MAX_SLOTS)
+		return;
+	Slot& target = _slots[slot];
+	for (VkImageView view : target.Views)
+		vkDestroyImageView(_device, view, nullptr);
+	target.Views.clear();
+	if (target.DescriptorPool)
+		vkDestroyDescriptorPool(_device, target.DescriptorPool, nullptr);
+	target.DescriptorPool = VK_NULL_HANDLE;
+}
+
+void MipGenerator::_record_blits(VkCommandBuffer command_buffer, const std::vector<const Request*>& requests,
+	VkImageLayout final_layout, VkPipelineStageFlags final_stages, VkAccessFlags final_access)
+{
+	TRACE_ZONE_DETAIL("RecordMipBlits", "texture", std::to_string(requests.size()));
+
+	uint32_t maxLevels = 1;
+	std::vector<VkImageMemoryBarrier> barriers;
+	for (const Request* request : requests)
+	{
+		maxLevels = std::max(maxLevels, request->MipLevels);
+		if (request->MipLevels > 1)
+			barriers.push_back(LevelBarrier(request->Image, 1, request->MipLevels - 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				0, VK_ACCESS_TRANSFER_WRITE_BIT));
+	}
+	if (!barriers.empty())
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+			static_cast<uint32_t>(barriers.size()), barriers.data());
+
+	// 逐级：所有纹理的上一级转为拷贝源（一次屏障），再依次 blit 到这一级
+	for (uint32_t level = 1; level < maxLevels; ++level)
+	{
+		barriers.clear();
+		for (const Request* request : requests)
+		{
+			if (level < request->MipLevels)
+				barriers.push_back(LevelBarrier(request->Image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT));
+		}
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+			static_cast<uint32_t>(barriers.size()), barriers.data());
+
+		for (const Request* request : requests)
+		{
+			if (level >= request->MipLevels)
+				continue;
+			VkImageBlit blit{};
+			blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 };
+			blit.srcOffsets[1] = { int32_t(std::max(request->Extent.width >> (level - 1), 1u)), int32_t(std::max(request->Extent.height >> (level - 1), 1u)), 1 };
+			blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+			blit.dstOffsets[1] = { int32_t(std::max(request->Extent.width >> level, 1u)), int32_t(std::max(request->Extent.height >> level, 1u)), 1 };
+			vkCmdBlitImage(command_buffer, request->Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, request->Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				1, &blit, VK_FILTER_LINEAR);
+			++_stats.Blits;
+		}
+	}
+
+	// 最后一级仍是拷贝目标，其余各级是拷贝源
+	barriers.clear();
+	for (const Request* request : requests)
+	{
+		uint32_t last = request->MipLevels - 1;
+		if (last > 0)
+			barriers.push_back(LevelBarrier(request->Image, 0, last, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, final_layout,
+				VK_ACCESS_TRANSFER_WRITE_BIT, final_access));
+		barriers.push_back(LevelBarrier(request->Image, last, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, final_layout,
+			VK_ACCESS_TRANSFER_WRITE_BIT, final_access));
+	}
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, final_stages, 0, 0, nullptr, 0, nullptr,
+		static_cast<uint32_t>(barriers.size()), barriers.data());
+}
+
+void MipGenerator::_record_compute(VkCommandBuffer command_buffer, Slot& slot, const std::vector<const Request*>& requests,
+	VkImageLayout final_layout, VkPipelineStageFlags final_stages, VkAccessFlags final_access)
+{
+	TRACE_ZONE_DETAIL("RecordMipDownsample", "texture", std::to_string(requests.size()));
+
+	// 每个纹理每 MIPS_PER_DISPATCH 级一次调度，每次调度一个描述符集
+	uint32_t dispatchCount = 0;
+	uint32_t maxRounds = 0;
+	for (const Request* request : requests)
+	{
+		uint32_t rounds = (request->MipLevels - 1 + MIPS_PER_DISPATCH - 1) / MIPS_PER_DISPATCH;
+		dispatchCount += rounds;
+		maxRounds = std::max(maxRounds, rounds);
+	}
+	if (dispatchCount == 0)
+		return;
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSize.descriptorCount = dispatchCount * BINDING_COUNT;
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = dispatchCount;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	if (VkResult result = vkCreateDescriptorPool(_device, &poolInfo, nullptr, &slot.DescriptorPool))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "MipGenerator : failed to create descriptor pool! Error code: {}", int32_t(result));
+		slot.DescriptorPool = VK_NULL_HANDLE;
+		return;
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(dispatchCount, _descriptor_set_layout);
+	std::vector<VkDescriptorSet> sets(dispatchCount);
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = slot.DescriptorPool;
+	allocInfo.descriptorSetCount = dispatchCount;
+	allocInfo.pSetLayouts = layouts.data();
+	if (VkResult result = vkAllocateDescriptorSets(_device, &allocInfo, sets.data()))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "MipGenerator : failed to allocate descriptor sets! Error code: {}", int32_t(result));
+		return;
+	}
+
+	// 每一级一个存储视图；第 0 级由传输写入，其余级直接转为 GENERAL
+	std::vector<uint32_t> firstView(requests.size());
+	std::vector<VkImageMemoryBarrier> barriers;
+	for (size_t i = 0; i < requests.size(); ++i)
+	{
+		const Request* request = requests[i];
+		firstView[i] = static_cast<uint32_t>(slot.Views.size());
+		for (uint32_t level = 0; level < request->MipLevels; ++level)
+		{
+			VkImageViewCreateInfo viewInfo{};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image = request->Image;
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.format = _storage_format(request->Format);
+			viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+			VkImageView view = VK_NULL_HANDLE;
+			if (VkResult result = vkCreateImageView(_device, &viewInfo, nullptr, &view))
+				LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "MipGenerator : failed to create storage view! Error code: {}", int32_t(result));
+			slot.Views.push_back(view);
+		}
+		barriers.push_back(LevelBarrier(request->Image, 0, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT));
+		if (request->MipLevels > 1)
+			barriers.push_back(LevelBarrier(request->Image, 1, request->MipLevels - 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+				0, VK_ACCESS_SHADER_WRITE_BIT));
+	}
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr,
+		static_cast<uint32_t>(barriers.size()), barriers.data());
+
+	// 所有调度的描述符集在绑定之前一次写入，集的顺序与下面的调度顺序相同
+	std::vector<VkDescriptorImageInfo> imageInfos(size_t(dispatchCount) * BINDING_COUNT);
+	std::vector<VkWriteDescriptorSet> writes(dispatchCount);
+	uint32_t setIndex = 0;
+	for (uint32_t round = 0; round < maxRounds; ++round)
+	{
+		for (size_t i = 0; i < requests.size(); ++i)
+		{
+			const Request* request = requests[i];
+			uint32_t base = round * MIPS_PER_DISPATCH;
+			if (base + 1 >= request->MipLevels)
+				continue;
+			uint32_t levelCount = std::min(MIPS_PER_DISPATCH, request->MipLevels - 1 - base);
+
+			// 用不到的绑定指向最后一级（不会被写入）
+			VkDescriptorImageInfo* infos = &imageInfos[size_t(setIndex) * BINDING_COUNT];
+			for (uint32_t binding = 0; binding < BINDING_COUNT; ++binding)
+			{
+				uint32_t level = binding == 0 ? base : base + std::min(binding, levelCount);
+				infos[binding].imageView = slot.Views[firstView[i] + level];
+				infos[binding].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+			}
+			VkWriteDescriptorSet& write = writes[setIndex];
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = sets[setIndex];
+			write.dstBinding = 0;
+			write.descriptorCount = BINDING_COUNT;
+			write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			write.pImageInfo = infos;
+			++setIndex;
+		}
+	}
+	vkUpdateDescriptorSets(_device, dispatchCount, writes.data(), 0, nullptr);
+
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline);
+
+	// 按轮次：每轮各纹理生成下一段至多 MIPS_PER_DISPATCH 级，轮次之间一个屏障
+	setIndex = 0;
+	for (uint32_t round = 0; round < maxRounds; ++round)
+	{
+		if (round > 0)
+		{
+			VkMemoryBarrier memoryBarrier{};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+		}
+
+		for (size_t i = 0; i < requests.size(); ++i)
+		{
+			const Request* request = requests[i];
+			uint32_t base = round * MIPS_PER_DISPATCH;
+			if (base + 1 >= request->MipLevels)
+				continue;
+			uint32_t levelCount = std::min(MIPS_PER_DISPATCH, request->MipLevels - 1 - base);
+
+			PushConstants constants{};
+			constants.SourceWidth = std::max(request->Extent.width >> base, 1u);
+			constants.SourceHeight = std::max(request->Extent.height >> base, 1u);
+			constants.LevelCount = levelCount;
+			constants.Srgb = _storage_format(request->Format) != request->Format ? 1 : 0;
+			vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline_layout, 0, 1, &sets[setIndex], 0, nullptr);
+			vkCmdPushConstants(command_buffer, _pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+			vkCmdDispatch(command_buffer, (constants.SourceWidth + TILE_SIZE - 1) / TILE_SIZE, (constants.SourceHeight + TILE_SIZE - 1) / TILE_SIZE, 1);
+			++setIndex;
+			++_stats.Dispatches;
+		}
+	}
+
+	barriers.clear();
+	for (const Request* request : requests)
+		barriers.push_back(LevelBarrier(request->Image, 0, request->MipLevels, VK_IMAGE_LAYOUT_GENERAL, final_layout,
+			VK_ACCESS_SHADER_WRITE_BIT, final_access));
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, final_stages, 0, 0, nullptr, 0, nullptr,
+		static_cast<uint32_t>(barriers.size()), barriers.data());
+}
+
+VkFormat MipGenerator::_storage_format(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		return VK_FORMAT_R8G8B8A8_UNORM;
+	default:
+		return VK_FORMAT_UNDEFINED;
+	}
+}
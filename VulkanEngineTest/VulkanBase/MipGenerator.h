@@ -0,0 +1,91 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// 在 GPU 上生成 mip 链。格式支持线性过滤的 blit 时逐级 vkCmdBlitImage；否则用计算着色器（mipDownsample.slang），
+/// 一次调度在共享内存里连续生成至多 MIPS_PER_DISPATCH 级。一次 Record 录制多个纹理：同一级的屏障合并成一次调用，
+/// 各纹理的 blit / 调度交错排在屏障之间。需要在支持图形（blit）或计算（计算路径）的队列上执行
+/// </summary>
+class MipGenerator
+{
+public:
+	static constexpr uint32_t MIPS_PER_DISPATCH = 5;
+	// 计算路径的临时视图与描述符集按槽位保存，槽位的命令执行完后 ResetSlot 释放
+	static constexpr uint32_t MAX_SLOTS = 4;
+
+	struct Request
+	{
+		VkImage Image = VK_NULL_HANDLE;
+		VkFormat Format = VK_FORMAT_UNDEFINED;
+		VkExtent2D Extent = { 0, 0 };
+		uint32_t MipLevels = 1;
+	};
+
+	struct Stats
+	{
+		uint64_t BlitTextures = 0;
+		uint64_t ComputeTextures = 0;
+		uint64_t Blits = 0;
+		uint64_t Dispatches = 0;
+	};
+
+	MipGenerator() = default;
+	~MipGenerator() = default;
+
+	/// <summary>
+	/// spv_path 为计算路径的着色器，加载失败时不支持线性过滤 blit 的格式无法生成 mip
+	/// </summary>
+	bool Init(VkPhysicalDevice physical_device, VkDevice device, const std::string& spv_path);
+	void CleanUp();
+
+	/// <summary>
+	/// 该格式走计算路径：图像需要额外的用途与创建标志（GetImageUsage / GetImageFlags）
+	/// </summary>
+	bool UsesCompute(VkFormat format) const;
+	bool CanGenerate(VkFormat format) const;
+	/// <summary>
+	/// 生成 mip 的图像在创建时需要加上的用途与标志
+	/// </summary>
+	VkImageUsageFlags GetImageUsage(VkFormat format) const;
+	VkImageCreateFlags GetImageFlags(VkFormat format) const;
+
+	/// <summary>
+	/// 录制 requests 的 mip 生成。进入时第 0 级处于 TRANSFER_DST_OPTIMAL 且已写入（之前的传输写入），其余各级内容任意；
+	/// 结束时所有级处于 final_layout，之后的 final_stages / final_access 可以访问。返回录制了的纹理数
+	/// </summary>
+	uint32_t Record(VkCommandBuffer command_buffer, uint32_t slot, const std::vector<Request>& requests,
+		VkImageLayout final_layout, VkPipelineStageFlags final_stages, VkAccessFlags final_access);
+	/// <summary>
+	/// 该槽位录制的命令执行完后调用
+	/// </summary>
+	void ResetSlot(uint32_t slot);
+
+	const Stats& GetStats() const { return _stats; }
+
+private:
+	struct Slot
+	{
+		VkDescriptorPool DescriptorPool = VK_NULL_HANDLE;
+		std::vector<VkImageView> Views;
+	};
+
+	void _record_blits(VkCommandBuffer command_buffer, const std::vector<const Request*>& requests,
+		VkImageLayout final_layout, VkPipelineStageFlags final_stages, VkAccessFlags final_access);
+	void _record_compute(VkCommandBuffer command_buffer, Slot& slot, const std::vector<const Request*>& requests,
+		VkImageLayout final_layout, VkPipelineStageFlags final_stages, VkAccessFlags final_access);
+	static VkFormat _storage_format(VkFormat format);
+
+private:
+	VkPhysicalDevice _physical_device = VK_NULL_HANDLE;
+	VkDevice _device = VK_NULL_HANDLE;
+	VkDescriptorSetLayout _descriptor_set_layout = VK_NULL_HANDLE;
+	VkPipelineLayout _pipeline_layout = VK_NULL_HANDLE;
+	VkPipeline _pipeline = VK_NULL_HANDLE;
+	Slot _slots[MAX_SLOTS];
+	Stats _stats;
+};
@@ -0,0 +1,739 @@
+﻿// 模拟预处理头
+#include "VulkanMemoryAllocator/VmaUsage.h"
+
+#include "RenderGraph.h"
+#include "MemoryTracker.h"
+#include "Tracer.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <format>
+
+namespace
+{
+	constexpr VkAccessFlags2 READ_ACCESS = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_INDEX_READ_BIT | VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT
+		| VK_ACCESS_2_UNIFORM_READ_BIT | VK_ACCESS_2_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT
+		| VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_HOST_READ_BIT | VK_ACCESS_2_MEMORY_READ_BIT
+		| VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+	constexpr VkAccessFlags2 WRITE_ACCESS = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+		| VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+
+	// synchronization2 的标志位低 32 位与旧的标志位相同，高位只能保守地换算
+	VkPipelineStageFlags ToLegacyStages(VkPipelineStageFlags2 stages, VkPipelineStageFlags empty)
+	{
+		VkPipelineStageFlags legacy = static_cast<VkPipelineStageFlags>(stages & 0xFFFFFFFFull);
+		if (stages >> 32)
+			legacy = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		return legacy ? legacy : empty;
+	}
+
+	VkAccessFlags ToLegacyAccess(VkAccessFlags2 access)
+	{
+		VkAccessFlags legacy = static_cast<VkAccessFlags>(access & 0xFFFFFFFFull);
+		if (access & (VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT))
+			legacy |= VK_ACCESS_SHADER_READ_BIT;
+		if (access & VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT)
+			legacy |= VK_ACCESS_SHADER_WRITE_BIT;
+		return legacy;
+	}
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Read(ResourceHandle resource, VkPipelineStageFlags2 stages, VkAccessFlags2 access, VkImageLayout layout)
+{
+	_graph._add_access(_pass, resource, { stages, access, layout }, false);
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Write(ResourceHandle resource, VkPipelineStageFlags2 stages, VkAccessFlags2 access, VkImageLayout layout)
+{
+	_graph._add_access(_pass, resource, { stages, access, layout }, true);
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::WriteColor(ResourceHandle image)
+{
+	return Write(image, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::WriteDepth(ResourceHandle image)
+{
+	return Write(image, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+		VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::ReadDepth(ResourceHandle image)
+{
+	return Read(image, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+		VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::ReadIndirect(ResourceHandle buffer, VkPipelineStageFlags2 shader_stages)
+{
+	return Read(buffer, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | shader_stages,
+		VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | (shader_stages ? VK_ACCESS_2_SHADER_READ_BIT : VK_ACCESS_2_NONE));
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::WriteStorage(ResourceHandle resource, VkPipelineStageFlags2 stages)
+{
+	return Write(resource, stages, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL);
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SideEffects()
+{
+	_graph._passes[_pass].SideEffects = true;
+	return *this;
+}
+
+bool RenderGraph::Init(VkDevice device, VmaAllocator allocator, bool synchronization2_enabled)
+{
+	_device = device;
+	_allocator = allocator;
+	_synchronization2_enabled = synchronization2_enabled;
+	LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "RenderGraph : barriers use {}", synchronization2_enabled ? "vkCmdPipelineBarrier2" : "vkCmdPipelineBarrier");
+	return true;
+}
+
+void RenderGraph::CleanUp()
+{
+	Reset();
+	_device = VK_NULL_HANDLE;
+	_allocator = nullptr;
+}
+
+void RenderGraph::Reset()
+{
+	_destroy_transient_images();
+	_passes.clear();
+	_resources.clear();
+	_order.clear();
+	_compiled = false;
+	_stats = Stats{};
+}
+
+RenderGraph::ResourceHandle RenderGraph::ImportImage(const std::string& name, VkFormat format, const ResourceState& initial, const ResourceState& final, bool output)
+{
+	Resource resource;
+	resource.Name = name;
+	resource.Kind = ResourceKind::ImportedImage;
+	resource.Output = output;
+	resource.Format = format;
+	resource.Initial = initial;
+	resource.Final = final;
+	_resources.push_back(std::move(resource));
+	_compiled = false;
+	return static_cast<ResourceHandle>(_resources.size() - 1);
+}
+
+RenderGraph::ResourceHandle RenderGraph::ImportBuffer(const std::string& name, bool output)
+{
+	Resource resource;
+	resource.Name = name;
+	resource.Kind = ResourceKind::ImportedBuffer;
+	resource.Output = output;
+	_resources.push_back(std::move(resource));
+	_compiled = false;
+	return static_cast<ResourceHandle>(_resources.size() - 1);
+}
+
+RenderGraph::ResourceHandle RenderGraph::CreateImage(const std::string& name, const ImageDesc& desc)
+{
+	Resource resource;
+	resource.Name = name;
+	resource.Kind = ResourceKind::TransientImage;
+	resource.Format = desc.Format;
+	resource.Desc = desc;
+	_resources.push_back(std::move(resource));
+	_compiled = false;
+	return static_cast<ResourceHandle>(_resources.size() - 1);
+}
+
+void RenderGraph::SetImportedImage(ResourceHandle resource, VkImage image, VkImageView view)
+{
+	if (resource >= _resources.size() || _resources[resource].Kind != ResourceKind::ImportedImage)
+		return;
+	_resources[resource].Image = image;
+	_resources[resource].View = view;
+}
+
+VkImage RenderGraph::GetImage(ResourceHandle resource) const
+{
+	return resource < _resources.size() ? _resources[resource].Image : VK_NULL_HANDLE;
+}
+
+VkImageView RenderGraph::GetImageView(ResourceHandle resource) const
+{
+	return resource < _resources.size() ? _resources[resource].View : VK_NULL_HANDLE;
+}
+
+RenderGraph::PassBuilder RenderGraph::AddPass(const std::string& name, ExecuteFunction execute)
+{
+	Pass pass;
+	pass.Name = name;
+	pass.Execute = std::move(execute);
+	_passes.push_back(std::move(pass));
+	_compiled = false;
+	return PassBuilder(*this, static_cast<PassHandle>(_passes.size() - 1));
+}
+
+void RenderGraph::SetPassEnabled(PassHandle pass, bool enabled)
+{
+	if (pass < _passes.size())
+		_passes[pass].Enabled = enabled;
+}
+
+void RenderGraph::_add_access(PassHandle pass, ResourceHandle resource, const ResourceState& state, bool write)
+{
+	if (pass >= _passes.size() || resource >= _resources.size())
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "RenderGraph : invalid access (pass {}, resource {})", pass, resource);
+		return;
+	}
+	auto& accesses = _passes[pass].Accesses;
+	auto iter = std::find_if(accesses.begin(), accesses.end(), [resource](const Access& access) { return access.Resource == resource; });
+	if (iter == accesses.end())
+	{
+		accesses.push_back({ resource, state, write });
+		return;
+	}
+
+	// 同一个 pass 对同一资源的多次声明合并成一次访问，布局只能有一个
+	if (_is_image(_resources[resource]) && state.Layout != VK_IMAGE_LAYOUT_UNDEFINED && iter->State.Layout != VK_IMAGE_LAYOUT_UNDEFINED && state.Layout != iter->State.Layout)
+		LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "RenderGraph : pass {} uses {} in two layouts, the last one wins", _passes[pass].Name, _resources[resource].Name);
+	iter->State.Stages |= state.Stages;
+	iter->State.Access |= state.Access;
+	if (state.Layout != VK_IMAGE_LAYOUT_UNDEFINED)
+		iter->State.Layout = state.Layout;
+	iter->Write = iter->Write || write;
+}
+
+bool RenderGraph::Compile()
+{
+	TRACE_ZONE("RenderGraphCompile");
+
+	_destroy_transient_images();
+	_stats = Stats{};
+
+	auto kept = _cull_passes();
+	_order = _sort_passes(kept);
+	_stats.Passes = static_cast<uint32_t>(_order.size());
+	_stats.CulledPasses = static_cast<uint32_t>(_passes.size() - _order.size());
+
+	for (auto& resource : _resources)
+	{
+		resource.FirstUse = UINT32_MAX;
+		resource.LastUse = 0;
+		resource.Tracked = TrackedState{};
+		resource.Aliases.clear();
+	}
+	for (uint32_t position = 0; position < _order.size(); ++position)
+	{
+		for (auto& access : _passes[_order[position]].Accesses)
+		{
+			auto& resource = _resources[access.Resource];
+			resource.FirstUse = std::min(resource.FirstUse, position);
+			resource.LastUse = std::max(resource.LastUse, position);
+		}
+	}
+
+	if (!_create_transient_images())
+	{
+		_destroy_transient_images();
+		return false;
+	}
+	_compiled = true;
+
+	std::string order;
+	for (auto& name : GetExecutionOrder())
+		order += order.empty() ? name : " -> " + name;
+	LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "RenderGraph : {} passes ({} culled) : {}; {} transient images, {} KB aliased into {} KB",
+		_stats.Passes, _stats.CulledPasses, order, _stats.TransientImages, _stats.TransientBytes / 1024, _stats.AllocatedBytes / 1024);
+	return true;
+}
+
+std::vector<uint32_t> RenderGraph::_cull_passes() const
+{
+	// 读取（或读改写）资源的 pass 依赖声明顺序中之前最近一次写它的 pass
+	std::vector<std::vector<uint32_t>> producers(_passes.size());
+	std::vector<uint32_t> lastWriter(_resources.size(), UINT32_MAX);
+	std::vector<bool> needed(_passes.size(), false);
+	for (uint32_t p = 0; p < _passes.size(); ++p)
+	{
+		for (auto& access : _passes[p].Accesses)
+		{
+			bool consumes = !access.Write || (access.State.Access & READ_ACCESS);
+			if (consumes && lastWriter[access.Resource] != UINT32_MAX)
+				producers[p].push_back(lastWriter[access.Resource]);
+			if (access.Write)
+			{
+				lastWriter[access.Resource] = p;
+				if (_resources[access.Resource].Output)
+					needed[p] = true;
+			}
+		}
+		if (_passes[p].SideEffects)
+			needed[p] = true;
+	}
+
+	// 生产者总在消费者之前声明，倒序一遍即可传播
+	for (uint32_t p = static_cast<uint32_t>(_passes.size()); p-- > 0;)
+	{
+		if (!needed[p])
+			continue;
+		for (uint32_t producer : producers[p])
+			needed[producer] = true;
+	}
+
+	std::vector<uint32_t> kept;
+	for (uint32_t p = 0; p < _passes.size(); ++p)
+	{
+		if (needed[p])
+			kept.push_back(p);
+		else
+			LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "RenderGraph : pass {} culled, its outputs are never used", _passes[p].Name);
+	}
+	return kept;
+}
+
+std::vector<uint32_t> RenderGraph::_sort_passes(const std::vector<uint32_t>& passes) const
+{
+	// 依赖边：写之后的读、读之后的写、写之后的写都必须保持声明顺序
+	size_t count = passes.size();
+	std::vector<std::vector<uint32_t>> successors(count);
+	std::vector<std::vector<bool>> dependsOn(count, std::vector<bool>(count, false));
+	std::vector<uint32_t> predecessorCount(count, 0);
+	std::vector<uint32_t> lastWriter(_resources.size(), UINT32_MAX);
+	std::vector<std::vector<uint32_t>> readers(_resources.size());
+	auto addEdge = [&](uint32_t from, uint32_t to) {
+		if (from == to || dependsOn[to][from])
+			return;
+		dependsOn[to][from] = true;
+		successors[from].push_back(to);
+		++predecessorCount[to];
+		};
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		for (auto& access : _passes[passes[i]].Accesses)
+		{
+			uint32_t writer = lastWriter[access.Resource];
+			if (writer != UINT32_MAX)
+				addEdge(writer, i);
+			if (access.Write)
+			{
+				for (uint32_t reader : readers[access.Resource])
+					addEdge(reader, i);
+				readers[access.Resource].clear();
+				lastWriter[access.Resource] = i;
+			}
+			else
+			{
+				readers[access.Resource].push_back(i);
+			}
+		}
+	}
+
+	// 拓扑排序：优先选不依赖上一个已排 pass 的就绪 pass，让相互依赖的 pass 之间隔开、减少屏障处的等待；
+	// 同等条件下保持声明顺序
+	std::vector<uint32_t> order;
+	std::vector<bool> scheduled(count, false);
+	uint32_t previous = UINT32_MAX;
+	for (size_t n = 0; n < count; ++n)
+	{
+		uint32_t choice = UINT32_MAX;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (scheduled[i] || predecessorCount[i] != 0)
+				continue;
+			if (choice == UINT32_MAX)
+				choice = i;
+			if (previous == UINT32_MAX || !dependsOn[i][previous])
+			{
+				choice = i;
+				break;
+			}
+		}
+		scheduled[choice] = true;
+		for (uint32_t successor : successors[choice])
+			--predecessorCount[successor];
+		order.push_back(passes[choice]);
+		previous = choice;
+	}
+	return order;
+}
+
+bool RenderGraph::_create_transient_images()
+{
+	std::vector<ResourceHandle> images;
+	for (ResourceHandle handle = 0; handle < _resources.size(); ++handle)
+	{
+		auto& resource = _resources[handle];
+		if (resource.Kind != ResourceKind::TransientImage || resource.FirstUse == UINT32_MAX)
+			continue;
+
+		VkExtent2D extent = resource.Desc.Extent.width ? resource.Desc.Extent : _extent;
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = resource.Desc.Format;
+		imageInfo.extent = { extent.width, extent.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = resource.Desc.Samples;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = resource.Desc.Usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		if (VkResult result = vkCreateImage(_device, &imageInfo, nullptr, &resource.Image))
+		{
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "RenderGraph : failed to create transient image {}! Error code: {}", resource.Name, int32_t(result));
+			return false;
+		}
+		vkGetImageMemoryRequirements(_device, resource.Image, &resource.Requirements);
+		images.push_back(handle);
+		_stats.TransientBytes += resource.Requirements.size;
+	}
+	_stats.TransientImages = static_cast<uint32_t>(images.size());
+	if (images.empty())
+		return true;
+
+	_place_transient_images(images);
+
+	for (auto& heap : _heaps)
+	{
+		VkMemoryRequirements requirements{};
+		requirements.size = heap.Size;
+		requirements.alignment = heap.Alignment;
+		requirements.memoryTypeBits = heap.MemoryTypeBits;
+		VmaAllocationCreateInfo allocInfo{};
+		allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		if (VkResult result = vmaAllocateMemory(_allocator, &requirements, &allocInfo, &heap.Allocation, nullptr))
+		{
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "RenderGraph : failed to allocate {} bytes for transient images! Error code: {}", heap.Size, int32_t(result));
+			heap.Allocation = nullptr;
+			return false;
+		}
+		MemoryTracker::Get().OnAllocate(heap.Allocation, MemoryTracker::CATEGORY_RENDER_TARGETS);
+		_stats.AllocatedBytes += heap.Size;
+	}
+
+	for (ResourceHandle handle : images)
+	{
+		auto& resource = _resources[handle];
+		if (VkResult result = vmaBindImageMemory2(_allocator, _heaps[resource.Heap].Allocation, resource.Offset, resource.Image, nullptr))
+		{
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "RenderGraph : failed to bind transient image {}! Error code: {}", resource.Name, int32_t(result));
+			return false;
+		}
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = resource.Image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = resource.Desc.Format;
+		viewInfo.subresourceRange = { _aspect_of(resource.Desc.Format), 0, 1, 0, 1 };
+		if (VkResult result = vkCreateImageView(_device, &viewInfo, nullptr, &resource.View))
+		{
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "RenderGraph : failed to create view of transient image {}! Error code: {}", resource.Name, int32_t(result));
+			return false;
+		}
+	}
+	return true;
+}
+
+void RenderGraph::_place_transient_images(std::vector<ResourceHandle>& images)
+{
+	// 大的先放；每个图像放在最低的、与生命周期重叠的已放置图像都不冲突的偏移上
+	std::sort(images.begin(), images.end(), [this](ResourceHandle a, ResourceHandle b) {
+		return _resources[a].Requirements.size > _resources[b].Requirements.size;
+		});
+
+	std::vector<ResourceHandle> placed;
+	for (ResourceHandle handle : images)
+	{
+		auto& resource = _resources[handle];
+		const auto& requirements = resource.Requirements;
+
+		uint32_t heapIndex = 0;
+		while (heapIndex < _heaps.size() && !(_heaps[heapIndex].MemoryTypeBits & requirements.memoryTypeBits))
+			++heapIndex;
+		if (heapIndex == _heaps.size())
+			_heaps.push_back({ requirements.memoryTypeBits, 1, 0, nullptr });
+		auto& heap = _heaps[heapIndex];
+
+		std::vector<ResourceHandle> conflicts;
+		for (ResourceHandle other : placed)
+		{
+			auto& o = _resources[other];
+			if (o.Heap == heapIndex && o.FirstUse <= resource.LastUse && resource.FirstUse <= o.LastUse)
+				conflicts.push_back(other);
+		}
+
+		auto alignUp = [&requirements](VkDeviceSize offset) { return (offset + requirements.alignment - 1) / requirements.alignment * requirements.alignment; };
+		std::vector<VkDeviceSize> candidates = { 0 };
+		for (ResourceHandle other : conflicts)
+			candidates.push_back(alignUp(_resources[other].Offset + _resources[other].Requirements.size));
+		std::sort(candidates.begin(), candidates.end());
+
+		VkDeviceSize offset = candidates.back();
+		for (VkDeviceSize candidate : candidates)
+		{
+			bool fits = std::none_of(conflicts.begin(), conflicts.end(), [&](ResourceHandle other) {
+				auto& o = _resources[other];
+				return candidate < o.Offset + o.Requirements.size && o.Offset < candidate + requirements.size;
+				});
+			if (fits)
+			{
+				offset = candidate;
+				break;
+			}
+		}
+
+		resource.Heap = heapIndex;
+		resource.Offset = offset;
+		heap.MemoryTypeBits &= requirements.memoryTypeBits;
+		heap.Alignment = std::max(heap.Alignment, requirements.alignment);
+		heap.Size = std::max(heap.Size, offset + requirements.size);
+		placed.push_back(handle);
+	}
+
+	// 显存区间重叠的图像互为别名
+	for (size_t i = 0; i < placed.size(); ++i)
+	{
+		for (size_t j = i + 1; j < placed.size(); ++j)
+		{
+			auto& a = _resources[placed[i]];
+			auto& b = _resources[placed[j]];
+			if (a.Heap == b.Heap && a.Offset < b.Offset + b.Requirements.size && b.Offset < a.Offset + a.Requirements.size)
+			{
+				a.Aliases.push_back(placed[j]);
+				b.Aliases.push_back(placed[i]);
+			}
+		}
+	}
+}
+
+void RenderGraph::_destroy_transient_images()
+{
+	for (auto& resource : _resources)
+	{
+		if (resource.Kind != ResourceKind::TransientImage)
+			continue;
+		if (resource.View)
+			vkDestroyImageView(_device, resource.View, nullptr);
+		if (resource.Image)
+			vkDestroyImage(_device, resource.Image, nullptr);
+		resource.View = VK_NULL_HANDLE;
+		resource.Image = VK_NULL_HANDLE;
+		resource.Heap = UINT32_MAX;
+	}
+	for (auto& heap : _heaps)
+	{
+		if (heap.Allocation)
+		{
+			MemoryTracker::Get().OnFree(heap.Allocation);
+			vmaFreeMemory(_allocator, heap.Allocation);
+		}
+	}
+	_heaps.clear();
+	_compiled = false;
+}
+
+void RenderGraph::Execute(VkCommandBuffer command_buffer)
+{
+	if (!_compiled)
+		return;
+
+	_stats.BarrierCalls = 0;
+	_stats.ImageBarriers = 0;
+	_stats.MemoryBarriers = 0;
+
+	// 导入资源每帧从初始状态开始；临时图像保留上一帧的访问，第一次使用时等待它们
+	for (auto& resource : _resources)
+	{
+		resource.Touched = false;
+		if (resource.Kind == ResourceKind::TransientImage)
+			continue;
+		resource.Tracked = TrackedState{};
+		resource.Tracked.WriteStages = resource.Initial.Stages;
+		resource.Tracked.WriteAccess = resource.Initial.Access & WRITE_ACCESS;
+		resource.Tracked.Layout = resource.Initial.Layout;
+	}
+
+	std::vector<VkImageMemoryBarrier2> imageBarriers;
+	VkMemoryBarrier2 memoryBarrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+	for (uint32_t p : _order)
+	{
+		auto& pass = _passes[p];
+		if (!pass.Enabled)
+			continue;
+		for (auto& access : pass.Accesses)
+			_transition(_resources[access.Resource], access.State, access.Write, imageBarriers, memoryBarrier);
+		_flush_barriers(command_buffer, imageBarriers, memoryBarrier);
+		pass.Execute(command_buffer);
+	}
+
+	for (auto& resource : _resources)
+	{
+		if (resource.Kind != ResourceKind::ImportedImage || !resource.Image)
+			continue;
+		if (resource.Final.Layout != resource.Tracked.Layout || resource.Final.Stages != VK_PIPELINE_STAGE_2_NONE)
+			_transition(resource, resource.Final, false, imageBarriers, memoryBarrier);
+	}
+	_flush_barriers(command_buffer, imageBarriers, memoryBarrier);
+}
+
+void RenderGraph::_transition(Resource& resource, const ResourceState& state, bool write,
+	std::vector<VkImageMemoryBarrier2>& image_barriers, VkMemoryBarrier2& memory_barrier)
+{
+	auto& tracked = resource.Tracked;
+	bool image = _is_image(resource);
+	VkPipelineStageFlags2 srcStages = tracked.WriteStages;
+	VkAccessFlags2 srcAccess = tracked.WriteAccess;
+	VkImageLayout oldLayout = tracked.Layout;
+
+	// 临时图像每帧第一次使用时丢弃内容，并等待之前对这段显存的所有访问（上一帧的自己与共用显存的图像）
+	bool discard = resource.Kind == ResourceKind::TransientImage && !resource.Touched;
+	if (discard)
+	{
+		oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		srcStages |= tracked.ReadStages;
+		for (ResourceHandle alias : resource.Aliases)
+		{
+			srcStages |= _resources[alias].Tracked.WriteStages | _resources[alias].Tracked.ReadStages;
+			srcAccess |= _resources[alias].Tracked.WriteAccess;
+		}
+	}
+	resource.Touched = true;
+
+	VkImageLayout newLayout = image && state.Layout != VK_IMAGE_LAYOUT_UNDEFINED ? state.Layout : tracked.Layout;
+	bool layoutChange = image && (newLayout != oldLayout || (discard && newLayout != VK_IMAGE_LAYOUT_UNDEFINED));
+
+	bool barrier = false;
+	if (write || layoutChange)
+	{
+		// 写之前要等之前的读与写；布局转换本身也是一次写
+		srcStages |= tracked.ReadStages;
+		barrier = srcStages != VK_PIPELINE_STAGE_2_NONE || layoutChange;
+
+		tracked.WriteStages = state.Stages;
+		tracked.WriteAccess = write ? state.Access & WRITE_ACCESS : VK_ACCESS_2_NONE;
+		tracked.ReadStages = write ? VK_PIPELINE_STAGE_2_NONE : state.Stages;
+		tracked.ReadAccess = write ? VK_ACCESS_2_NONE : state.Access;
+		tracked.Layout = newLayout;
+	}
+	else
+	{
+		// 读之后的读不需要屏障；之前的写已经对这些阶段与访问可见时也不需要
+		bool visible = (tracked.ReadStages & state.Stages) == state.Stages && (tracked.ReadAccess & state.Access) == state.Access;
+		barrier = tracked.WriteStages != VK_PIPELINE_STAGE_2_NONE && !visible;
+		tracked.ReadStages |= state.Stages;
+		tracked.ReadAccess |= state.Access;
+	}
+	if (!barrier)
+		return;
+
+	if (image && !resource.Image)
+	{
+		LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "RenderGraph : image {} has no handle, barrier skipped", resource.Name);
+		return;
+	}
+	if (!image)
+	{
+		memory_barrier.srcStageMask |= srcStages;
+		memory_barrier.srcAccessMask |= srcAccess;
+		memory_barrier.dstStageMask |= state.Stages;
+		memory_barrier.dstAccessMask |= state.Access;
+		return;
+	}
+
+	VkImageMemoryBarrier2 imageBarrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+	imageBarrier.srcStageMask = srcStages;
+	imageBarrier.srcAccessMask = srcAccess;
+	imageBarrier.dstStageMask = state.Stages;
+	imageBarrier.dstAccessMask = state.Access;
+	imageBarrier.oldLayout = oldLayout;
+	imageBarrier.newLayout = newLayout;
+	imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.image = resource.Image;
+	imageBarrier.subresourceRange = { _aspect_of(resource.Format), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+	image_barriers.push_back(imageBarrier);
+}
+
+void RenderGraph::_flush_barriers(VkCommandBuffer command_buffer, std::vector<VkImageMemoryBarrier2>& image_barriers, VkMemoryBarrier2& memory_barrier)
+{
+	bool memory = memory_barrier.srcStageMask != VK_PIPELINE_STAGE_2_NONE || memory_barrier.dstStageMask != VK_PIPELINE_STAGE_2_NONE;
+	if (image_barriers.empty() && !memory)
+		return;
+
+	if (_synchronization2_enabled)
+	{
+		VkDependencyInfo dependency{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+		dependency.memoryBarrierCount = memory ? 1 : 0;
+		dependency.pMemoryBarriers = &memory_barrier;
+		dependency.imageMemoryBarrierCount = static_cast<uint32_t>(image_barriers.size());
+		dependency.pImageMemoryBarriers = image_barriers.data();
+		vkCmdPipelineBarrier2(command_buffer, &dependency);
+	}
+	else
+	{
+		// 旧接口每次调用只有一组阶段，合并所有屏障的阶段
+		VkPipelineStageFlags2 srcStages = memory_barrier.srcStageMask;
+		VkPipelineStageFlags2 dstStages = memory_barrier.dstStageMask;
+		std::vector<VkImageMemoryBarrier> legacyImageBarriers;
+		legacyImageBarriers.reserve(image_barriers.size());
+		for (auto& barrier : image_barriers)
+		{
+			srcStages |= barrier.srcStageMask;
+			dstStages |= barrier.dstStageMask;
+			VkImageMemoryBarrier legacy{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+			legacy.srcAccessMask = ToLegacyAccess(barrier.srcAccessMask);
+			legacy.dstAccessMask = ToLegacyAccess(barrier.dstAccessMask);
+			legacy.oldLayout = barrier.oldLayout;
+			legacy.newLayout = barrier.newLayout;
+			legacy.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			legacy.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			legacy.image = barrier.image;
+			legacy.subresourceRange = barrier.subresourceRange;
+			legacyImageBarriers.push_back(legacy);
+		}
+		VkMemoryBarrier legacyMemoryBarrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+		legacyMemoryBarrier.srcAccessMask = ToLegacyAccess(memory_barrier.srcAccessMask);
+		legacyMemoryBarrier.dstAccessMask = ToLegacyAccess(memory_barrier.dstAccessMask);
+		vkCmdPipelineBarrier(command_buffer,
+			ToLegacyStages(srcStages, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT), ToLegacyStages(dstStages, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT), 0,
+			memory ? 1 : 0, &legacyMemoryBarrier, 0, nullptr, static_cast<uint32_t>(legacyImageBarriers.size()), legacyImageBarriers.data());
+	}
+
+	++_stats.BarrierCalls;
+	_stats.ImageBarriers += static_cast<uint32_t>(image_barriers.size());
+	_stats.MemoryBarriers += memory ? 1 : 0;
+	image_barriers.clear();
+	memory_barrier = VkMemoryBarrier2{ VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+}
+
+std::vector<std::string> RenderGraph::GetExecutionOrder() const
+{
+	std::vector<std::string> names;
+	for (uint32_t p : _order)
+		names.push_back(_passes[p].Name);
+	return names;
+}
+
+VkImageAspectFlags RenderGraph::_aspect_of(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_X8_D24_UNORM_PACK32:
+	case VK_FORMAT_D32_SFLOAT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT;
+	case VK_FORMAT_S8_UINT:
+		return VK_IMAGE_ASPECT_STENCIL_BIT;
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	default:
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
@@ -0,0 +1,235 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+typedef struct VmaAllocator_T* VmaAllocator;
+typedef struct VmaAllocation_T* VmaAllocation;
+
+/// <summary>
+/// 渲染图。每个 pass 声明自己读写的图像与缓冲（阶段、访问、布局），Compile 时：
+/// 剔除结果没有被输出资源或有副作用的 pass 用到的 pass；按依赖做拓扑排序，尽量不把依赖的 pass 紧挨着排；
+/// 统计临时图像的生命周期，生命周期不重叠的临时图像共用同一段显存（放在少数几块 VMA 分配里）。
+/// Execute 时按资源当前的状态在每个 pass 之前合并成一次 vkCmdPipelineBarrier2（不支持 synchronization2 时用旧的 vkCmdPipelineBarrier），
+/// 读之后的读不加屏障；缓冲只用全局内存屏障，图像用图像屏障做布局转换。
+/// 复用显存的临时图像第一次使用时等待之前占用这段显存的图像的最后一次访问。
+/// 声明在 Compile 之后保持不变，直到 Reset（例如交换链重建后重新声明）；每帧可以更换导入的图像、开关个别 pass
+/// </summary>
+class RenderGraph
+{
+public:
+	using ResourceHandle = uint32_t;
+	using PassHandle = uint32_t;
+	static constexpr ResourceHandle INVALID_RESOURCE = UINT32_MAX;
+
+	/// <summary>
+	/// 资源的一次访问。导入资源的初始状态里 Stages 表示需要等待的之前的访问（例如等待 acquire 信号量的阶段）
+	/// </summary>
+	struct ResourceState
+	{
+		VkPipelineStageFlags2 Stages = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 Access = VK_ACCESS_2_NONE;
+		VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	};
+
+	/// <summary>
+	/// 临时图像，宽高为 0 时使用 SetExtent 设置的大小
+	/// </summary>
+	struct ImageDesc
+	{
+		VkFormat Format = VK_FORMAT_UNDEFINED;
+		VkExtent2D Extent = { 0, 0 };
+		VkImageUsageFlags Usage = 0;
+		VkSampleCountFlagBits Samples = VK_SAMPLE_COUNT_1_BIT;
+	};
+
+	struct Stats
+	{
+		uint32_t Passes = 0;
+		uint32_t CulledPasses = 0;
+		uint32_t TransientImages = 0;
+		// 不复用时临时图像需要的显存与实际分配的显存
+		VkDeviceSize TransientBytes = 0;
+		VkDeviceSize AllocatedBytes = 0;
+		// 最近一次 Execute
+		uint32_t BarrierCalls = 0;
+		uint32_t ImageBarriers = 0;
+		uint32_t MemoryBarriers = 0;
+	};
+
+	using ExecuteFunction = std::function<void(VkCommandBuffer command_buffer)>;
+
+	class PassBuilder
+	{
+	public:
+		PassBuilder(RenderGraph& graph, PassHandle pass) : _graph(graph), _pass(pass) {}
+
+		PassBuilder& Read(ResourceHandle resource, VkPipelineStageFlags2 stages, VkAccessFlags2 access, VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED);
+		PassBuilder& Write(ResourceHandle resource, VkPipelineStageFlags2 stages, VkAccessFlags2 access, VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED);
+		PassBuilder& WriteColor(ResourceHandle image);
+		PassBuilder& WriteDepth(ResourceHandle image);
+		/// <summary>
+		/// 深度测试只读（例如预通道之后 EQUAL 测试、不写深度）
+		/// </summary>
+		PassBuilder& ReadDepth(ResourceHandle image);
+		PassBuilder& ReadIndirect(ResourceHandle buffer, VkPipelineStageFlags2 shader_stages = VK_PIPELINE_STAGE_2_NONE);
+		PassBuilder& WriteStorage(ResourceHandle resource, VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+		/// <summary>
+		/// 即使输出没有被用到也保留（例如回读到主机）
+		/// </summary>
+		PassBuilder& SideEffects();
+
+		PassHandle GetHandle() const { return _pass; }
+
+	private:
+		RenderGraph& _graph;
+		PassHandle _pass;
+	};
+
+	RenderGraph() = default;
+	~RenderGraph() = default;
+
+	bool Init(VkDevice device, VmaAllocator allocator, bool synchronization2_enabled);
+	/// <summary>
+	/// 需在 GPU 空闲后调用
+	/// </summary>
+	void CleanUp();
+	/// <summary>
+	/// 清空声明并释放临时图像，之后重新声明并 Compile。需在 GPU 不再使用临时图像后调用
+	/// </summary>
+	void Reset();
+
+	void SetExtent(VkExtent2D extent) { _extent = extent; }
+
+	/// <summary>
+	/// 外部图像（例如交换链图像）。每帧开始时处于 initial，Execute 结束时转换到 final；output 为 true 时写它的 pass 不会被剔除
+	/// </summary>
+	ResourceHandle ImportImage(const std::string& name, VkFormat format, const ResourceState& initial, const ResourceState& final, bool output = true);
+	/// <summary>
+	/// 外部缓冲。只用于排序与屏障，不需要句柄（缓冲之间用全局内存屏障）
+	/// </summary>
+	ResourceHandle ImportBuffer(const std::string& name, bool output = false);
+	ResourceHandle CreateImage(const std::string& name, const ImageDesc& desc);
+	/// <summary>
+	/// 每帧 Execute 之前设置导入图像当前的句柄
+	/// </summary>
+	void SetImportedImage(ResourceHandle resource, VkImage image, VkImageView view);
+	VkImage GetImage(ResourceHandle resource) const;
+	VkImageView GetImageView(ResourceHandle resource) const;
+
+	PassBuilder AddPass(const std::string& name, ExecuteFunction execute);
+	/// <summary>
+	/// 本帧跳过该 pass（不录制也不改变资源状态），之后的屏障按实际执行的 pass 计算
+	/// </summary>
+	void SetPassEnabled(PassHandle pass, bool enabled);
+
+	bool Compile();
+	bool IsCompiled() const { return _compiled; }
+	void Execute(VkCommandBuffer command_buffer);
+
+	/// <summary>
+	/// 编译后的执行顺序（已剔除的 pass 不在其中）
+	/// </summary>
+	std::vector<std::string> GetExecutionOrder() const;
+	const Stats& GetStats() const { return _stats; }
+
+private:
+	struct Access
+	{
+		ResourceHandle Resource;
+		ResourceState State;
+		bool Write;
+	};
+
+	struct Pass
+	{
+		std::string Name;
+		ExecuteFunction Execute;
+		std::vector<Access> Accesses;
+		bool SideEffects = false;
+		bool Enabled = true;
+	};
+
+	enum class ResourceKind : uint32_t
+	{
+		ImportedImage,
+		ImportedBuffer,
+		TransientImage,
+	};
+
+	// 执行时跟踪的状态：最近一次写（或布局转换）与之后已经可见的读
+	struct TrackedState
+	{
+		VkPipelineStageFlags2 WriteStages = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 WriteAccess = VK_ACCESS_2_NONE;
+		VkPipelineStageFlags2 ReadStages = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 ReadAccess = VK_ACCESS_2_NONE;
+		VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	};
+
+	struct Resource
+	{
+		std::string Name;
+		ResourceKind Kind;
+		bool Output = false;
+		VkFormat Format = VK_FORMAT_UNDEFINED;
+		ImageDesc Desc;
+		ResourceState Initial;
+		ResourceState Final;
+
+		VkImage Image = VK_NULL_HANDLE;
+		VkImageView View = VK_NULL_HANDLE;
+
+		// 临时图像：生命周期（执行顺序中的位置）与显存位置
+		uint32_t FirstUse = UINT32_MAX;
+		uint32_t LastUse = 0;
+		uint32_t Heap = UINT32_MAX;
+		VkDeviceSize Offset = 0;
+		VkMemoryRequirements Requirements{};
+		// 与它共用显存的其他临时图像
+		std::vector<ResourceHandle> Aliases;
+
+		TrackedState Tracked;
+		// 本帧是否已被访问（临时图像第一次访问时丢弃内容并等待共用显存的图像）
+		bool Touched = false;
+	};
+
+	// 一块 VMA 分配，放置若干临时图像
+	struct Heap
+	{
+		uint32_t MemoryTypeBits = 0;
+		VkDeviceSize Alignment = 1;
+		VkDeviceSize Size = 0;
+		VmaAllocation Allocation = nullptr;
+	};
+
+	void _add_access(PassHandle pass, ResourceHandle resource, const ResourceState& state, bool write);
+	std::vector<uint32_t> _cull_passes() const;
+	std::vector<uint32_t> _sort_passes(const std::vector<uint32_t>& passes) const;
+	bool _create_transient_images();
+	void _destroy_transient_images();
+	void _place_transient_images(std::vector<ResourceHandle>& images);
+	void _transition(Resource& resource, const ResourceState& state, bool write,
+		std::vector<VkImageMemoryBarrier2>& image_barriers, VkMemoryBarrier2& memory_barrier);
+	void _flush_barriers(VkCommandBuffer command_buffer, std::vector<VkImageMemoryBarrier2>& image_barriers, VkMemoryBarrier2& memory_barrier);
+	static VkImageAspectFlags _aspect_of(VkFormat format);
+	static bool _is_image(const Resource& resource) { return resource.Kind != ResourceKind::ImportedBuffer; }
+
+private:
+	VkDevice _device = VK_NULL_HANDLE;
+	VmaAllocator _allocator = nullptr;
+	bool _synchronization2_enabled = false;
+	VkExtent2D _extent = { 0, 0 };
+
+	std::vector<Pass> _passes;
+	std::vector<Resource> _resources;
+	std::vector<Heap> _heaps;
+	// 编译后的执行顺序（pass 序号）
+	std::vector<uint32_t> _order;
+	bool _compiled = false;
+	Stats _stats;
+};
@@ -1,4 +1,6 @@
 ﻿#include "ShaderCompiler.h"
+#include "Tracer.h"
+#include "Logger.h"
 
 #include <shaderSlang/slang.h>
 #include <shaderSlang/slang-com-helper.h>
@@ -8,18 +10,20 @@
 #include <fstream>
 #include <array>
 
-#include <iostream>
+#include <format>
 
 static void diagnoseIfNeeded(slang::IBlob* diagnosticsBlob)
 {
     if (diagnosticsBlob != nullptr)
     {
-        std::cout << (const char*)diagnosticsBlob->getBufferPointer() << std::endl;
+        LOG_WARNING(LOG_CATEGORY_SHADER_COMPILER, "{}", (const char*)diagnosticsBlob->getBufferPointer());
     }
 }
 
 bool ShaderCompiler::CompilerShaders(const std::vector<std::string>& shader_paths, const std::string& out_spv_path, const std::string& out_glsl_path)
 {
+    TRACE_ZONE_DETAIL("CompilerShaders", "shader", std::format("{} files", shader_paths.size()));
+
     // 1. Create Global Session
     Slang::ComPtr<slang::IGlobalSession> globalSession;
     SlangGlobalSessionDesc desc{};
@@ -75,7 +79,7 @@ bool ShaderCompiler::CompilerShaders(const std::vector<std::string>& shader_path
         hasShader = std::filesystem::exists(path);
         if (!hasShader)
         {
-            std::cout << "ERROR : [ ShaderCompiler ] not find slang file" << std::endl;
+            LOG_ERROR(LOG_CATEGORY_SHADER_COMPILER, "not find slang file : {}", path);
             continue;
         }
         if (!out_spv_path.empty())
@@ -88,10 +92,12 @@ bool ShaderCompiler::CompilerShaders(const std::vector<std::string>& shader_path
         }
         if (hasFile1 && hasFile2)
         {
-            std::cout << std::format("INFO : [ ShaderCompiler ] file is compiled.: {}", shaderName) << std::endl;
+            LOG_INFO(LOG_CATEGORY_SHADER_COMPILER, "file is compiled.: {}", shaderName);
             continue;
         }
 
+        TRACE_ZONE_DETAIL("CompileShader", "shader", shaderName);
+
         auto shaderSource = ReadFile(path);
         //std::cout << shaderSource.size() << "\n";
 
@@ -115,7 +121,7 @@ bool ShaderCompiler::CompilerShaders(const std::vector<std::string>& shader_path
         SlangInt32 entryPointCount = slangModule->getDefinedEntryPointCount();
         if (entryPointCount == 0)
         {
-            std::cout << std::format("WARNING : [ ShaderCompiler ] No entry points found in : {}", shaderName) << std::endl;
+            LOG_WARNING(LOG_CATEGORY_SHADER_COMPILER, "No entry points found in : {}", shaderName);
             continue;
         }
 
@@ -134,7 +140,7 @@ bool ShaderCompiler::CompilerShaders(const std::vector<std::string>& shader_path
             if (!layout)
             {
                 diagnoseIfNeeded(layoutDiag);
-                std::cout << std::format("ERROR : [ ShaderCompiler ] Failed to get layout for entry point : {}", epName) << std::endl;
+                LOG_ERROR(LOG_CATEGORY_SHADER_COMPILER, "Failed to get layout for entry point : {}", epName);
                 continue;
             }
 
@@ -173,8 +179,10 @@ bool ShaderCompiler::CompilerShaders(const std::vector<std::string>& shader_path
             case SLANG_STAGE_CALLABLE:
                 break;
             case SLANG_STAGE_MESH:
+                stageSuffix = "mesh";
                 break;
             case SLANG_STAGE_AMPLIFICATION:
+                stageSuffix = "task";
                 break;
             case SLANG_STAGE_DISPATCH:
                 break;
@@ -245,15 +253,15 @@ bool ShaderCompiler::CompilerShaders(const std::vector<std::string>& shader_path
                 }
                 else
                 {
-                    std::cout << "INFO : [ ShaderCompiler ] Compiled SPIR-V done. name: " << shaderName << ". stage: " << stageSuffix << std::endl;
+                    LOG_INFO(LOG_CATEGORY_SHADER_COMPILER, "Compiled SPIR-V done. name: {}. stage: {}", shaderName, stageSuffix);
                     auto res = WriteFile((const char*)spirvCode->getBufferPointer(), spirvCode->getBufferSize(), out_spv_path, shaderName + "." + stageSuffix + ".spv");
                     if (res)
                     {
-                        std::cout << "INFO : [ ShaderCompiler ] spv write done. file: " << shaderName << ". stage: " << stageSuffix << std::endl;
+                        LOG_INFO(LOG_CATEGORY_SHADER_COMPILER, "spv write done. file: {}. stage: {}", shaderName, stageSuffix);
                     }
                     else
                     {
-                        std::cout << "ERROR : [ ShaderCompiler ] spv file write error; " << shaderName << ". stage: " << stageSuffix << std::endl;
+                        LOG_ERROR(LOG_CATEGORY_SHADER_COMPILER, "spv file write error; {}. stage: {}", shaderName, stageSuffix);
                     }
                 }
             }
@@ -273,15 +281,15 @@ bool ShaderCompiler::CompilerShaders(const std::vector<std::string>& shader_path
                 }
                 else
                 {
-                    std::cout << "INFO : [ ShaderCompiler ] Compiled GLSL done. name: " << shaderName << ". stage: " << stageSuffix << std::endl;
+                    LOG_INFO(LOG_CATEGORY_SHADER_COMPILER, "Compiled GLSL done. name: {}. stage: {}", shaderName, stageSuffix);
                     auto res = WriteFile((const char*)glslCode->getBufferPointer(), glslCode->getBufferSize(), out_glsl_path, shaderName + "." + stageSuffix + ".glsl");
                     if (res)
                     {
-                        std::cout << "INFO : [ ShaderCompiler ] glsl write done. file: " << shaderName << ". stage: " << stageSuffix << std::endl;
+                        LOG_INFO(LOG_CATEGORY_SHADER_COMPILER, "glsl write done. file: {}. stage: {}", shaderName, stageSuffix);
                     }
                     else
                     {
-                        std::cout << "ERROR : [ ShaderCompiler ] glsl file write error; " << shaderName << ". stage: " << stageSuffix << std::endl;
+                        LOG_ERROR(LOG_CATEGORY_SHADER_COMPILER, "glsl file write error; {}. stage: {}", shaderName, stageSuffix);
                     }
                 }
             }
@@ -298,7 +306,7 @@ std::vector<char> ShaderCompiler::ReadFile(const std::string& path)
     std::ifstream file(path, std::ios::ate | std::ios::binary);
     if (!file.is_open())
     {
-        std::cout << std::format("ERROR : [ ShaderCompiler ] failed to open file : {} \n", path);
+        LOG_ERROR(LOG_CATEGORY_SHADER_COMPILER, "failed to open file : {}", path);
     }
 
     size_t fileSize = (size_t)file.tellg();
@@ -318,7 +326,7 @@ bool ShaderCompiler::WriteFile(const char* data, size_t buffer_size, const std::
     std::ofstream file(path, std::ios::binary | std::ios::trunc);
     if (!file.is_open())
     {
-        std::cout << "ERROR : [ ShaderCompiler ] file open error;\n";
+        LOG_ERROR(LOG_CATEGORY_SHADER_COMPILER, "file open error; {}", path);
         return false;
     }
 
@@ -326,12 +334,12 @@ bool ShaderCompiler::WriteFile(const char* data, size_t buffer_size, const std::
 
     if (!file)
     {
-        std::cout << "ERROR : [ ShaderCompiler ] file write error;\n";
+        LOG_ERROR(LOG_CATEGORY_SHADER_COMPILER, "file write error; {}", path);
         file.close();
         return false;
     }
 
-    std::cout << "INFO : [ ShaderCompiler ] write done.\n";
+    LOG_INFO(LOG_CATEGORY_SHADER_COMPILER, "write done. {}", path);
     file.close();
     return true;
 }
@@ -0,0 +1,135 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/// <summary>
+/// 纹理文件（KTX2 容器），由 VulkanEngineCooker 的 texture 子命令生成。只支持运行时需要的子集：
+/// 2D、单层、单面、无超压缩，mip 链预先生成好（levelCount 不为 0）。各级数据按块压缩格式的内存布局紧密排列，
+/// 运行时映射文件后直接拷贝到上传缓冲，不做任何解码
+/// </summary>
+constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+// 各级数据的对齐（块大小 8 / 16 字节与 4 的最小公倍数之上取 16）
+constexpr uint64_t KTX2_LEVEL_ALIGNMENT = 16;
+
+struct Ktx2Header
+{
+	uint8_t Identifier[12];
+	// 规范中的 vkFormat
+	uint32_t Format;
+	uint32_t TypeSize;
+	uint32_t PixelWidth;
+	uint32_t PixelHeight;
+	uint32_t PixelDepth;
+	uint32_t LayerCount;
+	uint32_t FaceCount;
+	uint32_t LevelCount;
+	uint32_t SupercompressionScheme;
+	// 数据格式描述（DFD）、键值对与超压缩全局数据的位置
+	uint32_t DfdByteOffset;
+	uint32_t DfdByteLength;
+	uint32_t KvdByteOffset;
+	uint32_t KvdByteLength;
+	uint64_t SgdByteOffset;
+	uint64_t SgdByteLength;
+};
+static_assert(sizeof(Ktx2Header) == 80, "Ktx2Header is part of the file format");
+
+// 紧跟在文件头之后，按 mip 级排列（第 0 级最精细）
+struct Ktx2LevelIndex
+{
+	uint64_t ByteOffset;
+	uint64_t ByteLength;
+	uint64_t UncompressedByteLength;
+};
+static_assert(sizeof(Ktx2LevelIndex) == 24, "Ktx2LevelIndex is part of the file format");
+
+/// <summary>
+/// 纹理文件可以使用的格式。未压缩格式的块为 1x1
+/// </summary>
+struct TextureFormatInfo
+{
+	VkFormat Format;
+	uint32_t BlockWidth;
+	uint32_t BlockHeight;
+	uint32_t BlockBytes;
+	bool Srgb;
+	const char* Name;
+};
+
+inline constexpr TextureFormatInfo TEXTURE_FORMATS[] = {
+	{ VK_FORMAT_R8G8B8A8_UNORM, 1, 1, 4, false, "rgba8" },
+	{ VK_FORMAT_R8G8B8A8_SRGB, 1, 1, 4, true, "rgba8" },
+	{ VK_FORMAT_BC1_RGBA_UNORM_BLOCK, 4, 4, 8, false, "bc1" },
+	{ VK_FORMAT_BC1_RGBA_SRGB_BLOCK, 4, 4, 8, true, "bc1" },
+	{ VK_FORMAT_BC3_UNORM_BLOCK, 4, 4, 16, false, "bc3" },
+	{ VK_FORMAT_BC3_SRGB_BLOCK, 4, 4, 16, true, "bc3" },
+	{ VK_FORMAT_BC5_UNORM_BLOCK, 4, 4, 16, false, "bc5" },
+	{ VK_FORMAT_BC7_UNORM_BLOCK, 4, 4, 16, false, "bc7" },
+	{ VK_FORMAT_BC7_SRGB_BLOCK, 4, 4, 16, true, "bc7" },
+	// 烘焙器不生成 ASTC，但其他工具生成的 ASTC 4x4 文件可以加载（移动端没有 BC）
+	{ VK_FORMAT_ASTC_4x4_UNORM_BLOCK, 4, 4, 16, false, "astc4x4" },
+	{ VK_FORMAT_ASTC_4x4_SRGB_BLOCK, 4, 4, 16, true, "astc4x4" },
+};
+
+inline const TextureFormatInfo* FindTextureFormat(uint32_t format)
+{
+	for (const auto& info : TEXTURE_FORMATS)
+	{
+		if (uint32_t(info.Format) == format)
+			return &info;
+	}
+	return nullptr;
+}
+
+inline uint64_t TextureLevelBytes(const TextureFormatInfo& info, uint32_t width, uint32_t height)
+{
+	return uint64_t((width + info.BlockWidth - 1) / info.BlockWidth) * ((height + info.BlockHeight - 1) / info.BlockHeight) * info.BlockBytes;
+}
+
+inline uint64_t AlignTextureLevel(uint64_t offset)
+{
+	return (offset + KTX2_LEVEL_ALIGNMENT - 1) & ~(KTX2_LEVEL_ALIGNMENT - 1);
+}
+
+/// <summary>
+/// 检查文件头是否属于支持的子集、格式是否已知，以及各级数据是否落在文件范围内且大小与尺寸一致。
+/// 合法时返回 nullptr，否则返回错误描述
+/// </summary>
+inline const char* ValidateKtx2File(const void* data, size_t size)
+{
+	if (size < sizeof(Ktx2Header))
+		return "file smaller than header";
+
+	auto& header = *static_cast<const Ktx2Header*>(data);
+	if (std::memcmp(header.Identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+		return "bad identifier";
+	const TextureFormatInfo* info = FindTextureFormat(header.Format);
+	if (!info)
+		return "unsupported format";
+	if (header.PixelWidth == 0 || header.PixelHeight == 0 || header.PixelDepth != 0 || header.LayerCount != 0 || header.FaceCount != 1)
+		return "not a 2D texture";
+	if (header.SupercompressionScheme != 0)
+		return "supercompression not supported";
+	// levelCount 为 0 表示要求加载方生成 mip
+	if (header.LevelCount == 0 || header.LevelCount > 32 ||
+		((header.PixelWidth >> (header.LevelCount - 1)) == 0 && (header.PixelHeight >> (header.LevelCount - 1)) == 0))
+		return "bad level count";
+	if (sizeof(Ktx2Header) + uint64_t(header.LevelCount) * sizeof(Ktx2LevelIndex) > size)
+		return "level index out of range";
+
+	auto levels = reinterpret_cast<const Ktx2LevelIndex*>(static_cast<const unsigned char*>(data) + sizeof(Ktx2Header));
+	for (uint32_t level = 0; level < header.LevelCount; ++level)
+	{
+		uint32_t width = header.PixelWidth >> level ? header.PixelWidth >> level : 1;
+		uint32_t height = header.PixelHeight >> level ? header.PixelHeight >> level : 1;
+		if (levels[level].ByteLength != TextureLevelBytes(*info, width, height))
+			return "level size mismatch";
+		if (levels[level].ByteOffset > size || levels[level].ByteLength > size - levels[level].ByteOffset)
+			return "level out of range";
+	}
+	return nullptr;
+}
@@ -0,0 +1,1151 @@
+﻿// 模拟预处理头
+#include "VulkanMemoryAllocator/VmaUsage.h"
+
+#include "TextureStreamer.h"
+#include "TextureFormat.h"
+#include "MappedFile.h"
+#include "MemoryTracker.h"
+#include "Tracer.h"
+#include "Logger.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <format>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define TEXTURE_STREAMER_SSSE3 1
+#endif
+
+static_assert(TextureStreamer::MAX_UPLOAD_BATCHES <= MipGenerator::MAX_SLOTS, "each mip batch owns a MipGenerator slot");
+
+bool TextureStreamer::Init(VkPhysicalDevice physical_device, VkDevice device, VmaAllocator allocator, VkQueue queue, uint32_t queue_family_index,
+	VkQueue graphics_queue, uint32_t graphics_family_index, const std::string& mip_shader_path, uint32_t frames_in_flight, uint32_t worker_count)
+{
+	_physical_device = physical_device;
+	_device = device;
+	_allocator = allocator;
+	_queue = queue;
+	_queue_family_index = queue_family_index;
+	_graphics_queue = graphics_queue;
+	_graphics_family_index = graphics_family_index;
+	_frames_in_flight = frames_in_flight;
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = queue_family_index;
+	if (VkResult result = vkCreateCommandPool(_device, &poolInfo, nullptr, &_command_pool))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "TextureStreamer : failed to create command pool! Error code: {}", int32_t(result));
+		_device = VK_NULL_HANDLE;
+		return false;
+	}
+
+	_batches.resize(MAX_UPLOAD_BATCHES);
+	for (auto& batch : _batches)
+	{
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = _command_pool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+		if (VkResult result = vkAllocateCommandBuffers(_device, &allocInfo, &batch.CommandBuffer))
+		{
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "TextureStreamer : failed to allocate command buffer! Error code: {}", int32_t(result));
+			CleanUp();
+			return false;
+		}
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		if (VkResult result = vkCreateFence(_device, &fenceInfo, nullptr, &batch.Fence))
+		{
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "TextureStreamer : failed to create fence! Error code: {}", int32_t(result));
+			CleanUp();
+			return false;
+		}
+	}
+
+	// mip 生成失败时退回到工作线程上生成，不影响加载
+	_mip_generator.Init(physical_device, _device, mip_shader_path);
+	poolInfo.queueFamilyIndex = graphics_family_index;
+	if (VkResult result = vkCreateCommandPool(_device, &poolInfo, nullptr, &_graphics_command_pool))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "TextureStreamer : failed to create mip command pool! Error code: {}", int32_t(result));
+		CleanUp();
+		return false;
+	}
+	_mip_batches.resize(MAX_UPLOAD_BATCHES);
+	for (auto& batch : _mip_batches)
+	{
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = _graphics_command_pool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		if (vkAllocateCommandBuffers(_device, &allocInfo, &batch.CommandBuffer) != VK_SUCCESS ||
+			vkCreateFence(_device, &fenceInfo, nullptr, &batch.Fence) != VK_SUCCESS)
+		{
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "TextureStreamer : failed to create mip batch!");
+			CleanUp();
+			return false;
+		}
+	}
+
+	if (worker_count == 0)
+		worker_count = std::clamp(std::thread::hardware_concurrency() / 2, 1u, MAX_WORKERS);
+	_shutdown = false;
+	for (uint32_t i = 0; i < worker_count; ++i)
+		_workers.emplace_back(&TextureStreamer::_worker, this, i);
+
+	LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "TextureStreamer : {} decode workers, upload queue family {}{}", worker_count, queue_family_index,
+		queue_family_index != graphics_family_index ? " (shared with graphics)" : "");
+	return true;
+}
+
+void TextureStreamer::CleanUp()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_shutdown = true;
+		_jobs.clear();
+	}
+	_wake.notify_all();
+	for (auto& worker : _workers)
+	{
+		if (worker.joinable())
+			worker.join();
+	}
+	_workers.clear();
+	for (auto& result : _decoded)
+		_destroy_source(result.Source);
+	_decoded.clear();
+	_pending_decodes = 0;
+
+	for (auto& batch : _batches)
+	{
+		if (batch.InFlight)
+			vkWaitForFences(_device, 1, &batch.Fence, VK_TRUE, UINT64_MAX);
+		for (const Rebuild& rebuild : batch.Rebuilds)
+			_destroy_image(rebuild.Image, rebuild.View, rebuild.Allocation);
+		if (batch.Fence)
+			vkDestroyFence(_device, batch.Fence, nullptr);
+	}
+	_batches.clear();
+	if (_command_pool)
+	{
+		vkDestroyCommandPool(_device, _command_pool, nullptr);
+		_command_pool = VK_NULL_HANDLE;
+	}
+
+	for (auto& batch : _mip_batches)
+	{
+		if (batch.InFlight)
+			vkWaitForFences(_device, 1, &batch.Fence, VK_TRUE, UINT64_MAX);
+		for (const MipJob& job : batch.Jobs)
+			_destroy_image(job.Image, VK_NULL_HANDLE, job.Allocation);
+		if (batch.Fence)
+			vkDestroyFence(_device, batch.Fence, nullptr);
+	}
+	_mip_batches.clear();
+	if (_graphics_command_pool)
+	{
+		vkDestroyCommandPool(_device, _graphics_command_pool, nullptr);
+		_graphics_command_pool = VK_NULL_HANDLE;
+	}
+	_mip_generator.CleanUp();
+
+	_destroy_retired(true);
+	for (auto& texture : _textures)
+	{
+		if (texture.Image)
+			_destroy_image(texture.Image, texture.View, texture.Allocation);
+		_destroy_source(texture.Source);
+	}
+	_textures.clear();
+	_committed_bytes = 0;
+	_device = VK_NULL_HANDLE;
+}
+
+TextureStreamer::TextureHandle TextureStreamer::Load(const std::string& path, bool srgb)
+{
+	if (!_device)
+		return INVALID_TEXTURE;
+
+	TextureHandle handle = static_cast<TextureHandle>(_textures.size());
+	Texture& texture = _textures.emplace_back();
+	texture.Path = path;
+	texture.Format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+	texture.LastUsedFrame = _frame;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs.push_back({ handle, path, texture.Format });
+		++_pending_decodes;
+	}
+	_wake.notify_one();
+	return handle;
+}
+
+void TextureStreamer::Release(TextureHandle texture)
+{
+	if (texture >= _textures.size() || _textures[texture].Released)
+		return;
+
+	Texture& record = _textures[texture];
+	record.Released = true;
+	if (_on_view_changed)
+		_on_view_changed(texture, VK_NULL_HANDLE);
+	uint32_t committed = _committed_mip(record);
+	if (committed != UINT32_MAX)
+		_committed_bytes -= _chain_bytes(record, committed);
+	// 上传中的图像在批次完成时销毁
+	if (record.Image)
+		_retire(record.Image, record.View, record.Allocation);
+	record.Image = VK_NULL_HANDLE;
+	record.View = VK_NULL_HANDLE;
+	record.Allocation = nullptr;
+	// 上传或生成 mip 中的批次还在读写源缓冲，批次完成时再销毁
+	if (record.PendingMip == UINT32_MAX && !record.MipsInFlight)
+		_destroy_source(record.Source);
+	record.Levels.clear();
+}
+
+void TextureStreamer::RequestScreenSize(TextureHandle texture, float screen_pixels)
+{
+	if (texture >= _textures.size() || _textures[texture].Released)
+		return;
+
+	Texture& record = _textures[texture];
+	if (record.LastUsedFrame != _frame)
+		record.ScreenPixels = 0.0f;
+	record.ScreenPixels = std::max(record.ScreenPixels, screen_pixels);
+	record.LastUsedFrame = _frame;
+}
+
+void TextureStreamer::Update()
+{
+	if (!_device)
+		return;
+
+	TRACE_ZONE("TextureStreamerUpdate");
+	++_frame;
+	_complete_batches();
+	_complete_mip_batches();
+	_destroy_retired(false);
+	_receive_decoded();
+	_schedule_mip_generation();
+	_update_desired_mips();
+	_schedule_uploads();
+}
+
+TextureStreamer::TextureState TextureStreamer::GetState(TextureHandle texture) const
+{
+	if (texture >= _textures.size() || _textures[texture].Released)
+		return STATE_FAILED;
+	return _textures[texture].State;
+}
+
+VkImageView TextureStreamer::GetImageView(TextureHandle texture) const
+{
+	return texture < _textures.size() ? _textures[texture].View : VK_NULL_HANDLE;
+}
+
+uint32_t TextureStreamer::GetResidentMip(TextureHandle texture) const
+{
+	return texture < _textures.size() ? _textures[texture].ResidentMip : UINT32_MAX;
+}
+
+uint32_t TextureStreamer::GetMipCount(TextureHandle texture) const
+{
+	return texture < _textures.size() ? static_cast<uint32_t>(_textures[texture].Levels.size()) : 0;
+}
+
+VkExtent2D TextureStreamer::GetExtent(TextureHandle texture) const
+{
+	if (texture >= _textures.size() || _textures[texture].Levels.empty())
+		return { 0, 0 };
+	return { _textures[texture].Levels[0].Width, _textures[texture].Levels[0].Height };
+}
+
+bool TextureStreamer::IsIdle() const
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_pending_decodes || !_decoded.empty())
+			return false;
+	}
+	for (const auto& batch : _batches)
+	{
+		if (batch.InFlight)
+			return false;
+	}
+	for (const auto& batch : _mip_batches)
+	{
+		if (batch.InFlight)
+			return false;
+	}
+	for (const auto& texture : _textures)
+	{
+		if (texture.Released)
+			continue;
+		if (texture.State == STATE_DECODED)
+			return false;
+		// 下一级能放进预算就还需要换入
+		if (texture.State == STATE_RESIDENT && texture.DesiredMip < texture.ResidentMip &&
+			_committed_bytes + _chain_bytes(texture, texture.ResidentMip - 1) - _chain_bytes(texture, texture.ResidentMip) <= _budget)
+			return false;
+	}
+	return true;
+}
+
+TextureStreamer::Stats TextureStreamer::GetStats() const
+{
+	Stats stats = _stats;
+	stats.Budget = _budget;
+	for (const auto& texture : _textures)
+	{
+		if (texture.Released)
+			continue;
+		++stats.Textures;
+		stats.SourceBytes += texture.Source.Size;
+		if (texture.ResidentMip != UINT32_MAX)
+			stats.ResidentBytes += _chain_bytes(texture, texture.ResidentMip);
+	}
+	std::lock_guard<std::mutex> lock(_mutex);
+	stats.PendingDecodes = _pending_decodes;
+	stats.DecodeMs = _decode_ms;
+	return stats;
+}
+
+void TextureStreamer::_worker(uint32_t index)
+{
+	Tracer::Get().SetThreadName(std::format("TextureDecode{}", index));
+
+	for (;;)
+	{
+		DecodeJob job;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wake.wait(lock, [this] { return _shutdown || !_jobs.empty(); });
+			if (_shutdown)
+				return;
+			job = std::move(_jobs.front());
+			_jobs.pop_front();
+		}
+
+		auto begin = std::chrono::steady_clock::now();
+		DecodeResult result;
+		result.Texture = job.Texture;
+		// 只有第 0 级时没有 mip 需要生成
+		result.MipsOnGpu = _mip_generator.CanGenerate(job.Format);
+		result.Failed = !_decode(job.Path, result);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_decoded.push_back(std::move(result));
+		--_pending_decodes;
+		_decode_ms += ms;
+	}
+}
+
+bool TextureStreamer::_decode(const std::string& path, DecodeResult& result)
+{
+	if (path.ends_with(".ktx2"))
+		return _load_ktx2(path, result);
+
+	TRACE_ZONE_DETAIL("DecodeTexture", "texture", path);
+
+	// 按原始通道数解码，省掉 stb_image 内部转换成 RGBA 的那一遍；展开与写入源缓冲合成一遍
+	int width = 0, height = 0, channels = 0;
+	stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, 0);
+	if (!pixels)
+	{
+		LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "TextureStreamer : failed to decode {} : {}", path, stbi_failure_reason());
+		return false;
+	}
+
+	uint32_t mipCount = std::bit_width(uint32_t(std::max(width, height)));
+	result.Levels.resize(mipCount);
+	VkDeviceSize offset = 0;
+	for (uint32_t mip = 0; mip < mipCount; ++mip)
+	{
+		MipLevel& level = result.Levels[mip];
+		level.Width = std::max(uint32_t(width) >> mip, 1u);
+		level.Height = std::max(uint32_t(height) >> mip, 1u);
+		level.Offset = offset;
+		level.Size = VkDeviceSize(level.Width) * level.Height * 4;
+		offset += level.Size;
+	}
+
+	if (!_create_source(offset, result.Source))
+	{
+		stbi_image_free(pixels);
+		return false;
+	}
+	_expand_to_rgba(pixels, uint32_t(channels), result.Source.Mapped, size_t(width) * size_t(height));
+	stbi_image_free(pixels);
+
+	result.MipsOnGpu = result.MipsOnGpu && mipCount > 1;
+	if (result.MipsOnGpu)
+	{
+		vmaFlushAllocation(_allocator, result.Source.Allocation, 0, result.Levels[0].Size);
+		return true;
+	}
+	_build_mip_chain(result.Source.Mapped, result.Levels);
+	vmaFlushAllocation(_allocator, result.Source.Allocation, 0, result.Source.Size);
+	return true;
+}
+
+bool TextureStreamer::_load_ktx2(const std::string& path, DecodeResult& result)
+{
+	TRACE_ZONE_DETAIL("LoadKtx2", "texture", path);
+
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "TextureStreamer : failed to map {}", path);
+		return false;
+	}
+	if (const char* error = ValidateKtx2File(file.Data(), file.Size()))
+	{
+		LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "TextureStreamer : invalid texture file {} : {}", path, error);
+		return false;
+	}
+
+	auto& header = *reinterpret_cast<const Ktx2Header*>(file.Data());
+	const TextureFormatInfo& info = *FindTextureFormat(header.Format);
+	if (!IsFormatSupported(info.Format))
+	{
+		LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "TextureStreamer : {} uses {}{}, not supported by the device", path, info.Name, info.Srgb ? " (sRGB)" : "");
+		return false;
+	}
+
+	// 块压缩格式的拷贝源偏移需要是块大小的整数倍
+	auto fileLevels = reinterpret_cast<const Ktx2LevelIndex*>(file.Data() + sizeof(Ktx2Header));
+	result.Format = info.Format;
+	result.MipsOnGpu = false;
+	result.Levels.resize(header.LevelCount);
+	VkDeviceSize offset = 0;
+	for (uint32_t mip = 0; mip < header.LevelCount; ++mip)
+	{
+		MipLevel& level = result.Levels[mip];
+		level.Width = std::max(header.PixelWidth >> mip, 1u);
+		level.Height = std::max(header.PixelHeight >> mip, 1u);
+		level.Offset = offset;
+		level.Size = fileLevels[mip].ByteLength;
+		offset = AlignTextureLevel(offset + level.Size);
+	}
+
+	if (!_create_source(offset, result.Source))
+		return false;
+	for (uint32_t mip = 0; mip < header.LevelCount; ++mip)
+		std::memcpy(result.Source.Mapped + result.Levels[mip].Offset, file.Data() + fileLevels[mip].ByteOffset, size_t(fileLevels[mip].ByteLength));
+	vmaFlushAllocation(_allocator, result.Source.Allocation, 0, result.Source.Size);
+	return true;
+}
+
+bool TextureStreamer::IsFormatSupported(VkFormat format) const
+{
+	// 传输目标的特性位要求 Vulkan 1.1（maintenance1），可采样的格式总能作为拷贝目标
+	VkFormatProperties properties{};
+	vkGetPhysicalDeviceFormatProperties(_physical_device, format, &properties);
+	return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
+
+#ifdef TEXTURE_STREAMER_SSSE3
+static bool HasSsse3()
+{
+	static const bool supported = [] {
+		int info[4] = {};
+		__cpuid(info, 1);
+		return (info[2] & (1 << 9)) != 0;
+		}();
+	return supported;
+}
+#endif
+
+void TextureStreamer::_expand_to_rgba(const uint8_t* src, uint32_t channels, uint8_t* dst, size_t pixel_count)
+{
+	if (channels == 4)
+	{
+		std::memcpy(dst, src, pixel_count * 4);
+		return;
+	}
+
+	size_t i = 0;
+	if (channels == 3)
+	{
+#ifdef TEXTURE_STREAMER_SSSE3
+		// 每次 16 个像素：48 字节读成 3 个寄存器，拼出 4 组 12 字节，各自用 pshufb 插入 alpha 位置后或上 0xff
+		if (HasSsse3())
+		{
+			const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+			const __m128i alpha = _mm_set1_epi32(int(0xff000000));
+			for (; i + 16 <= pixel_count; i += 16)
+			{
+				const __m128i* in = reinterpret_cast<const __m128i*>(src + i * 3);
+				__m128i a = _mm_loadu_si128(in);
+				__m128i b = _mm_loadu_si128(in + 1);
+				__m128i c = _mm_loadu_si128(in + 2);
+				__m128i* out = reinterpret_cast<__m128i*>(dst + i * 4);
+				_mm_storeu_si128(out, _mm_or_si128(_mm_shuffle_epi8(a, shuffle), alpha));
+				_mm_storeu_si128(out + 1, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), shuffle), alpha));
+				_mm_storeu_si128(out + 2, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), shuffle), alpha));
+				_mm_storeu_si128(out + 3, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(c, 4), shuffle), alpha));
+			}
+		}
+#endif
+		for (; i < pixel_count; ++i)
+		{
+			dst[i * 4 + 0] = src[i * 3 + 0];
+			dst[i * 4 + 1] = src[i * 3 + 1];
+			dst[i * 4 + 2] = src[i * 3 + 2];
+			dst[i * 4 + 3] = 255;
+		}
+		return;
+	}
+
+	// 灰度 / 灰度 + alpha
+	for (; i < pixel_count; ++i)
+	{
+		uint8_t grey = src[i * channels];
+		dst[i * 4 + 0] = grey;
+		dst[i * 4 + 1] = grey;
+		dst[i * 4 + 2] = grey;
+		dst[i * 4 + 3] = channels == 2 ? src[i * 2 + 1] : 255;
+	}
+}
+
+void TextureStreamer::_build_mip_chain(uint8_t* pixels, const std::vector<MipLevel>& levels)
+{
+	// 2x2 盒式滤波（在编码空间平均），奇数边长时边缘的像素重复使用
+	for (size_t mip = 1; mip < levels.size(); ++mip)
+	{
+		const MipLevel& src = levels[mip - 1];
+		const MipLevel& dst = levels[mip];
+		const uint8_t* srcPixels = pixels + src.Offset;
+		uint8_t* dstPixels = pixels + dst.Offset;
+		for (uint32_t y = 0; y < dst.Height; ++y)
+		{
+			const uint8_t* row0 = srcPixels + size_t(std::min(y * 2, src.Height - 1)) * src.Width * 4;
+			const uint8_t* row1 = srcPixels + size_t(std::min(y * 2 + 1, src.Height - 1)) * src.Width * 4;
+			for (uint32_t x = 0; x < dst.Width; ++x)
+			{
+				uint32_t x0 = std::min(x * 2, src.Width - 1) * 4;
+				uint32_t x1 = std::min(x * 2 + 1, src.Width - 1) * 4;
+				for (uint32_t c = 0; c < 4; ++c)
+					dstPixels[(size_t(y) * dst.Width + x) * 4 + c] = uint8_t((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+			}
+		}
+	}
+}
+
+bool TextureStreamer::_create_source(VkDeviceSize size, SourceBuffer& source)
+{
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	// 上传的拷贝源，也是 GPU 生成的 mip 拷回的目标
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	// CPU 生成 mip 时要读回上一级，选带缓存的主机内存
+	VmaAllocationCreateInfo allocInfo{};
+	allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+	allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+	VmaAllocationInfo allocationInfo{};
+	if (VkResult result = vmaCreateBuffer(_allocator, &bufferInfo, &allocInfo, &source.Buffer, &source.Allocation, &allocationInfo))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "TextureStreamer : failed to create source buffer ({} bytes)! Error code: {}", size, int32_t(result));
+		source = SourceBuffer{};
+		return false;
+	}
+	MemoryTracker::Get().OnAllocate(source.Allocation, MemoryTracker::CATEGORY_STAGING);
+	source.Mapped = static_cast<uint8_t*>(allocationInfo.pMappedData);
+	source.Size = size;
+	return true;
+}
+
+void TextureStreamer::_destroy_source(SourceBuffer& source)
+{
+	if (!source.Buffer)
+		return;
+	MemoryTracker::Get().OnFree(source.Allocation);
+	vmaDestroyBuffer(_allocator, source.Buffer, source.Allocation);
+	source = SourceBuffer{};
+}
+
+void TextureStreamer::_receive_decoded()
+{
+	std::vector<DecodeResult> decoded;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		decoded.swap(_decoded);
+	}
+
+	for (auto& result : decoded)
+	{
+		Texture& texture = _textures[result.Texture];
+		if (texture.Released)
+		{
+			_destroy_source(result.Source);
+			continue;
+		}
+		if (result.Failed)
+		{
+			texture.State = STATE_FAILED;
+			++_stats.DecodeFailures;
+			continue;
+		}
+
+		texture.Source = result.Source;
+		texture.Levels = std::move(result.Levels);
+		if (result.Format != VK_FORMAT_UNDEFINED)
+			texture.Format = result.Format;
+		texture.TailMip = static_cast<uint32_t>(texture.Levels.size()) - 1;
+		for (uint32_t mip = 0; mip < texture.Levels.size(); ++mip)
+		{
+			if (std::max(texture.Levels[mip].Width, texture.Levels[mip].Height) <= INITIAL_MIP_SIZE)
+			{
+				texture.TailMip = mip;
+				break;
+			}
+		}
+		texture.DesiredMip = texture.TailMip;
+		texture.MipsPending = result.MipsOnGpu;
+		texture.State = STATE_DECODED;
+		++_stats.Decoded;
+	}
+}
+
+void TextureStreamer::_complete_batches()
+{
+	for (auto& batch : _batches)
+	{
+		if (!batch.InFlight || vkGetFenceStatus(_device, batch.Fence) != VK_SUCCESS)
+			continue;
+
+		vkResetFences(_device, 1, &batch.Fence);
+		// 之后录制的帧都使用新图像；被替换的图像等在途的帧结束后销毁
+		for (const Rebuild& rebuild : batch.Rebuilds)
+		{
+			Texture& texture = _textures[rebuild.Texture];
+			texture.PendingMip = UINT32_MAX;
+			if (texture.Released)
+			{
+				_retire(rebuild.Image, rebuild.View, rebuild.Allocation);
+				_destroy_source(texture.Source);
+				continue;
+			}
+			if (texture.Image)
+				_retire(texture.Image, texture.View, texture.Allocation);
+			texture.Image = rebuild.Image;
+			texture.View = rebuild.View;
+			texture.Allocation = rebuild.Allocation;
+			texture.ResidentMip = rebuild.Mip;
+			texture.State = STATE_RESIDENT;
+			if (_on_view_changed)
+				_on_view_changed(rebuild.Texture, texture.View);
+		}
+		batch.Rebuilds.clear();
+		batch.InFlight = false;
+	}
+}
+
+void TextureStreamer::_complete_mip_batches()
+{
+	for (size_t index = 0; index < _mip_batches.size(); ++index)
+	{
+		MipBatch& batch = _mip_batches[index];
+		if (!batch.InFlight || vkGetFenceStatus(_device, batch.Fence) != VK_SUCCESS)
+			continue;
+
+		vkResetFences(_device, 1, &batch.Fence);
+		_mip_generator.ResetSlot(static_cast<uint32_t>(index));
+		// 源缓冲里已是完整的 mip 链，之后按普通的上传流程处理
+		for (const MipJob& job : batch.Jobs)
+		{
+			_destroy_image(job.Image, VK_NULL_HANDLE, job.Allocation);
+			Texture& texture = _textures[job.Texture];
+			texture.MipsInFlight = false;
+			if (texture.Released)
+			{
+				_destroy_source(texture.Source);
+				continue;
+			}
+			texture.MipsPending = false;
+			++_stats.MipChainsGenerated;
+		}
+		batch.Jobs.clear();
+		batch.InFlight = false;
+	}
+}
+
+void TextureStreamer::_schedule_mip_generation()
+{
+	size_t slot = 0;
+	while (slot < _mip_batches.size() && _mip_batches[slot].InFlight)
+		++slot;
+	if (slot == _mip_batches.size())
+		return;
+	MipBatch& batch = _mip_batches[slot];
+
+	std::vector<TextureHandle> pending;
+	VkDeviceSize bytes = 0;
+	for (TextureHandle handle = 0; handle < _textures.size(); ++handle)
+	{
+		const Texture& texture = _textures[handle];
+		if (texture.Released || !texture.MipsPending || texture.MipsInFlight)
+			continue;
+		if (!pending.empty() && bytes + texture.Source.Size > _upload_bytes_per_frame)
+			break;
+		pending.push_back(handle);
+		bytes += texture.Source.Size;
+	}
+	if (pending.empty())
+		return;
+
+	TRACE_ZONE_DETAIL("TextureMipGeneration", "texture", std::format("{} textures, {} KB", pending.size(), bytes / 1024));
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkResetCommandBuffer(batch.CommandBuffer, 0);
+	if (vkBeginCommandBuffer(batch.CommandBuffer, &beginInfo) != VK_SUCCESS)
+		return;
+
+	// 临时图像只在图形队列上使用，生成完就销毁
+	std::vector<MipGenerator::Request> requests;
+	std::vector<VkImageMemoryBarrier> barriers;
+	for (TextureHandle handle : pending)
+	{
+		Texture& texture = _textures[handle];
+		uint32_t levelCount = static_cast<uint32_t>(texture.Levels.size());
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.flags = _mip_generator.GetImageFlags(texture.Format);
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = texture.Format;
+		imageInfo.extent = { texture.Levels[0].Width, texture.Levels[0].Height, 1 };
+		imageInfo.mipLevels = levelCount;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = _mip_generator.GetImageUsage(texture.Format) | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VmaAllocationCreateInfo allocInfo{};
+		allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+		VkImage image = VK_NULL_HANDLE;
+		VmaAllocation allocation = nullptr;
+		if (VkResult result = vmaCreateImage(_allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr))
+		{
+			// 显存不足时在渲染线程上生成，纹理照常可用
+			LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "TextureStreamer : failed to create mip image for {}, building mips on CPU! Error code: {}",
+				texture.Path, int32_t(result));
+			_build_mip_chain(texture.Source.Mapped, texture.Levels);
+			vmaFlushAllocation(_allocator, texture.Source.Allocation, 0, texture.Source.Size);
+			texture.MipsPending = false;
+			continue;
+		}
+		MemoryTracker::Get().OnAllocate(allocation, MemoryTracker::CATEGORY_TEXTURES);
+
+		texture.MipsInFlight = true;
+		batch.Jobs.push_back({ handle, image, allocation });
+		requests.push_back({ image, texture.Format, { texture.Levels[0].Width, texture.Levels[0].Height }, levelCount });
+
+		VkImageMemoryBarrier& barrier = barriers.emplace_back();
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	}
+
+	if (!batch.Jobs.empty())
+	{
+		vkCmdPipelineBarrier(batch.CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+			static_cast<uint32_t>(barriers.size()), barriers.data());
+		for (const MipJob& job : batch.Jobs)
+		{
+			const Texture& texture = _textures[job.Texture];
+			VkBufferImageCopy region{};
+			region.bufferOffset = texture.Levels[0].Offset;
+			region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			region.imageExtent = { texture.Levels[0].Width, texture.Levels[0].Height, 1 };
+			vkCmdCopyBufferToImage(batch.CommandBuffer, texture.Source.Buffer, job.Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+		}
+
+		_mip_generator.Record(batch.CommandBuffer, static_cast<uint32_t>(slot), requests,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+		// 生成的各级拷回源缓冲，上传与换入 mip 都从源缓冲读
+		for (const MipJob& job : batch.Jobs)
+		{
+			const Texture& texture = _textures[job.Texture];
+			std::vector<VkBufferImageCopy> regions(texture.Levels.size() - 1);
+			for (uint32_t level = 1; level < texture.Levels.size(); ++level)
+			{
+				VkBufferImageCopy& region = regions[level - 1];
+				region.bufferOffset = texture.Levels[level].Offset;
+				region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+				region.imageExtent = { texture.Levels[level].Width, texture.Levels[level].Height, 1 };
+			}
+			vkCmdCopyImageToBuffer(batch.CommandBuffer, job.Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture.Source.Buffer,
+				static_cast<uint32_t>(regions.size()), regions.data());
+		}
+	}
+	vkEndCommandBuffer(batch.CommandBuffer);
+	if (batch.Jobs.empty())
+		return;
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.CommandBuffer;
+	if (VkResult result = vkQueueSubmit(_graphics_queue, 1, &submitInfo, batch.Fence))
+	{
+		// 下一帧重试
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "TextureStreamer : failed to submit mip generation! Error code: {}", int32_t(result));
+		for (const MipJob& job : batch.Jobs)
+		{
+			_textures[job.Texture].MipsInFlight = false;
+			_destroy_image(job.Image, VK_NULL_HANDLE, job.Allocation);
+		}
+		batch.Jobs.clear();
+		_mip_generator.ResetSlot(static_cast<uint32_t>(slot));
+		return;
+	}
+	batch.InFlight = true;
+	++_stats.MipSubmits;
+}
+
+void TextureStreamer::_destroy_retired(bool all)
+{
+	auto iter = std::remove_if(_retired.begin(), _retired.end(), [this, all](const RetiredImage& retired) {
+		if (!all && _frame < retired.Frame)
+			return false;
+		_destroy_image(retired.Image, retired.View, retired.Allocation);
+		return true;
+		});
+	_retired.erase(iter, _retired.end());
+}
+
+void TextureStreamer::_update_desired_mips()
+{
+	// 上一帧没有请求过的纹理不再需要精细的 mip，预算紧张时最先被卸下
+	for (auto& texture : _textures)
+	{
+		if (texture.Released || texture.Levels.empty())
+			continue;
+
+		texture.DesiredMip = texture.TailMip;
+		if (texture.LastUsedFrame + 1 != _frame || texture.ScreenPixels <= 0.0f)
+			continue;
+
+		float ratio = float(std::max(texture.Levels[0].Width, texture.Levels[0].Height)) / texture.ScreenPixels;
+		uint32_t mip = ratio <= 1.0f ? 0 : uint32_t(std::floor(std::log2(ratio)));
+		texture.DesiredMip = std::min(mip, texture.TailMip);
+	}
+}
+
+void TextureStreamer::_plan_rebuild(UploadPlan& plan, TextureHandle handle, uint32_t mip)
+{
+	Texture& texture = _textures[handle];
+	uint32_t committed = _committed_mip(texture);
+	if (committed != UINT32_MAX)
+		_committed_bytes -= _chain_bytes(texture, committed);
+	_committed_bytes += _chain_bytes(texture, mip);
+	texture.PendingMip = mip;
+	plan.Rebuilds.emplace_back(handle, mip);
+	plan.Bytes += _chain_bytes(texture, mip);
+}
+
+bool TextureStreamer::_make_room(VkDeviceSize bytes, TextureHandle requester, UploadPlan& plan)
+{
+	uint64_t requesterUsed = requester != INVALID_TEXTURE ? _textures[requester].LastUsedFrame : UINT64_MAX;
+	while (_committed_bytes + bytes > _budget)
+	{
+		// 先挑常驻 mip 超过需要的，其次挑最久没有使用的；尾部的几级不卸下
+		TextureHandle victim = INVALID_TEXTURE;
+		bool victimOverResident = false;
+		for (TextureHandle handle = 0; handle < _textures.size(); ++handle)
+		{
+			const Texture& texture = _textures[handle];
+			if (handle == requester || texture.Released || texture.State != STATE_RESIDENT || texture.PendingMip != UINT32_MAX ||
+				texture.ResidentMip >= texture.TailMip)
+				continue;
+			bool overResident = texture.ResidentMip < texture.DesiredMip;
+			if (!overResident && texture.LastUsedFrame >= requesterUsed)
+				continue;
+			if (victim == INVALID_TEXTURE || (overResident && !victimOverResident) ||
+				(overResident == victimOverResident && texture.LastUsedFrame < _textures[victim].LastUsedFrame))
+			{
+				victim = handle;
+				victimOverResident = overResident;
+			}
+		}
+		if (victim == INVALID_TEXTURE)
+			return false;
+
+		_plan_rebuild(plan, victim, _textures[victim].ResidentMip + 1);
+		++_stats.MipsEvicted;
+	}
+	return true;
+}
+
+void TextureStreamer::_schedule_uploads()
+{
+	UploadBatch* batch = nullptr;
+	for (auto& candidate : _batches)
+	{
+		if (!candidate.InFlight)
+		{
+			batch = &candidate;
+			break;
+		}
+	}
+	if (!batch)
+		return;
+
+	UploadPlan plan;
+	// 预算被调低时先卸下多余的 mip
+	if (_committed_bytes > _budget)
+		_make_room(0, INVALID_TEXTURE, plan);
+
+	// 新解码的纹理只上传尾部的几级，不受预算限制（尾部很小，也不会被卸下）
+	for (TextureHandle handle = 0; handle < _textures.size(); ++handle)
+	{
+		const Texture& texture = _textures[handle];
+		if (texture.Released || texture.State != STATE_DECODED || texture.MipsPending || texture.PendingMip != UINT32_MAX)
+			continue;
+		if (!plan.Rebuilds.empty() && plan.Bytes + _chain_bytes(texture, texture.TailMip) > _upload_bytes_per_frame)
+			break;
+		_plan_rebuild(plan, handle, texture.TailMip);
+	}
+
+	// 换入：最近使用的优先，其次与需要的 mip 差得多的优先；每个纹理每次只换入一级
+	std::vector<TextureHandle> upgrades;
+	for (TextureHandle handle = 0; handle < _textures.size(); ++handle)
+	{
+		const Texture& texture = _textures[handle];
+		if (!texture.Released && texture.State == STATE_RESIDENT && texture.PendingMip == UINT32_MAX && texture.DesiredMip < texture.ResidentMip)
+			upgrades.push_back(handle);
+	}
+	std::sort(upgrades.begin(), upgrades.end(), [this](TextureHandle a, TextureHandle b) {
+		const Texture& left = _textures[a];
+		const Texture& right = _textures[b];
+		if (left.LastUsedFrame != right.LastUsedFrame)
+			return left.LastUsedFrame > right.LastUsedFrame;
+		return left.ResidentMip - left.DesiredMip > right.ResidentMip - right.DesiredMip;
+		});
+	for (TextureHandle handle : upgrades)
+	{
+		const Texture& texture = _textures[handle];
+		// 已被选为别的纹理腾出预算而卸下
+		if (texture.PendingMip != UINT32_MAX)
+			continue;
+		uint32_t mip = texture.ResidentMip - 1;
+		VkDeviceSize bytes = _chain_bytes(texture, mip);
+		if (!plan.Rebuilds.empty() && plan.Bytes + bytes > _upload_bytes_per_frame)
+			break;
+		if (!_make_room(bytes - _chain_bytes(texture, texture.ResidentMip), handle, plan))
+			break;
+		_plan_rebuild(plan, handle, mip);
+		++_stats.MipsStreamedIn;
+	}
+
+	if (plan.Rebuilds.empty())
+		return;
+
+	TRACE_ZONE_DETAIL("TextureUpload", "memory", std::format("{} textures, {} KB", plan.Rebuilds.size(), plan.Bytes / 1024));
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkResetCommandBuffer(batch->CommandBuffer, 0);
+	bool recorded = vkBeginCommandBuffer(batch->CommandBuffer, &beginInfo) == VK_SUCCESS;
+
+	bool failed = !recorded;
+	VkDeviceSize uploadedBytes = 0;
+	for (const auto& [handle, mip] : plan.Rebuilds)
+	{
+		if (!recorded || !_record_rebuild(*batch, handle, mip))
+		{
+			_textures[handle].PendingMip = UINT32_MAX;
+			failed = true;
+			continue;
+		}
+		uploadedBytes += _chain_bytes(_textures[handle], mip);
+	}
+
+	if (recorded)
+	{
+		vkEndCommandBuffer(batch->CommandBuffer);
+		if (!batch->Rebuilds.empty())
+		{
+			VkSubmitInfo submitInfo{};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &batch->CommandBuffer;
+			if (VkResult result = vkQueueSubmit(_queue, 1, &submitInfo, batch->Fence))
+			{
+				LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "TextureStreamer : failed to submit uploads! Error code: {}", int32_t(result));
+				for (const Rebuild& rebuild : batch->Rebuilds)
+				{
+					_textures[rebuild.Texture].PendingMip = UINT32_MAX;
+					_destroy_image(rebuild.Image, rebuild.View, rebuild.Allocation);
+				}
+				batch->Rebuilds.clear();
+				failed = true;
+			}
+			else
+			{
+				batch->InFlight = true;
+				++_stats.Submits;
+				_stats.Uploads += batch->Rebuilds.size();
+				_stats.UploadedBytes += uploadedBytes;
+			}
+		}
+	}
+
+	// 有上传没能录制时按实际常驻的 mip 重新计算预算占用
+	if (failed)
+	{
+		_committed_bytes = 0;
+		for (const auto& texture : _textures)
+		{
+			uint32_t committed = _committed_mip(texture);
+			if (!texture.Released && committed != UINT32_MAX)
+				_committed_bytes += _chain_bytes(texture, committed);
+		}
+	}
+}
+
+bool TextureStreamer::_record_rebuild(UploadBatch& batch, TextureHandle handle, uint32_t mip)
+{
+	const Texture& texture = _textures[handle];
+	const MipLevel& top = texture.Levels[mip];
+	uint32_t levelCount = static_cast<uint32_t>(texture.Levels.size()) - mip;
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = texture.Format;
+	imageInfo.extent = { top.Width, top.Height, 1 };
+	imageInfo.mipLevels = levelCount;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	// 在传输队列上上传、在图形队列上采样，共享免去队列族所有权转移
+	std::array<uint32_t, 2> sharedFamilies = { _queue_family_index, _graphics_family_index };
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (_queue_family_index != _graphics_family_index)
+	{
+		imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(sharedFamilies.size());
+		imageInfo.pQueueFamilyIndices = sharedFamilies.data();
+	}
+
+	VmaAllocationCreateInfo allocInfo{};
+	allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+	VkImage image = VK_NULL_HANDLE;
+	VmaAllocation allocation = nullptr;
+	if (VkResult result = vmaCreateImage(_allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "TextureStreamer : failed to create image for {} (mip {})! Error code: {}", texture.Path, mip, int32_t(result));
+		return false;
+	}
+	MemoryTracker::Get().OnAllocate(allocation, MemoryTracker::CATEGORY_TEXTURES);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = texture.Format;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+	VkImageView view = VK_NULL_HANDLE;
+	if (VkResult result = vkCreateImageView(_device, &viewInfo, nullptr, &view))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "TextureStreamer : failed to create image view for {}! Error code: {}", texture.Path, int32_t(result));
+		_destroy_image(image, VK_NULL_HANDLE, allocation);
+		return false;
+	}
+
+	std::vector<VkBufferImageCopy> regions(levelCount);
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		const MipLevel& source = texture.Levels[mip + level];
+		VkBufferImageCopy& region = regions[level];
+		region.bufferOffset = source.Offset;
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+		region.imageExtent = { source.Width, source.Height, 1 };
+	}
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = viewInfo.subresourceRange;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(batch.CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	vkCmdCopyBufferToImage(batch.CommandBuffer, texture.Source.Buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levelCount, regions.data());
+
+	// 使用这个图像的帧在围栏发出信号之后才录制，这里只做布局转换
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	vkCmdPipelineBarrier(batch.CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	batch.Rebuilds.push_back({ handle, mip, image, view, allocation });
+	return true;
+}
+
+void TextureStreamer::_retire(VkImage image, VkImageView view, VmaAllocation allocation)
+{
+	_retired.push_back({ image, view, allocation, _frame + _frames_in_flight });
+}
+
+void TextureStreamer::_destroy_image(VkImage image, VkImageView view, VmaAllocation allocation)
+{
+	if (view)
+		vkDestroyImageView(_device, view, nullptr);
+	if (image)
+	{
+		MemoryTracker::Get().OnFree(allocation);
+		vmaDestroyImage(_allocator, image, allocation);
+	}
+}
+
+VkDeviceSize TextureStreamer::_chain_bytes(const Texture& texture, uint32_t mip)
+{
+	if (mip >= texture.Levels.size())
+		return 0;
+	const MipLevel& last = texture.Levels.back();
+	return last.Offset + last.Size - texture.Levels[mip].Offset;
+}
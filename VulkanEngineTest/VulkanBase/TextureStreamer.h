@@ -0,0 +1,327 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "MipGenerator.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+typedef struct VmaAllocator_T* VmaAllocator;
+typedef struct VmaAllocation_T* VmaAllocation;
+
+/// <summary>
+/// 纹理流式加载。Load 把解码交给工作线程：stb_image 按原始通道数解码，工作线程在主机可见、持久映射的源缓冲里预留完整 mip 链的空间，
+/// 把像素直接展开成 RGBA8 写进去（RGB 用 SSSE3 展开）；其余各级由 MipGenerator 在图形队列上生成（多个纹理合并成一次提交），
+/// 生成结果拷回源缓冲，GPU 不能生成的格式仍在工作线程上用 2x2 盒式滤波生成。烘焙好的 .ktx2（块压缩、mip 预先生成）映射文件后直接拷进源缓冲，不解码也不生成 mip。
+/// 上传直接从源缓冲拷贝到图像，不再经过单独的 staging；
+/// 渲染线程每帧 Update 一次：新解码的纹理先只上传边长不超过 INITIAL_MIP_SIZE 的几级 mip，尽快可用；
+/// 之后按 RequestScreenSize 给出的屏幕尺寸每次换入一级更精细的 mip，常驻显存不超过预算，超出时先从最久没有使用的纹理上卸下最精细的 mip。
+/// 没有稀疏绑定，换入 / 卸下 mip 都是新建一个只包含常驻 mip 的图像，从源缓冲重新上传，旧图像等引用它的帧都结束后才销毁。
+/// 上传在传输队列（没有专用传输队列族时即图形队列）上单独提交并用围栏异步等待，不阻塞渲染。
+/// 除工作线程外，所有接口只能在渲染线程上调用
+/// </summary>
+class TextureStreamer
+{
+public:
+	using TextureHandle = uint32_t;
+	static constexpr TextureHandle INVALID_TEXTURE = UINT32_MAX;
+
+	// 首次上传时常驻的最精细 mip 的边长上限
+	static constexpr uint32_t INITIAL_MIP_SIZE = 64;
+	static constexpr VkDeviceSize DEFAULT_BUDGET = 256ull * 1024 * 1024;
+	// 每帧提交的上传字节数上限（至少上传一个纹理，单个纹理超出时也会提交）
+	static constexpr VkDeviceSize DEFAULT_UPLOAD_BYTES_PER_FRAME = 16ull * 1024 * 1024;
+	// 同时在途的上传批次
+	static constexpr uint32_t MAX_UPLOAD_BATCHES = 2;
+	static constexpr uint32_t MAX_WORKERS = 4;
+
+	enum TextureState : uint32_t
+	{
+		STATE_DECODING = 0,
+		STATE_DECODED,
+		STATE_RESIDENT,
+		STATE_FAILED,
+	};
+
+	struct Stats
+	{
+		uint32_t Textures = 0;
+		uint32_t PendingDecodes = 0;
+		// 各纹理常驻 mip 的字节数之和（按像素数据计，不含对齐）
+		VkDeviceSize ResidentBytes = 0;
+		VkDeviceSize Budget = 0;
+		// 源缓冲（主机内存）里的 mip 链
+		VkDeviceSize SourceBytes = 0;
+		uint64_t Decoded = 0;
+		uint64_t DecodeFailures = 0;
+		uint64_t Uploads = 0;
+		uint64_t UploadedBytes = 0;
+		uint64_t Submits = 0;
+		uint64_t MipsStreamedIn = 0;
+		uint64_t MipsEvicted = 0;
+		// 在 GPU 上生成 mip 链的纹理数与提交次数
+		uint64_t MipChainsGenerated = 0;
+		uint64_t MipSubmits = 0;
+		// 累计解码耗时（各工作线程之和）
+		double DecodeMs = 0.0;
+	};
+
+	/// <summary>
+	/// 纹理换成新的图像视图时调用（首次可用、换入或卸下 mip），持有描述符的一方据此更新描述符；Release 时 view 为 VK_NULL_HANDLE
+	/// </summary>
+	using ViewChangedCallback = std::function<void(TextureHandle texture, VkImageView view)>;
+
+	TextureStreamer() = default;
+	~TextureStreamer() = default;
+
+	/// <summary>
+	/// queue_family_index 为上传队列的队列族，与 graphics_family_index 不同时图像在两个队列族之间共享。
+	/// graphics_queue 用于生成 mip（blit 与计算都不能在专用传输队列上执行），mip_shader_path 为计算路径的着色器。worker_count 为 0 时按硬件线程数选择
+	/// </summary>
+	bool Init(VkPhysicalDevice physical_device, VkDevice device, VmaAllocator allocator, VkQueue queue, uint32_t queue_family_index,
+		VkQueue graphics_queue, uint32_t graphics_family_index, const std::string& mip_shader_path, uint32_t frames_in_flight, uint32_t worker_count = 0);
+	/// <summary>
+	/// 需在 GPU 空闲后调用：停止工作线程（未开始的解码直接丢弃），等待在途的上传并销毁所有纹理
+	/// </summary>
+	void CleanUp();
+
+	/// <summary>
+	/// 异步加载，立即返回句柄；解码失败时状态为 STATE_FAILED。srgb 为 true 时按 sRGB 格式采样（颜色贴图），否则按 UNORM（法线、粗糙度等）。
+	/// .ktx2 文件使用文件里的格式（忽略 srgb），设备不支持该格式时同样为 STATE_FAILED
+	/// </summary>
+	TextureHandle Load(const std::string& path, bool srgb = true);
+	/// <summary>
+	/// 释放纹理，图像在引用它的帧结束后销毁；句柄之后不再有效
+	/// </summary>
+	void Release(TextureHandle texture);
+
+	/// <summary>
+	/// 本帧纹理在屏幕上覆盖的大致像素边长，同一帧多次调用取最大值。需要的 mip = log2(纹理边长 / 屏幕边长)，
+	/// 同时记为本帧使用过（LRU 淘汰依据）。上一帧没有调用过的纹理不再换入，预算紧张时最先被卸下
+	/// </summary>
+	void RequestScreenSize(TextureHandle texture, float screen_pixels);
+	/// <summary>
+	/// 每帧调用一次（该帧围栏等待之后）：完成上传的纹理换上新图像，接收解码结果，按预算提交新的上传
+	/// </summary>
+	void Update();
+
+	TextureState GetState(TextureHandle texture) const;
+	/// <summary>
+	/// 当前的图像视图，还没有常驻 mip 时为 VK_NULL_HANDLE。视图的第 0 级是完整 mip 链中的第 GetResidentMip 级
+	/// </summary>
+	VkImageView GetImageView(TextureHandle texture) const;
+	uint32_t GetResidentMip(TextureHandle texture) const;
+	uint32_t GetMipCount(TextureHandle texture) const;
+	VkExtent2D GetExtent(TextureHandle texture) const;
+
+	void SetBudget(VkDeviceSize bytes) { _budget = bytes; }
+	VkDeviceSize GetBudget() const { return _budget; }
+	void SetUploadBytesPerFrame(VkDeviceSize bytes) { _upload_bytes_per_frame = bytes; }
+	void SetOnViewChanged(ViewChangedCallback callback) { _on_view_changed = std::move(callback); }
+
+	/// <summary>
+	/// 没有在解码或上传的纹理，且预算内没有需要换入的 mip
+	/// </summary>
+	bool IsIdle() const;
+	Stats GetStats() const;
+	/// <summary>
+	/// 设备能否采样该格式（最优平铺），用于选择烘焙纹理的格式。可在任意线程调用
+	/// </summary>
+	bool IsFormatSupported(VkFormat format) const;
+
+private:
+	struct MipLevel
+	{
+		VkDeviceSize Offset = 0;
+		VkDeviceSize Size = 0;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+	};
+
+	struct DecodeJob
+	{
+		TextureHandle Texture = INVALID_TEXTURE;
+		std::string Path;
+		VkFormat Format = VK_FORMAT_UNDEFINED;
+	};
+
+	// 主机可见、持久映射的源缓冲，保存完整的 mip 链，上传时作为拷贝源
+	struct SourceBuffer
+	{
+		VkBuffer Buffer = VK_NULL_HANDLE;
+		VmaAllocation Allocation = nullptr;
+		uint8_t* Mapped = nullptr;
+		VkDeviceSize Size = 0;
+	};
+
+	struct DecodeResult
+	{
+		TextureHandle Texture = INVALID_TEXTURE;
+		bool Failed = false;
+		// 源缓冲里只有第 0 级，其余各级交给 GPU 生成
+		bool MipsOnGpu = false;
+		// 文件自带的格式（.ktx2），图片解码时为 VK_FORMAT_UNDEFINED
+		VkFormat Format = VK_FORMAT_UNDEFINED;
+		SourceBuffer Source;
+		std::vector<MipLevel> Levels;
+	};
+
+	struct Texture
+	{
+		std::string Path;
+		VkFormat Format = VK_FORMAT_R8G8B8A8_SRGB;
+		TextureState State = STATE_DECODING;
+		bool Released = false;
+
+		// 完整的 mip 链，第 0 级最精细
+		SourceBuffer Source;
+		std::vector<MipLevel> Levels;
+		// 首次上传的 mip（边长不超过 INITIAL_MIP_SIZE 的最精细一级）
+		uint32_t TailMip = 0;
+		// 源缓冲里还只有第 0 级，生成完之前不上传；MipsInFlight 为生成已提交
+		bool MipsPending = false;
+		bool MipsInFlight = false;
+
+		VkImage Image = VK_NULL_HANDLE;
+		VkImageView View = VK_NULL_HANDLE;
+		VmaAllocation Allocation = nullptr;
+		uint32_t ResidentMip = UINT32_MAX;
+		// 上传中的图像将要常驻的 mip，没有在途上传时为 UINT32_MAX
+		uint32_t PendingMip = UINT32_MAX;
+
+		uint32_t DesiredMip = UINT32_MAX;
+		float ScreenPixels = 0.0f;
+		uint64_t LastUsedFrame = 0;
+	};
+
+	// 一次提交里新建的图像，上传完成后换到纹理上
+	struct Rebuild
+	{
+		TextureHandle Texture;
+		uint32_t Mip;
+		VkImage Image;
+		VkImageView View;
+		VmaAllocation Allocation;
+	};
+
+	struct UploadBatch
+	{
+		VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+		VkFence Fence = VK_NULL_HANDLE;
+		bool InFlight = false;
+		std::vector<Rebuild> Rebuilds;
+	};
+
+	// 一次提交里生成 mip 的纹理：临时图像保存完整 mip 链，生成后拷回源缓冲，完成时销毁
+	struct MipJob
+	{
+		TextureHandle Texture;
+		VkImage Image;
+		VmaAllocation Allocation;
+	};
+
+	struct MipBatch
+	{
+		VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+		VkFence Fence = VK_NULL_HANDLE;
+		bool InFlight = false;
+		std::vector<MipJob> Jobs;
+	};
+
+	// 本帧要提交的上传：(纹理, 上传后常驻的 mip) 与拷贝的字节数
+	struct UploadPlan
+	{
+		std::vector<std::pair<TextureHandle, uint32_t>> Rebuilds;
+		VkDeviceSize Bytes = 0;
+	};
+
+	struct RetiredImage
+	{
+		VkImage Image;
+		VkImageView View;
+		VmaAllocation Allocation;
+		uint64_t Frame;
+	};
+
+	void _worker(uint32_t index);
+	bool _decode(const std::string& path, DecodeResult& result);
+	/// <summary>
+	/// 映射 .ktx2 文件，各级数据按 KTX2_LEVEL_ALIGNMENT 对齐拷进源缓冲
+	/// </summary>
+	bool _load_ktx2(const std::string& path, DecodeResult& result);
+	/// <summary>
+	/// 1 ~ 4 通道的 8 位像素展开成 RGBA8，缺少的颜色通道复制灰度，缺少的 alpha 为 255
+	/// </summary>
+	static void _expand_to_rgba(const uint8_t* src, uint32_t channels, uint8_t* dst, size_t pixel_count);
+	static void _build_mip_chain(uint8_t* pixels, const std::vector<MipLevel>& levels);
+	// 可在工作线程上调用（VMA 与 MemoryTracker 都是线程安全的）
+	bool _create_source(VkDeviceSize size, SourceBuffer& source);
+	void _destroy_source(SourceBuffer& source);
+
+	void _receive_decoded();
+	void _complete_batches();
+	void _complete_mip_batches();
+	/// <summary>
+	/// 把等待生成 mip 的纹理合并进一个命令缓冲：拷贝第 0 级到临时图像，MipGenerator 生成其余各级，再拷回源缓冲
+	/// </summary>
+	void _schedule_mip_generation();
+	void _destroy_retired(bool all);
+	void _update_desired_mips();
+	void _schedule_uploads();
+	void _plan_rebuild(UploadPlan& plan, TextureHandle handle, uint32_t mip);
+	/// <summary>
+	/// 为 requester 换入 bytes 字节腾出预算：从比它更久没有使用（或常驻 mip 超过需要）的纹理上卸下最精细的 mip，卸下也是一次重建，加入 plan
+	/// </summary>
+	bool _make_room(VkDeviceSize bytes, TextureHandle requester, UploadPlan& plan);
+	bool _record_rebuild(UploadBatch& batch, TextureHandle handle, uint32_t mip);
+	void _retire(VkImage image, VkImageView view, VmaAllocation allocation);
+	void _destroy_image(VkImage image, VkImageView view, VmaAllocation allocation);
+	// mip 及更粗的各级的字节数之和
+	static VkDeviceSize _chain_bytes(const Texture& texture, uint32_t mip);
+	// 常驻（或上传中将要常驻）的 mip
+	static uint32_t _committed_mip(const Texture& texture) { return texture.PendingMip != UINT32_MAX ? texture.PendingMip : texture.ResidentMip; }
+
+private:
+	VkPhysicalDevice _physical_device = VK_NULL_HANDLE;
+	VkDevice _device = VK_NULL_HANDLE;
+	VmaAllocator _allocator = nullptr;
+	VkQueue _queue = VK_NULL_HANDLE;
+	uint32_t _queue_family_index = 0;
+	uint32_t _graphics_family_index = 0;
+	uint32_t _frames_in_flight = 2;
+	VkCommandPool _command_pool = VK_NULL_HANDLE;
+	std::vector<UploadBatch> _batches;
+
+	VkQueue _graphics_queue = VK_NULL_HANDLE;
+	VkCommandPool _graphics_command_pool = VK_NULL_HANDLE;
+	std::vector<MipBatch> _mip_batches;
+	MipGenerator _mip_generator;
+
+	VkDeviceSize _budget = DEFAULT_BUDGET;
+	VkDeviceSize _upload_bytes_per_frame = DEFAULT_UPLOAD_BYTES_PER_FRAME;
+	// 各纹理常驻或上传中将要常驻的 mip 的字节数之和，预算按它计算
+	VkDeviceSize _committed_bytes = 0;
+	uint64_t _frame = 0;
+
+	std::vector<Texture> _textures;
+	std::vector<RetiredImage> _retired;
+	ViewChangedCallback _on_view_changed;
+	Stats _stats;
+
+	std::vector<std::thread> _workers;
+	mutable std::mutex _mutex;
+	std::condition_variable _wake;
+	bool _shutdown = false;
+	std::deque<DecodeJob> _jobs;
+	std::vector<DecodeResult> _decoded;
+	uint32_t _pending_decodes = 0;
+	double _decode_ms = 0.0;
+};
@@ -0,0 +1,225 @@
+﻿#include "Tracer.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <format>
+
+////////////////////////// ThreadBuffer ////////////////////////////////////////////
+
+void Tracer::ThreadBuffer::Push(const Event& event)
+{
+	uint64_t head = Head.load(std::memory_order_relaxed);
+	Events[head % RING_CAPACITY] = event;
+	Head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::ThreadBuffer::Snapshot(std::vector<Event>& out) const
+{
+	uint64_t head = Head.load(std::memory_order_acquire);
+	uint64_t begin = head > RING_CAPACITY ? head - RING_CAPACITY : 0;
+
+	size_t first = out.size();
+	for (uint64_t i = begin; i < head; ++i)
+	{
+		out.push_back(Events[i % RING_CAPACITY]);
+	}
+
+	// 拷贝期间生产者可能已经绕回并覆盖了最旧的几个槽位
+	uint64_t headAfter = Head.load(std::memory_order_acquire);
+	if (headAfter >= RING_CAPACITY && headAfter - RING_CAPACITY + 1 > begin)
+	{
+		uint64_t dropped = std::min<uint64_t>(headAfter - RING_CAPACITY + 1 - begin, head - begin);
+		out.erase(out.begin() + first, out.begin() + first + size_t(dropped));
+	}
+}
+
+////////////////////////// ScopedZone ////////////////////////////////////////////
+
+Tracer::ScopedZone::ScopedZone(const char* name, const char* category, const char* detail)
+	: _name(name)
+	, _category(category)
+	, _detail{}
+	, _begin_ns(Tracer::NowNs())
+{
+	// 拷贝一份，调用方传入的可能是临时字符串
+	if (detail)
+		strncpy_s(_detail, DETAIL_LENGTH, detail, _TRUNCATE);
+}
+
+Tracer::ScopedZone::~ScopedZone()
+{
+	Tracer::Get().RecordCpu(_name, _category, _begin_ns, Tracer::NowNs(), _detail[0] ? _detail : nullptr);
+}
+
+////////////////////////// Tracer ////////////////////////////////////////////
+
+Tracer& Tracer::Get()
+{
+	static Tracer tracer;
+	return tracer;
+}
+
+uint64_t Tracer::NowNs()
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+Tracer::ThreadBuffer& Tracer::_local_buffer()
+{
+	thread_local std::shared_ptr<ThreadBuffer> buffer;
+	if (!buffer)
+	{
+		buffer = std::make_shared<ThreadBuffer>();
+		std::lock_guard<std::mutex> lock(_registry_mutex);
+		buffer->ThreadId = _next_thread_id++;
+		buffer->ThreadName = std::format("Thread {}", buffer->ThreadId);
+		// 注册表持有一份引用，线程退出后事件仍可导出
+		_buffers.push_back(buffer);
+	}
+	return *buffer;
+}
+
+void Tracer::SetThreadName(const std::string& name)
+{
+	auto& buffer = _local_buffer();
+	std::lock_guard<std::mutex> lock(_registry_mutex);
+	buffer.ThreadName = name;
+}
+
+void Tracer::RecordCpu(const char* name, const char* category, uint64_t begin_ns, uint64_t end_ns, const char* detail)
+{
+	if (!IsEnabled())
+		return;
+
+	Event event;
+	event.Name = name;
+	event.Category = category;
+	event.BeginNs = begin_ns;
+	event.EndNs = end_ns;
+	if (detail)
+	{
+		strncpy_s(event.Detail, DETAIL_LENGTH, detail, _TRUNCATE);
+	}
+	_local_buffer().Push(event);
+}
+
+void Tracer::RecordGpu(const char* name, uint64_t begin_ns, uint64_t end_ns)
+{
+	if (!IsEnabled())
+		return;
+
+	Event event;
+	event.Name = name;
+	event.Category = "gpu";
+	event.BeginNs = begin_ns;
+	event.EndNs = end_ns;
+	_gpu_buffer.Push(event);
+}
+
+static std::string EscapeJson(const char* text)
+{
+	std::string escaped;
+	for (const char* c = text; c && *c; ++c)
+	{
+		switch (*c)
+		{
+		case '"':	escaped += "\\\""; break;
+		case '\\':	escaped += "\\\\"; break;
+		case '\n':	escaped += "\\n"; break;
+		case '\t':	escaped += "\\t"; break;
+		default:
+			if ((unsigned char)*c >= 0x20)
+				escaped += *c;
+			break;
+		}
+	}
+	return escaped;
+}
+
+std::string Tracer::ToChromeJson()
+{
+	struct ThreadEvents
+	{
+		uint32_t ThreadId;
+		std::string ThreadName;
+		std::vector<Event> Events;
+	};
+	std::vector<ThreadEvents> threads;
+	{
+		std::lock_guard<std::mutex> lock(_registry_mutex);
+		for (auto& buffer : _buffers)
+		{
+			auto& thread = threads.emplace_back();
+			thread.ThreadId = buffer->ThreadId;
+			thread.ThreadName = buffer->ThreadName;
+			buffer->Snapshot(thread.Events);
+		}
+	}
+	{
+		auto& thread = threads.emplace_back();
+		thread.ThreadId = GPU_THREAD_ID;
+		thread.ThreadName = "GPU Graphics Queue";
+		_gpu_buffer.Snapshot(thread.Events);
+	}
+
+	// 以最早的事件作为时间原点，避免 JSON 中出现过大的时间戳
+	uint64_t origin = UINT64_MAX;
+	for (auto& thread : threads)
+		for (auto& event : thread.Events)
+			origin = std::min(origin, event.BeginNs);
+	if (origin == UINT64_MAX)
+		origin = 0;
+
+	std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	auto append = [&json, &first](const std::string& line) {
+		if (!first) json += ",\n";
+		json += line;
+		first = false;
+		};
+
+	for (auto& thread : threads)
+	{
+		append(std::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+			thread.ThreadId, EscapeJson(thread.ThreadName.c_str())));
+		for (auto& event : thread.Events)
+		{
+			double ts = double(event.BeginNs - origin) / 1000.0;
+			double dur = double(event.EndNs > event.BeginNs ? event.EndNs - event.BeginNs : 0) / 1000.0;
+			std::string line = std::format("{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}",
+				EscapeJson(event.Name), EscapeJson(event.Category), thread.ThreadId, ts, dur);
+			if (event.Detail[0])
+			{
+				line += std::format(",\"args\":{{\"detail\":\"{}\"}}", EscapeJson(event.Detail));
+			}
+			line += "}";
+			append(line);
+		}
+	}
+	json += "\n]}\n";
+	return json;
+}
+
+bool Tracer::ExportChromeJson(const std::string& path)
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open())
+	{
+		LOG_ERROR(LOG_CATEGORY_PROFILER, "failed to open file : {}", path);
+		return false;
+	}
+	file << ToChromeJson();
+	LOG_INFO(LOG_CATEGORY_PROFILER, "trace written to : {}", path);
+	return bool(file);
+}
+
+void Tracer::Clear()
+{
+	std::lock_guard<std::mutex> lock(_registry_mutex);
+	for (auto& buffer : _buffers)
+		buffer->Head.store(0, std::memory_order_release);
+	_gpu_buffer.Head.store(0, std::memory_order_release);
+}
@@ -0,0 +1,102 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// 事件追踪：CPU 区间（zone）写入线程局部的环形缓冲区，GPU 时间戳区间由 GpuProfiler 换算到 CPU 时钟后写入同一处，
+/// 导出为 Chrome trace JSON（chrome://tracing 与 ui.perfetto.dev 均可直接打开），在一条时间线上查看 CPU/GPU 的空泡与同步等待。
+/// 所有时间以 std::chrono::steady_clock 的纳秒计。
+/// </summary>
+class Tracer
+{
+public:
+	static constexpr uint32_t RING_CAPACITY = 1u << 16; // 每个线程保留最近 65536 个事件
+	static constexpr uint32_t DETAIL_LENGTH = 48;
+	static constexpr uint32_t GPU_THREAD_ID = 0xFFFF;
+
+	struct Event
+	{
+		const char* Name = nullptr;		// 必须是静态字符串
+		const char* Category = nullptr;	// 必须是静态字符串
+		uint64_t BeginNs = 0;
+		uint64_t EndNs = 0;
+		char Detail[DETAIL_LENGTH] = {};	// 可选的动态附加信息（截断）
+	};
+
+	class ScopedZone
+	{
+	public:
+		ScopedZone(const char* name, const char* category = "cpu", const char* detail = nullptr);
+		ScopedZone(const char* name, const char* category, const std::string& detail)
+			: ScopedZone(name, category, detail.c_str()) {}
+		~ScopedZone();
+
+		ScopedZone(const ScopedZone&) = delete;
+		ScopedZone& operator=(const ScopedZone&) = delete;
+
+	private:
+		const char* _name;
+		const char* _category;
+		char _detail[DETAIL_LENGTH];
+		uint64_t _begin_ns;
+	};
+
+	static Tracer& Get();
+	static uint64_t NowNs();
+
+	void SetEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+	bool IsEnabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+	/// <summary>
+	/// 给当前线程命名（显示在时间线上）
+	/// </summary>
+	void SetThreadName(const std::string& name);
+
+	void RecordCpu(const char* name, const char* category, uint64_t begin_ns, uint64_t end_ns, const char* detail = nullptr);
+	/// <summary>
+	/// begin_ns / end_ns 必须已换算到 CPU 时钟
+	/// </summary>
+	void RecordGpu(const char* name, uint64_t begin_ns, uint64_t end_ns);
+
+	std::string ToChromeJson();
+	bool ExportChromeJson(const std::string& path);
+	// 仅在没有线程写入时调用
+	void Clear();
+
+private:
+	Tracer() = default;
+
+	struct ThreadBuffer
+	{
+		std::unique_ptr<Event[]> Events{ new Event[RING_CAPACITY] };
+		std::atomic<uint64_t> Head{ 0 };		// 单生产者写入，导出线程只读
+		uint32_t ThreadId = 0;
+		std::string ThreadName;
+
+		void Push(const Event& event);
+		// 拷贝出当前有效的事件；拷贝过程中被覆盖的事件会被丢弃
+		void Snapshot(std::vector<Event>& out) const;
+	};
+
+	ThreadBuffer& _local_buffer();
+
+private:
+	std::atomic<bool> _enabled{ true };
+
+	std::mutex _registry_mutex;
+	std::vector<std::shared_ptr<ThreadBuffer>> _buffers;
+	uint32_t _next_thread_id = 1;
+
+	// GPU 事件只由渲染线程在回收查询结果时写入
+	ThreadBuffer _gpu_buffer;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_ZONE(name) Tracer::ScopedZone TRACE_CONCAT(_trace_zone_, __COUNTER__)(name)
+#define TRACE_ZONE_DETAIL(name, category, detail) Tracer::ScopedZone TRACE_CONCAT(_trace_zone_, __COUNTER__)(name, category, detail)
@@ -7,8 +7,11 @@
 #include <vulkan/vulkan.h>
 
 #include <array>
+#include <cstddef>
 #include <glm/glm.hpp>
 
+#include "VertexLayout.h"
+
 struct Vertex
 {
     glm::vec2 position;
@@ -16,14 +19,13 @@ struct Vertex
 
     //  VK_VERTEX_INPUT_RATE_VERTEX：    在每个顶点之后移动到下一个数据条目
     //  VK_VERTEX_INPUT_RATE_INSTANCE    每次实例完成后，移至下一个数据条目
+    using Layout = VertexLayout<
+        VertexAttribute<0, VertexFormat::Float2>,
+        VertexAttribute<1, VertexFormat::Float3>>;
+
     static VkVertexInputBindingDescription getBindingDescription()
     {
-        VkVertexInputBindingDescription bindingDescription{};
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(Vertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-        return bindingDescription;
+        return Layout::getBindingDescription();
     }
 
     /*float：VK_FORMAT_R32_SFLOAT
@@ -35,17 +37,67 @@ struct Vertex
     double：VK_FORMAT_R64_SFLOAT，双精度（64 位）浮点数*/
     static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions()
     {
-        std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(Vertex, position);
-
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-        return attributeDescriptions;
+        return Layout::getAttributeDescriptions();
     }
 };
+
+static_assert(offsetof(Vertex, color) == Vertex::Layout::OFFSETS[1] && sizeof(Vertex) == Vertex::Layout::STRIDE);
+
+/// <summary>
+/// 压缩顶点：半精度位置（w = 1）+ RGBA8 颜色，12 字节（Vertex 为 20 字节）
+/// </summary>
+using PackedVertexLayout = VertexLayout<
+    VertexAttribute<0, VertexFormat::Half4>,
+    VertexAttribute<1, VertexFormat::UNorm8x4>>;
+using PackedVertex = PackedVertexLayout::Vertex;
+
+inline PackedVertex PackVertex(const Vertex& vertex)
+{
+    PackedVertex packed;
+    packed.Set<0>(EncodeHalf4(glm::vec4(vertex.position, 0.0f, 1.0f)));
+    packed.Set<1>(EncodeUNorm8x4(glm::vec4(vertex.color, 1.0f)));
+    return packed;
+}
+
+/// <summary>
+/// 分离的顶点流：位置单独一个流（binding 0），其余属性在另一个流（binding 1）。
+/// 只需要位置的 pass（深度预通道、阴影、剔除）使用 PositionOnlyStreams，只读取 8 字节 / 顶点
+/// </summary>
+using PositionStreamLayout = VertexLayout<
+    VertexAttribute<0, VertexFormat::Half4>>;
+using AttributeStreamLayout = VertexLayout<
+    VertexAttribute<1, VertexFormat::UNorm8x4>>;
+using SplitVertexStreams = VertexStreams<PositionStreamLayout, AttributeStreamLayout>;
+using PositionOnlyStreams = VertexStreams<PositionStreamLayout>;
+
+inline void SplitVertex(const Vertex& vertex, PositionStreamLayout::Vertex& position, AttributeStreamLayout::Vertex& attributes)
+{
+    position.Set<0>(EncodeHalf4(glm::vec4(vertex.position, 0.0f, 1.0f)));
+    attributes.Set<0>(EncodeUNorm8x4(glm::vec4(vertex.color, 1.0f)));
+}
+
+/// <summary>
+/// 实例流（按实例步进）：仿射变换的前三行 + RGBA8 颜色 + 材质索引，56 字节 / 实例。
+/// 变换作用在顶点位置上、再乘 UBO 的 model / view / projection
+/// </summary>
+using InstanceStreamLayout = VertexLayout<
+    VertexAttribute<2, VertexFormat::Float4>,
+    VertexAttribute<3, VertexFormat::Float4>,
+    VertexAttribute<4, VertexFormat::Float4>,
+    VertexAttribute<5, VertexFormat::UNorm8x4>,
+    VertexAttribute<6, VertexFormat::UInt>>;
+using InstanceData = InstanceStreamLayout::Vertex;
+using InstancedSplitVertexStreams = InstancedVertexStreams<SplitVertexStreams, InstanceStreamLayout>;
+using InstancedPositionOnlyStreams = InstancedVertexStreams<PositionOnlyStreams, InstanceStreamLayout>;
+
+inline InstanceData PackInstance(const glm::mat4& transform, const glm::vec4& color, uint32_t material_index)
+{
+    // glm 按列存储，着色器里逐行与位置点乘
+    InstanceData instance;
+    instance.Set<0>(glm::vec4(transform[0][0], transform[1][0], transform[2][0], transform[3][0]));
+    instance.Set<1>(glm::vec4(transform[0][1], transform[1][1], transform[2][1], transform[3][1]));
+    instance.Set<2>(glm::vec4(transform[0][2], transform[1][2], transform[2][2], transform[3][2]));
+    instance.Set<3>(EncodeUNorm8x4(color));
+    instance.Set<4>(material_index);
+    return instance;
+}
@@ -0,0 +1,230 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+/// <summary>
+/// 顶点属性格式：CPU 端存储类型与对应的 VkFormat。
+/// 半精度 / 归一化整数格式在顶点输入阶段由硬件转换成 float，着色器里仍按 float 读取
+/// </summary>
+namespace VertexFormat
+{
+	struct Float2 { using Type = glm::vec2; static constexpr VkFormat FORMAT = VK_FORMAT_R32G32_SFLOAT; };
+	struct Float3 { using Type = glm::vec3; static constexpr VkFormat FORMAT = VK_FORMAT_R32G32B32_SFLOAT; };
+	struct Float4 { using Type = glm::vec4; static constexpr VkFormat FORMAT = VK_FORMAT_R32G32B32A32_SFLOAT; };
+	struct Half2 { using Type = glm::u16vec2; static constexpr VkFormat FORMAT = VK_FORMAT_R16G16_SFLOAT; };
+	// 三分量的 16 位格式多数设备不支持作为顶点输入，位置用四分量（w 填 1）
+	struct Half4 { using Type = glm::u16vec4; static constexpr VkFormat FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT; };
+	struct UNorm8x4 { using Type = glm::u8vec4; static constexpr VkFormat FORMAT = VK_FORMAT_R8G8B8A8_UNORM; };
+	struct SNorm8x4 { using Type = glm::i8vec4; static constexpr VkFormat FORMAT = VK_FORMAT_R8G8B8A8_SNORM; };
+	// 八面体编码的法线 / 切线
+	struct SNorm16x2 { using Type = glm::i16vec2; static constexpr VkFormat FORMAT = VK_FORMAT_R16G16_SNORM; };
+	// [0, 1] 范围内的纹理坐标；需要平铺（超出 [0, 1]）时用 Half2
+	struct UNorm16x2 { using Type = glm::u16vec2; static constexpr VkFormat FORMAT = VK_FORMAT_R16G16_UNORM; };
+	struct UInt { using Type = uint32_t; static constexpr VkFormat FORMAT = VK_FORMAT_R32_UINT; };
+}
+
+template<uint32_t Location, typename Format>
+struct VertexAttribute
+{
+	using Type = typename Format::Type;
+	static constexpr uint32_t LOCATION = Location;
+	static constexpr VkFormat FORMAT = Format::FORMAT;
+	static constexpr uint32_t SIZE = uint32_t(sizeof(Type));
+};
+
+/// <summary>
+/// 由属性列表在编译期推导出紧密排列的顶点布局（按声明顺序、无填充）以及 Vulkan 的绑定 / 属性描述。
+/// 例：using Layout = VertexLayout&lt;VertexAttribute&lt;0, VertexFormat::Half4&gt;, VertexAttribute&lt;1, VertexFormat::UNorm8x4&gt;&gt;;
+/// Layout::Vertex 是对应大小的存储，用 Set&lt;I&gt; / Get&lt;I&gt; 按属性序号读写
+/// </summary>
+template<typename... Attributes>
+struct VertexLayout
+{
+	static constexpr uint32_t ATTRIBUTE_COUNT = uint32_t(sizeof...(Attributes));
+	static constexpr uint32_t STRIDE = (Attributes::SIZE + ... + 0);
+	static constexpr std::array<uint32_t, ATTRIBUTE_COUNT> OFFSETS = [] {
+		std::array<uint32_t, ATTRIBUTE_COUNT> offsets{};
+		uint32_t offset = 0;
+		size_t i = 0;
+		((offsets[i++] = offset, offset += Attributes::SIZE), ...);
+		return offsets;
+		}();
+
+	// 所有格式的大小都是 4 的倍数，属性偏移因此保持 4 字节对齐
+	static_assert(((Attributes::SIZE % 4 == 0) && ...), "vertex attributes must be 4-byte multiples");
+
+	template<size_t I>
+	using Attribute = std::tuple_element_t<I, std::tuple<Attributes...>>;
+
+	static constexpr VkVertexInputBindingDescription getBindingDescription(uint32_t binding = 0, VkVertexInputRate input_rate = VK_VERTEX_INPUT_RATE_VERTEX)
+	{
+		return { binding, STRIDE, input_rate };
+	}
+
+	static constexpr std::array<VkVertexInputAttributeDescription, ATTRIBUTE_COUNT> getAttributeDescriptions(uint32_t binding = 0)
+	{
+		std::array<VkVertexInputAttributeDescription, ATTRIBUTE_COUNT> attributeDescriptions{};
+		size_t i = 0;
+		((attributeDescriptions[i] = { Attributes::LOCATION, binding, Attributes::FORMAT, OFFSETS[i] }, ++i), ...);
+		return attributeDescriptions;
+	}
+
+	struct alignas(4) Vertex
+	{
+		std::array<unsigned char, STRIDE> Data{};
+
+		template<size_t I>
+		void Set(const typename Attribute<I>::Type& value)
+		{
+			std::memcpy(Data.data() + OFFSETS[I], &value, sizeof(value));
+		}
+
+		template<size_t I>
+		typename Attribute<I>::Type Get() const
+		{
+			typename Attribute<I>::Type value;
+			std::memcpy(&value, Data.data() + OFFSETS[I], sizeof(value));
+			return value;
+		}
+	};
+	static_assert(sizeof(Vertex) == STRIDE);
+};
+
+/// <summary>
+/// 多个顶点流（SoA）：每个 VertexLayout 占一个 binding，按模板参数顺序编号 0, 1, ...，属性描述合并。
+/// 只需要部分属性的 pass 使用只包含前几个流的变体（例如只有位置流），只绑定、只读取用到的缓冲
+/// </summary>
+template<typename... Layouts>
+struct VertexStreams
+{
+	static constexpr uint32_t BINDING_COUNT = uint32_t(sizeof...(Layouts));
+	static constexpr uint32_t ATTRIBUTE_COUNT = (Layouts::ATTRIBUTE_COUNT + ... + 0);
+	static constexpr std::array<uint32_t, BINDING_COUNT> STRIDES = { Layouts::STRIDE... };
+
+	template<size_t I>
+	using Stream = std::tuple_element_t<I, std::tuple<Layouts...>>;
+
+	static constexpr std::array<VkVertexInputBindingDescription, BINDING_COUNT> getBindingDescriptions(VkVertexInputRate input_rate = VK_VERTEX_INPUT_RATE_VERTEX)
+	{
+		std::array<VkVertexInputBindingDescription, BINDING_COUNT> bindingDescriptions{};
+		uint32_t binding = 0;
+		((bindingDescriptions[binding] = Layouts::getBindingDescription(binding, input_rate), ++binding), ...);
+		return bindingDescriptions;
+	}
+
+	static constexpr std::array<VkVertexInputAttributeDescription, ATTRIBUTE_COUNT> getAttributeDescriptions()
+	{
+		std::array<VkVertexInputAttributeDescription, ATTRIBUTE_COUNT> attributeDescriptions{};
+		uint32_t binding = 0;
+		size_t i = 0;
+		auto append = [&](const auto& descriptions) {
+			for (auto& description : descriptions)
+				attributeDescriptions[i++] = description;
+			++binding;
+			};
+		(append(Layouts::getAttributeDescriptions(binding)), ...);
+		return attributeDescriptions;
+	}
+};
+
+/// <summary>
+/// 顶点流之后追加按实例步进（VK_VERTEX_INPUT_RATE_INSTANCE）的流，binding 编号接在顶点流之后。
+/// 例：InstancedVertexStreams&lt;SplitVertexStreams, InstanceStreamLayout&gt; 的实例流在 binding 2
+/// </summary>
+template<typename Streams, typename... InstanceLayouts>
+struct InstancedVertexStreams
+{
+	static constexpr uint32_t VERTEX_BINDING_COUNT = Streams::BINDING_COUNT;
+	static constexpr uint32_t BINDING_COUNT = Streams::BINDING_COUNT + uint32_t(sizeof...(InstanceLayouts));
+	static constexpr uint32_t ATTRIBUTE_COUNT = Streams::ATTRIBUTE_COUNT + (InstanceLayouts::ATTRIBUTE_COUNT + ... + 0);
+
+	static constexpr std::array<VkVertexInputBindingDescription, BINDING_COUNT> getBindingDescriptions()
+	{
+		std::array<VkVertexInputBindingDescription, BINDING_COUNT> bindingDescriptions{};
+		uint32_t binding = 0;
+		for (auto& description : Streams::getBindingDescriptions())
+			bindingDescriptions[binding++] = description;
+		((bindingDescriptions[binding] = InstanceLayouts::getBindingDescription(binding, VK_VERTEX_INPUT_RATE_INSTANCE), ++binding), ...);
+		return bindingDescriptions;
+	}
+
+	static constexpr std::array<VkVertexInputAttributeDescription, ATTRIBUTE_COUNT> getAttributeDescriptions()
+	{
+		std::array<VkVertexInputAttributeDescription, ATTRIBUTE_COUNT> attributeDescriptions{};
+		size_t i = 0;
+		for (auto& description : Streams::getAttributeDescriptions())
+			attributeDescriptions[i++] = description;
+		uint32_t binding = VERTEX_BINDING_COUNT;
+		auto append = [&](const auto& descriptions) {
+			for (auto& description : descriptions)
+				attributeDescriptions[i++] = description;
+			++binding;
+			};
+		(append(InstanceLayouts::getAttributeDescriptions(binding)), ...);
+		return attributeDescriptions;
+	}
+};
+
+// 编码辅助函数
+
+inline glm::u16vec2 EncodeHalf2(const glm::vec2& value)
+{
+	return { glm::packHalf1x16(value.x), glm::packHalf1x16(value.y) };
+}
+
+inline glm::u16vec4 EncodeHalf4(const glm::vec4& value)
+{
+	return { glm::packHalf1x16(value.x), glm::packHalf1x16(value.y), glm::packHalf1x16(value.z), glm::packHalf1x16(value.w) };
+}
+
+inline glm::u8vec4 EncodeUNorm8x4(const glm::vec4& value)
+{
+	return glm::u8vec4(glm::round(glm::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+inline glm::i8vec4 EncodeSNorm8x4(const glm::vec4& value)
+{
+	return glm::i8vec4(glm::round(glm::clamp(value, -1.0f, 1.0f) * 127.0f));
+}
+
+inline glm::u16vec2 EncodeUNorm16x2(const glm::vec2& value)
+{
+	return glm::u16vec2(glm::round(glm::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+/// <summary>
+/// 单位向量的八面体编码：投影到 |x| + |y| + |z| = 1 的八面体上，下半球沿对角线折到上半球，结果在 [-1, 1]^2，存为 16 位 snorm
+/// </summary>
+inline glm::i16vec2 EncodeOctahedral(const glm::vec3& normal)
+{
+	glm::vec3 n = normal / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+	glm::vec2 oct(n.x, n.y);
+	if (n.z < 0.0f)
+	{
+		oct.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+		oct.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+	}
+	return glm::i16vec2(glm::round(glm::clamp(oct, -1.0f, 1.0f) * 32767.0f));
+}
+
+/// <summary>
+/// EncodeOctahedral 的逆变换（着色器中的解码与此相同，输入为硬件转换后的 [-1, 1] float2）
+/// </summary>
+inline glm::vec3 DecodeOctahedral(const glm::vec2& oct)
+{
+	glm::vec3 n(oct.x, oct.y, 1.0f - std::abs(oct.x) - std::abs(oct.y));
+	float t = glm::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return glm::normalize(n);
+}
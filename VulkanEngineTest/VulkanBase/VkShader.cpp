@@ -6,10 +6,9 @@
 #include <vulkan/vulkan.h>
 
 #include "VkShader.h"
+#include "Logger.h"
 
 #include <fstream>
-#include <iostream>
-#include <format>
 
 VkEngineShaderModule::VkEngineShaderModule(const VkDevice& device, const std::string& path)
 	: _shader_module(VK_NULL_HANDLE)
@@ -19,7 +18,7 @@ VkEngineShaderModule::VkEngineShaderModule(const VkDevice& device, const std::st
 	// assert
 	if (ShaderCode.size() % sizeof(uint32_t) != 0)
 	{
-		std::cout << std::format("ERROR: [shader] shader code error; path : {}", path);
+		LOG_ERROR(LOG_CATEGORY_SHADER, "shader code error; path : {}", path);
 		return;
 	}
 
@@ -30,7 +29,7 @@ VkEngineShaderModule::VkEngineShaderModule(const VkDevice& device, const std::st
 
 	if (VkResult result = vkCreateShaderModule(_device, &createInfo, nullptr, &_shader_module))
 	{
-		std::cout << std::format("ERROR : [ shader ] Failed to create a shader module! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_SHADER, "Failed to create a shader module! Error code: {}", int32_t(result));
 		return;
 	}
 
@@ -47,7 +46,7 @@ std::vector<char> VkEngineShaderModule::ReadFile(const std::string& path)
 	std::ifstream file(path, std::ios::ate | std::ios::binary);
 	if (!file.is_open())
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] failed to open file : {} \n", path);
+		LOG_ERROR(LOG_CATEGORY_SHADER, "failed to open file : {}", path);
 	}
 
 	size_t fileSize = (size_t)file.tellg();
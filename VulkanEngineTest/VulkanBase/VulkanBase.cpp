@@ -4,12 +4,17 @@
 #include "VulkanBase.h"
 #include "Vertex.h"
 #include "VkShader.h"
+#include "FrameProfiler.h"
+#include "Tracer.h"
+#include "Logger.h"
+#include "MemoryTracker.h"
+#include "MappedFile.h"
+#include "MeshFormat.h"
 
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-#include <iostream>
 #include <format>
 #include <vector>
 #include <set>
@@ -20,6 +25,7 @@
 #include <filesystem>
 #include <chrono>
 #include <thread>
+#include <bit>
 
 static auto StartTime = std::chrono::high_resolution_clock::now();
 
@@ -29,6 +35,7 @@ static uint32_t ImageIndex = 0;
 
 static VmaAllocator vmaAllocator = nullptr;
 static std::unordered_map<VkBuffer, VmaAllocation> MapBufferAllocation;
+static std::unordered_map<VkImage, VmaAllocation> MapImageAllocation;
 
 const std::vector<Vertex> vertices = {
 	{{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
@@ -54,19 +61,20 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
 	void* pUserData)
 {
 
+	// 校验层可能每帧重复报告同一条消息，交给异步日志限流
 	switch (messageSeverity)
 	{
 	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT:
-		std::cout << "VERBOSE: " << pCallbackData->pMessage << std::endl;
+		LOG_VERBOSE(LOG_CATEGORY_VALIDATION, "{}", pCallbackData->pMessage);
 		break;
 	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT:
-		std::cout << "INFO: " << pCallbackData->pMessage << std::endl;
+		LOG_INFO(LOG_CATEGORY_VALIDATION, "{}", pCallbackData->pMessage);
 		break;
 	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT:
-		std::cout << "WARNING: " << pCallbackData->pMessage << std::endl;
+		LOG_WARNING(LOG_CATEGORY_VALIDATION, "{}", pCallbackData->pMessage);
 		break;
 	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT:
-		std::cout << "ERROR: " << pCallbackData->pMessage << std::endl;
+		LOG_ERROR(LOG_CATEGORY_VALIDATION, "{}", pCallbackData->pMessage);
 		break;
 	default:
 		break;
@@ -105,6 +113,8 @@ VulkanBase::VulkanBase()
 	, _surface(VK_NULL_HANDLE)
 	, _swap_chain(VK_NULL_HANDLE)
 	, _present_queue(VK_NULL_HANDLE)
+	, _compute_queue(VK_NULL_HANDLE)
+	, _transfer_queue(VK_NULL_HANDLE)
 {}
 
 VulkanBase::~VulkanBase()
@@ -126,7 +136,7 @@ void VulkanBase::CreateVmaAllocator(VkInstance instance, VkDevice device, VkPhys
 
 	vmaCreateAllocator(&allocatorCreateInfo, &vmaAllocator);
 
-	std::cout << std::format("INFO : [VulkanBase] Create Vma Allocator done. \n");
+	LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "Create Vma Allocator done.");
 }
 
 void VulkanBase::DestoryVmaAllocator()
@@ -134,6 +144,11 @@ void VulkanBase::DestoryVmaAllocator()
 	vmaDestroyAllocator(vmaAllocator);
 }
 
+VmaAllocator VulkanBase::GetVmaAllocator()
+{
+	return vmaAllocator;
+}
+
 VulkanBase& VulkanBase::Base()
 {
 	static VulkanBase base;
@@ -159,41 +174,98 @@ bool VulkanBase::InitVulkan()
 	CreateSurface();
 	_pick_physical_device();
 	_create_logical_device();
-	_create_swap_chain();
-	_create_image_views();
+	_descriptor_allocator.Init(_device, MAX_FRAMES_IN_FLIGHT);
+	_descriptor_writer.Init(_device, _descriptor_allocator, _descriptor_templates_supported);
+	// 离屏目标由 VMA 分配，分配器需要先于交换链创建
 	VulkanBase::CreateVmaAllocator(_instance, _device, _physical_device);
+	MemoryTracker::Get().Init(vmaAllocator, _physical_device);
+	_defragmenter.Init(_device, vmaAllocator, _graphics_queue, _queue_family_indices.GraphicsFamily, MAX_FRAMES_IN_FLIGHT,
+		[this](VkBuffer old_buffer, VkBuffer new_buffer, VmaAllocation allocation) {
+			MapBufferAllocation.erase(old_buffer);
+			MapBufferAllocation[new_buffer] = allocation;
+			_meshlet_renderer.OnBufferReplaced(old_buffer, new_buffer);
+		});
+	_compute.Init(_physical_device, _device, _compute_queue, _queue_family_indices.ComputeFamily);
+	_async_compute.Init(_device, _compute_queue, _queue_family_indices.ComputeFamily, _queue_family_indices.GraphicsFamily, MAX_FRAMES_IN_FLIGHT);
+	_texture_streamer.Init(_physical_device, _device, vmaAllocator, _transfer_queue, _queue_family_indices.TransferFamily,
+		_graphics_queue, _queue_family_indices.GraphicsFamily, RunPath + "\\shader\\vulkan\\SPV\\mipDownsample.slang.comp.spv", MAX_FRAMES_IN_FLIGHT);
+	_texture_streamer.SetOnViewChanged([this](TextureStreamer::TextureHandle texture, VkImageView view) { _on_texture_view_changed(texture, view); });
+	// 纹理预算不超过设备本地堆剩余预算的一半
+	MemoryTracker::Get().Update();
+	if (VkDeviceSize available = MemoryTracker::Get().GetAvailableDeviceLocalBytes())
+		_texture_streamer.SetBudget(std::min(TextureStreamer::DEFAULT_BUDGET, available / 2));
+	if (_headless)
+		_create_offscreen_targets();
+	else
+		_create_swap_chain();
+	_create_image_views();
 	_create_render_pass();
 	_create_descriptor_set_layout();
+	// 无绑定资源堆是间接绘制管线布局的集 2，需先于间接绘制列表初始化；失败时间接绘制不采样纹理
+	if (_descriptor_indexing_supported)
+		_bindless_heap.Init(_physical_device, _device, MAX_FRAMES_IN_FLIGHT, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+	// 网格着色器管线使用网格簇渲染器的管线布局，需先于图形管线初始化
+	_meshlet_renderer.Init(_device, _descriptor_set_layout, MAX_FRAMES_IN_FLIGHT, RunPath + "\\shader\\vulkan\\SPV\\meshletCull.slang.comp.spv",
+		_draw_indirect_count_supported, _multi_draw_indirect_supported, _mesh_shader_supported);
+	_draw_list.Init(_device, _descriptor_set_layout, MAX_FRAMES_IN_FLIGHT, RunPath + "\\shader\\vulkan\\SPV\\drawCull.slang.comp.spv",
+		_draw_indirect_count_supported, _multi_draw_indirect_supported, _bindless_heap.GetSetLayout());
 	_create_graphics_pipeline();
+	// 深度图像是渲染图的临时图像，帧缓冲在渲染图编译之后创建
+	_frame_graph.Init(_device, vmaAllocator, _synchronization2_supported);
+	_build_frame_graph();
 	_create_framebuffers();
 	_create_command_pool();
-	//_create_vertex_buffer();
+	if (_bindless_heap.IsInitialized())
+		_create_bindless_fallback();
 	_vma_create_vertex_buffer();
 	_vma_create_index_buffer();
 	_vma_create_uniform_buffers();
-	_create_descriptor_pool();
 	_create_descriptor_sets();
 	_create_command_buffer();
 	_create_sync_objects();
+	_gpu_profiler.Init(_instance, _physical_device, _device, _graphics_queue, _queue_family_indices.GraphicsFamily,
+		_command_pool, MAX_FRAMES_IN_FLIGHT, _calibrated_timestamps_enabled, _pipeline_statistics_supported);
 	return true;
 }
 
 void VulkanBase::WaitForFence(uint32_t& frameIndex)
 {
+	FrameProfiler::ScopedPhase phase(FrameProfiler::PHASE_WAIT_FOR_FENCE);
+
 	if (VkResult result = vkWaitForFences(_device, 1, &_frame_fences[frameIndex], VK_TRUE, UINT64_MAX))
 	{
-		std::cout << std::format("ERROR : [VulkanBase] vkWaitForFences error : {}\n", (int32_t)result);
-	}
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "vkWaitForFences error : {}", (int32_t)result);
+	}
+
+	// 该帧上一次提交已完成，回收 GPU 时间戳
+	_gpu_profiler.Collect(frameIndex);
+	// 读取该帧上一次剔除的可见簇数
+	_meshlet_renderer.Collect(frameIndex);
+	_draw_list.Collect(frameIndex);
+	// 刷新各个堆的显存预算
+	MemoryTracker::Get().Update();
+	// 该帧的瞬时描述符集随池一起重置
+	_descriptor_allocator.BeginFrame(frameIndex);
+	// 推进碎片整理（每帧至多一步）
+	_defragmenter.Update();
+	// 换上上传完成的纹理，提交新解码的纹理与换入 / 卸下的 mip
+	_texture_streamer.Update();
 	
 	/*if (VkResult result = vkResetFences(_device, 1, &_frame_fences[frameIndex]))
 	{
-		std::cout << std::format("ERROR : [VulkanBase] vkResetFences error : {}\n", (int32_t)result);
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "vkResetFences error : {}", (int32_t)result);
 	}*/
 }
 
 int VulkanBase::AcquireNextImage(uint32_t& frameIndex)
 {
-	VkResult result = vkAcquireNextImageKHR(_device, _swap_chain, UINT64_MAX, _acquire_semaphores[frameIndex], VK_NULL_HANDLE, &ImageIndex);
+	FrameProfiler::ScopedPhase phase(FrameProfiler::PHASE_ACQUIRE_NEXT_IMAGE);
+
+	VkResult result = VK_SUCCESS;
+	if (_headless)
+		ImageIndex = (ImageIndex + 1) % _swap_chain_image_count;
+	else
+		result = vkAcquireNextImageKHR(_device, _swap_chain, UINT64_MAX, _acquire_semaphores[frameIndex], VK_NULL_HANDLE, &ImageIndex);
 	if (result == VK_ERROR_OUT_OF_DATE_KHR)
 	{
 		_recreate_swap_chain();
@@ -201,7 +273,7 @@ int VulkanBase::AcquireNextImage(uint32_t& frameIndex)
 	}
 	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
 	{
-		std::cout << std::format("ERROR : [VulkanBase] failed to acquire swap chain image! \n");
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "failed to acquire swap chain image!");
 		return -2;
 	}
 
@@ -210,7 +282,7 @@ int VulkanBase::AcquireNextImage(uint32_t& frameIndex)
 	// 延迟重置围栏
 	if (VkResult result = vkResetFences(_device, 1, &_frame_fences[frameIndex]))
 	{
-		std::cout << std::format("ERROR : [VulkanBase] vkResetFences error : {}\n", (int32_t)result);
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "vkResetFences error : {}", (int32_t)result);
 	}
 
 	return 0;
@@ -223,6 +295,8 @@ void VulkanBase::ResetCommandBuffer()
 
 void VulkanBase::RecordCommandBuffer(uint32_t& frameIndex)
 {
+	FrameProfiler::ScopedPhase phase(FrameProfiler::PHASE_RECORD_COMMAND_BUFFER);
+
 	_record_command_buffer(ImageIndex, frameIndex);
 }
 
@@ -238,28 +312,41 @@ void VulkanBase::UpdateUniformBuffer(uint32_t& frameIndex)
 	ubo.proj[1][1] *= -1;
 
 	memcpy(_uniform_buffers_mapped[frameIndex], &ubo, sizeof(ubo));
+	FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_BYTES_UPLOADED, sizeof(ubo));
 }
 
 bool VulkanBase::SubmitCommandBuffer(uint32_t& frameIndex)
 {
+	FrameProfiler::ScopedPhase phase(FrameProfiler::PHASE_SUBMIT_COMMAND_BUFFER);
+
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-	VkSemaphore waitSemaphores[] = { _acquire_semaphores[frameIndex]};
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
+	// 无窗口模式下没有 acquire / present，不需要信号量
+	std::array<VkSemaphore, 2> waitSemaphores{};
+	std::array<VkPipelineStageFlags, 2> waitStages{};
+	uint32_t waitCount = 0;
+	if (!_headless)
+	{
+		waitSemaphores[waitCount] = _acquire_semaphores[frameIndex];
+		waitStages[waitCount++] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	}
+	// 本帧的异步计算先提交，图形只在消费结果的阶段等待
+	if (_async_compute.Submit(frameIndex, waitSemaphores[waitCount], waitStages[waitCount]))
+		++waitCount;
+	submitInfo.waitSemaphoreCount = waitCount;
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &_command_buffer;
 
 	VkSemaphore signalSemaphores[] = { _submit_semaphores[ImageIndex]};
-	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.signalSemaphoreCount = _headless ? 0 : 1;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
 	if(VkResult result = vkQueueSubmit(_graphics_queue, 1, &submitInfo, _frame_fences[frameIndex]))
 	{
-		std::cout << std::format("ERROR : failed to submit draw command buffer! error code : {} \n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "failed to submit draw command buffer! error code : {}", int32_t(result));
 		return false;
 	}
 
@@ -268,6 +355,11 @@ bool VulkanBase::SubmitCommandBuffer(uint32_t& frameIndex)
 
 void VulkanBase::Present(uint32_t& frameIndex)
 {
+	FrameProfiler::ScopedPhase phase(FrameProfiler::PHASE_PRESENT);
+
+	if (_headless)
+		return;
+
 	VkSemaphore signalSemaphores[] = { _submit_semaphores[ImageIndex] };
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -288,7 +380,7 @@ void VulkanBase::Present(uint32_t& frameIndex)
 	}
 	else if (result != VK_SUCCESS)
 	{
-		std::cout << std::format("ERROR : failed to present swap chain image! error code : {} \n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "failed to present swap chain image! error code : {}", int32_t(result));
 	}
 }
 
@@ -311,7 +403,7 @@ bool VulkanBase::CreateBuffer(VkDeviceSize size,
 
 	if (VkResult result = vkCreateBuffer(_device, &bufferInfo, nullptr, &buffer))
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to create buffer! VkBufferUsageFlags : {},  Error code: {}\n", int32_t(usage), int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create buffer! VkBufferUsageFlags : {},  Error code: {}", int32_t(usage), int32_t(result));
 		return false;
 	}
 
@@ -330,7 +422,7 @@ bool VulkanBase::CreateBuffer(VkDeviceSize size,
 			}
 		}
 
-		std::cout << std::format("ERROR : [ VulkanBase ] failed to find suitable memory type!\n");
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "failed to find suitable memory type!");
 		return (uint32_t)-1;
 		};
 
@@ -341,7 +433,7 @@ bool VulkanBase::CreateBuffer(VkDeviceSize size,
 
 	if (VkResult result = vkAllocateMemory(_device, &allocInfo, nullptr, &buffer_memory))
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to allocate vertex buffer memory! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to allocate vertex buffer memory! Error code: {}", int32_t(result));
 		return false;
 	}
 
@@ -353,13 +445,33 @@ bool VulkanBase::CreateBuffer(VkDeviceSize size,
 bool VulkanBase::UseVmaCreateBuffer(VkDeviceSize size,
 	VkBufferUsageFlags usage, 
 	VkMemoryPropertyFlags properties,
-	VkBuffer& buffer)
+	VkBuffer& buffer,
+	bool movable)
 {
+	// 主机可见的缓冲可能被常驻映射或随时写入，不参与碎片整理
+	if (movable && (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+	{
+		LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "host visible buffers can not be movable, ignored");
+		movable = false;
+	}
+
 	VkBufferCreateInfo bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	bufferInfo.size = size;
 	bufferInfo.usage = usage;
 	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	// 可能同时被异步计算与图形访问的缓冲，免去队列族所有权转移
+	std::array<uint32_t, 2> sharedFamilies = { _queue_family_indices.GraphicsFamily, _queue_family_indices.ComputeFamily };
+	constexpr VkBufferUsageFlags sharedUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+	if (_queue_family_indices.HasDedicatedComputeFamily && (usage & sharedUsage))
+	{
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(sharedFamilies.size());
+		bufferInfo.pQueueFamilyIndices = sharedFamilies.data();
+	}
+	// 碎片整理时作为拷贝源和拷贝目标
+	if (movable)
+		bufferInfo.usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 
 	VmaAllocationCreateInfo vmaAllocInfo{};
 	vmaAllocInfo.usage = VMA_MEMORY_USAGE_AUTO;
@@ -371,11 +483,14 @@ bool VulkanBase::UseVmaCreateBuffer(VkDeviceSize size,
 	VmaAllocation allocation;
 	if (VkResult result = vmaCreateBuffer(vmaAllocator, &bufferInfo, &vmaAllocInfo, &buffer, &allocation, nullptr))
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to create buffer! VkBufferUsageFlags : {},  Error code: {}\n", int32_t(usage), int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create buffer! VkBufferUsageFlags : {},  Error code: {}", int32_t(usage), int32_t(result));
 		return false;
 	}
 
 	MapBufferAllocation[buffer] = allocation;
+	MemoryTracker::Get().OnAllocate(allocation, MemoryTracker::ClassifyBuffer(usage, properties));
+	if (movable)
+		_defragmenter.RegisterBuffer(allocation, &buffer, bufferInfo);
 
 	return true;
 }
@@ -384,12 +499,105 @@ void VulkanBase::UseVmaDestroyBuffer(VkBuffer buffer)
 {
 	auto iter = MapBufferAllocation.find(buffer);
 	if (iter != MapBufferAllocation.end())
-		vmaDestroyBuffer(vmaAllocator, buffer, iter->second);
+	{
+		MemoryTracker::Get().OnFree(iter->second);
+		// 正在被搬运的缓冲由碎片整理器销毁
+		if (!_defragmenter.OnDestroyBuffer(iter->second))
+			vmaDestroyBuffer(vmaAllocator, buffer, iter->second);
+	}
 	MapBufferAllocation.erase(buffer);
 }
 
+bool VulkanBase::UseVmaMapBuffer(VkBuffer buffer, void** data)
+{
+	auto iter = MapBufferAllocation.find(buffer);
+	if (iter == MapBufferAllocation.end())
+		return false;
+	if (VkResult result = vmaMapMemory(vmaAllocator, iter->second, data))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to map buffer! Error code: {}", int32_t(result));
+		return false;
+	}
+	return true;
+}
+
+void VulkanBase::UseVmaUnmapBuffer(VkBuffer buffer)
+{
+	auto iter = MapBufferAllocation.find(buffer);
+	if (iter != MapBufferAllocation.end())
+		vmaUnmapMemory(vmaAllocator, iter->second);
+}
+
+bool VulkanBase::UseVmaCreateImage(const VkImageCreateInfo& image_info, VkImage& image)
+{
+	VmaAllocationCreateInfo vmaAllocInfo{};
+	vmaAllocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+	VmaAllocation allocation;
+	if (VkResult result = vmaCreateImage(vmaAllocator, &image_info, &vmaAllocInfo, &image, &allocation, nullptr))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create image! VkImageUsageFlags : {},  Error code: {}", int32_t(image_info.usage), int32_t(result));
+		return false;
+	}
+
+	MapImageAllocation[image] = allocation;
+	MemoryTracker::Get().OnAllocate(allocation, MemoryTracker::ClassifyImage(image_info.usage));
+
+	return true;
+}
+
+void VulkanBase::UseVmaDestroyImage(VkImage image)
+{
+	auto iter = MapImageAllocation.find(image);
+	if (iter != MapImageAllocation.end())
+	{
+		MemoryTracker::Get().OnFree(iter->second);
+		vmaDestroyImage(vmaAllocator, image, iter->second);
+	}
+	MapImageAllocation.erase(image);
+}
+
+void VulkanBase::SetHeadless(uint32_t width, uint32_t height)
+{
+	_headless = true;
+	_frame_buffer_width = width;
+	_frame_buffer_height = height;
+}
+
+bool VulkanBase::RecreateGraphicsPipeline()
+{
+	vkDestroyPipeline(_device, _graphics_pipeline, nullptr);
+	vkDestroyPipeline(_device, _position_only_pipeline, nullptr);
+	vkDestroyPipeline(_device, _meshlet_mesh_pipeline, nullptr);
+	for (auto& pipeline : _instance_pipelines)
+	{
+		vkDestroyPipeline(_device, pipeline, nullptr);
+		pipeline = VK_NULL_HANDLE;
+	}
+	for (auto& pipeline : _indirect_pipelines)
+	{
+		vkDestroyPipeline(_device, pipeline, nullptr);
+		pipeline = VK_NULL_HANDLE;
+	}
+	vkDestroyPipeline(_device, _depth_prepass_pipeline, nullptr);
+	vkDestroyPipeline(_device, _depth_prepass_instance_pipeline, nullptr);
+	vkDestroyPipeline(_device, _depth_prepass_indirect_pipeline, nullptr);
+	vkDestroyPipelineLayout(_device, _pipeline_layout, nullptr);
+	_graphics_pipeline = VK_NULL_HANDLE;
+	_position_only_pipeline = VK_NULL_HANDLE;
+	_meshlet_mesh_pipeline = VK_NULL_HANDLE;
+	_depth_prepass_pipeline = VK_NULL_HANDLE;
+	_depth_prepass_instance_pipeline = VK_NULL_HANDLE;
+	_depth_prepass_indirect_pipeline = VK_NULL_HANDLE;
+	_pipeline_layout = VK_NULL_HANDLE;
+	return _create_graphics_pipeline();
+}
+
 bool VulkanBase::CopyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size)
 {
+	TRACE_ZONE_DETAIL("CopyBuffer", "upload", std::format("{} bytes", size));
+	FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_BYTES_UPLOADED, size);
+
 	VkCommandBufferAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -426,6 +634,102 @@ bool VulkanBase::CopyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSi
 	return true;
 }
 
+bool VulkanBase::_create_bindless_fallback()
+{
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+	imageInfo.extent = { 1, 1, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	if (!UseVmaCreateImage(imageInfo, _bindless_fallback_image))
+		return false;
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = _bindless_fallback_image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = imageInfo.format;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	if (VkResult result = vkCreateImageView(_device, &viewInfo, nullptr, &_bindless_fallback_view))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create bindless fallback image view! Error code: {}", int32_t(result));
+		return false;
+	}
+
+	constexpr VkDeviceSize bufferSize = 256;
+	if (!UseVmaCreateBuffer(bufferSize,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		_bindless_fallback_buffer))
+		return false;
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = _command_pool;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	vkAllocateCommandBuffers(_device, &allocInfo, &commandBuffer);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	VkImageMemoryBarrier imageBarrier{};
+	imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	imageBarrier.srcAccessMask = 0;
+	imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.image = _bindless_fallback_image;
+	imageBarrier.subresourceRange = viewInfo.subresourceRange;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+	VkClearColorValue white = { { 1.0f, 1.0f, 1.0f, 1.0f } };
+	vkCmdClearColorImage(commandBuffer, _bindless_fallback_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &white, 1, &viewInfo.subresourceRange);
+	vkCmdFillBuffer(commandBuffer, _bindless_fallback_buffer, 0, bufferSize, 0);
+
+	// 之后只被着色器读取
+	imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	VkMemoryBarrier memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+		1, &memoryBarrier, 0, nullptr, 1, &imageBarrier);
+
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	vkQueueSubmit(_graphics_queue, 1, &submitInfo, VK_NULL_HANDLE);
+	vkQueueWaitIdle(_graphics_queue);
+
+	vkFreeCommandBuffers(_device, _command_pool, 1, &commandBuffer);
+
+	_bindless_heap.SetFallback(_bindless_fallback_view, _bindless_fallback_buffer);
+	return true;
+}
+
 //void VulkanBase::DrawFrame()
 //{
 //	vkWaitForFences(_device, 1, &_in_flight_fence, VK_TRUE, UINT64_MAX);
@@ -496,17 +800,41 @@ void VulkanBase::CleanUp()
 		vkDestroyFence(_device, fence, nullptr);
 	}
 
+	_gpu_profiler.CleanUp();
+	_compute.CleanUp();
+	_async_compute.CleanUp();
+	// 完成进行中的搬运，之后才能销毁登记的缓冲
+	_defragmenter.CleanUp();
+	_texture_streamer.CleanUp();
 	vkDestroyCommandPool(_device, _command_pool, nullptr);
 
 	for(auto framebuffer : _swap_chain_framebuffers)
 	{
 		vkDestroyFramebuffer(_device, framebuffer, nullptr);
 	}
+	vkDestroyFramebuffer(_device, _depth_prepass_framebuffer, nullptr);
+
+	_meshlet_renderer.CleanUp();
+	_draw_list.CleanUp();
+	_bindless_heap.CleanUp();
+	vkDestroyImageView(_device, _bindless_fallback_view, nullptr);
+	UseVmaDestroyImage(_bindless_fallback_image);
+	UseVmaDestroyBuffer(_bindless_fallback_buffer);
+	_frame_graph.CleanUp();
 
-	//vkDestroyBuffer(_device, _vertex_buffer, nullptr);
-	UseVmaDestroyBuffer(_vertex_buffer);
-	//vkFreeMemory(_device, _vertex_buffer_memory, nullptr);
+	UseVmaDestroyBuffer(_position_buffer);
+	UseVmaDestroyBuffer(_attribute_buffer);
 	UseVmaDestroyBuffer(_index_buffer);
+	UseVmaDestroyBuffer(_meshlet_buffer);
+	UseVmaDestroyBuffer(_meshlet_vertex_buffer);
+	UseVmaDestroyBuffer(_meshlet_triangle_buffer);
+	for (auto& instanceBuffer : _instance_buffers)
+	{
+		if (instanceBuffer.Mapped)
+			UseVmaUnmapBuffer(instanceBuffer.Buffer);
+		UseVmaDestroyBuffer(instanceBuffer.Buffer);
+	}
+	_instance_buffers.clear();
 
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
 	{
@@ -514,24 +842,41 @@ void VulkanBase::CleanUp()
 		UseVmaDestroyBuffer(_uniform_buffers[i]);
 	}
 
-	vkDestroyDescriptorPool(_device, _descriptor_pool, nullptr);
-
-	vkDestroyDescriptorSetLayout(_device, _descriptor_set_layout, nullptr);
+	// 描述符集与 UBO 的集布局都属于分配器
+	_descriptor_writer.CleanUp();
+	_descriptor_allocator.CleanUp();
 	
 	vkDestroyPipeline(_device, _graphics_pipeline, nullptr);
+	vkDestroyPipeline(_device, _position_only_pipeline, nullptr);
+	vkDestroyPipeline(_device, _meshlet_mesh_pipeline, nullptr);
+	for (auto pipeline : _instance_pipelines)
+		vkDestroyPipeline(_device, pipeline, nullptr);
+	for (auto pipeline : _indirect_pipelines)
+		vkDestroyPipeline(_device, pipeline, nullptr);
+	vkDestroyPipeline(_device, _depth_prepass_pipeline, nullptr);
+	vkDestroyPipeline(_device, _depth_prepass_instance_pipeline, nullptr);
+	vkDestroyPipeline(_device, _depth_prepass_indirect_pipeline, nullptr);
 	vkDestroyPipelineLayout(_device, _pipeline_layout, nullptr);
 	vkDestroyRenderPass(_device, _render_pass, nullptr);
-
-	VulkanBase::DestoryVmaAllocator();
+	vkDestroyRenderPass(_device, _depth_load_render_pass, nullptr);
+	vkDestroyRenderPass(_device, _depth_prepass_render_pass, nullptr);
 
 	for (auto imageView : _swap_chain_image_views)
 	{
 		vkDestroyImageView(_device, imageView, nullptr);
 	}
 
-	vkDestroySwapchainKHR(_device, _swap_chain, nullptr);
+	if (_headless)
+		_destroy_offscreen_targets();
+
+	MemoryTracker::Get().CleanUp();
+	VulkanBase::DestoryVmaAllocator();
+
+	if (!_headless)
+		vkDestroySwapchainKHR(_device, _swap_chain, nullptr);
 	vkDestroyDevice(_device, nullptr);
-	vkDestroySurfaceKHR(_instance, _surface, nullptr);
+	if (_surface)
+		vkDestroySurfaceKHR(_instance, _surface, nullptr);
 	vkDestroyInstance(_instance, nullptr);
 
 }
@@ -597,14 +942,14 @@ bool VulkanBase::_create_instance()
 
 	if (vkCreateInstance(&createInfo, nullptr, &_instance) != VK_SUCCESS)
 	{
-		std::cout << "ERROR : failed to create instance!\n";
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "failed to create instance!");
 		return false;
 	}
 
-	std::cout << std::format("INFO : Create Instance done, instance Extensions Num : {}  :\n", instanceExtensions.size());
+	LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "Create Instance done, instance Extensions Num : {}  :", instanceExtensions.size());
 	for (auto& name : instanceExtensions)
 	{
-		std::cout << "\t" << name << ";\n";
+		LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "\t{};", name);
 	}
 
 	return true;
@@ -616,11 +961,11 @@ void VulkanBase::_use_lastest_api_version()
 	{
 		if (VkResult result = vkEnumerateInstanceVersion(&_api_version))
 		{
-			std::cout << std::format("vkEnumerateInstanceVersion error : {}  \n", (int)result);
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "vkEnumerateInstanceVersion error : {}", (int)result);
 		}
 		return;
 	}
-	std::cout << std::format("not found vkEnumerateInstanceVersion  \n");
+	LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "not found vkEnumerateInstanceVersion");
 }
 
 bool VulkanBase::_setup_debug_messenger()
@@ -643,13 +988,13 @@ bool VulkanBase::_setup_debug_messenger()
 	{
 		if (vkCreateDebugUtilsMessenger(_instance, &debugMsgInfo, nullptr, &_debug_messenger) != VK_SUCCESS)
 		{
-			std::cout << std::format("ERRORR : failed to set up debug messenger! \n");
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "failed to set up debug messenger!");
 			return false;
 		}
 	}
 	else
 	{
-		std::cout << std::format("ERRORR : not found vkCreateDebugUtilsMessengerEXT \n");
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "not found vkCreateDebugUtilsMessengerEXT");
 		return false;
 	}
 	return true;
@@ -667,7 +1012,7 @@ bool VulkanBase::_check_validation_layers()
 	uint32_t layerCount;
 	if (VkResult result = vkEnumerateInstanceLayerProperties(&layerCount, nullptr))
 	{
-		std::cout << std::format(" ERROR : [ VulkanBase ] Failed to get the count of instance layers! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to get the count of instance layers! Error code: {}", int32_t(result));
 		return false;
 	}
 	if (layerCount)
@@ -675,7 +1020,7 @@ bool VulkanBase::_check_validation_layers()
 		std::vector<VkLayerProperties> availableLayers(layerCount);
 		if (VkResult result = vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data()))
 		{
-			std::cout << std::format("ERROR : [ VulkanBase ] Failed to enumerate instance layer properties! Error code: {}\n", int32_t(result));
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to enumerate instance layer properties! Error code: {}", int32_t(result));
 			return false;
 		}
 		bool found = false;
@@ -695,10 +1040,10 @@ bool VulkanBase::_check_validation_layers()
 	{
 		validationLayers.clear();
 	}
-	std::cout << std::format("INFO : Check instanceLayers done, Num : {}  :\n", validationLayers.size());
+	LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "Check instanceLayers done, Num : {}  :", validationLayers.size());
 	for (auto& name : validationLayers)
 	{
-		std::cout << "\t" << name << ";\n";
+		LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "\t{};", name);
 	}
 	return true;
 }
@@ -708,7 +1053,7 @@ bool VulkanBase::_check_device_extension_support(VkPhysicalDevice device)
 	uint32_t extensionCount;
 	if (VkResult result = vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr))
 	{
-		std::cout << std::format(" ERROR : [ VulkanBase ] Failed to get the count of device extension! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to get the count of device extension! Error code: {}", int32_t(result));
 		return false;
 	}
 	if (extensionCount)
@@ -716,7 +1061,7 @@ bool VulkanBase::_check_device_extension_support(VkPhysicalDevice device)
 		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
 		if (VkResult result = vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data()))
 		{
-			std::cout << std::format("ERROR : [ VulkanBase ] Failed to enumerate device extension properties! Error code: {}\n", int32_t(result));
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to enumerate device extension properties! Error code: {}", int32_t(result));
 			return false;
 		}
 		bool found = false;
@@ -736,25 +1081,52 @@ bool VulkanBase::_check_device_extension_support(VkPhysicalDevice device)
 	{
 		deviceExtensions.clear();
 	}
-	std::cout << std::format("INFO : Check deviceExtensions done, Num : {}  :\n", deviceExtensions.size());
+	LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "Check deviceExtensions done, Num : {}  :", deviceExtensions.size());
 	for (auto& name : deviceExtensions)
 	{
-		std::cout << "\t" << name << ";\n";
+		LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "\t{};", name);
 	}
 	return true;
 }
 
+bool VulkanBase::_enable_optional_device_extension(const char* extensionName)
+{
+	for (auto name : deviceExtensions)
+	{
+		if (name && !strcmp(name, extensionName))
+			return true;
+	}
+
+	uint32_t extensionCount = 0;
+	if (vkEnumerateDeviceExtensionProperties(_physical_device, nullptr, &extensionCount, nullptr) || !extensionCount)
+		return false;
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	if (vkEnumerateDeviceExtensionProperties(_physical_device, nullptr, &extensionCount, availableExtensions.data()))
+		return false;
+
+	for (auto& extension : availableExtensions)
+	{
+		if (!strcmp(extension.extensionName, extensionName))
+		{
+			deviceExtensions.push_back(extensionName);
+			LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "optional device extension enabled : {}", extensionName);
+			return true;
+		}
+	}
+	return false;
+}
+
 bool VulkanBase::_pick_physical_device()
 {
 	uint32_t deviceCount = 0;
 	if (VkResult result = vkEnumeratePhysicalDevices(_instance, &deviceCount, nullptr))
 	{
-		std::cout << std::format(" ERROR : [ VulkanBase ] Failed to get the count of physical devices! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to get the count of physical devices! Error code: {}", int32_t(result));
 		return false;
 	}
 	if (deviceCount == 0)
 	{
-		std::cout << std::format(" ERROR : [ VulkanBase ] Failed to find GPUs with Vulkan support!\n");
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to find GPUs with Vulkan support!");
 		return false;
 	}
 	std::vector<VkPhysicalDevice> devices(deviceCount);
@@ -769,6 +1141,10 @@ bool VulkanBase::_pick_physical_device()
 
 		_queue_family_indices = _find_queue_families(device);
 
+		// 无窗口模式：不检查交换链，也接受集成显卡 / 软件实现（如 lavapipe）
+		if (_headless)
+			return _queue_family_indices.IsComplete() && _check_device_extension_support(device);
+
 		auto swapChainAdequate = [this, device]()->bool {
 			_swap_chain_support = _query_swap_chain_support(device);
 			return !_swap_chain_support.Formats.empty() && !_swap_chain_support.PresentModes.empty();
@@ -781,6 +1157,24 @@ bool VulkanBase::_pick_physical_device()
 			&& swapChainAdequate();
 		};
 
+	if (_headless)
+	{
+		// 按设备类型排序后选择第一个可用的：独显 > 集显 > 虚拟 > CPU
+		auto rank = [](VkPhysicalDevice device) -> int {
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(device, &properties);
+			switch (properties.deviceType)
+			{
+			case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:		return 0;
+			case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:	return 1;
+			case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:		return 2;
+			case VK_PHYSICAL_DEVICE_TYPE_CPU:				return 3;
+			default:										return 4;
+			}
+			};
+		std::stable_sort(devices.begin(), devices.end(), [&rank](VkPhysicalDevice a, VkPhysicalDevice b) { return rank(a) < rank(b); });
+	}
+
 	for (const auto& device : devices)
 	{
 		if (isDeviceSuitable(device))
@@ -792,7 +1186,7 @@ bool VulkanBase::_pick_physical_device()
 
 	if (_physical_device == VK_NULL_HANDLE)
 	{
-		std::cout << "failed to find a suitable GPU!";
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "failed to find a suitable GPU!");
 		return false;
 	}
 
@@ -802,7 +1196,8 @@ bool VulkanBase::_pick_physical_device()
 bool VulkanBase::_create_logical_device()
 {
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-	std::set<uint32_t> uniqueQueueFamilies = { _queue_family_indices.GraphicsFamily,_queue_family_indices.PresentFamily };
+	std::set<uint32_t> uniqueQueueFamilies = { _queue_family_indices.GraphicsFamily,_queue_family_indices.PresentFamily,
+		_queue_family_indices.ComputeFamily, _queue_family_indices.TransferFamily };
 	float queuePriority = 1.0f;
 	for (auto queueFamily : uniqueQueueFamilies)
 	{
@@ -813,11 +1208,87 @@ bool VulkanBase::_create_logical_device()
 		queueCreateInfo.pQueuePriorities = &queuePriority;
 	}
 
+	// 用于把 GPU 时间戳与 CPU 时钟对齐
+	_calibrated_timestamps_enabled = _enable_optional_device_extension(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(_physical_device, &supportedFeatures);
+
 	VkPhysicalDeviceFeatures deviceFeatures{};
+	// 可选：GPU 管线统计查询
+	deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+	_pipeline_statistics_supported = supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+	// 可选：一次调用多条间接绘制（网格簇渲染）
+	deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	_multi_draw_indirect_supported = supportedFeatures.multiDrawIndirect == VK_TRUE;
 
 	VkPhysicalDeviceVulkan11Features feat11 = {};
 	feat11.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
 	feat11.shaderDrawParameters = VK_TRUE;
+	void** next = &feat11.pNext;
+
+	// 可选：drawIndirectCount（1.2）与 VK_EXT_mesh_shader，都用于网格簇渲染
+	VkPhysicalDeviceVulkan12Features feat12 = {};
+	feat12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures = {};
+	meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+	// 可选：synchronization2（1.3），渲染图用它合并屏障
+	VkPhysicalDeviceVulkan13Features feat13 = {};
+	feat13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(_physical_device, &deviceProperties);
+	_descriptor_templates_supported = std::min(_api_version, deviceProperties.apiVersion) >= VK_API_VERSION_1_1;
+	if (std::min(_api_version, deviceProperties.apiVersion) >= VK_API_VERSION_1_2)
+	{
+		bool meshShaderExtension = _enable_optional_device_extension(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+
+		VkPhysicalDeviceMeshShaderFeaturesEXT supportedMeshShader = {};
+		supportedMeshShader.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+		VkPhysicalDeviceVulkan13Features supported13 = {};
+		supported13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+		supported13.pNext = meshShaderExtension ? &supportedMeshShader : nullptr;
+		bool api13 = std::min(_api_version, deviceProperties.apiVersion) >= VK_API_VERSION_1_3;
+		VkPhysicalDeviceVulkan12Features supported12 = {};
+		supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		if (api13)
+			supported12.pNext = &supported13;
+		else
+			supported12.pNext = meshShaderExtension ? &supportedMeshShader : nullptr;
+		VkPhysicalDeviceFeatures2 supportedFeatures2 = {};
+		supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supportedFeatures2.pNext = &supported12;
+		vkGetPhysicalDeviceFeatures2(_physical_device, &supportedFeatures2);
+
+		feat12.drawIndirectCount = supported12.drawIndirectCount;
+		_draw_indirect_count_supported = supported12.drawIndirectCount == VK_TRUE;
+		// 可选：描述符索引（无绑定资源堆）
+		if (BindlessHeap::IsSupported(supported12))
+		{
+			BindlessHeap::EnableFeatures(feat12);
+			_descriptor_indexing_supported = true;
+		}
+		*next = &feat12;
+		next = &feat12.pNext;
+
+		if (meshShaderExtension && supportedMeshShader.meshShader)
+		{
+			meshShaderFeatures.meshShader = VK_TRUE;
+			_mesh_shader_supported = true;
+			*next = &meshShaderFeatures;
+			next = &meshShaderFeatures.pNext;
+		}
+
+		if (api13 && supported13.synchronization2)
+		{
+			feat13.synchronization2 = VK_TRUE;
+			_synchronization2_supported = true;
+			*next = &feat13;
+			next = &feat13.pNext;
+		}
+		// 1.3 起深度比较与写入可以作为动态状态（extendedDynamicState 成为核心），不需要开启特性
+		_dynamic_depth_state_supported = api13;
+	}
 
 	VkDeviceCreateInfo deviceCreateInfo{};
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -837,12 +1308,18 @@ bool VulkanBase::_create_logical_device()
 
 	if (VkResult result = vkCreateDevice(_physical_device, &deviceCreateInfo, nullptr, &_device))
 	{
-		std::cout << std::format(" ERROR : [ VulkanBase ] failed to create logical device! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "failed to create logical device! Error code: {}", int32_t(result));
 		return false;
 	}
 
 	vkGetDeviceQueue(_device, _queue_family_indices.GraphicsFamily, 0, &_graphics_queue);
 	vkGetDeviceQueue(_device, _queue_family_indices.PresentFamily, 0, &_present_queue);
+	vkGetDeviceQueue(_device, _queue_family_indices.ComputeFamily, 0, &_compute_queue);
+	vkGetDeviceQueue(_device, _queue_family_indices.TransferFamily, 0, &_transfer_queue);
+	LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "queue families : graphics {}, present {}, compute {}{}, transfer {}{}",
+		_queue_family_indices.GraphicsFamily, _queue_family_indices.PresentFamily,
+		_queue_family_indices.ComputeFamily, _queue_family_indices.HasDedicatedComputeFamily ? " (dedicated)" : "",
+		_queue_family_indices.TransferFamily, _queue_family_indices.HasDedicatedTransferFamily ? " (dedicated)" : "");
 
 	return true;
 }
@@ -860,7 +1337,7 @@ bool VulkanBase::_create_swap_chain()
 	// 获取最新的 Surface Capabilities
 	if (VkResult result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(_physical_device, _surface, &_swap_chain_support.Capabilities))
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to Get Physical Device Surface Capabilities! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to Get Physical Device Surface Capabilities! Error code: {}", int32_t(result));
 		return false;
 	}
 	auto extent = _choose_swap_extent(_swap_chain_support.Capabilities);
@@ -915,20 +1392,20 @@ bool VulkanBase::_create_swap_chain()
 	// 
 	if (VkResult result = vkCreateSwapchainKHR(_device, &createInfo, nullptr, &_swap_chain))
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to create a swapchain! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create a swapchain! Error code: {}", int32_t(result));
 		return false;
 	}
 
 	uint32_t swapchainImageCount;
 	if (VkResult result = vkGetSwapchainImagesKHR(_device, _swap_chain, &swapchainImageCount, nullptr))
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to get the count of swapchain images! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to get the count of swapchain images! Error code: {}", int32_t(result));
 		return false;
 	}
 	_swap_chain_images.resize(swapchainImageCount);
 	if (VkResult result = vkGetSwapchainImagesKHR(_device, _swap_chain, &swapchainImageCount, _swap_chain_images.data()))
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to get swapchain images! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to get swapchain images! Error code: {}", int32_t(result));
 		return false;
 	}
 	_swap_chain_image_format = surfaceFormat.format;
@@ -938,6 +1415,49 @@ bool VulkanBase::_create_swap_chain()
 	return true;
 }
 
+bool VulkanBase::_create_offscreen_targets()
+{
+	_swap_chain_image_format = VK_FORMAT_R8G8B8A8_UNORM;
+	_swap_chain_extent = { _frame_buffer_width, _frame_buffer_height };
+	_swap_chain_image_count = MAX_FRAMES_IN_FLIGHT;
+	_swap_chain_images.resize(_swap_chain_image_count, VK_NULL_HANDLE);
+
+	for (uint32_t i = 0; i < _swap_chain_image_count; ++i)
+	{
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = _swap_chain_image_format;
+		imageInfo.extent = { _swap_chain_extent.width, _swap_chain_extent.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (!UseVmaCreateImage(imageInfo, _swap_chain_images[i]))
+		{
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create offscreen target {}!", i);
+			return false;
+		}
+	}
+
+	LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "headless mode, offscreen targets : {} x {} x {}",
+		_swap_chain_extent.width, _swap_chain_extent.height, _swap_chain_image_count);
+	return true;
+}
+
+void VulkanBase::_destroy_offscreen_targets()
+{
+	for (auto image : _swap_chain_images)
+	{
+		UseVmaDestroyImage(image);
+	}
+	_swap_chain_images.clear();
+}
+
 bool VulkanBase::_recreate_swap_chain()
 {
 	while (_frame_buffer_width == 0 || _frame_buffer_height == 0)
@@ -951,6 +1471,8 @@ bool VulkanBase::_recreate_swap_chain()
 
 	if (!_create_swap_chain()) return false;
 	if (!_create_image_views()) return false;
+	// 交换链图像的数量与大小可能变化，重新声明渲染图（GPU 已空闲，可以释放临时图像），深度图像随之重建
+	if (!_build_frame_graph()) return false;
 	if (!_create_framebuffers()) return false;
 
 	return true;
@@ -962,6 +1484,8 @@ bool VulkanBase::_cleanup_swap_chain()
 	{
 		vkDestroyFramebuffer(_device, framebuffer, nullptr);
 	}
+	vkDestroyFramebuffer(_device, _depth_prepass_framebuffer, nullptr);
+	_depth_prepass_framebuffer = VK_NULL_HANDLE;
 
 	for (auto imageView : _swap_chain_image_views)
 	{
@@ -995,7 +1519,7 @@ bool VulkanBase::_create_image_views()
 
 		if (VkResult result = vkCreateImageView(_device, &imageViewCreateInfo, nullptr, &_swap_chain_image_views[i]))
 		{
-			std::cout << std::format("ERROR : [ VulkanBase ] Failed to Create ImageView! Error code: {}\n", int32_t(result));
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to Create ImageView! Error code: {}", int32_t(result));
 			return false;
 		}
 	}
@@ -1004,6 +1528,13 @@ bool VulkanBase::_create_image_views()
 
 bool VulkanBase::_create_render_pass()
 {
+	_depth_format = _find_depth_format();
+	if (_depth_format == VK_FORMAT_UNDEFINED)
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to find a supported depth format!");
+		return false;
+	}
+
 	VkAttachmentDescription colorAttachment{};
 	colorAttachment.format = _swap_chain_image_format;
 	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -1011,44 +1542,95 @@ bool VulkanBase::_create_render_pass()
 	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	// 进入与离开 render pass 时的布局转换（以及等待 acquire）由渲染图的屏障完成
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	// 深度只在一帧之内使用，主通道结束后不需要保存
+	VkAttachmentDescription depthAttachment{};
+	depthAttachment.format = _depth_format;
+	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 	VkAttachmentReference colorAttachmentRef{};
 	colorAttachmentRef.attachment = 0;
 	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+	VkAttachmentReference depthAttachmentRef{};
+	depthAttachmentRef.attachment = 1;
+	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
 	VkSubpassDescription subpass{};
 	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 	subpass.colorAttachmentCount = 1;
 	subpass.pColorAttachments = &colorAttachmentRef;
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
-	VkSubpassDependency dependency{};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
+	VkAttachmentDescription attachments[] = { colorAttachment, depthAttachment };
 	VkRenderPassCreateInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = 1;
-	renderPassInfo.pAttachments = &colorAttachment;
+	renderPassInfo.attachmentCount = 2;
+	renderPassInfo.pAttachments = attachments;
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
+	renderPassInfo.dependencyCount = 0;
+	renderPassInfo.pDependencies = nullptr;
 
 	if (VkResult result = vkCreateRenderPass(_device, &renderPassInfo, nullptr, &_render_pass))
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to create render pass! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create render pass! Error code: {}", int32_t(result));
+		return false;
+	}
+
+	// 有深度预通道时主通道载入预通道写入的深度；只有载入方式不同，与 _render_pass 兼容，共用帧缓冲与管线
+	attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	if (VkResult result = vkCreateRenderPass(_device, &renderPassInfo, nullptr, &_depth_load_render_pass))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create depth load render pass! Error code: {}", int32_t(result));
+		return false;
+	}
+
+	// 预通道只有深度附件，写入的深度留给主通道
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	VkAttachmentReference prepassDepthRef{};
+	prepassDepthRef.attachment = 0;
+	prepassDepthRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription prepassSubpass{};
+	prepassSubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	prepassSubpass.colorAttachmentCount = 0;
+	prepassSubpass.pDepthStencilAttachment = &prepassDepthRef;
+
+	renderPassInfo.attachmentCount = 1;
+	renderPassInfo.pAttachments = &depthAttachment;
+	renderPassInfo.pSubpasses = &prepassSubpass;
+	if (VkResult result = vkCreateRenderPass(_device, &renderPassInfo, nullptr, &_depth_prepass_render_pass))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create depth prepass render pass! Error code: {}", int32_t(result));
 		return false;
 	}
 
 	return true;
 }
 
+VkFormat VulkanBase::_find_depth_format()
+{
+	// 不需要模板，优先纯深度格式
+	for (VkFormat format : { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT })
+	{
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(_physical_device, format, &properties);
+		if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+			return format;
+	}
+	return VK_FORMAT_UNDEFINED;
+}
+
 bool VulkanBase::_create_descriptor_set_layout()
 {
 	VkDescriptorSetLayoutBinding uboLayoutBinding{};
@@ -1056,33 +1638,121 @@ bool VulkanBase::_create_descriptor_set_layout()
 	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 	uboLayoutBinding.descriptorCount = 1;
 	// 着色器阶段
-	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	// 网格簇剔除（计算）与网格着色器也读取 UBO
+	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+	if (_mesh_shader_supported)
+		uboLayoutBinding.stageFlags |= VK_SHADER_STAGE_MESH_BIT_EXT;
 	uboLayoutBinding.pImmutableSamplers = nullptr;
 
-	VkDescriptorSetLayoutCreateInfo layoutInfo{};
-	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutInfo.bindingCount = 1;
-	layoutInfo.pBindings = &uboLayoutBinding;
+	_descriptor_set_layout = _descriptor_allocator.GetLayout(&uboLayoutBinding, 1);
+	return _descriptor_set_layout != VK_NULL_HANDLE;
+}
 
-	if (VkResult result = vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &_descriptor_set_layout))
+bool VulkanBase::_create_graphics_pipeline()
+{
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &_descriptor_set_layout;
+	pipelineLayoutInfo.pushConstantRangeCount = 0;
+	pipelineLayoutInfo.pPushConstantRanges = nullptr;
+
+	if (VkResult result = vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &_pipeline_layout))
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to create descriptor set layout! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create pipeline layout! Error code: {}", int32_t(result));
 		return false;
 	}
 
+	// 主管线读取位置流和属性流；只需要位置的变体只绑定位置流
+	constexpr auto bindingDescriptions = SplitVertexStreams::getBindingDescriptions();
+	constexpr auto attributeDescriptions = SplitVertexStreams::getAttributeDescriptions();
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+	if (!_create_pipeline_variant("fristTriangle", &vertexInputInfo, _pipeline_layout, _graphics_pipeline))
+		return false;
+
+	constexpr auto positionBindingDescriptions = PositionOnlyStreams::getBindingDescriptions();
+	constexpr auto positionAttributeDescriptions = PositionOnlyStreams::getAttributeDescriptions();
+	VkPipelineVertexInputStateCreateInfo positionInputInfo{};
+	positionInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	positionInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(positionBindingDescriptions.size());
+	positionInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(positionAttributeDescriptions.size());
+	positionInputInfo.pVertexBindingDescriptions = positionBindingDescriptions.data();
+	positionInputInfo.pVertexAttributeDescriptions = positionAttributeDescriptions.data();
+
+	if (!_create_pipeline_variant("positionOnly", &positionInputInfo, _pipeline_layout, _position_only_pipeline))
+		return false;
+
+	// 实例化变体：顶点流之后多一个按实例步进的实例流
+	constexpr auto instancedBindingDescriptions = InstancedSplitVertexStreams::getBindingDescriptions();
+	constexpr auto instancedAttributeDescriptions = InstancedSplitVertexStreams::getAttributeDescriptions();
+	VkPipelineVertexInputStateCreateInfo instancedInputInfo{};
+	instancedInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	instancedInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(instancedBindingDescriptions.size());
+	instancedInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(instancedAttributeDescriptions.size());
+	instancedInputInfo.pVertexBindingDescriptions = instancedBindingDescriptions.data();
+	instancedInputInfo.pVertexAttributeDescriptions = instancedAttributeDescriptions.data();
+
+	if (!_create_pipeline_variant("instanced", &instancedInputInfo, _pipeline_layout, _instance_pipelines[DRAW_PIPELINE_COLOR]))
+		return false;
+
+	constexpr auto instancedPositionBindingDescriptions = InstancedPositionOnlyStreams::getBindingDescriptions();
+	constexpr auto instancedPositionAttributeDescriptions = InstancedPositionOnlyStreams::getAttributeDescriptions();
+	VkPipelineVertexInputStateCreateInfo instancedPositionInputInfo{};
+	instancedPositionInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	instancedPositionInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(instancedPositionBindingDescriptions.size());
+	instancedPositionInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(instancedPositionAttributeDescriptions.size());
+	instancedPositionInputInfo.pVertexBindingDescriptions = instancedPositionBindingDescriptions.data();
+	instancedPositionInputInfo.pVertexAttributeDescriptions = instancedPositionAttributeDescriptions.data();
+
+	if (!_create_pipeline_variant("instancedPositionOnly", &instancedPositionInputInfo, _pipeline_layout, _instance_pipelines[DRAW_PIPELINE_POSITION_ONLY]))
+		return false;
+
+	// 间接绘制变体：顶点流与主管线相同，逐绘制数据走间接绘制列表的管线布局（集 1 + 推送常量）
+	if (_draw_list.GetPipelineLayout())
+	{
+		// 有无绑定资源堆时彩色变体按 DrawData::TextureIndex 采样纹理
+		const char* colorShader = _bindless_heap.IsInitialized() ? "indirectBindless" : "indirect";
+		if (!_create_pipeline_variant(colorShader, &vertexInputInfo, _draw_list.GetPipelineLayout(), _indirect_pipelines[DRAW_PIPELINE_COLOR])
+			|| !_create_pipeline_variant("indirectPositionOnly", &positionInputInfo, _draw_list.GetPipelineLayout(), _indirect_pipelines[DRAW_PIPELINE_POSITION_ONLY]))
+			return false;
+	}
+
+	// 深度预通道只需要位置，复用只读位置的顶点着色器；失败时只是不能开启预通道
+	if (_dynamic_depth_state_supported)
+	{
+		_create_pipeline_variant("positionOnly", &positionInputInfo, _pipeline_layout, _depth_prepass_pipeline, true);
+		_create_pipeline_variant("instancedPositionOnly", &instancedPositionInputInfo, _pipeline_layout, _depth_prepass_instance_pipeline, true);
+		if (_draw_list.GetPipelineLayout())
+			_create_pipeline_variant("indirectPositionOnly", &positionInputInfo, _draw_list.GetPipelineLayout(), _depth_prepass_indirect_pipeline, true);
+	}
+
+	// 网格着色器管线失败时只是不能切到网格着色器绘制
+	if (_meshlet_renderer.IsMeshShaderEnabled() && _meshlet_renderer.GetPipelineLayout())
+		_create_pipeline_variant("meshletMesh", nullptr, _meshlet_renderer.GetPipelineLayout(), _meshlet_mesh_pipeline);
 	return true;
 }
 
-bool VulkanBase::_create_graphics_pipeline()
+bool VulkanBase::_create_pipeline_variant(const char* shader_name, const VkPipelineVertexInputStateCreateInfo* vertex_input, VkPipelineLayout layout, VkPipeline& pipeline,
+	bool depth_only)
 {
-	auto vert_path = RunPath + "\\shader\\vulkan\\SPV\\fristTriangle.slang.vert.spv";
+	TRACE_ZONE_DETAIL("CreateGraphicsPipeline", "pipeline", shader_name);
+
+	// 网格着色器管线没有顶点输入与图元装配阶段
+	bool meshShader = vertex_input == nullptr;
+	auto vert_path = RunPath + std::format("\\shader\\vulkan\\SPV\\{}.slang.{}.spv", shader_name, meshShader ? "mesh" : "vert");
 	VkEngineShaderModule vertShaderModule(_device, vert_path);
-	auto frag_path = RunPath + "\\shader\\vulkan\\SPV\\fristTriangle.slang.frag.spv";
+	auto frag_path = RunPath + std::format("\\shader\\vulkan\\SPV\\{}.slang.frag.spv", shader_name);
 	VkEngineShaderModule fragShaderModule(_device, frag_path);
 
 	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
 	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	vertShaderStageInfo.stage = meshShader ? VK_SHADER_STAGE_MESH_BIT_EXT : VK_SHADER_STAGE_VERTEX_BIT;
 	vertShaderStageInfo.module = vertShaderModule.GetShaderModule();
 	vertShaderStageInfo.pName = "main";
 
@@ -1094,16 +1764,6 @@ bool VulkanBase::_create_graphics_pipeline()
 
 	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
-	// add vertex
-	auto bindingDescription = Vertex::getBindingDescription();
-	auto attributeDescriptions = Vertex::getAttributeDescriptions();
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
-
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
 	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
@@ -1113,6 +1773,12 @@ bool VulkanBase::_create_graphics_pipeline()
 	VK_DYNAMIC_STATE_VIEWPORT,
 	VK_DYNAMIC_STATE_SCISSOR
 	};
+	// 主通道有没有深度预通道都用同一组管线，录制时设置比较方式与是否写入
+	if (!depth_only && _dynamic_depth_state_supported)
+	{
+		dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_COMPARE_OP);
+		dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE);
+	}
 
 	VkPipelineDynamicStateCreateInfo dynamicState{};
 	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
@@ -1147,6 +1813,15 @@ bool VulkanBase::_create_graphics_pipeline()
 	multisampling.alphaToCoverageEnable = VK_FALSE;
 	multisampling.alphaToOneEnable = VK_FALSE;
 
+	// 不支持动态深度状态时固定为 LESS 并写入（没有预通道）
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
+
 	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
 	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 	colorBlendAttachment.blendEnable = VK_FALSE;
@@ -1161,47 +1836,36 @@ bool VulkanBase::_create_graphics_pipeline()
 	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 	colorBlending.logicOpEnable = VK_FALSE;
 	colorBlending.logicOp = VK_LOGIC_OP_COPY;
-	colorBlending.attachmentCount = 1;
+	// 深度预通道的 render pass 没有颜色附件
+	colorBlending.attachmentCount = depth_only ? 0 : 1;
 	colorBlending.pAttachments = &colorBlendAttachment;
 	colorBlending.blendConstants[0] = 0.0f;
 	colorBlending.blendConstants[1] = 0.0f;
 	colorBlending.blendConstants[2] = 0.0f;
 	colorBlending.blendConstants[3] = 0.0f;
 
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &_descriptor_set_layout;
-	pipelineLayoutInfo.pushConstantRangeCount = 0;
-	pipelineLayoutInfo.pPushConstantRanges = nullptr;
-
-	if (VkResult result = vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &_pipeline_layout))
-	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to create pipeline layout! Error code: {}\n", int32_t(result));
-		return false;
-	}
-
 	VkGraphicsPipelineCreateInfo pipelineInfo{};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = 2;
+	// 只写深度时不需要片元着色器
+	pipelineInfo.stageCount = depth_only ? 1 : 2;
 	pipelineInfo.pStages = shaderStages;
-	pipelineInfo.pVertexInputState = &vertexInputInfo;
-	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pVertexInputState = vertex_input;
+	pipelineInfo.pInputAssemblyState = meshShader ? nullptr : &inputAssembly;
 	pipelineInfo.pViewportState = &viewportState;
 	pipelineInfo.pRasterizationState = &rasterizer;
 	pipelineInfo.pMultisampleState = &multisampling;
-	pipelineInfo.pDepthStencilState = nullptr;
+	pipelineInfo.pDepthStencilState = &depthStencil;
 	pipelineInfo.pColorBlendState = &colorBlending;
 	pipelineInfo.pDynamicState = &dynamicState;
-	pipelineInfo.layout = _pipeline_layout;
-	pipelineInfo.renderPass = _render_pass;
+	pipelineInfo.layout = layout;
+	pipelineInfo.renderPass = depth_only ? _depth_prepass_render_pass : _render_pass;
 	pipelineInfo.subpass = 0;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 	pipelineInfo.basePipelineIndex = -1;
 
-	if (VkResult result = vkCreateGraphicsPipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_graphics_pipeline))
+	if (VkResult result = vkCreateGraphicsPipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline))
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to create graphics pipeline! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create graphics pipeline {}! Error code: {}", shader_name, int32_t(result));
 		return false;
 	}
 
@@ -1210,109 +1874,155 @@ bool VulkanBase::_create_graphics_pipeline()
 	return true;
 }
 
-bool VulkanBase::_create_vertex_buffer()
+bool VulkanBase::_vma_create_device_local_buffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer)
 {
-	
-	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
 	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-
-	if (!CreateBuffer(bufferSize, 
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-		stagingBuffer, 
-		stagingBufferMemory))
+	if (!UseVmaCreateBuffer(size,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		stagingBuffer))
 	{
 		return false;
 	}
 
-	void* data;
-	vkMapMemory(_device, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, vertices.data(), (size_t)bufferSize);
-	vkUnmapMemory(_device, stagingBufferMemory);
+	void* mapped;
+	vmaMapMemory(vmaAllocator, MapBufferAllocation[stagingBuffer], &mapped);
+	memcpy(mapped, data, (size_t)size);
+	vmaUnmapMemory(vmaAllocator, MapBufferAllocation[stagingBuffer]);
 
-	if (!CreateBuffer(bufferSize, 
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+	if (!UseVmaCreateBuffer(size,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		_vertex_buffer, 
-		_vertex_buffer_memory))
+		buffer, true))
 	{
+		UseVmaDestroyBuffer(stagingBuffer);
 		return false;
 	}
 
-	CopyBuffer(stagingBuffer, _vertex_buffer, bufferSize);
+	CopyBuffer(stagingBuffer, buffer, size);
 
-	vkDestroyBuffer(_device, stagingBuffer, nullptr);
-	vkFreeMemory(_device, stagingBufferMemory, nullptr);
+	UseVmaDestroyBuffer(stagingBuffer);
 
 	return true;
 }
 
 bool VulkanBase::_vma_create_vertex_buffer()
 {
-	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+	TRACE_ZONE_DETAIL("UploadVertexBuffer", "upload", "vertex");
+
+	// 拆成位置流与属性流两个缓冲
+	std::vector<PositionStreamLayout::Vertex> positions(vertices.size());
+	std::vector<AttributeStreamLayout::Vertex> attributes(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+		SplitVertex(vertices[i], positions[i], attributes[i]);
+
+	// 内置网格以原点为中心
+	float radius = 0.0f;
+	for (auto& vertex : vertices)
+		radius = std::max(radius, glm::length(vertex.position));
+	_mesh_bounds = glm::vec4(0.0f, 0.0f, 0.0f, radius);
+
+	return _vma_create_device_local_buffer(positions.data(), sizeof(positions[0]) * positions.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, _position_buffer)
+		&& _vma_create_device_local_buffer(attributes.data(), sizeof(attributes[0]) * attributes.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, _attribute_buffer);
+}
 
-	VkBuffer stagingBuffer;
+bool VulkanBase::_vma_create_index_buffer()
+{
+	TRACE_ZONE_DETAIL("UploadIndexBuffer", "upload", "index");
 
-	if (!UseVmaCreateBuffer(bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer))
-	{
-		return false;
-	}
+	_index_type = VK_INDEX_TYPE_UINT16;
+	_index_count = static_cast<uint32_t>(indices.size());
+	return _vma_create_device_local_buffer(indices.data(), sizeof(indices[0]) * indices.size(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, _index_buffer);
+}
 
-	void* data;
-	vmaMapMemory(vmaAllocator, MapBufferAllocation[stagingBuffer], &data);
-	memcpy(data, vertices.data(), (size_t)bufferSize);
-	vmaUnmapMemory(vmaAllocator, MapBufferAllocation[stagingBuffer]);
+ComputeContext::KernelHandle VulkanBase::CreateComputeKernel(const std::string& shader_name, uint32_t buffer_count, uint32_t push_constant_size)
+{
+	return _compute.CreateKernel(RunPath + std::format("\\shader\\vulkan\\SPV\\{}.slang.comp.spv", shader_name), buffer_count, push_constant_size);
+}
 
-	if (!UseVmaCreateBuffer(bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		_vertex_buffer))
+bool VulkanBase::LoadMesh(const std::string& path)
+{
+	TRACE_ZONE_DETAIL("LoadMesh", "upload", path);
+
+	MappedFile file;
+	if (!file.Open(path))
 	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "failed to map mesh file : {}", path);
 		return false;
 	}
 
-	CopyBuffer(stagingBuffer, _vertex_buffer, bufferSize);
-
-	UseVmaDestroyBuffer(stagingBuffer);
-
-	return true;
-}
-
-bool VulkanBase::_vma_create_index_buffer()
-{
-	VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-	VkBuffer stagingBuffer;
-	if (!UseVmaCreateBuffer(bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer))
+	if (const char* error = ValidateMeshFile(file.Data(), file.Size(), PositionStreamLayout::STRIDE, AttributeStreamLayout::STRIDE))
 	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "invalid mesh file {} : {}", path, error);
 		return false;
 	}
 
-	void* data;
-	vmaMapMemory(vmaAllocator, MapBufferAllocation[stagingBuffer], &data);
-	memcpy(data, indices.data(), (size_t)bufferSize);
-	vmaUnmapMemory(vmaAllocator, MapBufferAllocation[stagingBuffer]);
+	auto& header = *reinterpret_cast<const MeshFileHeader*>(file.Data());
 
-	if (!UseVmaCreateBuffer(bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		_index_buffer))
-	{
+	// 可移动缓冲按成员地址登记到碎片整理器，必须直接创建到成员上：先释放旧网格，上传失败时退回内置网格
+	_meshlet_renderer.ClearMesh();
+	UseVmaDestroyBuffer(_position_buffer);
+	UseVmaDestroyBuffer(_attribute_buffer);
+	UseVmaDestroyBuffer(_index_buffer);
+	UseVmaDestroyBuffer(_meshlet_buffer);
+	UseVmaDestroyBuffer(_meshlet_vertex_buffer);
+	UseVmaDestroyBuffer(_meshlet_triangle_buffer);
+	_position_buffer = _attribute_buffer = _index_buffer = VK_NULL_HANDLE;
+	_meshlet_buffer = _meshlet_vertex_buffer = _meshlet_triangle_buffer = VK_NULL_HANDLE;
+
+	// 顶点流同时作为存储缓冲供网格着色器读取
+	bool uploaded = _vma_create_device_local_buffer(file.Data() + header.PositionOffset,
+			VkDeviceSize(header.VertexCount) * header.PositionStride, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, _position_buffer)
+		&& _vma_create_device_local_buffer(file.Data() + header.AttributeOffset,
+			VkDeviceSize(header.VertexCount) * header.AttributeStride, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, _attribute_buffer)
+		&& _vma_create_device_local_buffer(file.Data() + header.IndexOffset,
+			VkDeviceSize(header.IndexCount) * header.IndexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, _index_buffer);
+	if (!uploaded)
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "failed to upload mesh : {}, falling back to built-in mesh", path);
+		UseVmaDestroyBuffer(_position_buffer);
+		UseVmaDestroyBuffer(_attribute_buffer);
+		UseVmaDestroyBuffer(_index_buffer);
+		_position_buffer = _attribute_buffer = _index_buffer = VK_NULL_HANDLE;
+		_vma_create_vertex_buffer();
+		_vma_create_index_buffer();
 		return false;
 	}
 
-	CopyBuffer(stagingBuffer, _index_buffer, bufferSize);
+	_index_type = header.IndexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	_index_count = header.IndexCount;
+	glm::vec3 boundsMin(header.BoundsMin[0], header.BoundsMin[1], header.BoundsMin[2]);
+	glm::vec3 boundsMax(header.BoundsMax[0], header.BoundsMax[1], header.BoundsMax[2]);
+	_mesh_bounds = glm::vec4((boundsMin + boundsMax) * 0.5f, glm::length(boundsMax - boundsMin) * 0.5f);
 
-	UseVmaDestroyBuffer(stagingBuffer);
+	// 簇数据可选：上传失败时只是不能走网格簇渲染
+	if (header.MeshletCount > 0)
+	{
+		bool meshletsUploaded = _vma_create_device_local_buffer(file.Data() + header.MeshletOffset,
+				VkDeviceSize(header.MeshletCount) * sizeof(MeshFileMeshlet), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, _meshlet_buffer)
+			&& _vma_create_device_local_buffer(file.Data() + header.MeshletVertexOffset,
+				VkDeviceSize(header.MeshletVertexCount) * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, _meshlet_vertex_buffer)
+			&& _vma_create_device_local_buffer(file.Data() + header.MeshletTriangleOffset,
+				VkDeviceSize(header.IndexCount / 3) * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, _meshlet_triangle_buffer);
+		if (meshletsUploaded)
+		{
+			MeshletRenderer::MeshBuffers meshBuffers;
+			meshBuffers.Positions = _position_buffer;
+			meshBuffers.Attributes = _attribute_buffer;
+			meshBuffers.Meshlets = _meshlet_buffer;
+			meshBuffers.MeshletVertices = _meshlet_vertex_buffer;
+			meshBuffers.MeshletTriangles = _meshlet_triangle_buffer;
+			meshBuffers.MeshletCount = header.MeshletCount;
+			_meshlet_renderer.SetMesh(meshBuffers);
+		}
+		else
+		{
+			LOG_WARNING(LOG_CATEGORY_VULKAN_BASE, "failed to upload meshlets of {}, meshlet rendering unavailable", path);
+		}
+	}
 
+	LOG_INFO(LOG_CATEGORY_VULKAN_BASE, "loaded mesh {} : {} vertices, {} triangles, {}-bit indices, {} meshlets",
+		path, header.VertexCount, header.IndexCount / 3, header.IndexSize * 8, header.MeshletCount);
 	return true;
 }
 
@@ -1338,65 +2048,21 @@ bool VulkanBase::_vma_create_uniform_buffers()
 	return true;
 }
 
-bool VulkanBase::_create_descriptor_pool()
-{
-	VkDescriptorPoolSize poolSize{};
-	poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSize.descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-
-	VkDescriptorPoolCreateInfo poolInfo{};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.poolSizeCount = 1;
-	poolInfo.pPoolSizes = &poolSize;
-	poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-
-	if (VkResult result = vkCreateDescriptorPool(_device, &poolInfo, nullptr, &_descriptor_pool))
-	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to create descriptor pool! Error code: {}\n", int32_t(result));
-		return false;
-	}
-
-	return true;
-}
-
 bool VulkanBase::_create_descriptor_sets()
 {
-	std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, _descriptor_set_layout);
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = _descriptor_pool;
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-	allocInfo.pSetLayouts = layouts.data();
-
+	// 每帧一个常驻的 UBO 集
 	_descriptor_sets.resize(MAX_FRAMES_IN_FLIGHT);
-	if (VkResult result = vkAllocateDescriptorSets(_device, &allocInfo, _descriptor_sets.data()))
+	for (auto& set : _descriptor_sets)
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to allocate descriptor sets! Error code: {}\n", int32_t(result));
-		return false;
+		set = _descriptor_allocator.Allocate(_descriptor_set_layout);
+		if (!set)
+			return false;
 	}
 
+	// 所有帧的写入合成一次 vkUpdateDescriptorSets
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
-	{
-		VkDescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = _uniform_buffers[i];
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(UniformBufferObject);
-
-		VkWriteDescriptorSet descriptorWrite{};
-		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrite.dstSet = _descriptor_sets[i];
-		descriptorWrite.dstBinding = 0;
-		descriptorWrite.dstArrayElement = 0;
-		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrite.descriptorCount = 1;
-		descriptorWrite.pBufferInfo = &bufferInfo;
-		descriptorWrite.pImageInfo = nullptr; // Optional
-		descriptorWrite.pTexelBufferView = nullptr; // Optional
-
-		vkUpdateDescriptorSets(_device, 1, &descriptorWrite, 0, nullptr);
-	}
-
-	
+		_descriptor_writer.WriteBuffer(_descriptor_sets[i], 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, _uniform_buffers[i], 0, sizeof(UniformBufferObject));
+	_descriptor_writer.Flush();
 
 	return true;
 }
@@ -1405,26 +2071,49 @@ bool VulkanBase::_create_framebuffers()
 {
 	_swap_chain_framebuffers.resize(_swap_chain_image_views.size());
 
+	// 深度图像由渲染图分配，所有交换链图像共用一张
+	VkImageView depthView = _frame_graph.GetImageView(_graph_depth);
+	if (!depthView)
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create framebuffer! depth image is not allocated");
+		return false;
+	}
+
 	for(size_t i = 0; i < _swap_chain_image_views.size(); ++i)
 	{
 		VkImageView attachments[] = {
-			_swap_chain_image_views[i]
+			_swap_chain_image_views[i],
+			depthView
 		};
 		VkFramebufferCreateInfo framebufferInfo{};
 		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
 		framebufferInfo.renderPass = _render_pass;
-		framebufferInfo.attachmentCount = 1;
+		framebufferInfo.attachmentCount = 2;
 		framebufferInfo.pAttachments = attachments;
 		framebufferInfo.width = _swap_chain_extent.width;
 		framebufferInfo.height = _swap_chain_extent.height;
 		framebufferInfo.layers = 1;
 		if (VkResult result = vkCreateFramebuffer(_device, &framebufferInfo, nullptr, &_swap_chain_framebuffers[i]))
 		{
-			std::cout << std::format("ERROR : [ VulkanBase ] Failed to create framebuffer! Error code: {}\n", int32_t(result));
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create framebuffer! Error code: {}", int32_t(result));
 			return false;
 		}
 	}
 
+	VkFramebufferCreateInfo prepassFramebufferInfo{};
+	prepassFramebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	prepassFramebufferInfo.renderPass = _depth_prepass_render_pass;
+	prepassFramebufferInfo.attachmentCount = 1;
+	prepassFramebufferInfo.pAttachments = &depthView;
+	prepassFramebufferInfo.width = _swap_chain_extent.width;
+	prepassFramebufferInfo.height = _swap_chain_extent.height;
+	prepassFramebufferInfo.layers = 1;
+	if (VkResult result = vkCreateFramebuffer(_device, &prepassFramebufferInfo, nullptr, &_depth_prepass_framebuffer))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create depth prepass framebuffer! Error code: {}", int32_t(result));
+		return false;
+	}
+
 	return true;
 }
 
@@ -1436,7 +2125,7 @@ bool VulkanBase::_create_command_pool()
 	poolInfo.queueFamilyIndex = _queue_family_indices.GraphicsFamily;
 	if (VkResult result = vkCreateCommandPool(_device, &poolInfo, nullptr, &_command_pool))
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to create command pool! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create command pool! Error code: {}", int32_t(result));
 		return false;
 	}
 
@@ -1453,7 +2142,7 @@ bool VulkanBase::_create_command_buffer()
 
 	if (VkResult result = vkAllocateCommandBuffers(_device, &allocInfo, &_command_buffer))
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to allocate command buffer! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to allocate command buffer! Error code: {}", int32_t(result));
 		return false;
 	}
 
@@ -1469,24 +2158,279 @@ bool VulkanBase::_record_command_buffer(uint32_t imageIndex, uint32_t frame_inde
 
 	if (VkResult result = vkBeginCommandBuffer(_command_buffer, &beginInfo))
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to begin recording command buffer! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to begin recording command buffer! Error code: {}", int32_t(result));
+		return false;
+	}
+
+	_gpu_profiler.BeginFrame(_command_buffer, frame_index);
+	// 该帧上一次的命令已执行完，把登记与更新写入该帧的无绑定描述符集
+	if (_bindless_heap.IsInitialized())
+		_bindless_heap.BeginFrame(frame_index, _descriptor_writer);
+
+	// 有实例或间接绘制时绘制这两个列表，否则绘制当前网格
+	auto& state = _frame_state;
+	state.ImageIndex = imageIndex;
+	state.FrameIndex = frame_index;
+	state.Instancing = !_instance_batcher.IsEmpty() && _prepare_instance_buffer(frame_index);
+	state.Indirect = !_draw_list.IsEmpty() && _indirect_pipelines[DRAW_PIPELINE_COLOR] && _draw_list.Prepare(frame_index);
+	state.SceneDraws = state.Instancing || state.Indirect;
+	state.MeshletPath = !state.SceneDraws && _meshlet_rendering && _meshlet_renderer.HasMesh();
+	state.MeshShading = state.MeshletPath && _mesh_shading && _meshlet_mesh_pipeline;
+	if (state.MeshletPath)
+		_meshlet_renderer.Prepare(frame_index);
+	// 无绑定资源堆、间接绘制列表与网格簇渲染器登记的写入在录制之前一次提交，之后绑定的集都已写好
+	_descriptor_writer.Flush();
+	bool gpuCulling = state.Indirect && _draw_list.IsGpuCulling();
+	bool asyncCulling = gpuCulling && _async_compute.IsEnabled();
+	if (asyncCulling)
+	{
+		// 在计算队列上剔除，图形提交在读取间接命令与 drawIds 之前等待
+		VkDescriptorSet uboSet = _descriptor_sets[frame_index];
+		_async_compute.AddPass("DrawCull", VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+			[this, uboSet](VkCommandBuffer command_buffer, uint32_t frame) {
+				_draw_list.RecordCull(command_buffer, frame, uboSet, true);
+			});
+	}
+
+	_frame_graph.SetImportedImage(_graph_backbuffer, _swap_chain_images[imageIndex], _swap_chain_image_views[imageIndex]);
+	_frame_graph.SetPassEnabled(_graph_draw_cull_pass, gpuCulling && !asyncCulling);
+	_frame_graph.SetPassEnabled(_graph_meshlet_cull_pass, state.MeshletPath);
+	// 网格着色器绘制没有只写深度的管线，不做预通道
+	bool prepassPipelines = state.SceneDraws
+		? (!state.Instancing || _depth_prepass_instance_pipeline) && (!state.Indirect || _depth_prepass_indirect_pipeline)
+		: _depth_prepass_pipeline != VK_NULL_HANDLE;
+	state.DepthPrepass = _depth_prepass && _dynamic_depth_state_supported && !state.MeshShading && prepassPipelines;
+	_frame_graph.SetPassEnabled(_graph_depth_prepass_pass, state.DepthPrepass);
+	_frame_graph.Execute(_command_buffer);
+
+	if (VkResult result = vkEndCommandBuffer(_command_buffer))
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to record command buffer! Error code: {}", int32_t(result));
 		return false;
 	}
 
+	return true;
+}
+
+bool VulkanBase::_build_frame_graph()
+{
+	_frame_graph.Reset();
+	_frame_graph.SetExtent(_swap_chain_extent);
+
+	// 交换链图像：等待 acquire 信号量（颜色输出阶段）后从 UNDEFINED 转换，结束时转换到呈现（无窗口模式没有启用 VK_KHR_swapchain，转换到拷贝源）
+	RenderGraph::ResourceState backbufferFinal = _headless
+		? RenderGraph::ResourceState{ VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL }
+		: RenderGraph::ResourceState{ VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR };
+	_graph_backbuffer = _frame_graph.ImportImage("Backbuffer", _swap_chain_image_format,
+		{ VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED }, backbufferFinal);
+	// 剔除写出的间接命令（各帧各自的缓冲，只用全局内存屏障）
+	_graph_draw_commands = _frame_graph.ImportBuffer("DrawCommands");
+	_graph_meshlet_commands = _frame_graph.ImportBuffer("MeshletCommands");
+	// 深度只在一帧之内使用，交给渲染图作为临时图像（随交换链重建）
+	_graph_depth = _frame_graph.CreateImage("Depth", { _depth_format, {}, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT });
+
+	// 剔除在计算着色器中写命令，在拷贝阶段清零计数
+	constexpr VkPipelineStageFlags2 cullStages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+	constexpr VkAccessFlags2 cullAccess = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	_graph_draw_cull_pass = _frame_graph.AddPass("DrawCull", [this](VkCommandBuffer command_buffer) {
+			uint32_t zone = _gpu_profiler.BeginZone(command_buffer, "DrawCull");
+			_draw_list.RecordCull(command_buffer, _frame_state.FrameIndex, _descriptor_sets[_frame_state.FrameIndex], true);
+			_gpu_profiler.EndZone(command_buffer, zone);
+		})
+		.Write(_graph_draw_commands, cullStages, cullAccess)
+		.GetHandle();
+	_graph_meshlet_cull_pass = _frame_graph.AddPass("MeshletCull", [this](VkCommandBuffer command_buffer) {
+			uint32_t zone = _gpu_profiler.BeginZone(command_buffer, "MeshletCull");
+			_meshlet_renderer.RecordCull(command_buffer, _frame_state.FrameIndex, _descriptor_sets[_frame_state.FrameIndex], true);
+			_gpu_profiler.EndZone(command_buffer, zone);
+		})
+		.Write(_graph_meshlet_commands, cullStages, cullAccess)
+		.GetHandle();
+
+	_graph_depth_prepass_pass = _frame_graph.AddPass("DepthPrepass", [this](VkCommandBuffer command_buffer) { _record_depth_prepass(command_buffer); })
+		.ReadIndirect(_graph_draw_commands, VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT)
+		.ReadIndirect(_graph_meshlet_commands)
+		.WriteDepth(_graph_depth)
+		.GetHandle();
+
+	VkPipelineStageFlags2 indirectShaderStages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT;
+	if (_mesh_shader_supported)
+		indirectShaderStages |= VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT;
+	// 有预通道时主通道只以 EQUAL 读取深度，仍声明为写：两种情况布局相同，不需要转换
+	_frame_graph.AddPass("MainPass", [this](VkCommandBuffer command_buffer) { _record_main_pass(command_buffer); })
+		.ReadIndirect(_graph_draw_commands, VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT)
+		.ReadIndirect(_graph_meshlet_commands, indirectShaderStages)
+		.WriteColor(_graph_backbuffer)
+		.WriteDepth(_graph_depth);
+
+	if (!_frame_graph.Compile())
+	{
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "failed to compile frame graph!");
+		return false;
+	}
+	return true;
+}
+
+void VulkanBase::_record_main_pass(VkCommandBuffer command_buffer)
+{
+	const auto& state = _frame_state;
+	uint32_t frame_index = state.FrameIndex;
+
+	// 有预通道时载入预通道写入的深度
+	VkRenderPassBeginInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = state.DepthPrepass ? _depth_load_render_pass : _render_pass;
+	renderPassInfo.framebuffer = _swap_chain_framebuffers[state.ImageIndex];
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = _swap_chain_extent;
+
+	std::array<VkClearValue, 2> clearValues{};
+	clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+	clearValues[1].depthStencil = { 1.0f, 0 };
+	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+	renderPassInfo.pClearValues = clearValues.data();
+
+	uint32_t mainPassZone = _gpu_profiler.BeginZone(command_buffer, "MainPass");
+
+	vkCmdBeginRenderPass(command_buffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	if (!state.SceneDraws)
+	{
+		VkPipeline pipeline = state.MeshShading ? _meshlet_mesh_pipeline : _position_only ? _position_only_pipeline : _graphics_pipeline;
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_PIPELINE_BINDS);
+	}
+
+	_set_viewport_scissor(command_buffer);
+	if (_dynamic_depth_state_supported)
+	{
+		// 预通道之后深度已是最终结果，只有可见的片元通过 EQUAL 测试，每个像素只着色一次
+		vkCmdSetDepthCompareOp(command_buffer, state.DepthPrepass ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS);
+		vkCmdSetDepthWriteEnable(command_buffer, state.DepthPrepass ? VK_FALSE : VK_TRUE);
+	}
+
+	if (state.MeshShading)
+	{
+		// 网格着色器从存储缓冲读取顶点与簇，不绑定顶点流
+		_meshlet_renderer.RecordDrawMeshTasks(command_buffer, frame_index, _descriptor_sets[frame_index], _draw_count);
+		FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_DESCRIPTOR_BINDS);
+	}
+	else if (state.SceneDraws)
+	{
+		vkCmdBindIndexBuffer(command_buffer, _index_buffer, 0, _index_type);
+
+		if (state.Instancing)
+		{
+			vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline_layout, 0, 1, &_descriptor_sets[frame_index], 0, nullptr);
+			FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_DESCRIPTOR_BINDS);
+
+			_record_instanced_draws(command_buffer, frame_index);
+		}
+		if (state.Indirect)
+			_record_indirect_draws(command_buffer, frame_index);
+	}
+	else
+	{
+		// 位置流在 binding 0，属性流在 binding 1；只画位置时不绑定属性流
+		VkBuffer vertexBuffers[] = { _position_buffer, _attribute_buffer };
+		VkDeviceSize offsets[] = { 0, 0 };
+		vkCmdBindVertexBuffers(command_buffer, 0, _position_only ? PositionOnlyStreams::BINDING_COUNT : SplitVertexStreams::BINDING_COUNT, vertexBuffers, offsets);
+
+		vkCmdBindIndexBuffer(command_buffer, _index_buffer, 0, _index_type);
+
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline_layout, 0, 1, &_descriptor_sets[frame_index], 0, nullptr);
+		FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_DESCRIPTOR_BINDS);
+
+		if (state.MeshletPath)
+		{
+			// 每个簇是索引缓冲中连续的一段，幸存的簇由剔除写成间接绘制命令
+			_meshlet_renderer.RecordDrawIndexed(command_buffer, frame_index, _draw_count);
+		}
+		else
+		{
+			//vkCmdDraw(command_buffer, 3, 1, 0, 0);
+			for (uint32_t i = 0; i < _draw_count; ++i)
+			{
+				vkCmdDrawIndexed(command_buffer, _index_count, 1, 0, 0, 0);
+			}
+		}
+	}
+	if (!state.SceneDraws)
+	{
+		FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_DRAW_CALLS, _draw_count);
+		FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_TRIANGLES, uint64_t(_index_count / 3) * _draw_count);
+	}
+	vkCmdEndRenderPass(command_buffer);
+
+	_gpu_profiler.EndZone(command_buffer, mainPassZone);
+}
+
+void VulkanBase::_record_depth_prepass(VkCommandBuffer command_buffer)
+{
+	const auto& state = _frame_state;
+	uint32_t frame_index = state.FrameIndex;
+
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = _render_pass;
-	renderPassInfo.framebuffer = _swap_chain_framebuffers[imageIndex];
+	renderPassInfo.renderPass = _depth_prepass_render_pass;
+	renderPassInfo.framebuffer = _depth_prepass_framebuffer;
 	renderPassInfo.renderArea.offset = { 0, 0 };
 	renderPassInfo.renderArea.extent = _swap_chain_extent;
 
-	VkClearValue clearColor = { {{0.0f, 0.0f, 0.0f, 1.0f}} };
+	VkClearValue clearDepth{};
+	clearDepth.depthStencil = { 1.0f, 0 };
 	renderPassInfo.clearValueCount = 1;
-	renderPassInfo.pClearValues = &clearColor;
+	renderPassInfo.pClearValues = &clearDepth;
+
+	uint32_t prepassZone = _gpu_profiler.BeginZone(command_buffer, "DepthPrepass");
+
+	vkCmdBeginRenderPass(command_buffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	_set_viewport_scissor(command_buffer);
+
+	// 与主通道画同样的几何，只绑定位置流
+	vkCmdBindIndexBuffer(command_buffer, _index_buffer, 0, _index_type);
+	if (state.SceneDraws)
+	{
+		if (state.Instancing)
+		{
+			vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline_layout, 0, 1, &_descriptor_sets[frame_index], 0, nullptr);
+			FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_DESCRIPTOR_BINDS);
 
-	vkCmdBeginRenderPass(_command_buffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-	vkCmdBindPipeline(_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _graphics_pipeline);
+			_record_instanced_draws(command_buffer, frame_index, true);
+		}
+		if (state.Indirect)
+			_record_indirect_draws(command_buffer, frame_index, true);
+	}
+	else
+	{
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _depth_prepass_pipeline);
+		FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_PIPELINE_BINDS);
+
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(command_buffer, 0, PositionOnlyStreams::BINDING_COUNT, &_position_buffer, &offset);
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline_layout, 0, 1, &_descriptor_sets[frame_index], 0, nullptr);
+		FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_DESCRIPTOR_BINDS);
 
+		if (state.MeshletPath)
+		{
+			_meshlet_renderer.RecordDrawIndexed(command_buffer, frame_index, _draw_count);
+		}
+		else
+		{
+			for (uint32_t i = 0; i < _draw_count; ++i)
+			{
+				vkCmdDrawIndexed(command_buffer, _index_count, 1, 0, 0, 0);
+			}
+		}
+		FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_DRAW_CALLS, _draw_count);
+		FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_TRIANGLES, uint64_t(_index_count / 3) * _draw_count);
+	}
+	vkCmdEndRenderPass(command_buffer);
+
+	_gpu_profiler.EndZone(command_buffer, prepassZone);
+}
+
+void VulkanBase::_set_viewport_scissor(VkCommandBuffer command_buffer)
+{
 	VkViewport viewport{};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
@@ -1494,33 +2438,160 @@ bool VulkanBase::_record_command_buffer(uint32_t imageIndex, uint32_t frame_inde
 	viewport.height = static_cast<float>(_swap_chain_extent.height);
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
-	vkCmdSetViewport(_command_buffer, 0, 1, &viewport);
+	vkCmdSetViewport(command_buffer, 0, 1, &viewport);
 
 	VkRect2D scissor{};
 	scissor.offset = { 0, 0 };
 	scissor.extent = _swap_chain_extent;
-	vkCmdSetScissor(_command_buffer, 0, 1, &scissor);
+	vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+}
 
-	// 
-	VkBuffer vertexBuffers[] = { _vertex_buffer };
-	VkDeviceSize offsets[] = { 0 };
-	vkCmdBindVertexBuffers(_command_buffer, 0, 1, vertexBuffers, offsets);
+bool VulkanBase::_prepare_instance_buffer(uint32_t frame_index)
+{
+	if (_instance_buffers.size() < MAX_FRAMES_IN_FLIGHT)
+		_instance_buffers.resize(MAX_FRAMES_IN_FLIGHT);
+
+	// 实例列表未变化时沿用该帧缓冲里的数据
+	auto& instanceBuffer = _instance_buffers[frame_index];
+	if (instanceBuffer.Version == _instance_batcher.GetVersion())
+		return true;
+
+	uint32_t count = _instance_batcher.GetInstanceCount();
+	if (count > instanceBuffer.Capacity)
+	{
+		// 该帧的上一次提交已完成（WaitForFence），可以直接替换
+		if (instanceBuffer.Mapped)
+			UseVmaUnmapBuffer(instanceBuffer.Buffer);
+		UseVmaDestroyBuffer(instanceBuffer.Buffer);
+		instanceBuffer = {};
+
+		uint32_t capacity = std::bit_ceil(std::max(count, 1024u));
+		if (!UseVmaCreateBuffer(VkDeviceSize(capacity) * sizeof(InstanceData),
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			instanceBuffer.Buffer)
+			|| !UseVmaMapBuffer(instanceBuffer.Buffer, &instanceBuffer.Mapped))
+		{
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "failed to create instance buffer for {} instances", count);
+			UseVmaDestroyBuffer(instanceBuffer.Buffer);
+			instanceBuffer = {};
+			return false;
+		}
+		instanceBuffer.Capacity = capacity;
+	}
 
-	vkCmdBindIndexBuffer(_command_buffer, _index_buffer, 0, VK_INDEX_TYPE_UINT16);
+	// 实例直接按批次顺序写入映射的缓冲
+	_instance_batcher.Build(static_cast<InstanceData*>(instanceBuffer.Mapped));
+	instanceBuffer.Version = _instance_batcher.GetVersion();
+	FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_BYTES_UPLOADED, uint64_t(count) * sizeof(InstanceData));
+	return true;
+}
 
-	vkCmdBindDescriptorSets(_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline_layout, 0, 1, &_descriptor_sets[frame_index], 0, nullptr);
+void VulkanBase::_record_instanced_draws(VkCommandBuffer command_buffer, uint32_t frame_index, bool depth_only)
+{
+	VkBuffer instanceBuffer = _instance_buffers[frame_index].Buffer;
+	uint32_t boundPipeline = DRAW_PIPELINE_COUNT;
+	uint64_t drawCalls = 0;
+	uint64_t triangles = 0;
+	for (auto& batch : _instance_batcher.GetBatches())
+	{
+		if (batch.Pipeline >= DRAW_PIPELINE_COUNT || !_instance_pipelines[batch.Pipeline])
+			continue;
+
+		// 深度预通道所有批次共用一条只读位置的管线
+		uint32_t pipelineKey = depth_only ? uint32_t(DRAW_PIPELINE_POSITION_ONLY) : batch.Pipeline;
+		if (pipelineKey != boundPipeline)
+		{
+			vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depth_only ? _depth_prepass_instance_pipeline : _instance_pipelines[batch.Pipeline]);
+			FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_PIPELINE_BINDS);
 
-	//vkCmdDraw(_command_buffer, 3, 1, 0, 0);
-	vkCmdDrawIndexed(_command_buffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
-	vkCmdEndRenderPass(_command_buffer);
+			// 实例流接在顶点流之后：只画位置时在 binding 1，否则在 binding 2
+			VkDeviceSize offsets[] = { 0, 0, 0 };
+			if (pipelineKey == DRAW_PIPELINE_POSITION_ONLY)
+			{
+				VkBuffer vertexBuffers[] = { _position_buffer, instanceBuffer };
+				vkCmdBindVertexBuffers(command_buffer, 0, InstancedPositionOnlyStreams::BINDING_COUNT, vertexBuffers, offsets);
+			}
+			else
+			{
+				VkBuffer vertexBuffers[] = { _position_buffer, _attribute_buffer, instanceBuffer };
+				vkCmdBindVertexBuffers(command_buffer, 0, InstancedSplitVertexStreams::BINDING_COUNT, vertexBuffers, offsets);
+			}
+			boundPipeline = pipelineKey;
+		}
 
-	if (VkResult result = vkEndCommandBuffer(_command_buffer))
+		vkCmdDrawIndexed(command_buffer, batch.Mesh.IndexCount, batch.InstanceCount, batch.Mesh.FirstIndex, batch.Mesh.VertexOffset, batch.FirstInstance);
+		++drawCalls;
+		triangles += uint64_t(batch.Mesh.IndexCount / 3) * batch.InstanceCount;
+	}
+	FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_DRAW_CALLS, drawCalls);
+	FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_TRIANGLES, triangles);
+}
+
+void VulkanBase::_on_texture_view_changed(TextureStreamer::TextureHandle texture, VkImageView view)
+{
+	if (!_bindless_heap.IsInitialized())
+		return;
+
+	if (texture >= _bindless_texture_indices.size())
+		_bindless_texture_indices.resize(size_t(texture) + 1, BindlessHeap::NULL_INDEX);
+	uint32_t& index = _bindless_texture_indices[texture];
+	if (!view)
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to record command buffer! Error code: {}\n", int32_t(result));
-		return false;
+		if (index != BindlessHeap::NULL_INDEX)
+			_bindless_heap.Remove(BindlessHeap::BINDING_TEXTURES, index);
+		index = BindlessHeap::NULL_INDEX;
+		return;
+	}
+	if (index == BindlessHeap::NULL_INDEX)
+	{
+		index = _bindless_heap.AddTexture(view);
+		if (index == BindlessHeap::INVALID_INDEX)
+			index = BindlessHeap::NULL_INDEX;
 	}
+	else
+		_bindless_heap.UpdateTexture(index, view);
+}
 
-	return true;
+uint32_t VulkanBase::GetBindlessTextureIndex(TextureStreamer::TextureHandle texture) const
+{
+	return texture < _bindless_texture_indices.size() ? _bindless_texture_indices[texture] : BindlessHeap::NULL_INDEX;
+}
+
+void VulkanBase::_record_indirect_draws(VkCommandBuffer command_buffer, uint32_t frame_index, bool depth_only)
+{
+	// 集 0 与实例化管线兼容，但集 1 只存在于间接绘制的管线布局中，需要重新绑定；无绑定资源堆随之绑定为集 2，桶之间不再切换
+	_draw_list.BindDescriptorSets(command_buffer, frame_index, _descriptor_sets[frame_index],
+		_bindless_heap.IsInitialized() ? _bindless_heap.GetDescriptorSet(frame_index) : VK_NULL_HANDLE);
+	FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_DESCRIPTOR_BINDS);
+
+	uint64_t drawCalls = 0;
+	uint64_t triangles = 0;
+	uint64_t draws = 0;
+	auto& buckets = _draw_list.GetBuckets();
+	for (uint32_t i = 0; i < buckets.size(); ++i)
+	{
+		auto& bucket = buckets[i];
+		if (bucket.Pipeline >= DRAW_PIPELINE_COUNT || !_indirect_pipelines[bucket.Pipeline])
+			continue;
+
+		// 每个桶只有一种管线，每次都要绑定；深度预通道都用只读位置的管线
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depth_only ? _depth_prepass_indirect_pipeline : _indirect_pipelines[bucket.Pipeline]);
+		FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_PIPELINE_BINDS);
+
+		VkBuffer vertexBuffers[] = { _position_buffer, _attribute_buffer };
+		VkDeviceSize offsets[] = { 0, 0 };
+		bool positionOnly = depth_only || bucket.Pipeline == DRAW_PIPELINE_POSITION_ONLY;
+		uint32_t bindingCount = positionOnly ? PositionOnlyStreams::BINDING_COUNT : SplitVertexStreams::BINDING_COUNT;
+		vkCmdBindVertexBuffers(command_buffer, 0, bindingCount, vertexBuffers, offsets);
+
+		drawCalls += _draw_list.RecordBucket(command_buffer, frame_index, i);
+		triangles += bucket.Triangles;
+		draws += bucket.DrawCount;
+	}
+	FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_DRAW_CALLS, drawCalls);
+	FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_TRIANGLES, triangles);
+	FrameProfiler::Get().AddCounter(FrameProfiler::COUNTER_INDIRECT_DRAWS, draws);
 }
 
 bool VulkanBase::_create_sync_objects()
@@ -1537,7 +2608,7 @@ bool VulkanBase::_create_sync_objects()
 	{
 		if (VkResult result = vkCreateFence(_device, &fenceInfo, nullptr, &_frame_fences[i]))
 		{
-			std::cout << std::format("ERROR : [ VulkanBase ] Failed to create fences! Error codes: {},\n", int32_t(result));
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create fences! Error codes: {},", int32_t(result));
 			return false;
 		}
 	}
@@ -1546,7 +2617,7 @@ bool VulkanBase::_create_sync_objects()
 	{
 		if (VkResult result = vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &_acquire_semaphores[i]))
 		{
-			std::cout << std::format("ERROR : [ VulkanBase ] Failed to create _acquire_semaphores! Error codes: {},\n", int32_t(result));
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create _acquire_semaphores! Error codes: {},", int32_t(result));
 			return false;
 		}
 	}
@@ -1555,7 +2626,7 @@ bool VulkanBase::_create_sync_objects()
 	{
 		if (VkResult result = vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &_submit_semaphores[i]))
 		{
-			std::cout << std::format("ERROR : [ VulkanBase ] Failed to create _submit_semaphores! Error codes: {},\n", int32_t(result));
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create _submit_semaphores! Error codes: {},", int32_t(result));
 			return false;
 		}
 	}
@@ -1565,7 +2636,7 @@ bool VulkanBase::_create_sync_objects()
 	VkResult fenceResult = vkCreateFence(_device, &fenceInfo, nullptr, &_in_flight_fence);
 	if (imgSemaphoreResult != VK_SUCCESS || renderSemaphoreResult != VK_SUCCESS || fenceResult != VK_SUCCESS)
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to create synchronization objects! Error codes: {}, {}, {}\n",
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to create synchronization objects! Error codes: {}, {}, {}",
 			int32_t(imgSemaphoreResult), int32_t(renderSemaphoreResult), int32_t(fenceResult));
 
 		return false;
@@ -1632,10 +2703,20 @@ VulkanBase::QueueFamilyIndices VulkanBase::_find_queue_families(VkPhysicalDevice
 			indices.HasGraphicsFamily = true;
 		}
 
+		// 无窗口模式没有 surface，呈现队列与图形队列相同
+		if (_headless)
+		{
+			indices.PresentFamily = indices.GraphicsFamily;
+			indices.HasPresentFamily = indices.HasGraphicsFamily;
+			if (indices.IsComplete()) break;
+			i++;
+			continue;
+		}
+
 		VkBool32 presentSupport = false;
 		if (VkResult result = vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &presentSupport))
 		{
-			std::cout << std::format(" ERROR : [ VulkanBase ] failed to get device surface! Error code: {}\n", int32_t(result));
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "failed to get device surface! Error code: {}", int32_t(result));
 		}
 
 		if (presentSupport)
@@ -1649,6 +2730,24 @@ VulkanBase::QueueFamilyIndices VulkanBase::_find_queue_families(VkPhysicalDevice
 		i++;
 	}
 
+	// 专用队列族：计算不含图形能力，传输只有传输能力；没有时退回图形队列族
+	indices.ComputeFamily = indices.GraphicsFamily;
+	indices.TransferFamily = indices.GraphicsFamily;
+	for (uint32_t family = 0; family < queueFamilyCount; ++family)
+	{
+		VkQueueFlags flags = queueFamilies[family].queueFlags;
+		if (!indices.HasDedicatedComputeFamily && (flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+		{
+			indices.ComputeFamily = family;
+			indices.HasDedicatedComputeFamily = true;
+		}
+		if (!indices.HasDedicatedTransferFamily && (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+		{
+			indices.TransferFamily = family;
+			indices.HasDedicatedTransferFamily = true;
+		}
+	}
+
 	return indices;
 }
 
@@ -1657,14 +2756,14 @@ VulkanBase::SwapChainSupportDetails VulkanBase::_query_swap_chain_support(VkPhys
 	SwapChainSupportDetails details;
 	if (VkResult result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, _surface, &details.Capabilities))
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to get physical device surface capabilities! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to get physical device surface capabilities! Error code: {}", int32_t(result));
 		return details;
 	}
 
 	uint32_t surfaceFormatCount;
 	if (VkResult result = vkGetPhysicalDeviceSurfaceFormatsKHR(device, _surface, &surfaceFormatCount, nullptr))
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to get the count of surface formats! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to get the count of surface formats! Error code: {}", int32_t(result));
 		return details;
 	}
 	if (surfaceFormatCount)
@@ -1672,20 +2771,20 @@ VulkanBase::SwapChainSupportDetails VulkanBase::_query_swap_chain_support(VkPhys
 		details.Formats.resize((size_t)surfaceFormatCount);
 		if (VkResult result = vkGetPhysicalDeviceSurfaceFormatsKHR(device, _surface, &surfaceFormatCount, details.Formats.data()))
 		{
-			std::cout << std::format("ERROR : [ VulkanBase ] Failed to get surface formats! Error code: {}\n", int32_t(result));
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to get surface formats! Error code: {}", int32_t(result));
 			details.Formats.clear();
 			return details;
 		}
 	}
 	else
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to find any supported surface format!\n");
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to find any supported surface format!");
 	}
 
 	uint32_t surfacePresentModeCount;
 	if (VkResult result = vkGetPhysicalDeviceSurfacePresentModesKHR(device, _surface, &surfacePresentModeCount, nullptr))
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to get the count of surface present modes! Error code: {}\n", int32_t(result));
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to get the count of surface present modes! Error code: {}", int32_t(result));
 		return details;
 	}
 	if (surfacePresentModeCount)
@@ -1693,14 +2792,14 @@ VulkanBase::SwapChainSupportDetails VulkanBase::_query_swap_chain_support(VkPhys
 		details.PresentModes.resize(surfacePresentModeCount);
 		if (VkResult result = vkGetPhysicalDeviceSurfacePresentModesKHR(device, _surface, &surfacePresentModeCount, details.PresentModes.data()))
 		{
-			std::cout << std::format("ERROR : [ VulkanBase ] Failed to get surface present modes!\nError code: {}\n", int32_t(result));
+			LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to get surface present modes! Error code: {}", int32_t(result));
 			details.PresentModes.clear();
 			return details;
 		}
 	}
 	else
 	{
-		std::cout << std::format("ERROR : [ VulkanBase ] Failed to find any surface present mode!\n");
+		LOG_ERROR(LOG_CATEGORY_VULKAN_BASE, "Failed to find any surface present mode!");
 	}
 
 	return details;
@@ -1,11 +1,27 @@
 ﻿#pragma once
 
 #include "VkShader.h"
+#include "GpuProfiler.h"
+#include "Defragmenter.h"
+#include "MeshletRenderer.h"
+#include "InstanceBatcher.h"
+#include "IndirectDrawList.h"
+#include "ComputeContext.h"
+#include "AsyncComputeScheduler.h"
+#include "RenderGraph.h"
+#include "TextureStreamer.h"
+#include "BindlessHeap.h"
+#include "DescriptorAllocator.h"
+#include "DescriptorWriter.h"
 
 #include <vulkan/vulkan.h>
 
+#include <array>
+#include <string>
 #include <vector>
 
+typedef struct VmaAllocator_T* VmaAllocator;
+
 //#ifndef UseDebugMessenger
 //#define UseDebugMessenger
 //#endif
@@ -17,13 +33,21 @@ public:
 
 	static void CreateVmaAllocator(VkInstance instance, VkDevice device, VkPhysicalDevice physical_device);
 	static void DestoryVmaAllocator();
+	static VmaAllocator GetVmaAllocator();
 
 	struct QueueFamilyIndices {
 		uint32_t GraphicsFamily = 0;
 		uint32_t PresentFamily = 0;
+		// 没有专用队列族时与 GraphicsFamily 相同
+		uint32_t ComputeFamily = 0;
+		uint32_t TransferFamily = 0;
 
 		bool HasGraphicsFamily = false;
 		bool HasPresentFamily = false;
+		// 不含图形能力的计算队列族（异步计算）
+		bool HasDedicatedComputeFamily = false;
+		// 只有传输能力的队列族（DMA 引擎，后台上传）
+		bool HasDedicatedTransferFamily = false;
 
 		bool IsComplete() const
 		{
@@ -41,9 +65,132 @@ public:
 	uint32_t GetVulkanVersion() const { return _api_version; }
 	VkInstance GetVkInstance() const { return _instance; }
 	VkDevice GetVkDevice() const { return _device; }
+	VkPhysicalDevice GetPhysicalDevice() const { return _physical_device; }
 	VkSurfaceKHR GetSurface() const { return _surface; }
 	void SetSurface(VkSurfaceKHR surface) { if (!_surface) _surface = surface; }
 	uint32_t GetSwapChainImageCount() const { return _swap_chain_image_count; }
+	const GpuProfiler& GetGpuProfiler() const { return _gpu_profiler; }
+	GpuProfiler& GetGpuProfiler() { return _gpu_profiler; }
+	Defragmenter& GetDefragmenter() { return _defragmenter; }
+	/// <summary>
+	/// 通用计算调度（在计算队列上，没有专用计算队列族时即图形队列），只能在渲染线程上录制与提交
+	/// </summary>
+	ComputeContext& GetCompute() { return _compute; }
+	/// <summary>
+	/// 每帧的计算通道提交到专用计算队列（有专用计算队列族时），图形提交等待其信号量
+	/// </summary>
+	AsyncComputeScheduler& GetAsyncCompute() { return _async_compute; }
+	/// <summary>
+	/// 纹理流式加载（解码在工作线程上，上传在传输队列上），每帧在围栏等待之后推进
+	/// </summary>
+	TextureStreamer& GetTextureStreamer() { return _texture_streamer; }
+	/// <summary>
+	/// 无绑定资源堆（需要 Vulkan 1.2 的描述符索引特性），间接绘制管线布局的集 2。不支持时 IsInitialized 为 false
+	/// </summary>
+	BindlessHeap& GetBindlessHeap() { return _bindless_heap; }
+	/// <summary>
+	/// 描述符集分配器：缓存集布局，常驻集与按帧重置的瞬时集（AllocateTransient 传入 RecordCommandBuffer 的帧序号）
+	/// </summary>
+	DescriptorAllocator& GetDescriptorAllocator() { return _descriptor_allocator; }
+	/// <summary>
+	/// 描述符写入：WriteBuffer / WriteImage 登记的写入在下一次 RecordCommandBuffer 开始时合成一次提交；
+	/// Update 按布局的更新模板从打包的结构体写入整个集
+	/// </summary>
+	DescriptorWriter& GetDescriptorWriter() { return _descriptor_writer; }
+	bool IsBindlessSupported() const { return _bindless_heap.IsInitialized(); }
+	/// <summary>
+	/// 纹理流式加载的纹理在无绑定资源堆里的下标（填入 DrawData::TextureIndex），第一次有图像视图时登记，之后换入 / 卸下 mip 时下标不变。
+	/// 还没有常驻 mip 或不支持无绑定时返回 BindlessHeap::NULL_INDEX
+	/// </summary>
+	uint32_t GetBindlessTextureIndex(TextureStreamer::TextureHandle texture) const;
+	/// <summary>
+	/// 每帧的渲染图（剔除、主通道），pass 之间的屏障与布局转换由它生成
+	/// </summary>
+	const RenderGraph& GetFrameGraph() const { return _frame_graph; }
+	const QueueFamilyIndices& GetQueueFamilyIndices() const { return _queue_family_indices; }
+	VkQueue GetGraphicsQueue() const { return _graphics_queue; }
+	VkQueue GetComputeQueue() const { return _compute_queue; }
+	VkQueue GetTransferQueue() const { return _transfer_queue; }
+	/// <summary>
+	/// 从 shader\vulkan\SPV\{shader_name}.slang.comp.spv 创建计算内核
+	/// </summary>
+	ComputeContext::KernelHandle CreateComputeKernel(const std::string& shader_name, uint32_t buffer_count, uint32_t push_constant_size = 0);
+	VkExtent2D GetSwapChainExtent() const { return _swap_chain_extent; }
+
+	/// <summary>
+	/// 无窗口模式（基准测试用）：不创建 surface 与交换链，渲染到 VMA 分配的离屏图像，Present 为空操作。
+	/// 必须在 InitVulkanInstance 之前调用
+	/// </summary>
+	void SetHeadless(uint32_t width, uint32_t height);
+	bool IsHeadless() const { return _headless; }
+	/// <summary>
+	/// 每帧重复绘制的次数（压力测试用），默认 1
+	/// </summary>
+	void SetDrawCount(uint32_t count) { _draw_count = count ? count : 1; }
+	/// <summary>
+	/// 销毁并重新创建图形管线（调用前需保证 GPU 空闲）
+	/// </summary>
+	bool RecreateGraphicsPipeline();
+	/// <summary>
+	/// 只绑定位置流、用只读位置的管线变体绘制（纯色），用于观察 / 测量位置流的带宽
+	/// </summary>
+	void SetPositionOnly(bool position_only) { _position_only = position_only; }
+	bool IsPositionOnly() const { return _position_only; }
+	/// <summary>
+	/// 加载烘焙好的 .vmesh 文件（见 MeshFormat.h）替换当前网格：映射文件后各段直接拷入 staging 缓冲上传。
+	/// 调用前需保证 GPU 空闲；文件无效时保留原网格，上传失败时退回内置网格
+	/// </summary>
+	bool LoadMesh(const std::string& path);
+	uint32_t GetIndexCount() const { return _index_count; }
+	/// <summary>
+	/// 网格簇渲染：每帧先在 GPU 上剔除簇，再用间接绘制画幸存的簇。只对带簇数据的 .vmesh 生效
+	/// </summary>
+	void SetMeshletRendering(bool meshlet_rendering) { _meshlet_rendering = meshlet_rendering; }
+	bool IsMeshletRendering() const { return _meshlet_rendering; }
+	/// <summary>
+	/// 网格簇渲染时改用网格着色器（VK_EXT_mesh_shader）绘制，设备不支持时忽略
+	/// </summary>
+	void SetMeshShading(bool mesh_shading) { _mesh_shading = mesh_shading; }
+	bool IsMeshShading() const { return _mesh_shading; }
+	bool IsMeshShaderSupported() const { return _mesh_shader_supported; }
+	bool IsSynchronization2Supported() const { return _synchronization2_supported; }
+	/// <summary>
+	/// 深度预通道：先用只读位置的管线只写深度，主通道再以 EQUAL 测试、不写深度绘制，每个像素只着色一次。
+	/// 主通道的深度比较与写入是动态状态，需要 Vulkan 1.3；不支持时忽略。网格着色器绘制时不做预通道
+	/// </summary>
+	void SetDepthPrepass(bool depth_prepass) { _depth_prepass = depth_prepass; }
+	bool IsDepthPrepass() const { return _depth_prepass; }
+	bool IsDepthPrepassSupported() const { return _dynamic_depth_state_supported; }
+	const MeshletRenderer& GetMeshletRenderer() const { return _meshlet_renderer; }
+
+	/// <summary>
+	/// 实例列表与间接绘制列表使用的管线：DRAW_PIPELINE_COLOR 读取全部顶点流，DRAW_PIPELINE_POSITION_ONLY 只读取位置流、输出实例 / 绘制颜色
+	/// </summary>
+	enum DrawPipeline : uint32_t
+	{
+		DRAW_PIPELINE_COLOR = 0,
+		DRAW_PIPELINE_POSITION_ONLY,
+
+		DRAW_PIPELINE_COUNT
+	};
+	/// <summary>
+	/// 实例列表非空时每帧绘制其中的实例（按网格 + 管线分组成实例化绘制），代替当前网格的单次绘制。
+	/// 列表在 Clear 之前一直保留，未修改时不会重新上传
+	/// </summary>
+	InstanceBatcher& GetInstanceBatcher() { return _instance_batcher; }
+	/// <summary>
+	/// 间接绘制列表非空时每帧按管线分桶、每桶一次多重间接绘制，与实例列表可同时使用。
+	/// 列表在 Clear 之前一直保留，未修改时不会重新上传
+	/// </summary>
+	IndirectDrawList& GetDrawList() { return _draw_list; }
+	/// <summary>
+	/// 当前网格在索引缓冲中的范围（用于提交实例）
+	/// </summary>
+	MeshRange GetMeshRange() const { return { 0, _index_count, 0 }; }
+	/// <summary>
+	/// 当前网格的包围球（网格空间，xyz 中心，w 半径），用于间接绘制列表的 GPU 剔除
+	/// </summary>
+	glm::vec4 GetMeshBounds() const { return _mesh_bounds; }
 
 	// create instance
 	bool InitVulkanInstance();
@@ -69,12 +216,23 @@ public:
 		VkBuffer& buffer,
 		VkDeviceMemory& buffer_memory);
 
+	/// <summary>
+	/// movable 为 true 时登记到碎片整理器，缓冲可能被搬运到新位置：buffer 引用的变量会被写入新句柄，必须在缓冲销毁前一直有效。
+	/// 只对设备本地的缓冲有效。
+	/// 有专用计算队列族时，存储 / uniform / 间接缓冲在图形与计算队列族之间以 CONCURRENT 方式共享
+	/// </summary>
 	bool UseVmaCreateBuffer(VkDeviceSize size,
 		VkBufferUsageFlags usage,
 		VkMemoryPropertyFlags properties,
-		VkBuffer& buffer);
+		VkBuffer& buffer,
+		bool movable = false);
 
 	void UseVmaDestroyBuffer(VkBuffer buffer);
+	bool UseVmaMapBuffer(VkBuffer buffer, void** data);
+	void UseVmaUnmapBuffer(VkBuffer buffer);
+
+	bool UseVmaCreateImage(const VkImageCreateInfo& image_info, VkImage& image);
+	void UseVmaDestroyImage(VkImage image);
 
 	bool CopyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size);
 
@@ -104,29 +262,52 @@ private:
 	// 检查验证层
 	bool _check_validation_layers();
 	bool _check_device_extension_support(VkPhysicalDevice device);
+	// 可选扩展：物理设备支持时才加入 deviceExtensions
+	bool _enable_optional_device_extension(const char* extensionName);
 
 	bool _pick_physical_device();
 	bool _create_logical_device();
 	bool _create_swap_chain();
+	// 无窗口模式下代替交换链
+	bool _create_offscreen_targets();
+	void _destroy_offscreen_targets();
 	bool _recreate_swap_chain();
 	bool _cleanup_swap_chain();
 	bool _create_image_views();
 	bool _create_render_pass();
+	VkFormat _find_depth_format();
 	// ubo
 	bool _create_descriptor_set_layout();
 	//
 	bool _create_graphics_pipeline();
-	//
-	bool _create_vertex_buffer();
+	// vertex_input 为 nullptr 时创建网格着色器管线（<shader_name>.slang.mesh.spv）；
+	// depth_only 时只有顶点着色器，用于深度预通道的 render pass
+	bool _create_pipeline_variant(const char* shader_name, const VkPipelineVertexInputStateCreateInfo* vertex_input, VkPipelineLayout layout, VkPipeline& pipeline,
+		bool depth_only = false);
+	// 经 staging 缓冲上传到设备本地（可移动）缓冲
+	bool _vma_create_device_local_buffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer);
 	bool _vma_create_vertex_buffer();
 	bool _vma_create_index_buffer();
 	bool _vma_create_uniform_buffers();
-	bool _create_descriptor_pool();
 	bool _create_descriptor_sets();
 	bool _create_framebuffers();
 	bool _create_command_pool();
+	// 无绑定资源堆归还的下标指向的 1x1 白色纹理与清零的存储缓冲
+	bool _create_bindless_fallback();
 	bool _create_command_buffer();
 	bool _record_command_buffer(uint32_t imageIndex, uint32_t frame_index);
+	// 声明每帧的渲染图并编译，交换链重建后重新声明
+	bool _build_frame_graph();
+	void _record_main_pass(VkCommandBuffer command_buffer);
+	void _record_depth_prepass(VkCommandBuffer command_buffer);
+	void _set_viewport_scissor(VkCommandBuffer command_buffer);
+	// 实例列表有变化时写入该帧的实例缓冲（不够大时重建）
+	bool _prepare_instance_buffer(uint32_t frame_index);
+	// depth_only 时所有批次 / 桶都用深度预通道的管线，只绑定位置流
+	void _record_instanced_draws(VkCommandBuffer command_buffer, uint32_t frame_index, bool depth_only = false);
+	void _record_indirect_draws(VkCommandBuffer command_buffer, uint32_t frame_index, bool depth_only = false);
+	// 纹理流式加载换了图像视图：登记到无绑定资源堆或更新下标对应的描述符，释放时归还下标
+	void _on_texture_view_changed(TextureStreamer::TextureHandle texture, VkImageView view);
 	bool _create_sync_objects();
 	VkSurfaceFormatKHR _choose_swap_surface_format(const std::vector<VkSurfaceFormatKHR>& available_formats);
 	/// <summary>
@@ -158,6 +339,8 @@ private:
 	VkPhysicalDevice _physical_device;
 	VkQueue _graphics_queue;
 	VkQueue _present_queue;
+	VkQueue _compute_queue;
+	VkQueue _transfer_queue;
 	VkSurfaceKHR _surface;
 	VkSwapchainKHR _swap_chain;
 	VkFormat _swap_chain_image_format;
@@ -166,14 +349,37 @@ private:
 	VkDescriptorSetLayout _descriptor_set_layout;
 	VkPipelineLayout _pipeline_layout;
 	VkRenderPass _render_pass;
+	// 与 _render_pass 兼容，深度附件载入预通道的结果而不是清除
+	VkRenderPass _depth_load_render_pass = VK_NULL_HANDLE;
+	// 只有深度附件
+	VkRenderPass _depth_prepass_render_pass = VK_NULL_HANDLE;
+	VkFramebuffer _depth_prepass_framebuffer = VK_NULL_HANDLE;
+	VkFormat _depth_format = VK_FORMAT_UNDEFINED;
 	VkPipeline _graphics_pipeline;
+	VkPipeline _position_only_pipeline = VK_NULL_HANDLE;
+	VkPipeline _meshlet_mesh_pipeline = VK_NULL_HANDLE;
+	std::array<VkPipeline, DRAW_PIPELINE_COUNT> _instance_pipelines{};
+	std::array<VkPipeline, DRAW_PIPELINE_COUNT> _indirect_pipelines{};
+	// 深度预通道：当前网格、实例列表、间接绘制列表各一条只写深度的管线
+	VkPipeline _depth_prepass_pipeline = VK_NULL_HANDLE;
+	VkPipeline _depth_prepass_instance_pipeline = VK_NULL_HANDLE;
+	VkPipeline _depth_prepass_indirect_pipeline = VK_NULL_HANDLE;
 	VkCommandPool _command_pool;
 	VkCommandBuffer _command_buffer;
-	VkBuffer _vertex_buffer;
-	VkDeviceMemory _vertex_buffer_memory;
+	// 顶点流：位置（binding 0）与其余属性（binding 1）
+	VkBuffer _position_buffer = VK_NULL_HANDLE;
+	VkBuffer _attribute_buffer = VK_NULL_HANDLE;
 	VkBuffer _index_buffer;
-
-	VkDescriptorPool _descriptor_pool;
+	VkIndexType _index_type = VK_INDEX_TYPE_UINT16;
+	uint32_t _index_count = 0;
+	glm::vec4 _mesh_bounds = glm::vec4(0.0f);
+	// 网格簇数据（.vmesh 带簇时）
+	VkBuffer _meshlet_buffer = VK_NULL_HANDLE;
+	VkBuffer _meshlet_vertex_buffer = VK_NULL_HANDLE;
+	VkBuffer _meshlet_triangle_buffer = VK_NULL_HANDLE;
+
+	DescriptorAllocator _descriptor_allocator;
+	DescriptorWriter _descriptor_writer;
 	std::vector<VkDescriptorSet> _descriptor_sets;
 	std::vector<VkBuffer> _uniform_buffers;
 	std::vector<void*> _uniform_buffers_mapped;
@@ -184,6 +390,65 @@ private:
 
 	QueueFamilyIndices _queue_family_indices;
 
+	GpuProfiler _gpu_profiler;
+	Defragmenter _defragmenter;
+	ComputeContext _compute;
+	AsyncComputeScheduler _async_compute;
+	TextureStreamer _texture_streamer;
+	BindlessHeap _bindless_heap;
+	VkImage _bindless_fallback_image = VK_NULL_HANDLE;
+	VkImageView _bindless_fallback_view = VK_NULL_HANDLE;
+	VkBuffer _bindless_fallback_buffer = VK_NULL_HANDLE;
+	// 按纹理句柄索引
+	std::vector<uint32_t> _bindless_texture_indices;
+	MeshletRenderer _meshlet_renderer;
+
+	// 每帧一个持久映射的实例缓冲
+	struct InstanceBuffer
+	{
+		VkBuffer Buffer = VK_NULL_HANDLE;
+		void* Mapped = nullptr;
+		uint32_t Capacity = 0;
+		uint64_t Version = UINT64_MAX;
+	};
+	InstanceBatcher _instance_batcher;
+	std::vector<InstanceBuffer> _instance_buffers;
+	IndirectDrawList _draw_list;
+
+	// 录制时本帧的状态，渲染图中的 pass 读取它
+	struct FrameRecordState
+	{
+		uint32_t ImageIndex = 0;
+		uint32_t FrameIndex = 0;
+		bool Instancing = false;
+		bool Indirect = false;
+		bool SceneDraws = false;
+		bool MeshletPath = false;
+		bool MeshShading = false;
+		bool DepthPrepass = false;
+	};
+	RenderGraph _frame_graph;
+	FrameRecordState _frame_state;
+	RenderGraph::ResourceHandle _graph_backbuffer = RenderGraph::INVALID_RESOURCE;
+	RenderGraph::ResourceHandle _graph_draw_commands = RenderGraph::INVALID_RESOURCE;
+	RenderGraph::ResourceHandle _graph_meshlet_commands = RenderGraph::INVALID_RESOURCE;
+	RenderGraph::ResourceHandle _graph_depth = RenderGraph::INVALID_RESOURCE;
+	RenderGraph::PassHandle _graph_draw_cull_pass = 0;
+	RenderGraph::PassHandle _graph_meshlet_cull_pass = 0;
+	RenderGraph::PassHandle _graph_depth_prepass_pass = 0;
+	bool _calibrated_timestamps_enabled = false;
+	bool _pipeline_statistics_supported = false;
+	bool _multi_draw_indirect_supported = false;
+	bool _draw_indirect_count_supported = false;
+	bool _mesh_shader_supported = false;
+	bool _synchronization2_supported = false;
+	// 无绑定资源堆需要的描述符索引特性（1.2）
+	bool _descriptor_indexing_supported = false;
+	// 描述符更新模板（1.1）
+	bool _descriptor_templates_supported = false;
+	// 深度比较与写入作为动态状态（1.3），深度预通道需要
+	bool _dynamic_depth_state_supported = false;
+
 	uint32_t _api_version;
 
 	uint32_t _swap_chain_image_count = 0;
@@ -193,5 +458,12 @@ private:
 
 	bool _framebuffer_resized = false;
 
+	bool _headless = false;
+	uint32_t _draw_count = 1;
+	bool _position_only = false;
+	bool _meshlet_rendering = false;
+	bool _mesh_shading = false;
+	bool _depth_prepass = false;
+
 };
 
@@ -9,9 +9,9 @@
 
 #include <iostream>
 #include <format>
-#include <sstream>
 
 #include <filesystem>
+#include <fstream>
 #include <cstdlib>
 #include <array>
 
@@ -30,11 +30,22 @@
 #endif // _WIN32
 
 #include "VulkanBase/ShaderCompiler.h"
+#include "VulkanBase/FrameProfiler.h"
+#include "VulkanBase/Tracer.h"
+#include "VulkanBase/Logger.h"
+#include "VulkanBase/MemoryTracker.h"
 
 GLFWwindow* glfw_window;
 GLFWmonitor* glfw_monitor;
 constexpr const char* title = "VKTest";
 
+void DumpFrameStats();
+void DumpTrace();
+void TogglePipelineStatistics();
+void DumpMemoryStats();
+void ToggleMeshletRendering(bool mesh_shading);
+void ToggleDrawMode(bool depth_prepass);
+
 bool InitializeWindow(VkExtent2D size, bool fullScreen = false, bool isResizable = true, bool limitFrameRate = true)
 {
     if (!glfwInit())
@@ -64,6 +75,26 @@ bool InitializeWindow(VkExtent2D size, bool fullScreen = false, bool isResizable
         VulkanBase::Base().FrameBufferResize(width, height);
         });
 
+    glfwSetKeyCallback(glfw_window, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
+        if (key == GLFW_KEY_F5 && action == GLFW_PRESS)
+            DumpFrameStats();
+        if (key == GLFW_KEY_F6 && action == GLFW_PRESS)
+            DumpTrace();
+        if (key == GLFW_KEY_F7 && action == GLFW_PRESS)
+            TogglePipelineStatistics();
+        if (key == GLFW_KEY_F8 && action == GLFW_PRESS)
+            DumpMemoryStats();
+        // F9 : 立即开始一次显存碎片整理
+        if (key == GLFW_KEY_F9 && action == GLFW_PRESS)
+            VulkanBase::Base().GetDefragmenter().Request();
+        // F10 : 只绑定位置流绘制；Shift + F10 : 开关深度预通道
+        if (key == GLFW_KEY_F10 && action == GLFW_PRESS)
+            ToggleDrawMode((mods & GLFW_MOD_SHIFT) != 0);
+        // F11 : 开关网格簇渲染（GPU 剔除 + 间接绘制）；Shift + F11 : 开关网格着色器
+        if (key == GLFW_KEY_F11 && action == GLFW_PRESS)
+            ToggleMeshletRendering((mods & GLFW_MOD_SHIFT) != 0);
+        });
+
     // 用glfwGetRequiredInstanceExtensions(...)获取平台所需的扩展，若执行成功，返回一个指针，指向一个由所需扩展的名称为元素的数组，
     // 失败则返回nullptr，并意味着此设备不支持Vulkan。
     uint32_t extensionCount = 0;
@@ -112,21 +143,110 @@ void TitleFps()
     static double time0 = glfwGetTime();
     static double time1;
     static double dt;
-    static int dframe = -1;
-    static std::stringstream info;
     time1 = glfwGetTime();
-    dframe++;
     if ((dt = time1 - time0) >= 1)
     {
-        info.precision(1);
-        info << title << "    " << std::fixed << dframe / dt << " FPS";
-        glfwSetWindowTitle(glfw_window, info.str().c_str());
-        info.str(""); //别忘了在设置完窗口标题后清空所用的stringstream
+        // 只显示平均帧率会掩盖卡顿，同时显示本窗口内的分位数与卡顿次数
+        auto summary = FrameProfiler::Get().TakeWindowSummary();
+        auto& profiler = FrameProfiler::Get();
+        auto info = std::format("{}    {:.1f} FPS    p50 {:.2f} ms  p99 {:.2f} ms  max {:.2f} ms  hitches {}    draws {}  tris {}",
+            title, summary.Count / dt, summary.P50Ms, summary.P99Ms, summary.MaxMs, summary.Hitches,
+            profiler.GetLastFrameCounter(FrameProfiler::COUNTER_DRAW_CALLS), profiler.GetLastFrameCounter(FrameProfiler::COUNTER_TRIANGLES));
+        glfwSetWindowTitle(glfw_window, info.c_str());
         time0 = time1;
-        dframe = 0;
     }
 }
 
+// F5 : 导出帧阶段统计
+void DumpFrameStats()
+{
+    auto path = std::filesystem::current_path().string();
+    FrameProfiler::Get().DumpCsv(path + "\\frame_stats.csv");
+    FrameProfiler::Get().DumpJson(path + "\\frame_stats.json");
+}
+
+// F6 : 导出 Chrome trace（chrome://tracing 或 ui.perfetto.dev 打开）
+void DumpTrace()
+{
+    auto path = std::filesystem::current_path().string();
+    Tracer::Get().ExportChromeJson(path + "\\trace.json");
+}
+
+// F7 : 开关 GPU 管线统计（结果随 F5 导出）
+void TogglePipelineStatistics()
+{
+    auto& gpuProfiler = VulkanBase::Base().GetGpuProfiler();
+    if (!gpuProfiler.IsPipelineStatisticsSupported())
+    {
+        std::cout << std::format("WARNING : pipeline statistics queries are not supported on this device\n");
+        return;
+    }
+    gpuProfiler.SetPipelineStatisticsEnabled(!gpuProfiler.IsPipelineStatisticsEnabled());
+    std::cout << std::format("INFO : pipeline statistics : {}\n", gpuProfiler.IsPipelineStatisticsEnabled() ? "on" : "off");
+}
+
+// F8 : 导出显存统计（引擎分类汇总 + VMA 详细 JSON）
+void DumpMemoryStats()
+{
+    auto path = std::filesystem::current_path().string();
+    auto& tracker = MemoryTracker::Get();
+    std::ofstream file(path + "\\memory_stats.json", std::ios::trunc);
+    if (file.is_open())
+        file << tracker.ToJson();
+    else
+        LOG_ERROR(LOG_CATEGORY_PROFILER, "failed to open file : {}", path + "\\memory_stats.json");
+    tracker.DumpVmaStats(path + "\\vma_stats.json");
+
+    for (uint32_t c = 0; c < MemoryTracker::CATEGORY_COUNT; ++c)
+    {
+        auto category = MemoryTracker::Category(c);
+        LOG_INFO(LOG_CATEGORY_PROFILER, "memory {:<14} {:.2f} MB", MemoryTracker::CategoryName(category), tracker.GetCategoryBytes(category) / (1024.0 * 1024.0));
+    }
+}
+
+// F11 : 网格簇渲染需要带簇数据的 .vmesh（VulkanEngineCooker mesh 生成）
+void ToggleMeshletRendering(bool mesh_shading)
+{
+    auto& base = VulkanBase::Base();
+    if (!base.GetMeshletRenderer().HasMesh())
+    {
+        LOG_WARNING(LOG_CATEGORY_GENERAL, "current mesh has no meshlets");
+        return;
+    }
+    if (mesh_shading)
+    {
+        if (!base.IsMeshShaderSupported())
+        {
+            LOG_WARNING(LOG_CATEGORY_GENERAL, "VK_EXT_mesh_shader is not supported on this device");
+            return;
+        }
+        base.SetMeshShading(!base.IsMeshShading());
+    }
+    else
+    {
+        base.SetMeshletRendering(!base.IsMeshletRendering());
+    }
+    LOG_INFO(LOG_CATEGORY_GENERAL, "meshlet rendering : {}, mesh shader : {}",
+        base.IsMeshletRendering() ? "on" : "off", base.IsMeshShading() ? "on" : "off");
+}
+
+void ToggleDrawMode(bool depth_prepass)
+{
+    auto& base = VulkanBase::Base();
+    if (!depth_prepass)
+    {
+        base.SetPositionOnly(!base.IsPositionOnly());
+        return;
+    }
+    if (!base.IsDepthPrepassSupported())
+    {
+        LOG_WARNING(LOG_CATEGORY_GENERAL, "depth prepass needs Vulkan 1.3");
+        return;
+    }
+    base.SetDepthPrepass(!base.IsDepthPrepass());
+    LOG_INFO(LOG_CATEGORY_GENERAL, "depth prepass : {}", base.IsDepthPrepass() ? "on" : "off");
+}
+
 //#ifdef _WIN32
 //void executeAndPrint(const char* command)
 //{
@@ -149,7 +269,8 @@ void TitleFps()
 
 
 
-int main()
+// 用法 : VulkanEngineTest.exe [mesh.vmesh]    不指定时绘制内置的四边形
+int main(int argc, char** argv)
 {
 //    std::string path;
 //    try
@@ -167,11 +288,24 @@ int main()
 //    std::cout << "................................................\n";
 //#endif // _WIN32
 
+    Tracer::Get().SetThreadName("Main");
+
     //////////////////////////
     if (1)
     {
         std::vector<std::string> shaderPaths = {
-        ".\\shader\\vulkan\\Slang\\fristTriangle.slang"
+        ".\\shader\\vulkan\\Slang\\fristTriangle.slang",
+        ".\\shader\\vulkan\\Slang\\positionOnly.slang",
+        ".\\shader\\vulkan\\Slang\\meshletCull.slang",
+        ".\\shader\\vulkan\\Slang\\meshletMesh.slang",
+        ".\\shader\\vulkan\\Slang\\instanced.slang",
+        ".\\shader\\vulkan\\Slang\\instancedPositionOnly.slang",
+        ".\\shader\\vulkan\\Slang\\indirect.slang",
+        ".\\shader\\vulkan\\Slang\\indirectPositionOnly.slang",
+        ".\\shader\\vulkan\\Slang\\indirectBindless.slang",
+        ".\\shader\\vulkan\\Slang\\drawCull.slang",
+        ".\\shader\\vulkan\\Slang\\mipDownsample.slang",
+        ".\\shader\\vulkan\\Slang\\test.slang"
         };
 
         ShaderCompiler::CompilerShaders(shaderPaths, ".\\shader\\vulkan\\SPV", ".\\shader\\vulkan\\GLSL");
@@ -184,12 +318,18 @@ int main()
     if (!InitializeWindow({ 1280, 720 }))
         return -1; 
 
+    // 由 VulkanEngineCooker mesh 烘焙的网格
+    if (argc > 1)
+        VulkanBase::Base().LoadMesh(argv[1]);
+
 	uint32_t frameIndex = 0;
 
     VkClearValue clearColor = { .color = { 1.f, 0.f, 0.f, 1.f } };
 
     while (!glfwWindowShouldClose(glfw_window))
     {
+        TRACE_ZONE("Frame");
+
         while (glfwGetWindowAttrib(glfw_window, GLFW_ICONIFIED))
             glfwWaitEvents();
 
@@ -216,13 +356,18 @@ int main()
 		VulkanBase::Base().Present(frameIndex);
 		//VulkanBase::Base().DrawFrame();
 
-        glfwPollEvents();
+        {
+            FrameProfiler::ScopedPhase phase(FrameProfiler::PHASE_POLL_EVENTS);
+            glfwPollEvents();
+        }
+        FrameProfiler::Get().EndFrame();
         TitleFps();
 
     }
 	VulkanBase::Base().WaitIdle();
     VulkanBase::Base().CleanUp();
     TerminateWindow();
+    Logger::Get().Shutdown();
     return 0;
 }
 